@@ -0,0 +1,74 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include "ShaderProgram.h"
+
+/**
+ * @brief SSAO quality presets, from cheapest to best. Every preset works at half resolution; they
+ * differ in the number of samples per pixel and the radius that is searched.
+ */
+enum class AmbientOcclusionQuality {
+	Off,
+	Low,
+	Medium,
+	High
+};
+
+/**
+ * @brief Screen-space ambient occlusion of the bound framebuffer's scene, computed at half
+ * resolution and multiplied into the scene's color.
+ *
+ * apply() copies the scene's depth, reconstructs a half-resolution buffer of view-space normals and
+ * depths from it, and estimates occlusion from it (ssao.frag). Optionally, each frame's occlusion
+ * is blended into a reprojected history, which lets the low presets rotate their few samples every
+ * frame and converge to a smooth result. A bilateral upsample weights the nearest half-resolution
+ * texels by depth similarity, so occlusion stays on its side of depth edges.
+ */
+class AmbientOcclusion {
+private:
+	AmbientOcclusionQuality m_quality;
+	bool m_temporal;
+	uint32_t m_width;
+	uint32_t m_height;
+
+	// A full-resolution copy of the scene's depth.
+	uint32_t m_depthTexture;
+	uint32_t m_depthFramebuffer;
+	// Half resolution: RGBA32F view-space normal and depth, R8 occlusion, and the RG32F history
+	// of occlusion and depth, ping-ponged between frames.
+	uint32_t m_normalDepthTexture;
+	uint32_t m_normalDepthFramebuffer;
+	uint32_t m_occlusionTexture;
+	uint32_t m_occlusionFramebuffer;
+	uint32_t m_historyTextures[2];
+	uint32_t m_historyFramebuffers[2];
+	uint32_t m_historyIndex;
+	bool m_historyValid;
+
+	ShaderProgram m_prepareProgram;
+	ShaderProgram m_occlusionProgram;
+	ShaderProgram m_temporalProgram;
+	ShaderProgram m_upsampleProgram;
+
+	int32_t m_frameIndex;
+	glm::mat4 m_previousView;
+	glm::mat4 m_previousProjection;
+
+	void resize(uint32_t width, uint32_t height);
+
+public:
+	AmbientOcclusion();
+
+	void setQuality(AmbientOcclusionQuality quality);
+	AmbientOcclusionQuality quality() const { return m_quality; }
+	void setTemporal(bool temporal);
+	bool temporal() const { return m_temporal; }
+
+	/**
+	 * @brief Darkens the bound framebuffer's color by the occlusion of its depth buffer. Does
+	 * nothing if the quality is Off.
+	 * @param view the view matrix the scene was drawn with.
+	 * @param projection the projection the scene was drawn with.
+	 */
+	void apply(const glm::mat4& view, const glm::mat4& projection, uint32_t width, uint32_t height);
+};
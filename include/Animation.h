@@ -50,6 +50,14 @@ public:
 		applyAnimation(dt);
 	}
 
+	/**
+	 * @brief Continues the animation from the given time without starting it again, when its
+	 * object already has the state it had at that time.
+	 */
+	void resume(float currentTime) {
+		m_currentTime = currentTime;
+	}
+
 	/**
 	 * @brief Starts the animation.
 	 */
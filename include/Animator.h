@@ -3,6 +3,17 @@
 #include "Animation.h"
 #include "RotationAnimation.h"
 
+/**
+ * @brief How far an Animator has progressed through its sequence, for saving and restoring it.
+ */
+struct AnimatorState {
+	float currentTime;
+	float nextTransition;
+	int32_t currentIndex;
+	// The elapsed time of the current animation.
+	float animationTime;
+};
+
 class Animator {
 private:
 	/**
@@ -59,4 +70,12 @@ public:
 	 */
 	void tick(float dt);
 
+	AnimatorState state() const;
+
+	/**
+	 * @brief Returns a started Animator to a state saved from one with the same sequence of
+	 * animations. The animated objects must already be where they were when it was saved.
+	 */
+	void restore(const AnimatorState& state);
+
 };
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "MeshDraw.h"
+#include "ShaderProgram.h"
+
+class Mesh3D;
+
+/**
+ * @brief Post-process anti-aliasing, as cheaper alternatives to a multisampled window.
+ */
+enum class AntiAliasingMode {
+	// The scene is drawn straight into the window, with whatever multisampling it has.
+	Off,
+	// Fast approximate anti-aliasing (Lottes 2009): one pass that blurs along detected edges.
+	Fxaa,
+	// Temporal anti-aliasing: the projection is jittered every frame, and each pixel is blended
+	// with its reprojected history, clamped to the current frame's neighborhood.
+	Taa
+};
+
+/**
+ * @brief Renders the scene into an offscreen target, then resolves it into the window with FXAA
+ * or TAA.
+ *
+ * For TAA, a motion vector pass after the scene writes each pixel's screen-space motion since the
+ * previous frame, from every draw's current and previous model matrices and the current and
+ * previous view-projection. Pixels without a draw, such as impostors, fall back to reprojecting
+ * their depth with the camera's motion.
+ */
+class AntiAliasing {
+private:
+	AntiAliasingMode m_mode;
+	uint32_t m_width;
+	uint32_t m_height;
+
+	// The scene target: RGBA8 color, RG16F motion vectors and depth.
+	uint32_t m_colorTexture;
+	uint32_t m_motionTexture;
+	uint32_t m_depthTexture;
+	uint32_t m_sceneFramebuffer;
+	// TAA's accumulated image, ping-ponged between frames.
+	uint32_t m_historyTextures[2];
+	uint32_t m_historyFramebuffers[2];
+	uint32_t m_historyIndex;
+	bool m_historyValid;
+
+	ShaderProgram m_fxaaProgram;
+	ShaderProgram m_motionProgram;
+	ShaderProgram m_resolveProgram;
+	ShaderProgram m_compositeProgram;
+
+	// The jitter sample of this frame, and the matrices and model transforms of the last frame.
+	uint32_t m_frameIndex;
+	glm::vec2 m_jitter;
+	glm::mat4 m_previousViewProjection;
+	std::unordered_map<const Mesh3D*, glm::mat4> m_previousModels;
+	std::unordered_map<const Mesh3D*, glm::mat4> m_currentModels;
+
+	void resize(uint32_t width, uint32_t height);
+	void renderMotionVectors(const std::vector<const std::vector<MeshDraw>*>& drawLists,
+		const glm::mat4& viewProjection, const glm::mat4& jitteredViewProjection);
+
+public:
+	AntiAliasing();
+
+	void setMode(AntiAliasingMode mode);
+	AntiAliasingMode mode() const { return m_mode; }
+
+	/**
+	 * @brief Offsets the projection by this frame's subpixel jitter in TAA mode, and returns it
+	 * unchanged otherwise. Render the scene with the result, and pass the original to resolve().
+	 */
+	glm::mat4 jitter(const glm::mat4& projection) const;
+
+	/**
+	 * @brief Binds the offscreen scene target, unless anti-aliasing is off. Call before clearing
+	 * and drawing the scene, which then uses the bound framebuffer instead of the window.
+	 */
+	void begin(uint32_t width, uint32_t height);
+
+	/**
+	 * @brief Resolves the scene target into the window, with depth, and advances the jitter.
+	 * @param drawLists the draws of the frame, whose motion TAA tracks.
+	 * @param view the frame's view matrix.
+	 * @param projection the frame's projection, without jitter.
+	 */
+	void resolve(const std::vector<const std::vector<MeshDraw>*>& drawLists, const glm::mat4& view,
+		const glm::mat4& projection);
+};
@@ -0,0 +1,245 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "AssimpImport.h"
+#include "GpuUploader.h"
+#include "Object3D.h"
+#include "StbImage.h"
+
+class TextureStreamer;
+
+/**
+ * @brief Counters of an AssetReloader, since it was created.
+ */
+struct AssetReloadStats {
+	uint32_t watchedModels = 0;
+	uint32_t watchedFiles = 0;
+	uint64_t modelsReloaded = 0;
+	// Models whose hierarchy changed, and so were rebuilt rather than updated mesh by mesh.
+	uint64_t modelsRebuilt = 0;
+	uint64_t meshesUploaded = 0;
+	uint64_t meshesUnchanged = 0;
+	uint64_t texturesReloaded = 0;
+	// Imports and decodes that threw, usually because a file was read while being written.
+	uint64_t failures = 0;
+	// Changed meshes and images, and new textures, waiting for the upload thread.
+	uint32_t stagedUploads = 0;
+	float lastApplyMilliseconds = 0;
+};
+
+/**
+ * @brief Loads models and watches their files, so that edits to them show up without a restart.
+ *
+ * A watcher thread polls the modification times of every model file, its binary buffers and its
+ * textures. A changed image is decoded, and a changed model re-imported, on worker threads; the
+ * results are swapped in by applyPending(), called between frames on the thread that owns the GL
+ * context. Textures are re-uploaded into their existing texture objects, and a model whose node
+ * hierarchy is unchanged is updated in place: only meshes whose geometry changed are re-uploaded,
+ * into their existing buffers. A model whose hierarchy changed is rebuilt inside its existing
+ * Object3D. Either way the objects keep their transforms, so handles and animators stay valid.
+ */
+class AssetReloader {
+private:
+	struct WatchedModel {
+		std::string path;
+		bool flipTextureCoords;
+		ImportProfile profile;
+		TextureStreamer* streamer;
+		// Every texture of the model by path; the textures' IDs never change.
+		std::unordered_map<std::string, Texture> textures;
+		// The children the import created, ahead of any added to the root afterwards.
+		size_t importedChildren;
+		// A hash of the geometry of every mesh, in depth-first order, to tell which meshes a reload
+		// changed without reading them back from VRAM.
+		std::vector<uint64_t> meshHashes;
+		// Counts the rebuilds of the model, which make staged meshes of earlier imports obsolete.
+		uint32_t generation;
+	};
+
+	/**
+	 * @brief What the import threads work out about each mesh, so the render thread doesn't have to.
+	 */
+	struct MeshSummary {
+		uint64_t geometryHash;
+		glm::vec3 boundsCenter;
+		float boundsRadius;
+	};
+
+	enum class JobKind {
+		Model,
+		Image
+	};
+
+	struct Job {
+		JobKind kind;
+		std::string path;
+		bool flipTextureCoords;
+		ImportProfile profile;
+		// For models, the images they already have, which the import doesn't decode again.
+		std::unordered_set<std::string> knownImages;
+	};
+
+	struct Result {
+		JobKind kind;
+		std::string path;
+		std::unique_ptr<ImportedModel> model;
+		// The model's meshes in depth-first order.
+		std::vector<MeshSummary> meshes;
+		std::unique_ptr<StbImage> image;
+	};
+
+	/**
+	 * @brief A changed mesh whose new geometry is being uploaded into buffers of its own, to be
+	 * copied into the mesh's buffers once both are ready.
+	 */
+	struct StagedMesh {
+		size_t meshIndex;
+		GpuUploader::Ticket vertexTicket;
+		GpuUploader::Ticket faceTicket;
+		uint32_t vertexCount;
+		uint32_t faceCount;
+		glm::vec3 boundsCenter;
+		float boundsRadius;
+		std::vector<Meshlet> meshlets;
+		// Zero until taken from the uploader.
+		uint32_t vertexBuffer;
+		uint32_t faceBuffer;
+	};
+
+	/**
+	 * @brief The staged meshes of one reload of a model, applied together so the model never shows
+	 * a mix of two imports.
+	 */
+	struct StagedModel {
+		std::string path;
+		uint32_t generation;
+		std::vector<StagedMesh> meshes;
+	};
+
+	struct StagedTexture {
+		std::string path;
+		GpuUploader::Ticket ticket;
+		// Zero until taken from the uploader.
+		uint32_t textureId;
+	};
+
+	/**
+	 * @brief A reloaded model that uses images its earlier imports didn't, waiting for the upload
+	 * thread to create their textures. Later reloads of the model wait behind it, with or without
+	 * textures of their own, so that they are applied in order.
+	 */
+	struct StagedTextures {
+		Result result;
+		std::vector<StagedTexture> textures;
+	};
+
+	struct StagedImage {
+		std::string path;
+		int width;
+		int height;
+		GpuUploader::Ticket ticket;
+	};
+
+	struct WatchedFile {
+		std::filesystem::file_time_type lastWrite;
+		JobKind kind;
+		// The model a buffer file belongs to; image jobs are applied to every model that uses them.
+		std::string target;
+		bool flipTextureCoords;
+		ImportProfile profile;
+	};
+
+	std::vector<WatchedModel> m_models;
+	AssetReloadStats m_stats;
+	GpuUploader* m_uploader;
+	std::deque<StagedModel> m_stagedModels;
+	std::deque<StagedTextures> m_stagedTextures;
+	std::deque<StagedImage> m_stagedImages;
+
+	// Guards everything below.
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::unordered_map<std::string, WatchedFile> m_files;
+	std::unordered_map<std::string, std::unordered_set<std::string>> m_modelImages;
+	std::unordered_set<std::string> m_queuedTargets;
+	std::deque<Job> m_jobs;
+	std::deque<Result> m_results;
+	bool m_stopping;
+	std::thread m_watcher;
+	std::vector<std::thread> m_workers;
+
+	void watch();
+	void work();
+	void watchFile(const std::filesystem::path& path, JobKind kind, const WatchedModel& model);
+	void watchModelFiles(const WatchedModel& model);
+
+	static void summarizeMeshes(const ImportedNode& node, std::vector<MeshSummary>& meshes);
+	bool canStage() const;
+	void applyImage(const std::string& path, std::shared_ptr<const StbImage> image);
+	bool applyModel(WatchedModel& model, Result& result, std::vector<Object3D>& objects);
+	void uploadNewTextures(WatchedModel& model, ImportedModel& imported);
+	bool stageNewTextures(WatchedModel& model, Result& result);
+	void updateNode(WatchedModel& model, Object3D& object, ImportedNode& node, const std::vector<MeshSummary>& meshes,
+		size_t& meshIndex, StagedModel& staged);
+	uint32_t applyStaged(std::vector<Object3D>& objects);
+
+public:
+	/**
+	 * @brief How often the watcher thread checks the files for changes.
+	 */
+	static constexpr std::chrono::milliseconds POLL_INTERVAL{ 500 };
+
+	/**
+	 * @brief Starts the watcher and the given number of import threads. If an uploader is given,
+	 * changed meshes and images, and the textures of images that models didn't use before, are
+	 * uploaded by its thread, and swapped in by a later applyPending once they are ready. Rebuilt
+	 * models' meshes, and new textures of models loaded with a streamer, are still uploaded by
+	 * applyPending itself.
+	 */
+	AssetReloader(uint32_t workerThreads = 2, GpuUploader* uploader = nullptr);
+	~AssetReloader();
+	AssetReloader(const AssetReloader&) = delete;
+	AssetReloader& operator=(const AssetReloader&) = delete;
+
+	/**
+	 * @brief Loads a model like assimpLoad and watches its files; reloads use the same profile. The
+	 * returned object is named after the path, which is how applyPending finds it again, so it must
+	 * keep that name.
+	 */
+	Object3D load(const std::string& path, bool flipTextureCoords, TextureStreamer* streamer = nullptr,
+		ImportProfile profile = ImportProfile::Max);
+
+	/**
+	 * @brief Watches a model that was loaded without importing it, such as one restored from a
+	 * scene snapshot, as if load() had loaded it: the object must be named after the model's path
+	 * and hold only the children the import made. texturePaths gives the image of each of its
+	 * textures by ID. The geometry of its meshes is unknown, so the first reload uploads all of them.
+	 */
+	void watchLoaded(const Object3D& object, bool flipTextureCoords, TextureStreamer* streamer,
+		ImportProfile profile, const std::unordered_map<uint32_t, std::string>& texturePaths);
+
+	/**
+	 * @brief The image of every texture of the watched models, by texture ID.
+	 */
+	std::unordered_map<uint32_t, std::string> texturePaths() const;
+
+	/**
+	 * @brief Swaps in every reload finished since the last call, updating the objects loaded by
+	 * load() wherever they are in the given list. Must be called on the GL thread, between frames.
+	 * Returns the number of models whose meshes changed, whose draws must be gathered again;
+	 * texture changes don't count, since they keep their IDs.
+	 */
+	uint32_t applyPending(std::vector<Object3D>& objects);
+
+	AssetReloadStats stats();
+};
@@ -1,11 +1,132 @@
 #pragma once
 #include "Object3D.h"
-#include <assimp/scene.h>
+#include "StbImage.h"
 #include <unordered_map>
+#include <unordered_set>
 #include <filesystem>
 #include <string>
 
-Object3D assimpLoad(const std::string& path, bool flipUVCoords);
-Object3D processAssimpNode(aiNode* node, const aiScene* scene,
-	const std::filesystem::path& modelPath,
-	std::unordered_map<std::string, Texture>& loadedTextures);
\ No newline at end of file
+class TextureStreamer;
+
+/**
+ * @brief Which of Assimp's post-process steps an import runs, from the fewest the loader needs to
+ * the full realtime max-quality preset.
+ */
+enum class ImportProfile {
+	// Triangulation, normals where missing, and splitting meshes by primitive type. The loader then
+	// welds exactly equal vertices itself.
+	Fast,
+	// Fast, plus welding identical vertices, ordering triangles for the vertex cache, and cleaning
+	// up degenerate and invalid data. The loader then welds vertices whose attributes differ by less
+	// than a small tolerance, as does it for Max.
+	Balanced,
+	// aiProcessPreset_TargetRealtime_MaxQuality, which also validates the scene, finds instances,
+	// merges meshes and computes tangents.
+	Max
+};
+
+const char* importProfileName(ImportProfile profile);
+
+/**
+ * @brief Parses "fast", "balanced" or "max". Returns false for anything else.
+ */
+bool parseImportProfile(const std::string& name, ImportProfile& profile);
+
+/**
+ * @brief Assimp's post-process flags for a profile.
+ */
+unsigned int importProfileFlags(ImportProfile profile);
+
+struct ImportStepTime {
+	// The name Assimp logs for the step, such as "JoinVerticesProcess".
+	std::string name;
+	double milliseconds;
+};
+
+/**
+ * @brief Where the time of an import went.
+ */
+struct ImportTiming {
+	// Reading and parsing the file, before any post-process step.
+	double readMilliseconds = 0;
+	// Every post-process step that ran, in order.
+	std::vector<ImportStepTime> steps;
+	double postProcessMilliseconds = 0;
+	// Building vertices, faces and meshlets, and decoding images.
+	double convertMilliseconds = 0;
+	double totalMilliseconds = 0;
+	// Welding the vertices of every mesh, which is part of converting them.
+	double weldMilliseconds = 0;
+	size_t verticesBeforeWeld = 0;
+	size_t verticesAfterWeld = 0;
+};
+
+/**
+ * @brief A texture a mesh refers to: the image file, and the sampler it is bound to.
+ */
+struct ImportedTexture {
+	std::string path;
+	std::string samplerName;
+};
+
+/**
+ * @brief A mesh read from a model file, before anything is uploaded to the GPU.
+ */
+struct ImportedMesh {
+	std::vector<Vertex3D> vertices;
+	std::vector<uint32_t> faces;
+	std::vector<Meshlet> meshlets;
+	std::vector<ImportedTexture> textures;
+	AlphaMode alphaMode;
+	float alphaCutoff;
+	float opacity;
+};
+
+struct ImportedNode {
+	glm::mat4 baseTransform;
+	std::vector<ImportedMesh> meshes;
+	std::vector<ImportedNode> children;
+};
+
+/**
+ * @brief A model read from a file, with the decoded images of the textures it uses.
+ */
+struct ImportedModel {
+	ImportedNode root;
+	std::unordered_map<std::string, StbImage> images;
+};
+
+/**
+ * @brief Reads a model and decodes its textures, except for the images in skipImages, without
+ * touching OpenGL, so that it can run on any thread. Throws if the file can't be imported.
+ * Duplicate vertices are welded, and each mesh's vertex count before and after is logged, unless
+ * timing is given, which receives the totals instead.
+ *
+ * If timing is given, the time of every post-process step is measured through Assimp's progress
+ * handler and the begin messages the steps log. Assimp's logger is global, so timed imports run
+ * one at a time, and leave a logger behind at debugging severity.
+ */
+ImportedModel assimpImport(const std::string& path, bool flipUVCoords,
+	const std::unordered_set<std::string>& skipImages = {}, ImportProfile profile = ImportProfile::Max,
+	ImportTiming* timing = nullptr);
+
+/**
+ * @brief Uploads an imported model and builds its objects. Textures already in loadedTextures are
+ * shared rather than uploaded again; new ones are added to it. If a streamer is given, textures are
+ * created by it, with their mip levels streamed.
+ */
+Object3D createImportedObject(ImportedModel& model, std::unordered_map<std::string, Texture>& loadedTextures,
+	TextureStreamer* streamer = nullptr);
+
+/**
+ * @brief Uploads an imported mesh; its textures must already be in loadedTextures.
+ */
+Mesh3D createImportedMesh(ImportedMesh& mesh, const std::unordered_map<std::string, Texture>& loadedTextures);
+
+/**
+ * @brief Imports and uploads a model. If a streamer is given, the model's textures are created by it,
+ * with their mip levels streamed. If loadedTextures is given, it receives every texture of the model
+ * by path.
+ */
+Object3D assimpLoad(const std::string& path, bool flipUVCoords, TextureStreamer* streamer = nullptr,
+	std::unordered_map<std::string, Texture>* loadedTextures = nullptr, ImportProfile profile = ImportProfile::Max);
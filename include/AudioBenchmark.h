@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Measures the mixer's CPU time and memory with the given number of positioned voices all
+ * playing the given file, once preloaded, once streamed, and once with voice limiting, and prints
+ * the results. Runs offline, without an audio device.
+ */
+void runAudioBenchmark(const std::string& path, uint32_t voiceCount);
@@ -0,0 +1,188 @@
+#pragma once
+#include "SoundBank.h"
+#include <glm/ext.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief The output format of the mixer: interleaved stereo at this sample rate.
+ */
+const uint32_t MIXER_SAMPLE_RATE = 44100;
+const uint32_t MIXER_CHANNELS = 2;
+/**
+ * @brief The number of frames mixed per block, for both the device and offline rendering.
+ */
+const uint32_t MIXER_BLOCK_FRAMES = 1024;
+
+/**
+ * @brief Identifies a source added to an AudioMixer.
+ */
+using AudioSourceId = uint32_t;
+
+/**
+ * @brief Whether a source's sound is decoded up front into the sound bank or streamed from disk.
+ * Auto streams sounds longer than the bank's threshold.
+ */
+enum class AudioLoadMode {
+	Auto,
+	Preload,
+	Stream
+};
+
+/**
+ * @brief How a source is played and attenuated.
+ */
+struct AudioSourceSettings {
+	float volume = 1.0f;
+	AudioLoadMode loadMode = AudioLoadMode::Auto;
+	bool loop = true;
+	// Non-spatial sources (like background music) play centered at full volume wherever the
+	// listener is.
+	bool spatial = true;
+	// Distance attenuation follows OpenAL's inverse distance clamped model: full volume within
+	// the reference distance, falling off as ref / (ref + rolloff * (d - ref)) up to maxDistance,
+	// and silent beyond it.
+	float referenceDistance = 5.0f;
+	float maxDistance = 100.0f;
+	float rolloff = 1.0f;
+};
+
+/**
+ * @brief Counters for measuring the mixer's cost.
+ */
+struct AudioMixerStats {
+	uint32_t voices = 0;
+	uint32_t streamingVoices = 0;
+	// Voices mixed in the last block, after culling and voice limiting.
+	uint32_t mixedVoices = 0;
+	// Ring buffers and decoding buffers owned by streaming voices.
+	size_t streamingBytes = 0;
+	// Decoded clips in the sound bank, shared by every voice that plays them.
+	size_t clipBytes = 0;
+	size_t clips = 0;
+};
+
+struct Voice;
+class MixerStream;
+
+/**
+ * @brief Mixes many positioned sound sources into one stereo stream.
+ *
+ * Short sounds are decoded once into the SoundBank and shared. Long sounds are streamed from disk
+ * and decoded (and resampled to MIXER_SAMPLE_RATE) on a dedicated thread into per-source ring
+ * buffers. The mixer applies distance attenuation and equal-power panning relative to the
+ * listener, with gains ramped across each block to avoid clicks, and skips sources that are
+ * inaudible: they neither decode nor mix, but keep their playback position so they resume in
+ * sync when the listener comes closer. When more sources are audible than the voice limit, only
+ * the loudest are mixed.
+ *
+ * After start(), a device stream pulls blocks from the mixer. Without start(), renderToFile()
+ * decodes and mixes synchronously into a WAV file, which needs no audio device.
+ */
+class AudioMixer {
+private:
+	// Guards m_voices and the spatial parameters shared with the mixing and decoding threads.
+	std::mutex m_mutex;
+	std::vector<std::unique_ptr<Voice>> m_voices;
+	glm::vec3 m_listenerPosition;
+	glm::vec3 m_listenerRight;
+	uint32_t m_maxVoices;
+
+	SoundBank m_soundBank;
+
+	std::thread m_decodeThread;
+	std::atomic<bool> m_running;
+	std::condition_variable m_decodeWake;
+	std::unique_ptr<MixerStream> m_deviceStream;
+
+	// Mixer-thread scratch space.
+	std::vector<float> m_sourceScratch;
+	std::vector<Voice*> m_mixVoices;
+	std::vector<Voice*> m_audibleScratch;
+	// Decoding-thread scratch space.
+	std::vector<Voice*> m_decodeVoices;
+
+	std::atomic<uint32_t> m_audibleVoices;
+
+	void decodeLoop();
+
+public:
+	AudioMixer();
+	~AudioMixer();
+
+	/**
+	 * @brief Adds a sound file as a new source, preloading or streaming it according to the
+	 * settings' load mode. Throws if the file can't be opened or holds no audio.
+	 */
+	AudioSourceId addSource(const std::string& path, const AudioSourceSettings& settings);
+
+	void setSourcePosition(AudioSourceId source, const glm::vec3& position);
+	void setSourceVolume(AudioSourceId source, float volume);
+
+	/**
+	 * @brief Plays the source again from the start; preloaded sources restart without any I/O.
+	 */
+	void restartSource(AudioSourceId source);
+
+	/**
+	 * @brief The most sources mixed at once; the quietest audible sources beyond it are faded out.
+	 */
+	void setMaxVoices(uint32_t maxVoices);
+
+	SoundBank& soundBank() { return m_soundBank; }
+
+	/**
+	 * @brief Moves the listener; usually the camera position and orientation.
+	 */
+	void setListener(const glm::vec3& position, const glm::vec3& front, const glm::vec3& up);
+
+	/**
+	 * @brief Starts the decoding thread and plays the mix on the default audio device.
+	 */
+	void start();
+	void stop();
+
+	/**
+	 * @brief Mixes the next block of frames into out, which holds frames * MIXER_CHANNELS samples.
+	 * Called from the audio device thread, or from renderToFile.
+	 */
+	void mix(float* out, uint32_t frames);
+
+	/**
+	 * @brief Tops up the ring buffer of every audible streaming voice, returning true if anything
+	 * was decoded. The decoding thread calls this after start(); offline rendering calls it
+	 * before each mix().
+	 */
+	bool decodeAvailable();
+
+	/**
+	 * @brief Mixes the given duration of audio into a 16-bit stereo WAV file, decoding on the
+	 * calling thread. Must not be called while the mixer is started.
+	 */
+	void renderToFile(const std::string& path, float seconds);
+
+	/**
+	 * @brief How many sources were audible, and therefore mixed, in the last block.
+	 */
+	uint32_t audibleVoices() const { return m_audibleVoices.load(); }
+
+	AudioMixerStats stats();
+};
+
+/**
+ * @brief Adds samples * (left, right) gains into interleaved stereo output, ramping the gains
+ * linearly from their start to end values. Uses SSE2 when available.
+ */
+void mixMonoToStereo(float* out, const float* samples, uint32_t frames,
+	float leftStart, float rightStart, float leftEnd, float rightEnd);
+
+/**
+ * @brief Converts float samples to saturated 16-bit integers.
+ */
+void convertToInt16(const float* samples, int16_t* out, size_t count);
@@ -0,0 +1,79 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief A lock-free single-producer, single-consumer ring buffer of audio samples. One thread
+ * may write while another reads; the capacity is rounded up to a power of two.
+ */
+class AudioRingBuffer {
+private:
+	std::vector<float> m_samples;
+	size_t m_mask;
+	// Monotonic counts of samples written and read; their difference is the fill level.
+	std::atomic<size_t> m_writeCount;
+	std::atomic<size_t> m_readCount;
+
+public:
+	explicit AudioRingBuffer(size_t capacity) : m_writeCount(0), m_readCount(0) {
+		size_t size = 1;
+		while (size < capacity) {
+			size <<= 1;
+		}
+		m_samples.resize(size);
+		m_mask = size - 1;
+	}
+
+	size_t capacity() const { return m_samples.size(); }
+
+	/**
+	 * @brief How many samples can be read. Safe to call from either thread.
+	 */
+	size_t available() const {
+		return m_writeCount.load(std::memory_order_acquire) - m_readCount.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * @brief How many samples can be written. Safe to call from either thread.
+	 */
+	size_t space() const { return capacity() - available(); }
+
+	/**
+	 * @brief Appends up to count samples and returns how many fit. Producer thread only.
+	 */
+	size_t write(const float* samples, size_t count) {
+		size_t write = m_writeCount.load(std::memory_order_relaxed);
+		count = std::min(count, capacity() - (write - m_readCount.load(std::memory_order_acquire)));
+		size_t start = write & m_mask;
+		size_t first = std::min(count, capacity() - start);
+		std::copy(samples, samples + first, m_samples.data() + start);
+		std::copy(samples + first, samples + count, m_samples.data());
+		m_writeCount.store(write + count, std::memory_order_release);
+		return count;
+	}
+
+	/**
+	 * @brief Removes up to count samples into the destination and returns how many were read.
+	 * Consumer thread only.
+	 */
+	size_t read(float* samples, size_t count) {
+		size_t read = m_readCount.load(std::memory_order_relaxed);
+		count = std::min(count, m_writeCount.load(std::memory_order_acquire) - read);
+		size_t start = read & m_mask;
+		size_t first = std::min(count, capacity() - start);
+		std::copy(m_samples.data() + start, m_samples.data() + start + first, samples);
+		std::copy(m_samples.data(), m_samples.data() + (count - first), samples + first);
+		m_readCount.store(read + count, std::memory_order_release);
+		return count;
+	}
+
+	/**
+	 * @brief Discards everything that has been written so far. Only safe while the other thread
+	 * leaves the buffer alone, as a streaming voice's mixer does during a resync.
+	 */
+	void clear() {
+		m_readCount.store(m_writeCount.load(std::memory_order_acquire), std::memory_order_release);
+	}
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include "ShaderProgram.h"
+
+/**
+ * @brief A hierarchical-Z (Hi-Z) pyramid built from the depth buffer of the last rendered frame.
+ * Each level stores, per texel, the farthest depth of the texels it covers in the level below, so
+ * a bounding volume whose nearest depth is farther than a pyramid texel is certainly occluded.
+ */
+class DepthPyramid {
+private:
+	// Size of the window depth buffer that the pyramid was last built from.
+	uint32_t m_sourceWidth;
+	uint32_t m_sourceHeight;
+	// Size of the pyramid's first level, which is half the size of the depth buffer.
+	uint32_t m_width;
+	uint32_t m_height;
+	uint32_t m_levels;
+
+	// A single-sampled copy of the window's depth buffer.
+	uint32_t m_depthTexture;
+	uint32_t m_depthFramebuffer;
+	// The R32F pyramid texture and the framebuffer used to render into its levels.
+	uint32_t m_pyramidTexture;
+	uint32_t m_pyramidFramebuffer;
+
+	ShaderProgram m_reduceProgram;
+
+	void resize(uint32_t width, uint32_t height);
+
+public:
+	DepthPyramid();
+
+	/**
+	 * @brief Copies the depth buffer of the bound framebuffer, which holds the scene, and rebuilds
+	 * every pyramid level. Call after the scene has been rendered and before the window is displayed.
+	 */
+	void build(uint32_t width, uint32_t height);
+
+	/**
+	 * @brief The pyramid texture, sampled with texelFetch/textureLod at integer levels.
+	 */
+	uint32_t texture() const { return m_pyramidTexture; }
+	uint32_t width() const { return m_width; }
+	uint32_t height() const { return m_height; }
+	uint32_t levels() const { return m_levels; }
+	bool isBuilt() const { return m_levels > 0; }
+};
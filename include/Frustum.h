@@ -0,0 +1,46 @@
+#pragma once
+#include <glm/ext.hpp>
+
+/**
+ * @brief The six clipping planes of a view volume, stored as (a, b, c, d) such that a point p is
+ * inside a plane when dot(abc, p) + d >= 0.
+ *
+ * Planes are extracted from a combined transformation matrix (Gribb & Hartmann), so extracting
+ * them from projection * view * model yields planes in the model's local space.
+ */
+struct Frustum {
+	glm::vec4 planes[6];
+
+	/**
+	 * @brief Extracts the (unnormalized) clipping planes of the given clip-space transformation.
+	 */
+	static Frustum fromMatrix(const glm::mat4& m) {
+		// glm matrices are column-major; row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i]).
+		glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		Frustum f;
+		f.planes[0] = row3 + row0; // left
+		f.planes[1] = row3 - row0; // right
+		f.planes[2] = row3 + row1; // bottom
+		f.planes[3] = row3 - row1; // top
+		f.planes[4] = row3 + row2; // near
+		f.planes[5] = row3 - row2; // far
+		return f;
+	}
+
+	/**
+	 * @brief True if any part of the given sphere may lie inside the frustum.
+	 */
+	bool intersectsSphere(const glm::vec3& center, float radius) const {
+		for (auto& plane : planes) {
+			glm::vec3 normal(plane);
+			if (glm::dot(normal, center) + plane.w < -radius * glm::length(normal)) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
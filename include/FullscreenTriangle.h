@@ -0,0 +1,18 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+
+/**
+ * @brief Draws a single triangle that covers the whole viewport, for screen-space passes.
+ * The vertex shader (fullscreen.vert) derives the corners from gl_VertexID, so no vertex buffer
+ * is needed; a core profile context still requires some vertex array to be bound.
+ */
+inline void drawFullscreenTriangle() {
+	static uint32_t vao = 0;
+	if (vao == 0) {
+		glGenVertexArrays(1, &vao);
+	}
+	glBindVertexArray(vao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+}
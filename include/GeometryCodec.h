@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Vertex3D;
+
+/**
+ * @brief Compresses a vertex buffer without losing any bits. Each of Vertex3D's eight 32-bit
+ * fields is stored as its difference from the previous vertex's, zigzag-mapped so that small steps
+ * either way give small numbers, and split into four byte planes. Each of the 32 planes is then
+ * Huffman-coded on its own, or kept as-is or as a single repeated byte when that is smaller.
+ */
+std::vector<uint8_t> encodeVertices(const std::vector<Vertex3D>& vertices);
+
+/**
+ * @brief Decodes vertices written by encodeVertices; the differences are summed and the planes
+ * interleaved back with SSE2 where available. Throws if the data is corrupt.
+ */
+std::vector<Vertex3D> decodeVertices(const uint8_t* data, size_t size);
+
+/**
+ * @brief Compresses the index buffer of a triangle list. Each triangle is rotated to start at its
+ * smallest index, which keeps its winding, and stored as that index's difference from the previous
+ * triangle's first, then the other two's differences from it, all as varints. Decoded triangles are
+ * the same, but may start at another corner.
+ */
+std::vector<uint8_t> encodeIndices(const std::vector<uint32_t>& faces);
+
+/**
+ * @brief Decodes indices written by encodeIndices. Throws if the data is corrupt.
+ */
+std::vector<uint32_t> decodeIndices(const uint8_t* data, size_t size);
@@ -0,0 +1,184 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <vector>
+#include "MeshDraw.h"
+#include "ShaderProgram.h"
+
+class Mesh3D;
+class DepthPyramid;
+class ReflectionProbes;
+class Object3D;
+
+/**
+ * @brief One instance as stored in the instance buffer; matches struct Instance in
+ * object_cull.comp and instanced_lighting.vert.
+ */
+struct GpuInstance {
+	glm::mat4 model;
+	// The columns of the normal matrix, padded to vec4 as std430 requires.
+	glm::vec4 normalMatrix[3];
+	// The world-space bounding sphere: center and radius.
+	glm::vec4 sphere;
+	uint32_t batch;
+	uint32_t padding[3];
+};
+static_assert(sizeof(GpuInstance) == 144, "GpuInstance must match the std430 layout in object_cull.comp");
+
+/**
+ * @brief A changed instance transform, as packed into the staging buffer; matches struct
+ * TransformUpdate in transform_scatter.comp.
+ */
+struct GpuTransformUpdate {
+	uint32_t instance;
+	uint32_t padding[3];
+	glm::mat4 model;
+	glm::vec4 normalMatrix[3];
+	glm::vec4 sphere;
+};
+static_assert(sizeof(GpuTransformUpdate) == 144, "GpuTransformUpdate must match transform_scatter.comp");
+
+/**
+ * @brief Culls and draws many mesh instances with a CPU cost that doesn't grow with their number.
+ *
+ * build() uploads every instance's transform and bounds to a shader storage buffer once, grouped
+ * into batches that share a mesh and a material. Each frame a compute shader (object_cull.comp)
+ * tests every instance against the view frustum and optionally the previous frame's Hi-Z pyramid,
+ * and appends the survivors to their batch's range of a visible-instance list, counting them with
+ * atomics in one indirect draw command per batch. Each batch is then drawn with a single
+ * glDrawElementsIndirect, whose instance count was written by the GPU; instanced_lighting.vert
+ * looks up each instance's transform through the visible list.
+ *
+ * Instance transforms stay in the GPU buffer between frames. syncTransforms() finds the objects
+ * whose transforms changed, and only their instances are packed into a staging buffer, which a
+ * second compute shader (transform_scatter.comp) scatters into the instance buffer. Upload
+ * volume is proportional to the number of changed instances.
+ *
+ * Needs OpenGL 4.3 for compute shaders and storage buffers; check isSupported() first.
+ */
+class GpuObjectCuller {
+private:
+	struct Batch {
+		const Mesh3D* mesh;
+		glm::vec4 material;
+		uint32_t firstSlot;
+		uint32_t instanceCount;
+	};
+
+	/**
+	 * @brief Where the instances of one scene object came from: the positions of its culled draws
+	 * in the list returned by its collectDraws, and the instances they became.
+	 */
+	struct TrackedObject {
+		uint64_t transformVersion;
+		uint32_t firstMapping;
+		uint32_t mappingCount;
+	};
+	struct InstanceMapping {
+		uint32_t drawIndex;
+		uint32_t instance;
+	};
+
+	bool m_supported;
+	ShaderProgram m_cullProgram;
+	ShaderProgram m_drawProgram;
+	ShaderProgram m_scatterProgram;
+
+	uint32_t m_instanceBuffer;
+	uint32_t m_visibleBuffer;
+	uint32_t m_commandBuffer;
+	// The commands with zero instances, copied over the command buffer before each cull.
+	uint32_t m_commandTemplateBuffer;
+
+	uint32_t m_stagingBuffer;
+
+	std::vector<Batch> m_batches;
+	// The batch of each instance, kept to rebuild instances when their transform changes.
+	std::vector<uint32_t> m_instanceBatches;
+	uint32_t m_instanceCount;
+
+	std::vector<TrackedObject> m_trackedObjects;
+	std::vector<InstanceMapping> m_mappings;
+	std::vector<MeshDraw> m_drawScratch;
+
+	// Updates waiting for the next flush, and counters of what was uploaded.
+	std::vector<GpuTransformUpdate> m_pendingUpdates;
+	uint32_t m_lastUploadCount;
+	uint64_t m_totalUploadCount;
+
+	glm::mat4 m_view;
+	glm::mat4 m_projection;
+	const DepthPyramid* m_depthPyramid;
+
+	// The lighting uniforms of lighting.frag, applied to the draw program.
+	glm::vec3 m_ambientColor;
+	glm::vec3 m_directionalLight;
+	glm::vec3 m_directionalColor;
+	glm::vec3 m_viewPos;
+	const ReflectionProbes* m_reflectionProbes;
+
+	void cull();
+	void flushUpdates();
+
+public:
+	GpuObjectCuller();
+
+	/**
+	 * @brief True if the context supports the compute path.
+	 */
+	bool isSupported() const { return m_supported; }
+
+	/**
+	 * @brief Uploads the opaque and masked meshes of the given objects as the instances to cull,
+	 * replacing any previous ones. Only needs to be called again when objects or meshes are added
+	 * or removed; transform changes are picked up by syncTransforms().
+	 */
+	void build(const std::vector<Object3D>& objects);
+
+	/**
+	 * @brief Queues updates for the instances of every object whose transform changed since the
+	 * last build or sync. Must be given the same objects, in the same order, as build().
+	 */
+	void syncTransforms(const std::vector<Object3D>& objects);
+
+	/**
+	 * @brief Queues a new model matrix for one instance, uploaded before the next cull.
+	 */
+	void updateInstance(uint32_t instance, const glm::mat4& model);
+
+	/**
+	 * @brief Sets the lighting of the draw program; the parameters have the same meaning as the
+	 * uniforms of lighting.frag.
+	 */
+	void setLighting(const glm::vec3& ambientColor, const glm::vec3& directionalLight,
+		const glm::vec3& directionalColor, const glm::vec3& viewPos);
+
+	/**
+	 * @brief Sets the camera that instances are culled against and drawn with.
+	 */
+	void setView(const glm::mat4& view, const glm::mat4& projection);
+
+	/**
+	 * @brief Sets the Hi-Z pyramid used for occlusion culling, or nullptr to disable it.
+	 */
+	void setDepthPyramid(const DepthPyramid* pyramid);
+
+	/**
+	 * @brief Sets the probes that instances reflect, or nullptr to disable reflections.
+	 */
+	void setReflectionProbes(const ReflectionProbes* probes);
+
+	/**
+	 * @brief Culls every instance on the GPU and draws the survivors, then restores the previously
+	 * active program.
+	 */
+	void render();
+
+	uint32_t instanceCount() const { return m_instanceCount; }
+	/**
+	 * @brief The number of instance transforms uploaded in the last render(), and overall.
+	 */
+	uint32_t lastUploadCount() const { return m_lastUploadCount; }
+	uint64_t totalUploadCount() const { return m_totalUploadCount; }
+	uint32_t batchCount() const { return static_cast<uint32_t>(m_batches.size()); }
+};
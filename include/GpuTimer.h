@@ -0,0 +1,36 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Measures the GPU time spent between begin() and end() with GL_TIME_ELAPSED queries.
+ * Results are read back a few frames later, once they are available, so timing never stalls the
+ * pipeline. Only one GpuTimer may be active at a time (a GL restriction on elapsed-time queries).
+ */
+class GpuTimer {
+private:
+	static const size_t QUERY_COUNT = 4;
+	std::array<uint32_t, QUERY_COUNT> m_queries;
+	// Which queries have been issued and not yet read back.
+	std::array<bool, QUERY_COUNT> m_pending;
+	size_t m_next;
+
+	double m_totalMilliseconds;
+	uint32_t m_samples;
+
+	void collect();
+
+public:
+	GpuTimer();
+
+	void begin();
+	void end();
+
+	/**
+	 * @brief The average GPU time, in milliseconds, of the intervals measured since the last reset().
+	 */
+	double averageMilliseconds() const;
+	uint32_t samples() const { return m_samples; }
+	void reset();
+};
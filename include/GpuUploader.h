@@ -0,0 +1,135 @@
+#pragma once
+#include <glad/glad.h>
+#include <SFML/Window/ContextSettings.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "StbImage.h"
+
+/**
+ * @brief Counters of a GpuUploader, since it was created.
+ */
+struct GpuUploadStats {
+	uint64_t buffersUploaded = 0;
+	uint64_t texturesUploaded = 0;
+	uint64_t bytesUploaded = 0;
+	// Jobs the upload thread hasn't finished, and finished jobs whose fences haven't signalled.
+	uint32_t queuedJobs = 0;
+	uint32_t pendingFences = 0;
+	// Time the upload thread spent in GL calls on the last job.
+	float lastJobMilliseconds = 0;
+};
+
+/**
+ * @brief Creates buffers and textures on a thread of its own, so that uploads don't take frame time.
+ *
+ * The thread owns a second OpenGL context in the window's share group; buffer and texture objects
+ * are shared between the two, vertex arrays and framebuffers aren't. Every finished job is followed
+ * by a glFenceSync, and its object is published to the render thread only once poll() finds that
+ * fence signalled, so the render thread never waits on the upload thread or the GPU. Per the GL
+ * rules on shared objects, the render thread must bind an object after taking it before the
+ * uploaded contents are guaranteed visible, which every use of a buffer or texture does anyway.
+ */
+class GpuUploader {
+public:
+	typedef uint64_t Ticket;
+
+private:
+	enum class JobKind {
+		Buffer,
+		Texture
+	};
+
+	struct Job {
+		Ticket ticket;
+		JobKind kind;
+		const void* data;
+		size_t bytes;
+		// Keeps the data alive until the job is done.
+		std::shared_ptr<const void> owner;
+	};
+
+	struct Finished {
+		Ticket ticket;
+		uint32_t objectId;
+		JobKind kind;
+		GLsync fence;
+	};
+
+	// Guards everything down to m_stats.
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::deque<Job> m_jobs;
+	std::vector<Finished> m_finished;
+	Ticket m_nextTicket;
+	bool m_stopping;
+	bool m_started;
+	bool m_available;
+	GpuUploadStats m_stats;
+	std::thread m_thread;
+
+	// Only touched by the render thread.
+	std::vector<Finished> m_fenced;
+	std::unordered_map<Ticket, Finished> m_ready;
+
+	void run(sf::ContextSettings settings);
+	uint32_t perform(const Job& job);
+	Ticket submit(JobKind kind, const void* data, size_t bytes, std::shared_ptr<const void> owner);
+
+public:
+	/**
+	 * @brief Starts the upload thread with a context of the given settings, normally the window's,
+	 * and waits until the context is created. GL functions must already be loaded.
+	 */
+	GpuUploader(const sf::ContextSettings& settings);
+	/**
+	 * @brief Stops the upload thread, and deletes the objects of jobs that were never taken. Must be
+	 * called on the render thread, with its context current.
+	 */
+	~GpuUploader();
+	GpuUploader(const GpuUploader&) = delete;
+	GpuUploader& operator=(const GpuUploader&) = delete;
+
+	/**
+	 * @brief Whether the upload context could be created and supports fences. If not, jobs are never
+	 * run and callers must upload on the render thread themselves.
+	 */
+	bool isAvailable() const { return m_available; }
+
+	/**
+	 * @brief Queues the creation of a GL_STATIC_DRAW buffer holding a copy of the given bytes, which
+	 * the owner keeps alive until the copy is made.
+	 */
+	Ticket uploadBuffer(const void* data, size_t bytes, std::shared_ptr<const void> owner);
+
+	template<typename T>
+	Ticket uploadBuffer(std::vector<T>&& data) {
+		auto owner = std::make_shared<const std::vector<T>>(std::move(data));
+		return uploadBuffer(owner->data(), owner->size() * sizeof(T), owner);
+	}
+
+	/**
+	 * @brief Queues the creation of a texture from the image, as Texture::loadImage does, mipmaps
+	 * included.
+	 */
+	Ticket uploadTexture(std::shared_ptr<const StbImage> image);
+
+	/**
+	 * @brief Checks, without waiting, which finished jobs' fences have signalled, and makes their
+	 * objects available to take(). Call once per frame on the render thread.
+	 */
+	void poll();
+
+	/**
+	 * @brief If the job is done and its fence signalled, gives its buffer or texture to the caller,
+	 * who then owns it, and returns true.
+	 */
+	bool take(Ticket ticket, uint32_t& objectId);
+
+	GpuUploadStats stats();
+};
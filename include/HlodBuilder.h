@@ -0,0 +1,63 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <vector>
+#include "Object3D.h"
+#include "ShaderProgram.h"
+
+/**
+ * @brief A group of nearby objects, and a single simplified mesh that stands in for all of them
+ * when the group is far from the camera.
+ */
+struct HlodCluster {
+	// Indices of the member objects in the scene's object list.
+	std::vector<size_t> members;
+	// The world-space bounding sphere of the members.
+	glm::vec3 center;
+	float radius;
+	// The members' combined transform version when the proxy was built. A cluster whose members
+	// have moved since must not be swapped for its proxy.
+	uint64_t transformVersion;
+	// The merged proxy, in world space, with one mesh and one atlas texture.
+	Object3D proxy;
+	uint32_t sourceTriangles;
+	uint32_t proxyTriangles;
+};
+
+/**
+ * @brief Builds hierarchical LOD proxies: clusters static objects on a grid in the ground plane,
+ * and merges each cluster's opaque and masked meshes into one mesh that is drawn with a single
+ * draw call.
+ *
+ * The merged geometry is simplified by vertex clustering: vertices are snapped to a grid whose
+ * cell size is a fraction of the cluster's size, and triangles that collapse are dropped. The
+ * members' base textures are copied into one atlas, and the UVs remapped into it.
+ */
+class HlodBuilder {
+private:
+	ShaderProgram m_copyProgram;
+	float m_clusterSize;
+	uint32_t m_atlasSlotSize;
+	uint32_t m_simplifyResolution;
+
+	HlodCluster buildCluster(const std::vector<Object3D>& objects, std::vector<size_t>&& members);
+
+public:
+	/**
+	 * @param clusterSize the size of the ground-plane grid cells that objects are grouped by.
+	 * @param atlasSlotSize the size in pixels that each source texture is resampled to in the atlas.
+	 * @param simplifyResolution how many vertex-clustering cells span the cluster's diameter.
+	 */
+	HlodBuilder(float clusterSize = 40, uint32_t atlasSlotSize = 256, uint32_t simplifyResolution = 64);
+
+	/**
+	 * @brief Clusters the candidate objects by position, and builds a proxy for every cluster of at
+	 * least two objects; a single object gains nothing from merging. Needs a current GL context.
+	 */
+	std::vector<HlodCluster> build(const std::vector<Object3D>& objects, const std::vector<size_t>& candidates);
+
+	/**
+	 * @brief Whether none of the cluster's members have moved since its proxy was built.
+	 */
+	static bool isCurrent(const HlodCluster& cluster, const std::vector<Object3D>& objects);
+};
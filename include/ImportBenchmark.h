@@ -0,0 +1,10 @@
+#pragma once
+#include <string>
+#include <vector>
+
+/**
+ * @brief Imports each model with every import profile, prints the time of each post-process step,
+ * and compares the triangles each profile produces with those of the max profile, so that the
+ * cheapest profile that loses nothing can be chosen per model. Runs offline, without a window.
+ */
+void runImportBenchmark(const std::vector<std::string>& modelPaths, bool flipTextureCoords);
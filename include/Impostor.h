@@ -0,0 +1,21 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+
+/**
+ * @brief A model pre-rendered from a hemisphere of views, laid out on a hemi-octahedral grid of
+ * frames in two atlas textures. See ImpostorBaker and ImpostorRenderer.
+ */
+struct Impostor {
+	// RGBA8: the model's unlit base color, with coverage in alpha.
+	uint32_t albedoTexture;
+	// RGBA8: the model-space normal in rgb, and the depth along the frame's view axis in alpha.
+	uint32_t normalDepthTexture;
+	// The atlas holds frames x frames views of frameSize x frameSize pixels each.
+	uint32_t frames;
+	uint32_t frameSize;
+	// The model's bounding sphere in model space, before the object's own transform; every frame
+	// is an orthographic view of exactly this sphere.
+	glm::vec3 center;
+	float radius;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include "Impostor.h"
+#include "ShaderProgram.h"
+
+class Object3D;
+
+/**
+ * @brief Renders impostors of objects: one orthographic view of the object's bounding sphere for
+ * every frame of a hemi-octahedral grid, each into its own cell of an albedo and a normal/depth
+ * atlas.
+ *
+ * Frame (i, j) of an N x N grid looks at the object from the direction hemiOctDecode of
+ * (i, j) / (N - 1) * 2 - 1, in the object's own space, so that views all around and above the
+ * object are covered evenly. impostor.vert and impostor.frag decode the same layout.
+ */
+class ImpostorBaker {
+private:
+	ShaderProgram m_bakeProgram;
+
+public:
+	ImpostorBaker();
+
+	/**
+	 * @brief Bakes an impostor of the object's opaque and masked meshes. Blended meshes are left
+	 * out, since a single layer can't represent them. Needs a current GL context; the previous
+	 * framebuffer, viewport and program are restored.
+	 */
+	Impostor bake(const Object3D& object, uint32_t frames = 8, uint32_t frameSize = 128);
+};
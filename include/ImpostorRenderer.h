@@ -0,0 +1,77 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <vector>
+#include "Impostor.h"
+#include "ShaderProgram.h"
+
+class Object3D;
+
+/**
+ * @brief Draws objects far from the camera as camera-facing quads textured from their impostors.
+ *
+ * Each quad blends the three baked views nearest to the direction it is seen from, and writes the
+ * baked depth, so impostors intersect each other and the rest of the scene correctly. All the
+ * instances of one impostor are drawn with a single instanced draw, so thousands of distant
+ * objects cost a handful of draws.
+ */
+class ImpostorRenderer {
+private:
+	struct ImpostorInstance {
+		// The world-space bounding sphere.
+		glm::vec4 centerRadius;
+		// The object's rotation, as x, y, z, w.
+		glm::vec4 rotation;
+		glm::vec4 material;
+	};
+
+	std::vector<Impostor> m_impostors;
+	// This frame's instances of each impostor.
+	std::vector<std::vector<ImpostorInstance>> m_instances;
+
+	ShaderProgram m_program;
+	uint32_t m_vao;
+	uint32_t m_quadBuffer;
+	uint32_t m_instanceBuffer;
+	size_t m_instanceCapacity;
+
+	glm::vec3 m_ambientColor;
+	glm::vec3 m_directionalLight;
+	glm::vec3 m_directionalColor;
+	uint32_t m_instancesDrawn;
+
+public:
+	ImpostorRenderer();
+
+	/**
+	 * @brief Takes ownership of a baked impostor, and returns the index to draw it by.
+	 */
+	uint32_t addImpostor(const Impostor& impostor);
+	const Impostor& getImpostor(uint32_t index) const { return m_impostors[index]; }
+
+	/**
+	 * @brief The world-space bounding sphere of an object drawn with the given impostor, as center
+	 * and radius.
+	 */
+	glm::vec4 worldBounds(uint32_t impostor, const Object3D& object) const;
+
+	void setLighting(const glm::vec3& ambientColor, const glm::vec3& directionalLight,
+		const glm::vec3& directionalColor);
+
+	/**
+	 * @brief Forgets the previous frame's instances.
+	 */
+	void clear();
+
+	/**
+	 * @brief Draws the object with the given impostor this frame, instead of with its meshes.
+	 */
+	void submit(uint32_t impostor, const Object3D& object);
+
+	/**
+	 * @brief Draws every submitted instance. The previous program is restored.
+	 */
+	void render(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos);
+
+	uint32_t instancesDrawn() const { return m_instancesDrawn; }
+};
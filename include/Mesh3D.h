@@ -5,6 +5,10 @@
 
 #include "Texture.h"
 #include "ShaderProgram.h"
+#include "Meshlet.h"
+
+class MeshletCuller;
+
 struct Vertex3D {
 	float x;
 	float y;
@@ -22,12 +26,39 @@ struct Vertex3D {
 		x(px), y(py), z(pz), nx(normX), ny(normY), nz(normZ), u(texU), v(texV) {}
 };
 
+/**
+ * @brief How a mesh's alpha is interpreted, following glTF's alphaMode.
+ */
+enum class AlphaMode {
+	// Alpha is ignored; the mesh is fully opaque.
+	Opaque,
+	// Fragments with alpha below the mesh's cutoff are discarded; the rest are opaque.
+	Mask,
+	// The mesh is alpha-blended over what is behind it.
+	Blend
+};
+
 class Mesh3D {
 private:
 	uint32_t m_vao;
+	uint32_t m_vbo;
+	uint32_t m_ebo;
+	// Texture buffer views of the vertex and element buffers, for shaders that fetch vertices.
+	uint32_t m_vertexTexture;
+	uint32_t m_indexTexture;
 	std::vector<Texture> m_textures;
 	uint32_t m_vertexCount;
 	uint32_t m_faceCount;
+	// The mesh's meshlets, and a GPU buffer holding a copy of them for compute culling.
+	std::vector<Meshlet> m_meshlets;
+	uint32_t m_meshletBuffer;
+	// A bounding sphere of the mesh's vertices, in local space.
+	glm::vec3 m_boundsCenter;
+	float m_boundsRadius;
+
+	AlphaMode m_alphaMode;
+	float m_alphaCutoff;
+	float m_opacity;
 
 public:
 	Mesh3D() = delete;
@@ -45,6 +76,79 @@ public:
 		std::vector<Texture>&& textures);
 
 	void addTexture(Texture texture);
+	void setTextures(std::vector<Texture>&& textures);
+	const std::vector<Texture>& getTextures() const { return m_textures; }
+
+	/**
+	 * @brief Assigns the meshlets that partition this mesh's index buffer, so that the mesh can be
+	 * culled at meshlet granularity. See buildMeshlets.
+	 */
+	void setMeshlets(std::vector<Meshlet>&& meshlets);
+	const std::vector<Meshlet>& getMeshlets() const { return m_meshlets; }
+	uint32_t getMeshletBuffer() const { return m_meshletBuffer; }
+	uint32_t getFaceCount() const { return m_faceCount; }
+	const glm::vec3& getBoundsCenter() const { return m_boundsCenter; }
+	float getBoundsRadius() const { return m_boundsRadius; }
+
+	/**
+	 * @brief Sets how the mesh's alpha is used. The cutoff only applies to AlphaMode::Mask.
+	 */
+	void setAlphaMode(AlphaMode mode, float cutoff = 0.5f);
+	AlphaMode getAlphaMode() const { return m_alphaMode; }
+	float getAlphaCutoff() const { return m_alphaCutoff; }
+
+	/**
+	 * @brief Sets a constant factor that multiplies the alpha of the mesh's base texture.
+	 */
+	void setOpacity(float opacity);
+	float getOpacity() const { return m_opacity; }
+
+	/**
+	 * @brief A samplerBuffer (GL_RGBA32F) view of the vertex buffer; each Vertex3D spans two texels.
+	 */
+	uint32_t getVertexTexture() const { return m_vertexTexture; }
+	/**
+	 * @brief A usamplerBuffer (GL_R32UI) view of the element buffer.
+	 */
+	uint32_t getIndexTexture() const { return m_indexTexture; }
+
+	/**
+	 * @brief Copies the mesh's vertices and faces back from VRAM, for tools that rebuild geometry
+	 * after loading.
+	 */
+	void readGeometry(std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces) const;
+
+	/**
+	 * @brief Replaces the mesh's vertices and faces in its existing GPU buffers, so that every
+	 * handle to the mesh sees the new geometry. Clears the mesh's meshlets; call setMeshlets again
+	 * to restore them.
+	 */
+	void setGeometry(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces);
+
+	/**
+	 * @brief Replaces the mesh's vertices and faces with copies of those in the given buffers, made
+	 * on the GPU, so that every handle to the mesh sees the new geometry. For geometry uploaded on
+	 * another thread; the caller keeps the given buffers. Clears the mesh's meshlets.
+	 */
+	void copyGeometry(uint32_t vertexBuffer, uint32_t vertexCount, uint32_t indexBuffer, uint32_t faceCount,
+		const glm::vec3& boundsCenter, float boundsRadius);
+
+	/**
+	 * @brief A bounding sphere of the vertices, around the center of their bounding box.
+	 */
+	static void computeBounds(const std::vector<Vertex3D>& vertices, glm::vec3& center, float& radius);
+
+	/**
+	 * @brief Binds the mesh's textures to consecutive texture units starting at 0, and points the
+	 * program's samplers at them.
+	 */
+	void bindTextures(ShaderProgram& program) const;
+
+	/**
+	 * @brief Draws every triangle of the mesh without binding any textures, for passes that only
+	 * need geometry.
+	 */
+	void renderGeometry() const;
 
 	/**
 	 * @brief Constructs a 1x1 square centered at the origin in world space.
@@ -58,5 +162,24 @@ public:
 	 * @param proj the view->clip projection matrix.
 	*/
 	void render(ShaderProgram& program) const;
+
+	/**
+	 * @brief Renders only the meshlets of the mesh that survive culling against the culler's view.
+	 * Meshes without meshlets are drawn in full.
+	 * @param model the local->world model transformation matrix of the mesh.
+	*/
+	void render(ShaderProgram& program, MeshletCuller& culler, const glm::mat4& model) const;
+
+	/**
+	 * @brief Renders the mesh with the DrawElementsIndirectCommand at the given byte offset of the
+	 * bound GL_DRAW_INDIRECT_BUFFER, so that the GPU decides how many instances are drawn.
+	 */
+	void renderIndirect(ShaderProgram& program, size_t commandOffset) const;
+
+	/**
+	 * @brief Renders the given number of instances of the whole mesh, for shaders that place
+	 * each instance themselves.
+	 */
+	void renderInstanced(ShaderProgram& program, uint32_t instanceCount) const;
 	
 };
@@ -0,0 +1,15 @@
+#pragma once
+#include <glm/ext.hpp>
+
+class Mesh3D;
+
+/**
+ * @brief One mesh to be drawn with a given model matrix and material, as gathered from an
+ * Object3D hierarchy by Object3D::collectDraws. The mesh is owned by the scene, and the pointer
+ * stays valid until the scene's objects are modified.
+ */
+struct MeshDraw {
+	const Mesh3D* mesh;
+	glm::mat4 model;
+	glm::vec4 material;
+};
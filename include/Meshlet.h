@@ -0,0 +1,50 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <vector>
+
+struct Vertex3D;
+
+/**
+ * @brief The most vertices that a single meshlet may reference.
+ */
+const uint32_t MAX_MESHLET_VERTICES = 64;
+/**
+ * @brief The most triangles that a single meshlet may contain.
+ */
+const uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+/**
+ * @brief A small cluster of triangles within a Mesh3D, which can be culled independently of the
+ * rest of the mesh. A meshlet occupies a contiguous range of its mesh's index buffer.
+ *
+ * The layout matches the std430 "Meshlet" struct in meshlet_cull.comp, so a vector of meshlets
+ * can be uploaded to a shader storage buffer as-is.
+ */
+struct Meshlet {
+	// The bounding sphere of the meshlet, in the mesh's local space.
+	glm::vec3 center;
+	float radius;
+
+	// The normal cone of the meshlet: if the camera lies inside the cone behind the apex,
+	// every triangle in the meshlet faces away from it.
+	glm::vec3 coneAxis;
+	float coneCutoff;
+	glm::vec3 coneApex;
+
+	// The first index of the meshlet in the mesh's index buffer.
+	uint32_t indexOffset;
+	// The number of indices in the meshlet (3 per triangle).
+	uint32_t indexCount;
+	// The number of unique vertices referenced by the meshlet.
+	uint32_t vertexCount;
+	uint32_t padding[2];
+};
+static_assert(sizeof(Meshlet) == 64, "Meshlet must match the std430 layout in meshlet_cull.comp");
+
+/**
+ * @brief Splits a triangle list into meshlets of at most MAX_MESHLET_VERTICES vertices and
+ * MAX_MESHLET_TRIANGLES triangles, and computes their bounding spheres and normal cones.
+ * Triangles are grouped in index buffer order, so the index buffer does not need to change.
+ */
+std::vector<Meshlet> buildMeshlets(const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& faces);
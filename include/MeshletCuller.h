@@ -0,0 +1,89 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include "ShaderProgram.h"
+
+class Mesh3D;
+class DepthPyramid;
+
+/**
+ * @brief The command layout read by glMultiDrawElementsIndirect.
+ */
+struct DrawElementsIndirectCommand {
+	uint32_t count;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t baseVertex;
+	uint32_t baseInstance;
+};
+
+/**
+ * @brief Draws only the meshlets of a mesh that may be visible from the current camera.
+ *
+ * On OpenGL 4.3+ a compute shader (meshlet_cull.comp) tests each meshlet against the view
+ * frustum, its normal cone, and optionally a Hi-Z pyramid of the previous frame, and compacts the
+ * survivors into an indirect draw buffer. Otherwise the frustum and cone tests run on the CPU,
+ * and adjacent surviving meshlets are merged into ranges for glMultiDrawElements.
+ */
+class MeshletCuller {
+private:
+	bool m_useGpu;
+	// True if glMultiDrawElementsIndirectCount (OpenGL 4.6) can consume the GPU draw count.
+	bool m_hasDrawCount;
+	ShaderProgram m_cullProgram;
+	uint32_t m_commandBuffer;
+	uint32_t m_commandCapacity;
+	uint32_t m_countBuffer;
+
+	glm::mat4 m_view;
+	glm::mat4 m_projection;
+	glm::vec3 m_cameraPos;
+	const DepthPyramid* m_depthPyramid;
+
+	// Scratch space for the ranges drawn by the CPU path.
+	std::vector<GLsizei> m_counts;
+	std::vector<const void*> m_offsets;
+
+	uint64_t m_meshletsTested;
+	uint64_t m_meshletsDrawn;
+
+	void drawVisibleCpu(const Mesh3D& mesh, const glm::mat4& model);
+	void drawVisibleGpu(const Mesh3D& mesh, const glm::mat4& model, ShaderProgram& drawProgram);
+
+public:
+	/**
+	 * @brief Constructs a culler, which uses the compute path if preferGpu is set and the context
+	 * supports compute shaders.
+	 */
+	MeshletCuller(bool preferGpu = true);
+
+	/**
+	 * @brief Sets the camera that meshlets are culled against, for the upcoming frame.
+	 */
+	void setView(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos);
+
+	/**
+	 * @brief Sets the Hi-Z pyramid used for occlusion culling on the GPU path, or nullptr to
+	 * disable occlusion culling.
+	 */
+	void setDepthPyramid(const DepthPyramid* pyramid);
+
+	bool usesGpu() const { return m_useGpu; }
+
+	/**
+	 * @brief Issues draws for the visible meshlets of the mesh. The mesh's vertex array and
+	 * textures must already be bound, and drawProgram is re-activated if the GPU path used its
+	 * own program for culling.
+	 */
+	void drawVisible(const Mesh3D& mesh, const glm::mat4& model, ShaderProgram& drawProgram);
+
+	/**
+	 * @brief Statistics since the last call to resetStatistics(). The number of meshlets drawn is
+	 * only known on the CPU path; the GPU path never reads its draw count back.
+	 */
+	uint64_t meshletsTested() const { return m_meshletsTested; }
+	uint64_t meshletsDrawn() const { return m_meshletsDrawn; }
+	void resetStatistics();
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A Motion JPEG video: a file of concatenated JPEG images, one per frame, played at a
+ * fixed frame rate.
+ *
+ * The whole file is read into memory and indexed by walking each image's segments, so frames can
+ * be decoded in any order and from several threads at once.
+ */
+class MjpegVideo {
+private:
+	struct FrameRange {
+		size_t offset;
+		size_t size;
+	};
+
+	std::vector<uint8_t> m_data;
+	std::vector<FrameRange> m_frames;
+	uint32_t m_width;
+	uint32_t m_height;
+	float m_frameRate;
+
+public:
+	/**
+	 * @brief Reads and indexes the given file. Throws if it can't be read or holds no JPEG images.
+	 */
+	MjpegVideo(const std::string& path, float frameRate);
+
+	uint32_t frameCount() const { return static_cast<uint32_t>(m_frames.size()); }
+	uint32_t width() const { return m_width; }
+	uint32_t height() const { return m_height; }
+	float frameRate() const { return m_frameRate; }
+
+	/**
+	 * @brief The size of a frame dimension decoded with the given reduction.
+	 */
+	static uint32_t reducedSize(uint32_t size, uint32_t reduction) { return size / reduction > 0 ? size / reduction : 1; }
+
+	/**
+	 * @brief Decodes the given frame as RGBA8 into output, box-filtered down by the given factor
+	 * in each dimension. Returns false if the frame is corrupt or not the size of the first frame.
+	 * Safe to call from several threads at once.
+	 */
+	bool decode(uint32_t frame, uint32_t reduction, uint8_t* output) const;
+};
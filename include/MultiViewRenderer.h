@@ -0,0 +1,127 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <vector>
+#include "Frustum.h"
+#include "MeshDraw.h"
+#include "ShaderProgram.h"
+
+class RenderQueue;
+class ReflectionProbes;
+
+/**
+ * @brief One of several views of the same scene, drawn into a rectangle of a framebuffer.
+ */
+struct RenderView {
+	glm::mat4 view;
+	glm::mat4 projection;
+	// The eye position, for specular lighting and sorting.
+	glm::vec3 position;
+	// x, y, width and height in the target framebuffer.
+	glm::ivec4 viewport;
+	// 0 for the window.
+	uint32_t framebuffer;
+};
+
+/**
+ * @brief Draws one frame's draws into several views, culling and sorting them once for all views.
+ *
+ * cull() tests each draw's bounding sphere against a box around every view's frustum, and only
+ * the survivors against each view's frustum, producing a mask of the views that see it in the same
+ * traversal. Blended draws are sorted once, from the views' average eye position. The draw
+ * packets are then shared by every view.
+ *
+ * Views that share a framebuffer and an eye position (stereo pairs within a few centimeters, or
+ * wall screens around one viewer) are drawn together with instancing: multiview.vert draws one
+ * instance per view, moves it into that view's viewport and clips it to that view with clip
+ * distances, so each draw is submitted once for the whole group. Instances of views that don't
+ * see the draw are clipped away entirely.
+ */
+class MultiViewRenderer {
+public:
+	// The number of views drawn by one instanced draw; matches MAX_VIEWS in multiview.vert.
+	static const uint32_t MAX_INSTANCED_VIEWS = 8;
+	// The number of views, limited by the width of the visibility masks.
+	static const uint32_t MAX_VIEWS = 32;
+
+private:
+	struct VisibleDraw {
+		MeshDraw draw;
+		// Bit i is set if view i sees the draw.
+		uint32_t viewMask;
+	};
+
+	// Views drawn with one instanced draw per packet.
+	struct ViewGroup {
+		std::vector<uint32_t> views;
+		glm::ivec4 viewport;
+	};
+
+	std::vector<RenderView> m_views;
+	std::vector<Frustum> m_frustums;
+	glm::vec3 m_combinedMin;
+	glm::vec3 m_combinedMax;
+
+	// The packets that survived culling, in draw order per bucket.
+	std::vector<VisibleDraw> m_opaque;
+	std::vector<VisibleDraw> m_masked;
+	std::vector<VisibleDraw> m_blended;
+
+	// Scratch space for sorting, kept between frames.
+	std::vector<VisibleDraw> m_sorted;
+	std::vector<uint32_t> m_sortKeys;
+	std::vector<uint32_t> m_sortOrder;
+	std::vector<uint32_t> m_scratchKeys;
+	std::vector<uint32_t> m_scratchOrder;
+
+	std::vector<ViewGroup> m_groups;
+	ShaderProgram m_program;
+	glm::vec3 m_ambientColor;
+	glm::vec3 m_directionalLight;
+	glm::vec3 m_directionalColor;
+	const ReflectionProbes* m_reflectionProbes;
+
+	uint32_t m_drawsTested;
+	uint32_t m_viewDraws;
+	uint32_t m_drawCalls;
+
+	void cullBucket(const std::vector<MeshDraw>& draws, std::vector<VisibleDraw>& visible);
+	void sortBlended();
+	void buildGroups();
+	void renderGroup(const ViewGroup& group);
+	void renderBucket(const ViewGroup& group, const std::vector<VisibleDraw>& draws);
+
+public:
+	MultiViewRenderer();
+
+	/**
+	 * @brief Replaces the views to draw. Throws if there are more than MAX_VIEWS.
+	 */
+	void setViews(const std::vector<RenderView>& views);
+	const std::vector<RenderView>& views() const { return m_views; }
+
+	void setLighting(const glm::vec3& ambientColor, const glm::vec3& directionalLight,
+		const glm::vec3& directionalColor);
+	void setReflectionProbes(const ReflectionProbes* probes);
+
+	/**
+	 * @brief Culls the queue's draws against every view at once, and sorts its blended draws.
+	 */
+	void cull(const RenderQueue& queue);
+
+	/**
+	 * @brief Clears every view's rectangle and draws the culled draws into it: opaque, then
+	 * alpha-masked, then blended.
+	 */
+	void render();
+
+	// Statistics of the last cull() and render().
+	uint32_t drawsTested() const { return m_drawsTested; }
+	uint32_t drawsVisible() const {
+		return static_cast<uint32_t>(m_opaque.size() + m_masked.size() + m_blended.size());
+	}
+	// The sum, over every view, of the draws it sees.
+	uint32_t viewDraws() const { return m_viewDraws; }
+	uint32_t drawCalls() const { return m_drawCalls; }
+	uint32_t groupCount() const { return static_cast<uint32_t>(m_groups.size()); }
+};
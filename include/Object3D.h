@@ -2,17 +2,19 @@
 #include <memory>
 #include "ShaderProgram.h"
 #include "Mesh3D.h"
+#include "MeshDraw.h"
+#include "Transform.h"
+
+class MeshletCuller;
+
 class Object3D {
 private:
 	// The object's list of meshes and children.
 	std::vector<Mesh3D> m_meshes;
 	std::vector<Object3D> m_children;
 
-	// The object's position, orientation, and scale in world space.
-	glm::vec3 m_position;
-	glm::vec3 m_orientation;
-	glm::vec3 m_scale;
-	glm::vec3 m_center;
+	// The object's position, orientation, scale, and center of rotation relative to its parent.
+	Transform m_transform;
 
 	// The object's material.
 	glm::vec4 m_material;
@@ -20,12 +22,18 @@ private:
 	// The object's base transformation matrix.
 	glm::mat4 m_baseTransform;
 
+	// Incremented whenever the object's transform changes.
+	uint32_t m_transformVersion;
+
 	// Some objects from Assimp imports have a "name" field, useful for debugging.
 	std::string m_name;
 
 	// Recomputes the local->world transformation matrix.
 	glm::mat4 buildModelMatrix() const;
 
+	void collectDrawsRecursive(std::vector<MeshDraw>& draws, const glm::mat4& parentMatrix,
+		const glm::vec4& material) const;
+
 
 public:
 	// No default constructor; you must have a mesh to initialize an object.
@@ -36,11 +44,17 @@ public:
 
 	// Simple accessors.
 	const glm::vec3& getPosition() const;
-	const glm::vec3& getOrientation() const;
+	glm::vec3 getOrientation() const;
+	const glm::quat& getRotation() const;
 	const glm::vec3& getScale() const;
 	const glm::vec3& getCenter() const;
 	const std::string& getName() const;
 	const glm::vec4& getMaterial() const;
+	const Transform& getTransform() const;
+	const glm::mat4& getBaseTransform() const;
+
+	std::vector<Mesh3D>& getMeshes();
+	const std::vector<Mesh3D>& getMeshes() const;
 
 	// Child management.
 	size_t numberOfChildren() const;
@@ -51,18 +65,31 @@ public:
 	// Simple mutators.
 	void setPosition(const glm::vec3& position);
 	void setOrientation(const glm::vec3& orientation);
+	void setRotation(const glm::quat& rotation);
 	void setScale(const glm::vec3& scale);
 	void setCenter(const glm::vec3& center);
 	void setName(const std::string& name);
 	void setMaterial(const glm::vec4& material);
+	void setBaseTransform(const glm::mat4& baseTransform);
+	void setTransform(const Transform& transform);
 
 	// Transformations.
 	void move(const glm::vec3& offset);
 	void rotate(const glm::vec3& rotation);
 	void grow(const glm::vec3& growth);
 	void addChild(Object3D&& child);
+	void replaceContents(Object3D&& other, size_t replacedChildren);
+
+	// Rendering. If a culler is given, meshes that have meshlets draw only their visible meshlets.
+	void render(ShaderProgram& shaderProgram, MeshletCuller* culler = nullptr) const;
+	void renderRecursive(ShaderProgram& shaderProgram, const glm::mat4& parentMatrix,
+		MeshletCuller* culler = nullptr) const;
+
+	// A number that changes whenever the transform of this object or any of its descendants
+	// changes, so that consumers can detect changes without comparing matrices.
+	uint64_t transformVersion() const;
 
-	// Rendering.
-	void render(ShaderProgram& shaderProgram) const;
-	void renderRecursive(ShaderProgram& shaderProgram, const glm::mat4& parentMatrix) const;
+	// Appends a MeshDraw for every mesh in the hierarchy, instead of rendering it immediately.
+	// Like render(), every mesh in the hierarchy uses this object's material.
+	void collectDraws(std::vector<MeshDraw>& draws) const;
 };
\ No newline at end of file
@@ -0,0 +1,8 @@
+#pragma once
+
+/**
+ * @brief Measures the CPU particle simulation, scalar and with SSE, and the radix sort that
+ * alpha-blended emitters need, with 10k, 100k and 1M particles, and prints the results. Runs
+ * offline, without a window; the GPU simulation is timed in the running scene instead.
+ */
+void runParticleBenchmark();
@@ -0,0 +1,66 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Where and how one emitter spawns particles this frame, in world space. Shared by the CPU
+ * simulation and particle_simulate.comp.
+ */
+struct ParticleSpawn {
+	glm::vec3 position = glm::vec3(0);
+	// A unit vector; particles leave within a cone around it.
+	glm::vec3 direction = glm::vec3(0, 1, 0);
+	// The radius of the cone at unit distance along the direction.
+	float spread = 0.3f;
+	float speed = 5.0f;
+	float lifetime = 2.0f;
+	glm::vec3 gravity = glm::vec3(0, -9.8f, 0);
+	// The fraction of velocity lost per second.
+	float drag = 0.0f;
+};
+
+/**
+ * @brief Particles as a structure of arrays, so that the CPU simulation can update four at a time.
+ *
+ * A particle whose age has reached its lifetime is respawned in place, carrying over the time
+ * past its lifetime, so a range of n particles with lifetime t emits n / t particles per second
+ * without any allocation. Negative ages are particles that have not been born yet.
+ */
+struct ParticleArrays {
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+	std::vector<float> velocityX;
+	std::vector<float> velocityY;
+	std::vector<float> velocityZ;
+	std::vector<float> age;
+	std::vector<float> lifetime;
+
+	void resize(size_t count);
+	size_t size() const { return age.size(); }
+};
+
+/**
+ * @brief A well-mixed 32-bit hash (PCG), the same as particleHash in particle_simulate.comp.
+ */
+uint32_t particleHash(uint32_t value);
+
+/**
+ * @brief Staggers the birth of a range of particles over one lifetime, so that the range starts
+ * emitting at a steady rate instead of in one burst.
+ */
+void initializeParticles(ParticleArrays& particles, uint32_t first, uint32_t count, float lifetime);
+
+/**
+ * @brief Advances a range of particles by dt seconds, respawning those that have died.
+ * @param seed varies the random directions of respawned particles; change it every frame.
+ * @param useSimd whether to integrate four particles at a time with SSE, where available.
+ */
+void simulateParticles(ParticleArrays& particles, uint32_t first, uint32_t count, const ParticleSpawn& spawn,
+	float dt, uint32_t seed, bool useSimd);
+
+/**
+ * @brief Whether simulateParticles has an SSE path in this build.
+ */
+bool particleSimdAvailable();
@@ -0,0 +1,138 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <vector>
+#include "ParticleSimulation.h"
+#include "ShaderProgram.h"
+
+class Object3D;
+
+/**
+ * @brief How an emitter's particles are blended into the scene.
+ */
+enum class ParticleBlend {
+	// Added to the scene (sparks, glow), in any order.
+	Additive,
+	// Blended over the scene (confetti), which needs the particles sorted back to front.
+	Alpha
+};
+
+struct ParticleEmitterSettings {
+	// Where particles start, relative to the node's position and rotated with the node.
+	glm::vec3 offset = glm::vec3(0);
+	// The direction particles leave in, rotated with the node.
+	glm::vec3 direction = glm::vec3(0, 1, 0);
+	float spread = 0.3f;
+	float speed = 5.0f;
+	// Particles per second, and how long each lives on average.
+	float rate = 100.0f;
+	float lifetime = 2.0f;
+	glm::vec3 gravity = glm::vec3(0, -9.8f, 0);
+	float drag = 0.0f;
+	glm::vec4 startColor = glm::vec4(1);
+	glm::vec4 endColor = glm::vec4(1, 1, 1, 0);
+	float startSize = 0.2f;
+	float endSize = 0.1f;
+	float colorVariation = 0.0f;
+	ParticleBlend blend = ParticleBlend::Additive;
+};
+
+/**
+ * @brief Particle effects attached to scene objects.
+ *
+ * Every emitter owns a fixed range of particles sized to its rate and lifetime, whose particles
+ * respawn in place when they die (see ParticleArrays). Additive emitters are simulated by a
+ * compute shader (particle_simulate.comp) that ping-pongs between two storage buffers, which are
+ * then drawn directly as instance data. Alpha-blended emitters must be sorted every frame, so they
+ * are simulated on the CPU, four particles at a time with SSE, radix sorted by distance to the
+ * camera and uploaded. Without OpenGL 4.3, every emitter takes the CPU path.
+ *
+ * Each emitter is drawn with one instanced draw of camera-facing quads (particle.vert).
+ */
+class ParticleSystem {
+public:
+	/**
+	 * @brief One particle as stored in the buffers; matches struct Particle in
+	 * particle_simulate.comp and the attributes of particle.vert.
+	 */
+	struct GpuParticle {
+		glm::vec4 positionAge;
+		glm::vec4 velocityLifetime;
+	};
+
+private:
+	struct Emitter {
+		const Object3D* node;
+		ParticleEmitterSettings settings;
+		bool onGpu;
+		// The emitter's range in the GPU buffers or the CPU arrays.
+		uint32_t first;
+		uint32_t count;
+	};
+
+	std::vector<Emitter> m_emitters;
+	float m_density;
+	bool m_layoutChanged;
+	bool m_gpuSupported;
+	bool m_useSimd;
+	uint32_t m_seed;
+
+	// CPU-simulated particles, and the same in draw order for upload.
+	ParticleArrays m_cpuParticles;
+	std::vector<GpuParticle> m_packed;
+	uint32_t m_cpuBuffer;
+	// GPU-simulated particles: last frame's state is read from one buffer, and this frame's written
+	// to the other.
+	uint32_t m_gpuBuffers[2];
+	uint32_t m_gpuIndex;
+	uint32_t m_gpuParticleCount;
+
+	ShaderProgram m_simulateProgram;
+	ShaderProgram m_renderProgram;
+	uint32_t m_vao;
+
+	// Scratch space for sorting, kept between frames.
+	std::vector<uint32_t> m_sortKeys;
+	std::vector<uint32_t> m_sortOrder;
+	std::vector<uint32_t> m_scratchKeys;
+	std::vector<uint32_t> m_scratchOrder;
+	std::vector<uint32_t> m_emitterOrder;
+
+	double m_cpuMilliseconds;
+
+	void layout();
+	ParticleSpawn spawnOf(const Emitter& emitter) const;
+	void packCpuEmitter(const Emitter& emitter, const glm::vec3& cameraPos);
+
+public:
+	ParticleSystem(bool preferGpu = true);
+
+	/**
+	 * @brief Adds an emitter that follows the given node, which must outlive the system.
+	 */
+	uint32_t addEmitter(const Object3D& node, const ParticleEmitterSettings& settings);
+
+	/**
+	 * @brief Scales the number of particles of every emitter, for benchmarking.
+	 */
+	void setDensity(float density);
+	float density() const { return m_density; }
+	void setUseSimd(bool useSimd) { m_useSimd = useSimd; }
+	bool usesSimd() const { return m_useSimd; }
+
+	/**
+	 * @brief Advances every emitter's particles by dt seconds.
+	 */
+	void update(float dt);
+
+	/**
+	 * @brief Draws every emitter's particles into the bound framebuffer, depth-tested against the
+	 * scene but not writing depth.
+	 */
+	void render(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos);
+
+	uint32_t particleCount() const;
+	uint32_t gpuParticleCount() const { return m_gpuParticleCount; }
+	// The CPU time of the last update()'s CPU simulation, and render()'s sorting and packing.
+	double cpuMilliseconds() const { return m_cpuMilliseconds; }
+};
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Maps a float to an unsigned integer with the same ordering, so that floats can be
+ * radix sorted as integers.
+ */
+uint32_t floatToSortableKey(float value);
+
+/**
+ * @brief Sorts keys in ascending order, applying the same permutation to values, with an LSD
+ * radix sort of four 8-bit digits. Runs in linear time; passes in which every key has the same
+ * digit are skipped. The scratch vectors are resized as needed and can be reused between calls
+ * to avoid allocations.
+ */
+void radixSort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values,
+	std::vector<uint32_t>& scratchKeys, std::vector<uint32_t>& scratchValues);
@@ -0,0 +1,118 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <vector>
+#include "GpuTimer.h"
+#include "MeshDraw.h"
+#include "ShaderProgram.h"
+
+/**
+ * @brief A cube map of the scene as seen from one point, prefiltered so that its mip levels hold
+ * the reflections of increasingly rough surfaces.
+ */
+struct ReflectionProbe {
+	glm::vec3 position;
+	// The box that reflections are projected onto, usually the room the probe is in.
+	glm::vec3 boxMin;
+	glm::vec3 boxMax;
+	// Static probes are rendered once, by bakeStatic(); the others are refreshed continuously.
+	bool isStatic;
+	// RGBA16F, with one prefiltered level per roughness step.
+	uint32_t cubemap;
+	// Whether the cube map has been completely rendered at least once.
+	bool valid;
+};
+
+/**
+ * @brief Reflection probes whose updates are spread over many frames.
+ *
+ * Updating a probe takes twelve steps: six that render a cube face of the scene into a shared
+ * scratch cube map, then six that prefilter one face into every mip level of the probe's own cube
+ * map with GGX importance sampling. update() runs as many steps as fit in a GPU time budget,
+ * cycling through the dynamic probes, so a probe is never shown half-rendered and the cost per
+ * frame stays bounded.
+ *
+ * lighting.frag blends the two probes nearest to the camera per fragment, with the reflection
+ * vector corrected for parallax against each probe's box.
+ */
+class ReflectionProbes {
+private:
+	static const uint32_t STEPS_PER_UPDATE = 12;
+
+	std::vector<ReflectionProbe> m_probes;
+	uint32_t m_size;
+	uint32_t m_levels;
+
+	uint32_t m_captureCubemap;
+	uint32_t m_captureDepth;
+	uint32_t m_captureFramebuffer;
+	uint32_t m_prefilterFramebuffer;
+	ShaderProgram m_captureProgram;
+	ShaderProgram m_prefilterProgram;
+
+	// The dynamic probe being updated, and its next step.
+	size_t m_currentProbe;
+	uint32_t m_currentStep;
+
+	// GPU time of recent updates, for estimating the cost of one step.
+	GpuTimer m_timer;
+	uint32_t m_timedFrames;
+	uint32_t m_timedSteps;
+	uint32_t m_lastSteps;
+
+	std::vector<MeshDraw> m_faceDraws;
+
+	void runStep(ReflectionProbe& probe, uint32_t step, const std::vector<MeshDraw>& draws);
+	void captureFace(const ReflectionProbe& probe, uint32_t face, const std::vector<MeshDraw>& draws);
+	void prefilterFace(ReflectionProbe& probe, uint32_t face);
+
+public:
+	/**
+	 * @param size the width and height of every cube face.
+	 */
+	explicit ReflectionProbes(uint32_t size = 128);
+
+	/**
+	 * @brief Adds a probe, and returns its index. Its cube map is black until it is first rendered.
+	 */
+	size_t addProbe(const glm::vec3& position, const glm::vec3& boxMin, const glm::vec3& boxMax, bool isStatic);
+	const ReflectionProbe& getProbe(size_t index) const { return m_probes[index]; }
+	size_t probeCount() const { return m_probes.size(); }
+
+	/**
+	 * @brief Sets the lighting of the scene as the probes see it.
+	 */
+	void setLighting(const glm::vec3& ambientColor, const glm::vec3& directionalLight,
+		const glm::vec3& directionalColor);
+
+	/**
+	 * @brief Renders every static probe completely. Call once, after the static scene is loaded;
+	 * the probes are not rendered again.
+	 * @param draws the draws the probes see, typically a low-detail version of the scene.
+	 */
+	void bakeStatic(const std::vector<MeshDraw>& draws);
+
+	/**
+	 * @brief Runs update steps of the dynamic probes until the estimated GPU time of this frame's
+	 * steps reaches the budget. At least one step is run if any dynamic probe exists.
+	 */
+	void update(const std::vector<MeshDraw>& draws, float budgetMilliseconds);
+
+	/**
+	 * @brief Points lighting.frag in the active program at the two valid probes nearest to the
+	 * given position, or disables reflections if there are none.
+	 */
+	void apply(ShaderProgram& program, const glm::vec3& position) const;
+
+	/**
+	 * @brief Disables reflections in lighting.frag in the active program. Its probe samplers are
+	 * still pointed at units of their own, which a program must do before drawing even if it
+	 * never reflects anything.
+	 */
+	static void disable(ShaderProgram& program);
+
+	/**
+	 * @brief The number of update steps run in the last call to update().
+	 */
+	uint32_t lastStepCount() const { return m_lastSteps; }
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <vector>
+#include "MeshDraw.h"
+#include "ShaderProgram.h"
+
+class Object3D;
+class MeshletCuller;
+
+/**
+ * @brief Collects the draws of a frame into buckets by alpha mode, so that opaque and
+ * alpha-masked meshes are drawn before blended ones, and blended meshes are drawn back to front.
+ */
+class RenderQueue {
+private:
+	std::vector<MeshDraw> m_opaque;
+	std::vector<MeshDraw> m_masked;
+	std::vector<MeshDraw> m_blended;
+
+	// Scratch space for sorting, kept between frames to avoid allocations.
+	std::vector<MeshDraw> m_collected;
+	std::vector<MeshDraw> m_sorted;
+	std::vector<uint32_t> m_sortKeys;
+	std::vector<uint32_t> m_sortOrder;
+	std::vector<uint32_t> m_scratchKeys;
+	std::vector<uint32_t> m_scratchOrder;
+
+public:
+	/**
+	 * @brief Empties every bucket, for the next frame.
+	 */
+	void clear();
+
+	/**
+	 * @brief Adds the draws of an object hierarchy to the buckets matching their meshes' alpha modes.
+	 */
+	void submit(const Object3D& object);
+
+	/**
+	 * @brief Sorts the blended bucket from farthest to nearest along the view direction, using the
+	 * centers of the meshes' bounding spheres. Linear in the number of blended draws.
+	 */
+	void sortBlended(const glm::mat4& view);
+
+	const std::vector<MeshDraw>& getOpaque() const { return m_opaque; }
+	const std::vector<MeshDraw>& getMasked() const { return m_masked; }
+	const std::vector<MeshDraw>& getBlended() const { return m_blended; }
+
+	/**
+	 * @brief Draws the given draws in order with a forward shading program.
+	 */
+	static void render(const std::vector<MeshDraw>& draws, ShaderProgram& program, MeshletCuller* culler);
+
+	/**
+	 * @brief Draws the blended bucket with alpha blending and without depth writes. Call
+	 * sortBlended first.
+	 */
+	void renderBlended(ShaderProgram& program, MeshletCuller* culler) const;
+};
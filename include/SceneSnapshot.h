@@ -0,0 +1,69 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Animator.h"
+#include "Object3D.h"
+#include "Transform.h"
+
+class TextureStreamer;
+
+/**
+ * @brief What changes while the scene runs, saved often so that a restart can pick up where the
+ * last run stopped. Transforms and materials are those of the scene's top-level objects, in order;
+ * animators only ever move whole objects.
+ */
+struct SceneState {
+	std::vector<Transform> objectTransforms;
+	std::vector<glm::vec4> objectMaterials;
+	std::vector<AnimatorState> animators;
+	glm::vec3 cameraPos;
+	float cameraYaw;
+	float cameraPitch;
+};
+
+/**
+ * @brief A number that changes whenever a file under the directory is added, removed or
+ * modified, so that snapshots of the assets in it can tell when they are out of date.
+ */
+uint64_t assetStamp(const std::filesystem::path& directory);
+
+/**
+ * @brief Writes the scene's objects, fully resolved, to a single file: their node hierarchies
+ * flattened in depth-first order, every distinct mesh's vertices, faces and meshlets read back
+ * from VRAM, and every distinct texture's complete mip chain. Vertices and faces are stored
+ * compressed by GeometryCodec, which loses nothing. Textures created by the streamer are taken
+ * from its copy in system memory; others are read back. Each texture keeps the image path
+ * texturePaths gives for it, if any, so that a restored scene can still be watched for edits.
+ * The file is written under a
+ * temporary name and then renamed, so a crash never leaves a partial snapshot behind. Throws if
+ * the file can't be written.
+ */
+void saveSceneSnapshot(const std::string& path, const std::vector<Object3D>& objects,
+	const std::vector<size_t>& modelObjects, uint64_t assetStamp, const TextureStreamer* streamer,
+	const std::unordered_map<uint32_t, std::string>& texturePaths);
+
+/**
+ * @brief Reads a snapshot written by saveSceneSnapshot in one pass and uploads it, appending its
+ * objects and model indices to the given lists, and the image path of each texture that has one
+ * to texturePaths. Returns false, without changing anything, if the
+ * file doesn't exist, was written by another version of the format, or was taken of assets with
+ * another stamp. Throws if the file is corrupt.
+ */
+bool loadSceneSnapshot(const std::string& path, uint64_t assetStamp, std::vector<Object3D>& objects,
+	std::vector<size_t>& modelObjects, TextureStreamer* streamer,
+	std::unordered_map<uint32_t, std::string>& texturePaths);
+
+/**
+ * @brief Writes a scene state, replacing the previous one only once the new one is complete.
+ */
+void saveSceneState(const std::string& path, const SceneState& state);
+
+/**
+ * @brief Reads a scene state written by saveSceneState. Returns false if there is none, or it
+ * can't be read.
+ */
+bool loadSceneState(const std::string& path, SceneState& state);
@@ -0,0 +1,79 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MeshDraw.h"
+#include "ShaderProgram.h"
+
+class Object3D;
+
+/**
+ * @brief What a screen's content is asked to draw.
+ */
+struct ScreenFrame {
+	uint32_t width;
+	uint32_t height;
+	// The texture being rendered into, which the content must not sample.
+	uint32_t texture;
+	// Seconds since the screen was added, and since its last refresh.
+	float time;
+	float elapsed;
+};
+
+/**
+ * @brief Something a render-to-texture screen shows, drawn by the engine itself.
+ */
+class ScreenContent {
+public:
+	virtual ~ScreenContent() = default;
+
+	/**
+	 * @brief Draws the content into the bound framebuffer, which is cleared and has its viewport set.
+	 */
+	virtual void render(const ScreenFrame& frame) = 0;
+};
+
+/**
+ * @brief 2D content: a fragment shader run over the whole screen, given the uniforms "time" and
+ * "resolution".
+ */
+class ShaderScreenContent : public ScreenContent {
+private:
+	ShaderProgram m_program;
+
+public:
+	explicit ShaderScreenContent(const std::string& fragmentPath);
+	void render(const ScreenFrame& frame) override;
+};
+
+/**
+ * @brief 3D content: the scene as seen by a camera that slowly pans from side to side, like a
+ * security camera. Blended meshes are left out, and so is any mesh showing the screen itself.
+ */
+class SceneCameraContent : public ScreenContent {
+private:
+	const std::vector<Object3D>& m_objects;
+	glm::vec3 m_position;
+	glm::vec3 m_target;
+	float m_fieldOfView;
+	ShaderProgram m_program;
+	std::vector<MeshDraw> m_draws;
+	std::vector<MeshDraw> m_visibleDraws;
+
+public:
+	/**
+	 * @param objects the scene's objects, read whenever the screen is refreshed.
+	 * @param fieldOfView the vertical field of view in radians.
+	 */
+	SceneCameraContent(const std::vector<Object3D>& objects, const glm::vec3& position, const glm::vec3& target,
+		float fieldOfView);
+
+	/**
+	 * @brief Sets the lighting of the scene as the camera sees it.
+	 */
+	void setLighting(const glm::vec3& ambientColor, const glm::vec3& directionalLight,
+		const glm::vec3& directionalColor);
+
+	void render(const ScreenFrame& frame) override;
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "GpuTimer.h"
+#include "ScreenContent.h"
+
+/**
+ * @brief Render-to-texture screens whose refreshes are scheduled by how they are seen.
+ *
+ * Every screen renders its content into a framebuffer of its own, whose color texture (with
+ * mipmaps) is shown on a surface of the scene. update() gives each screen a refresh rate from the
+ * size its bounding sphere projects to: every frame once it covers FULL_RATE_PIXELS of the view,
+ * dropping in proportion below that down to MIN_RATE_HZ, and never while it is outside the view,
+ * so a culled screen keeps its last image. The screens that are due are refreshed most overdue
+ * first until their estimated GPU time reaches a budget shared by all screens, so the main view's
+ * frame time stays bounded however many are close.
+ */
+class ScreenRenderTargets {
+private:
+	struct Screen {
+		std::unique_ptr<ScreenContent> content;
+		uint32_t width;
+		uint32_t height;
+		uint32_t texture;
+		uint32_t depth;
+		uint32_t framebuffer;
+		glm::vec3 center;
+		float radius;
+		float time;
+		float sinceRefresh;
+		// Seconds between refreshes; 0 refreshes every frame, and a negative interval never.
+		float interval;
+		bool valid;
+	};
+
+	std::vector<Screen> m_screens;
+	std::vector<uint32_t> m_dueScreens;
+
+	// GPU time of recent updates, for estimating the cost of one refresh.
+	GpuTimer m_timer;
+	uint32_t m_timedFrames;
+	uint32_t m_timedRefreshes;
+
+	uint32_t m_lastRefreshes;
+	uint32_t m_lastDue;
+	uint32_t m_frozenScreens;
+	uint32_t m_fullRateScreens;
+
+	void refresh(Screen& screen);
+
+public:
+	static constexpr float FULL_RATE_PIXELS = 300.0f;
+	static constexpr float MAX_RATE_HZ = 60.0f;
+	static constexpr float MIN_RATE_HZ = 4.0f;
+
+	ScreenRenderTargets();
+	~ScreenRenderTargets();
+	ScreenRenderTargets(const ScreenRenderTargets&) = delete;
+	ScreenRenderTargets& operator=(const ScreenRenderTargets&) = delete;
+
+	/**
+	 * @brief Adds a screen of the given resolution and returns its index. It is black until its
+	 * first refresh, which happens as soon as it is seen.
+	 */
+	uint32_t addScreen(std::unique_ptr<ScreenContent> content, uint32_t width, uint32_t height);
+
+	/**
+	 * @brief The texture a screen renders into, to show on a mesh.
+	 */
+	uint32_t texture(uint32_t screen) const { return m_screens[screen].texture; }
+
+	/**
+	 * @brief Sets the world-space bounding sphere of the surface that shows the screen.
+	 */
+	void setBounds(uint32_t screen, const glm::vec3& center, float radius);
+
+	/**
+	 * @brief Refreshes the screens that are due, most overdue first, until the estimated GPU time
+	 * of this frame's refreshes reaches the budget. At least one due screen is refreshed. Restores
+	 * the program, viewport and framebuffer.
+	 */
+	void update(float dt, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos,
+		uint32_t viewportHeight, float budgetMilliseconds);
+
+	uint32_t screenCount() const { return static_cast<uint32_t>(m_screens.size()); }
+	/**
+	 * @brief What the last update() did: screens refreshed and due, screens frozen outside the
+	 * view, and screens refreshed every frame.
+	 */
+	uint32_t lastRefreshCount() const { return m_lastRefreshes; }
+	uint32_t lastDueCount() const { return m_lastDue; }
+	uint32_t frozenCount() const { return m_frozenScreens; }
+	uint32_t fullRateCount() const { return m_fullRateScreens; }
+};
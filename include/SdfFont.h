@@ -0,0 +1,79 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Where one glyph's signed distance field lies in the atlas.
+ */
+struct SdfGlyph {
+	uint32_t page;
+	glm::vec2 uvMin;
+	glm::vec2 uvMax;
+};
+
+/**
+ * @brief A signed distance field atlas of the built-in 5x7 pixel font.
+ *
+ * The constructor rasterizes every glyph's distance field on worker threads, each writing its own
+ * cells of the CPU-side pages, then uploads the pages as single-channel textures. Glyphs are
+ * looked up by character; lowercase letters use their uppercase glyph and unknown characters
+ * show as '?'.
+ *
+ * All metrics are in units of the cap height, so a string drawn at height h advances h * ADVANCE
+ * per character.
+ */
+class SdfFont {
+public:
+	static const uint32_t PAGE_SIZE = 512;
+	// The size of one glyph's cell in an atlas page, and the pixels per font pixel within it.
+	static const uint32_t CELL_SIZE = 48;
+	static const uint32_t CELL_SCALE = 5;
+	// How far, in atlas pixels, the distance field reaches either side of a glyph's edge.
+	static constexpr float SPREAD = 6.0f;
+
+	static const uint32_t GLYPH_COLUMNS = 5;
+	static const uint32_t GLYPH_ROWS = 7;
+	// Five font pixels of glyph and one of spacing, per seven of cap height.
+	static constexpr float ADVANCE = 6.0f / GLYPH_ROWS;
+	static constexpr float LINE_HEIGHT = 9.0f / GLYPH_ROWS;
+	// The size of a glyph's quad, and where its corner sits relative to the glyph's baseline origin.
+	static constexpr float QUAD_SIZE = static_cast<float>(CELL_SIZE) / CELL_SCALE / GLYPH_ROWS;
+	static constexpr float QUAD_OFFSET_X = -static_cast<float>((CELL_SIZE - GLYPH_COLUMNS * CELL_SCALE) / 2) / CELL_SCALE / GLYPH_ROWS;
+	static constexpr float QUAD_OFFSET_Y = -static_cast<float>((CELL_SIZE - GLYPH_ROWS * CELL_SCALE) / 2) / CELL_SCALE / GLYPH_ROWS;
+
+private:
+	std::vector<SdfGlyph> m_glyphs;
+	// The glyph of each ASCII character, or -1.
+	std::array<int32_t, 128> m_glyphIndex;
+	std::vector<uint32_t> m_pages;
+	uint32_t m_buildThreads;
+	double m_buildMilliseconds;
+
+public:
+	/**
+	 * @brief Builds the atlas on the given number of threads, or one per hardware thread if 0.
+	 * Must be called with an OpenGL context current.
+	 */
+	explicit SdfFont(uint32_t threads = 0);
+	~SdfFont();
+	SdfFont(const SdfFont&) = delete;
+	SdfFont& operator=(const SdfFont&) = delete;
+
+	/**
+	 * @brief The glyph that draws the given character; never null.
+	 */
+	const SdfGlyph& glyph(char c) const;
+
+	/**
+	 * @brief The width of a single line of text drawn at the given cap height.
+	 */
+	static float measure(size_t characters, float height) { return characters * ADVANCE * height; }
+
+	uint32_t pageCount() const { return static_cast<uint32_t>(m_pages.size()); }
+	uint32_t pageTexture(uint32_t page) const { return m_pages[page]; }
+	uint32_t glyphCount() const { return static_cast<uint32_t>(m_glyphs.size()); }
+	uint32_t buildThreads() const { return m_buildThreads; }
+	double buildMilliseconds() const { return m_buildMilliseconds; }
+};
@@ -7,13 +7,19 @@ class ShaderProgram {
 public:
 	ShaderProgram();
 	void load(const std::string& vertexShaderPath, const std::string& fragmentShaderPath);
+	/**
+	 * @brief Loads a compute shader program. Requires OpenGL 4.3.
+	 */
+	void loadCompute(const std::string& computeShaderPath);
 
 	void activate();
 
 	void setUniform(const std::string& uniformName, bool value);
 	void setUniform(const std::string& uniformName, int32_t value);
+	void setUniform(const std::string& uniformName, uint32_t value);
 	void setUniform(const std::string& uniformName, float value);
 	void setUniform(const std::string& uniformName, const glm::vec2& value);
+	void setUniform(const std::string& uniformName, const glm::ivec2& value);
 	void setUniform(const std::string& uniformName, const glm::vec3& value);
 	void setUniform(const std::string& uniformName, const glm::vec4& value);
 	void setUniform(const std::string& uniformName, const glm::mat2& value);
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A sound decoded in full at the mixer's sample rate, shared by every voice that plays it.
+ */
+struct SoundClip {
+	// Interleaved samples, channels per frame.
+	std::vector<float> samples;
+	uint32_t channels;
+	uint64_t frames;
+};
+
+/**
+ * @brief Decides whether sounds are preloaded or streamed, and caches preloaded clips.
+ *
+ * Short sounds (like cabinet effects that restart often) are decoded once and shared, so playing
+ * them again costs neither file I/O nor decoding. Sounds longer than the streaming threshold
+ * (like music) are streamed instead, since holding them decoded would cost megabytes each.
+ */
+class SoundBank {
+private:
+	std::mutex m_mutex;
+	// Keyed by path and channel count, since the same file may be played both mono and stereo.
+	std::map<std::pair<std::string, uint32_t>, std::shared_ptr<const SoundClip>> m_clips;
+	float m_streamThreshold;
+
+public:
+	/**
+	 * @brief Sounds longer than the given number of seconds are streamed rather than preloaded.
+	 */
+	explicit SoundBank(float streamThresholdSeconds = 10.0f);
+
+	/**
+	 * @brief True if the given file is long enough that it should be streamed. Throws if the file
+	 * can't be opened.
+	 */
+	bool shouldStream(const std::string& path) const;
+
+	/**
+	 * @brief Returns the decoded clip for the given file and channel count (1 or 2), decoding it on
+	 * first use. Throws if the file can't be opened.
+	 */
+	std::shared_ptr<const SoundClip> load(const std::string& path, uint32_t channels);
+
+	/**
+	 * @brief Drops cached clips that no voice is playing.
+	 */
+	void unloadUnused();
+
+	/**
+	 * @brief The number of bytes of decoded samples held by the bank.
+	 */
+	size_t memoryUsage();
+	size_t clipCount();
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <SFML/Audio.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Decodes a sound file in chunks of float samples at the mixer's sample rate, with either
+ * one channel (stereo files are downmixed) or two (mono files are duplicated).
+ */
+class SoundDecoder {
+private:
+	sf::InputSoundFile m_file;
+	uint32_t m_fileChannels;
+	uint64_t m_fileFrames;
+	// File frames advanced per output frame.
+	double m_step;
+	uint32_t m_channels;
+
+	std::vector<int16_t> m_fileScratch;
+	std::vector<float> m_convertScratch;
+	std::vector<float> m_outputScratch;
+
+	// Resampling position relative to the last decoded file frame, and that frame's samples.
+	double m_phase;
+	float m_history[2];
+
+public:
+	/**
+	 * @brief The number of file frames read by each call to decode().
+	 */
+	static const size_t CHUNK_FRAMES = 2048;
+
+	/**
+	 * @brief Opens the given file for decoding with the given number of output channels (1 or 2).
+	 * Throws if the file can't be opened.
+	 */
+	SoundDecoder(const std::string& path, uint32_t channels);
+
+	uint32_t channels() const { return m_channels; }
+
+	/**
+	 * @brief The length of the sound in output frames.
+	 */
+	uint64_t lengthFrames() const;
+
+	/**
+	 * @brief The most output frames that a single call to decode() can produce.
+	 */
+	size_t maxChunkFrames() const;
+
+	/**
+	 * @brief The number of bytes held by the decoder's buffers.
+	 */
+	size_t memoryUsage() const;
+
+	/**
+	 * @brief Decodes the next chunk of the file, pointing samples at the decoded (interleaved)
+	 * output. Returns the number of output frames, or 0 at the end of the file.
+	 */
+	size_t decode(const float*& samples);
+
+	/**
+	 * @brief Moves decoding to the given output frame.
+	 */
+	void seek(uint64_t frame);
+
+	/**
+	 * @brief Continues decoding from the start of the file, keeping the resampling state so that
+	 * a loop has no seam.
+	 */
+	void rewind();
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "SdfFont.h"
+#include "ShaderProgram.h"
+
+/**
+ * @brief Draws batches of world-space and screen-space text with a signed distance field font.
+ *
+ * Strings are added every frame and turned straight into glyph quads, grouped by atlas page.
+ * render() uploads every quad of the frame into one orphaned vertex buffer and draws each page's
+ * quads, world-space and screen-space alike, with a single draw call (text.vert), then forgets
+ * them. World-space text is depth tested against the scene; screen-space text sits on the near
+ * plane, over everything, and is drawn after the world-space text of its page.
+ */
+class TextRenderer {
+public:
+	/**
+	 * @brief One glyph quad corner; matches the attributes of text.vert.
+	 */
+	struct TextVertex {
+		// A world position, or a pixel position from the top left of the viewport.
+		glm::vec3 position;
+		float screenSpace;
+		glm::vec2 texCoord;
+		// RGBA8, normalized by the vertex attribute.
+		uint32_t color;
+		float padding;
+	};
+
+private:
+	struct PageQuads {
+		std::vector<TextVertex> world;
+		std::vector<TextVertex> screen;
+	};
+
+	SdfFont m_font;
+	ShaderProgram m_program;
+	std::vector<PageQuads> m_pages;
+	std::vector<TextVertex> m_uploadScratch;
+
+	uint32_t m_vao;
+	uint32_t m_vertexBuffer;
+	uint32_t m_indexBuffer;
+	// The number of quads the index buffer has indices for.
+	uint32_t m_indexedQuads;
+
+	uint32_t m_stringCount;
+	double m_pendingMilliseconds;
+	uint32_t m_lastStringCount;
+	uint32_t m_lastGlyphCount;
+	uint32_t m_lastDrawCount;
+	double m_cpuMilliseconds;
+
+	void addQuads(const std::string& text, const glm::vec4& color, bool screenSpace,
+		const glm::mat4& transform, const glm::vec2& origin, float height);
+	void reserveIndices(uint32_t quads);
+
+public:
+	TextRenderer();
+	~TextRenderer();
+	TextRenderer(const TextRenderer&) = delete;
+	TextRenderer& operator=(const TextRenderer&) = delete;
+
+	/**
+	 * @brief Adds a line of text in the XY plane of the given transform, reading along +X with its
+	 * baseline on the X axis and its left end at the origin; height is its cap height.
+	 */
+	void addWorldText(const std::string& text, const glm::mat4& transform, float height, const glm::vec4& color);
+
+	/**
+	 * @brief Adds a line of text whose top left corner is at the given pixel position, counted
+	 * from the top left of the viewport; height is its cap height in pixels.
+	 */
+	void addScreenText(const std::string& text, const glm::vec2& position, float height, const glm::vec4& color);
+
+	/**
+	 * @brief Draws and clears every string added since the last render, over the bound framebuffer.
+	 */
+	void render(const glm::mat4& view, const glm::mat4& projection, uint32_t width, uint32_t height);
+
+	const SdfFont& font() const { return m_font; }
+	/**
+	 * @brief What the last render() drew: strings, glyphs and draw calls, and the CPU time spent
+	 * building and uploading its quads.
+	 */
+	uint32_t lastStringCount() const { return m_lastStringCount; }
+	uint32_t lastGlyphCount() const { return m_lastGlyphCount; }
+	uint32_t lastDrawCount() const { return m_lastDrawCount; }
+	double cpuMilliseconds() const { return m_cpuMilliseconds; }
+};
@@ -32,4 +32,28 @@ struct Texture {
 
 		return Texture{ texId, samplerName };
 	}
+
+	/**
+	 * @brief Replaces the image of a texture created by loadImage, keeping its ID.
+	 */
+	static void reloadImage(uint32_t textureId, const StbImage& texture) {
+		glBindTexture(GL_TEXTURE_2D, textureId);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture.getWidth(), texture.getHeight(), 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, texture.getData());
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	/**
+	 * @brief Replaces the image of a texture created by loadImage with RGBA8 texels read from a pixel
+	 * buffer, such as one filled by a GpuUploader, so the copy happens on the GPU.
+	 */
+	static void reloadImage(uint32_t textureId, int width, int height, uint32_t pixelBuffer) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+		glBindTexture(GL_TEXTURE_2D, textureId);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
 };
\ No newline at end of file
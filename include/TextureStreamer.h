@@ -0,0 +1,139 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "MeshDraw.h"
+#include "StbImage.h"
+#include "Texture.h"
+
+/**
+ * @brief Residency counters of a TextureStreamer.
+ */
+struct TextureStreamingStats {
+	uint32_t textures = 0;
+	// Bytes of texel data in VRAM, and how many there would be with every level resident.
+	size_t residentBytes = 0;
+	size_t fullBytes = 0;
+	size_t budgetBytes = 0;
+	// Textures whose wanted levels are not all resident yet, or were dropped to fit the budget.
+	uint32_t pendingTextures = 0;
+	uint32_t budgetLimitedTextures = 0;
+	// Levels uploaded and evicted since the streamer was created.
+	uint64_t levelsLoaded = 0;
+	uint64_t levelsEvicted = 0;
+};
+
+/**
+ * @brief Keeps only the mip levels of each texture that are needed on screen resident in VRAM.
+ *
+ * Textures created through load() keep their full mip chain in system memory, and only their
+ * coarse levels start out in VRAM. Each frame, requestDraws() estimates analytically which level
+ * every texture needs from the screen-space size of the meshes that use it, and update() uploads
+ * finer levels or evicts unneeded ones, limited to a number of bytes per frame. Textures are
+ * sampled only from the resident levels by moving GL_TEXTURE_BASE_LEVEL; evicted levels are
+ * redefined as empty, which frees their storage.
+ *
+ * When the wanted levels of all textures don't fit in the VRAM budget, the textures with the
+ * largest wanted levels are coarsened first.
+ */
+class TextureStreamer {
+public:
+	/**
+	 * @brief One level of a texture's mip chain, as RGBA8 texels.
+	 */
+	struct MipLevel {
+		uint32_t width;
+		uint32_t height;
+		std::vector<uint8_t> texels;
+	};
+
+private:
+
+	struct StreamedTexture {
+		uint32_t textureId;
+		std::vector<MipLevel> levels;
+		// The finest resident level; every level from it to the coarsest is resident.
+		uint32_t residentLevel;
+		// The finest level that stays resident even when the texture isn't requested.
+		uint32_t coarseLevel;
+		// The finest level requested this frame, and the level chosen under the budget.
+		uint32_t requestedLevel;
+		uint32_t wantedLevel;
+	};
+
+	std::vector<StreamedTexture> m_textures;
+	std::unordered_map<uint32_t, size_t> m_textureIndices;
+	size_t m_budgetBytes;
+	size_t m_uploadBytesPerFrame;
+	TextureStreamingStats m_stats;
+
+	void buildLevels(StreamedTexture& texture, const StbImage& image);
+	void chooseCoarseLevel(StreamedTexture& texture);
+	Texture create(StreamedTexture&& texture, const std::string& samplerName);
+	// Defines the coarse levels of the bound texture and makes them the only resident ones.
+	void uploadCoarseLevels(StreamedTexture& texture);
+	size_t bytesFrom(const StreamedTexture& texture, uint32_t level) const;
+	void applyBudget();
+	void loadLevel(StreamedTexture& texture, uint32_t level);
+	void evictTo(StreamedTexture& texture, uint32_t level);
+
+public:
+	/**
+	 * @brief Creates a streamer that keeps at most budgetBytes of texels resident, and uploads at
+	 * most uploadBytesPerFrame per call to update().
+	 */
+	TextureStreamer(size_t budgetBytes, size_t uploadBytesPerFrame = 4 * 1024 * 1024);
+
+	/**
+	 * @brief Builds the image's mip chain in system memory and creates a texture with only its
+	 * coarse levels resident.
+	 */
+	Texture load(const StbImage& image, const std::string& samplerName);
+
+	/**
+	 * @brief Creates a texture from a complete mip chain built earlier, finest level first, such as
+	 * one returned by levels(), with only its coarse levels resident.
+	 */
+	Texture loadLevels(std::vector<MipLevel>&& levels, const std::string& samplerName);
+
+	/**
+	 * @brief The mip chain kept in system memory for a texture created by this streamer, or null
+	 * if the texture wasn't.
+	 */
+	const std::vector<MipLevel>* levels(uint32_t textureId) const;
+
+	/**
+	 * @brief Replaces the image of a texture created by load(), which may change its size, keeping
+	 * its ID. Only the new image's coarse levels are resident afterwards. Returns false if the
+	 * texture wasn't created by this streamer.
+	 */
+	bool reload(uint32_t textureId, const StbImage& image);
+
+	/**
+	 * @brief Deletes a texture created by this streamer, along with its mip chain. Returns false if
+	 * the texture wasn't created by this streamer.
+	 */
+	bool unload(uint32_t textureId);
+
+	/**
+	 * @brief Forgets this frame's requests; textures that aren't requested again fall back to their
+	 * coarse levels.
+	 */
+	void beginFrame();
+
+	/**
+	 * @brief Requests the levels needed by the textures of the given draws, estimated from the
+	 * on-screen size of each mesh's bounding sphere.
+	 */
+	void requestDraws(const std::vector<MeshDraw>& draws, const glm::mat4& view, const glm::mat4& projection,
+		uint32_t viewportHeight);
+
+	/**
+	 * @brief Fits the requests into the budget, then loads and evicts levels to match.
+	 */
+	void update();
+
+	TextureStreamingStats stats() const;
+};
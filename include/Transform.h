@@ -0,0 +1,59 @@
+#pragma once
+#include <glm/ext.hpp>
+
+/**
+ * @brief A local-to-parent transformation stored as its components: a translation, a rotation
+ * quaternion, and a scale about a pivot point. The matrix is
+ *     translate(translation + pivot * scale) * rotate(rotation) * scale(scale) * translate(-pivot),
+ * so the pivot is the local-space point that rotation and scaling happen around.
+ *
+ * Because the components are kept separately, the inverse and the normal matrix have closed
+ * forms that need no general 4x4 inverse, and two transforms can be interpolated directly.
+ */
+struct Transform {
+	glm::vec3 translation;
+	glm::quat rotation;
+	glm::vec3 scale;
+	glm::vec3 pivot;
+
+	Transform();
+
+	/**
+	 * @brief The rotation of the given Euler angles (radians), applied around Y, then X, then Z.
+	 */
+	static glm::quat eulerToQuat(const glm::vec3& euler);
+	/**
+	 * @brief The Euler angles of the given rotation, in the order used by eulerToQuat.
+	 */
+	static glm::vec3 quatToEuler(const glm::quat& rotation);
+
+	glm::mat4 toMatrix() const;
+
+	/**
+	 * @brief The inverse of toMatrix(), computed from the components.
+	 */
+	glm::mat4 inverseMatrix() const;
+
+	/**
+	 * @brief The matrix that transforms normal vectors: the inverse transpose of the upper 3x3 of
+	 * toMatrix(), which for a rotation and scale is just rotate(rotation) * scale(1 / scale).
+	 */
+	glm::mat3 normalMatrix() const;
+
+	/**
+	 * @brief Linearly interpolates the translation, scale and pivot, and spherically interpolates
+	 * the rotation.
+	 */
+	static Transform interpolate(const Transform& a, const Transform& b, float t);
+};
+
+/**
+ * @brief The inverse of a matrix whose last row is (0, 0, 0, 1), which only needs the inverse of
+ * its upper 3x3.
+ */
+glm::mat4 inverseAffine(const glm::mat4& m);
+
+/**
+ * @brief The inverse transpose of the upper 3x3 of an affine matrix, for transforming normals.
+ */
+glm::mat3 normalMatrix(const glm::mat4& model);
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Vertex3D;
+
+/**
+ * @brief How far apart the attributes of two vertices may be for them to be welded. A step of 0
+ * welds only vertices whose attributes are exactly equal.
+ */
+struct WeldTolerance {
+	float position = 0;
+	float normal = 0;
+	float texCoord = 0;
+};
+
+/**
+ * @brief Merges duplicate vertices of a triangle list and rewrites its index buffer to match.
+ *
+ * Vertices are keyed by all of their attributes, either exactly or snapped to the tolerance's
+ * steps; the first vertex with a key stands in for every later one, so welded vertices may move by
+ * up to one step. The remaining vertices are stored in the order the index buffer first references
+ * them, which also drops unreferenced vertices and makes vertex fetches more sequential. Vertices
+ * that differ by less than a step but fall on either side of a step boundary aren't welded.
+ * Returns the number of vertices before welding.
+ */
+size_t weldVertices(std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces,
+	const WeldTolerance& tolerance = WeldTolerance());
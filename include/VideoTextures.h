@@ -0,0 +1,143 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MjpegVideo.h"
+
+/**
+ * @brief Counters of a VideoTextures; frame counts are since it was created.
+ */
+struct VideoTextureStats {
+	uint32_t videos = 0;
+	// Videos decoded at full rate and resolution last update, and at a reduced one.
+	uint32_t fullRateVideos = 0;
+	uint32_t reducedVideos = 0;
+	uint64_t framesDecoded = 0;
+	uint64_t framesUploaded = 0;
+	// Frames skipped because decoding or the upload budget fell behind playback.
+	uint64_t framesDropped = 0;
+	size_t bytesUploadedLastUpdate = 0;
+};
+
+/**
+ * @brief Plays looping videos into textures, for the screens of the cabinets.
+ *
+ * Each video owns a small ring of pixel buffer objects. update() maps a free buffer of the ring
+ * for the frame playback needs next and queues it for a worker thread, which decodes the JPEG
+ * straight into the mapped memory. Decoded frames are unmapped and copied into the video's
+ * texture with glTexSubImage2D from the buffer, within a budget of bytes per update shared by all
+ * videos in turn, so the copy runs asynchronously on the GPU.
+ *
+ * When decoding or uploading falls behind, playback doesn't wait: stale frames are skipped before
+ * decoding, older decoded frames are superseded by newer ones, and the texture keeps the last
+ * frame shown. Videos whose screen is outside the view decode a quarter of their frames at a
+ * quarter of their resolution, and distant ones half of each.
+ */
+class VideoTextures {
+private:
+	enum class SlotState {
+		Free,
+		Decoding,
+		Ready
+	};
+
+	struct Slot {
+		uint32_t buffer;
+		uint8_t* mapped;
+		SlotState state;
+		// The frame, counted from the start of playback rather than of the file, and its reduction.
+		uint64_t frame;
+		uint32_t reduction;
+		// Once playback passes this frame, the slot's frame would be superseded before it's shown.
+		uint64_t staleAfter;
+		bool decoded;
+	};
+
+	struct Video {
+		std::unique_ptr<MjpegVideo> source;
+		uint32_t texture;
+		uint32_t textureReduction;
+		std::vector<Slot> slots;
+		glm::vec3 center;
+		float radius;
+		double time;
+		// The newest frame playback has reached, read by workers to skip stale work.
+		std::atomic<uint64_t> targetFrame;
+		bool anyRequested;
+		uint64_t requestedFrame;
+		bool anyShown;
+		uint64_t shownFrame;
+		uint32_t step;
+		uint32_t reduction;
+	};
+
+	struct DecodeJob {
+		Video* video;
+		uint32_t slot;
+	};
+
+	std::vector<std::unique_ptr<Video>> m_videos;
+	uint32_t m_ringSize;
+	size_t m_uploadBytesPerUpdate;
+	uint32_t m_nextUploadVideo;
+	VideoTextureStats m_stats;
+
+	// Guards the job queue, every slot's state, and the decode counters.
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::deque<DecodeJob> m_jobs;
+	bool m_stopping;
+	std::vector<std::thread> m_workers;
+
+	void work();
+	void release(Slot& slot);
+	void uploadReady(size_t& budgetUsed);
+	void requestNext(Video& video);
+
+public:
+	/**
+	 * @brief Beyond this distance from the camera, a visible screen plays at half rate and resolution.
+	 */
+	static constexpr float REDUCED_DISTANCE = 40.0f;
+
+	/**
+	 * @brief Starts the given number of decoding threads. Each video gets ringSize pixel buffers,
+	 * and update() uploads at most uploadBytesPerUpdate of frames, unless a single frame is larger.
+	 */
+	VideoTextures(uint32_t workerThreads = 2, uint32_t ringSize = 3, size_t uploadBytesPerUpdate = 8 * 1024 * 1024);
+	~VideoTextures();
+	VideoTextures(const VideoTextures&) = delete;
+	VideoTextures& operator=(const VideoTextures&) = delete;
+
+	/**
+	 * @brief Opens a Motion JPEG file and creates its texture, black until the first frame is
+	 * decoded. Throws if the file can't be read. Returns the video's index.
+	 */
+	uint32_t addVideo(const std::string& path, float frameRate = 30.0f);
+
+	/**
+	 * @brief The texture a video plays into; its ID stays the same when its size changes.
+	 */
+	uint32_t texture(uint32_t video) const { return m_videos[video]->texture; }
+
+	/**
+	 * @brief Sets the world-space bounding sphere of the surface that shows the video, which
+	 * decides the rate and resolution it is decoded at.
+	 */
+	void setBounds(uint32_t video, const glm::vec3& center, float radius);
+
+	/**
+	 * @brief Advances playback, uploads the newest decoded frames within the budget and queues the
+	 * next frames for decoding.
+	 */
+	void update(float dt, const glm::mat4& viewProjection, const glm::vec3& cameraPos);
+
+	VideoTextureStats stats();
+};
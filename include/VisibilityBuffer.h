@@ -0,0 +1,70 @@
+#pragma once
+#include <glm/ext.hpp>
+#include <cstdint>
+#include <vector>
+#include "MeshDraw.h"
+#include "ShaderProgram.h"
+
+/**
+ * @brief The most draws that one visibility buffer frame can distinguish. Draw IDs are also
+ * stored as material depths with 1/65536 spacing, which stay exact in a 32-bit float depth buffer.
+ */
+const uint32_t MAX_VISIBILITY_DRAWS = 65535;
+
+/**
+ * @brief An alternative to forward Phong rendering that shades each pixel exactly once.
+ *
+ * 1. The visibility pass rasterizes every draw, storing only (draw ID + 1, triangle ID) per pixel.
+ * 2. The classify pass converts each pixel's draw ID into a "material depth".
+ * 3. The resolve pass draws one fullscreen triangle per draw at that draw's material depth, with
+ *    an EQUAL depth test, so only the draw's own pixels are shaded. The shader fetches the
+ *    triangle's vertices from the mesh's texture buffers and reconstructs perspective-correct
+ *    attributes and texture gradients from the pixel position.
+ * 4. The composite pass copies the shaded color and the scene depth to the window.
+ *
+ * Meshlet culling is not applied here: gl_PrimitiveID restarts for every range of a multi-draw,
+ * so each mesh is drawn whole to keep its triangle IDs meaningful.
+ */
+class VisibilityBuffer {
+private:
+	uint32_t m_width;
+	uint32_t m_height;
+
+	uint32_t m_visibilityTexture;
+	uint32_t m_depthTexture;
+	uint32_t m_visibilityFramebuffer;
+
+	uint32_t m_colorTexture;
+	uint32_t m_materialDepthTexture;
+	uint32_t m_resolveFramebuffer;
+
+	ShaderProgram m_visibilityProgram;
+	ShaderProgram m_classifyProgram;
+	ShaderProgram m_resolveProgram;
+	ShaderProgram m_compositeProgram;
+
+	// The lighting uniforms of lighting.frag, applied to the resolve pass.
+	glm::vec3 m_ambientColor;
+	glm::vec3 m_directionalLight;
+	glm::vec3 m_directionalColor;
+	glm::vec3 m_viewPos;
+
+	void resize(uint32_t width, uint32_t height);
+
+public:
+	VisibilityBuffer();
+
+	/**
+	 * @brief Sets the lighting used to shade resolved pixels; the parameters have the same meaning
+	 * as the uniforms of lighting.frag.
+	 */
+	void setLighting(const glm::vec3& ambientColor, const glm::vec3& directionalLight,
+		const glm::vec3& directionalColor, const glm::vec3& viewPos);
+
+	/**
+	 * @brief Renders the draws through the visibility buffer and writes the shaded result, with
+	 * depth, to the bound framebuffer.
+	 */
+	void render(const std::vector<MeshDraw>& draws, const glm::mat4& view, const glm::mat4& projection,
+		uint32_t width, uint32_t height);
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include "ShaderProgram.h"
+
+/**
+ * @brief Order-independent transparency by weighted blended accumulation (McGuire and Bavoil,
+ * "Weighted Blended Order-Independent Transparency", JCGT 2013). Blended draws need no sorting:
+ * they accumulate weighted color and revealage into offscreen targets, which are composited over
+ * the opaque scene in one fullscreen pass.
+ *
+ * Draws between begin() and end() must be made with lighting.frag's weightedOit uniform set.
+ */
+class WeightedBlendedOit {
+private:
+	uint32_t m_width;
+	uint32_t m_height;
+	// RGBA16F: sum of weighted premultiplied color, and the product of (1 - alpha) in alpha.
+	uint32_t m_accumTexture;
+	// R16F: sum of weighted alpha.
+	uint32_t m_weightTexture;
+	// A copy of the opaque scene's depth, so transparent fragments are hidden by opaque ones.
+	uint32_t m_depthTexture;
+	uint32_t m_framebuffer;
+	// The framebuffer the scene is drawn into, which end() composites over.
+	int32_t m_sceneFramebuffer;
+
+	ShaderProgram m_compositeProgram;
+
+	void resize(uint32_t width, uint32_t height);
+
+public:
+	WeightedBlendedOit();
+
+	/**
+	 * @brief Copies the depth buffer of the bound framebuffer and directs subsequent draws into the accumulation
+	 * targets. Call after all opaque geometry has been drawn.
+	 */
+	void begin(uint32_t width, uint32_t height);
+
+	/**
+	 * @brief Composites the accumulated transparency over the default framebuffer.
+	 */
+	void end();
+};
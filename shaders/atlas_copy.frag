@@ -0,0 +1,11 @@
+#version 330
+// Resamples a texture into the current viewport, for building texture atlases.
+layout (location=0) out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D sourceTexture;
+
+void main() {
+    FragColor = texture(sourceTexture, TexCoord);
+}
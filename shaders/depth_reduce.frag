@@ -0,0 +1,34 @@
+#version 330
+// Builds one level of a hierarchical-Z pyramid: each output texel is the farthest depth of the
+// 2x2 (or, on odd-sized edges, 3x3) block of source texels that it covers.
+layout (location=0) out float FarDepth;
+
+// The previous level of the pyramid, or the scene's depth texture for the first level.
+uniform sampler2D source;
+uniform int sourceLevel;
+uniform ivec2 sourceSize;
+
+float fetch(ivec2 p) {
+    return texelFetch(source, min(p, sourceSize - 1), sourceLevel).r;
+}
+
+void main() {
+    ivec2 dst = ivec2(gl_FragCoord.xy);
+    ivec2 src = dst * 2;
+    float d = max(max(fetch(src), fetch(src + ivec2(1, 0))),
+                  max(fetch(src + ivec2(0, 1)), fetch(src + ivec2(1, 1))));
+
+    // When the source has an odd size, the last row/column is folded into the edge texels.
+    bool extraX = (sourceSize.x & 1) != 0 && src.x + 2 == sourceSize.x - 1;
+    bool extraY = (sourceSize.y & 1) != 0 && src.y + 2 == sourceSize.y - 1;
+    if (extraX) {
+        d = max(d, max(fetch(src + ivec2(2, 0)), fetch(src + ivec2(2, 1))));
+    }
+    if (extraY) {
+        d = max(d, max(fetch(src + ivec2(0, 2)), fetch(src + ivec2(1, 2))));
+    }
+    if (extraX && extraY) {
+        d = max(d, fetch(src + ivec2(2, 2)));
+    }
+    FarDepth = d;
+}
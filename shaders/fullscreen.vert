@@ -0,0 +1,10 @@
+#version 330
+// A vertex shader for screen-space passes. Draw 3 vertices with no vertex buffer, and this
+// produces one triangle that covers the whole viewport.
+out vec2 TexCoord;
+
+void main() {
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    TexCoord = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
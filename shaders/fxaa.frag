@@ -0,0 +1,133 @@
+#version 330
+// Fast approximate anti-aliasing, after Lottes' FXAA 3.11: finds the direction of the edge
+// through each pixel from luma differences, searches along it for the edge's ends, and resamples
+// the pixel across the edge by how far it is from them. Copies the scene depth along.
+layout (location=0) out vec4 FragColor;
+
+uniform sampler2D sceneColor;
+uniform sampler2D sceneDepth;
+
+const float EDGE_THRESHOLD = 0.125;
+const float EDGE_THRESHOLD_MIN = 0.0312;
+const float SUBPIXEL_QUALITY = 0.75;
+const int SEARCH_STEPS = 10;
+
+float luma(vec3 color) {
+    return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+float lumaAt(ivec2 p) {
+    ivec2 size = textureSize(sceneColor, 0);
+    return luma(texelFetch(sceneColor, clamp(p, ivec2(0), size - 1), 0).rgb);
+}
+
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    vec2 texel = 1.0 / vec2(textureSize(sceneColor, 0));
+    vec2 uv = (vec2(p) + 0.5) * texel;
+    gl_FragDepth = texelFetch(sceneDepth, p, 0).r;
+
+    vec3 center = texelFetch(sceneColor, p, 0).rgb;
+    float lumaCenter = luma(center);
+    float lumaDown = lumaAt(p + ivec2(0, -1));
+    float lumaUp = lumaAt(p + ivec2(0, 1));
+    float lumaLeft = lumaAt(p + ivec2(-1, 0));
+    float lumaRight = lumaAt(p + ivec2(1, 0));
+    float lumaMin = min(lumaCenter, min(min(lumaDown, lumaUp), min(lumaLeft, lumaRight)));
+    float lumaMax = max(lumaCenter, max(max(lumaDown, lumaUp), max(lumaLeft, lumaRight)));
+    float range = lumaMax - lumaMin;
+    // Leave flat areas alone; that is most of the screen.
+    if (range < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD)) {
+        FragColor = vec4(center, 1);
+        return;
+    }
+
+    float lumaDownLeft = lumaAt(p + ivec2(-1, -1));
+    float lumaUpRight = lumaAt(p + ivec2(1, 1));
+    float lumaUpLeft = lumaAt(p + ivec2(-1, 1));
+    float lumaDownRight = lumaAt(p + ivec2(1, -1));
+    float lumaDownUp = lumaDown + lumaUp;
+    float lumaLeftRight = lumaLeft + lumaRight;
+    float lumaLeftCorners = lumaDownLeft + lumaUpLeft;
+    float lumaDownCorners = lumaDownLeft + lumaDownRight;
+    float lumaRightCorners = lumaDownRight + lumaUpRight;
+    float lumaUpCorners = lumaUpRight + lumaUpLeft;
+    float edgeHorizontal = abs(-2.0 * lumaLeft + lumaLeftCorners) + abs(-2.0 * lumaCenter + lumaDownUp) * 2.0
+        + abs(-2.0 * lumaRight + lumaRightCorners);
+    float edgeVertical = abs(-2.0 * lumaUp + lumaUpCorners) + abs(-2.0 * lumaCenter + lumaLeftRight) * 2.0
+        + abs(-2.0 * lumaDown + lumaDownCorners);
+    bool isHorizontal = edgeHorizontal >= edgeVertical;
+
+    // Pick the side of the pixel the edge is on: the neighbor with the steeper gradient.
+    float luma1 = isHorizontal ? lumaDown : lumaLeft;
+    float luma2 = isHorizontal ? lumaUp : lumaRight;
+    float gradient1 = luma1 - lumaCenter;
+    float gradient2 = luma2 - lumaCenter;
+    bool is1Steepest = abs(gradient1) >= abs(gradient2);
+    float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+    float stepLength = isHorizontal ? texel.y : texel.x;
+    float lumaLocalAverage;
+    if (is1Steepest) {
+        stepLength = -stepLength;
+        lumaLocalAverage = 0.5 * (luma1 + lumaCenter);
+    }
+    else {
+        lumaLocalAverage = 0.5 * (luma2 + lumaCenter);
+    }
+
+    // Walk along the edge, half a pixel towards it, in both directions until its luma changes.
+    vec2 edgeUv = uv;
+    if (isHorizontal) {
+        edgeUv.y += stepLength * 0.5;
+    }
+    else {
+        edgeUv.x += stepLength * 0.5;
+    }
+    vec2 offset = isHorizontal ? vec2(texel.x, 0.0) : vec2(0.0, texel.y);
+    vec2 uv1 = edgeUv - offset;
+    vec2 uv2 = edgeUv + offset;
+    float lumaEnd1 = luma(texture(sceneColor, uv1).rgb) - lumaLocalAverage;
+    float lumaEnd2 = luma(texture(sceneColor, uv2).rgb) - lumaLocalAverage;
+    bool reached1 = abs(lumaEnd1) >= gradientScaled;
+    bool reached2 = abs(lumaEnd2) >= gradientScaled;
+    for (int i = 0; i < SEARCH_STEPS && !(reached1 && reached2); i++) {
+        // Take longer steps the farther the search goes.
+        float stride = i < 3 ? 1.0 : i < 6 ? 2.0 : 4.0;
+        if (!reached1) {
+            uv1 -= offset * stride;
+            lumaEnd1 = luma(texture(sceneColor, uv1).rgb) - lumaLocalAverage;
+            reached1 = abs(lumaEnd1) >= gradientScaled;
+        }
+        if (!reached2) {
+            uv2 += offset * stride;
+            lumaEnd2 = luma(texture(sceneColor, uv2).rgb) - lumaLocalAverage;
+            reached2 = abs(lumaEnd2) >= gradientScaled;
+        }
+    }
+
+    float distance1 = isHorizontal ? uv.x - uv1.x : uv.y - uv1.y;
+    float distance2 = isHorizontal ? uv2.x - uv.x : uv2.y - uv.y;
+    bool isDirection1 = distance1 < distance2;
+    float distanceFinal = min(distance1, distance2);
+    float edgeLength = distance1 + distance2;
+    float pixelOffset = -distanceFinal / edgeLength + 0.5;
+    // Only blend if the nearer end of the edge varies the same way as the center.
+    bool isLumaCenterSmaller = lumaCenter < lumaLocalAverage;
+    bool correctVariation = ((isDirection1 ? lumaEnd1 : lumaEnd2) < 0.0) != isLumaCenterSmaller;
+    float finalOffset = correctVariation ? pixelOffset : 0.0;
+
+    // Thin features narrower than a pixel get an extra blend by how much they stand out.
+    float lumaAverage = (2.0 * (lumaDownUp + lumaLeftRight) + lumaLeftCorners + lumaRightCorners) / 12.0;
+    float subPixelOffset1 = clamp(abs(lumaAverage - lumaCenter) / range, 0.0, 1.0);
+    float subPixelOffset2 = (-2.0 * subPixelOffset1 + 3.0) * subPixelOffset1 * subPixelOffset1;
+    finalOffset = max(finalOffset, subPixelOffset2 * subPixelOffset2 * SUBPIXEL_QUALITY);
+
+    vec2 finalUv = uv;
+    if (isHorizontal) {
+        finalUv.y += finalOffset * stepLength;
+    }
+    else {
+        finalUv.x += finalOffset * stepLength;
+    }
+    FragColor = vec4(texture(sceneColor, finalUv).rgb, 1);
+}
@@ -0,0 +1,96 @@
+#version 330
+// Shades an impostor quad from three baked frames, with the Phong model of lighting.frag, and
+// writes the baked depth.
+layout (location=0) out vec4 FragColor;
+
+in vec3 LocalOffset;
+in vec3 WorldPos;
+flat in ivec2 Frame0;
+flat in ivec2 Frame1;
+flat in ivec2 Frame2;
+flat in vec3 FrameWeights;
+flat in vec3 ViewDir;
+flat in vec4 CenterRadius;
+flat in vec4 Rotation;
+flat in vec4 Material;
+
+uniform sampler2D albedoAtlas;
+uniform sampler2D normalDepthAtlas;
+uniform int frames;
+uniform float frameSize;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform vec3 cameraPos;
+uniform vec3 ambientColor;
+uniform vec3 directionalLight;
+uniform vec3 directionalColor;
+
+vec3 rotate(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+// Maps a point of [-1, 1]^2 to a direction on the upper (+y) hemisphere.
+vec3 hemiOctDecode(vec2 e) {
+    vec2 t = vec2(e.x + e.y, e.x - e.y) * 0.5;
+    return normalize(vec3(t.x, 1.0 - abs(t.x) - abs(t.y), t.y));
+}
+
+// Must match frameView in ImpostorBaker.cpp.
+void frameBasis(vec3 d, out vec3 right, out vec3 up) {
+    vec3 worldUp = abs(d.y) > 0.999 ? vec3(0, 0, -1) : vec3(0, 1, 0);
+    right = normalize(cross(worldUp, d));
+    up = cross(d, right);
+}
+
+// Accumulates one frame's texels at this fragment, weighted by the frame's weight and coverage.
+void sampleFrame(ivec2 frame, float weight, inout vec4 albedo, inout vec4 normalDepth) {
+    vec3 right, up;
+    frameBasis(hemiOctDecode(vec2(frame) / float(frames - 1) * 2.0 - 1.0), right, up);
+    // Every frame is an orthographic view of the unit sphere, so project the point onto its plane.
+    vec2 uv = vec2(dot(LocalOffset, right), dot(LocalOffset, up)) * 0.5 + 0.5;
+    if (weight <= 0.0 || any(lessThan(uv, vec2(0))) || any(greaterThan(uv, vec2(1)))) {
+        return;
+    }
+    // Keep bilinear filtering from reading the neighbouring frame.
+    uv = clamp(uv, vec2(0.5 / frameSize), vec2(1.0 - 0.5 / frameSize));
+    vec2 atlasUv = (vec2(frame) + uv) / float(frames);
+    vec4 color = texture(albedoAtlas, atlasUv);
+    albedo += weight * color;
+    normalDepth += weight * color.a * texture(normalDepthAtlas, atlasUv);
+}
+
+void main() {
+    vec4 albedo = vec4(0);
+    vec4 normalDepth = vec4(0);
+    sampleFrame(Frame0, FrameWeights.x, albedo, normalDepth);
+    sampleFrame(Frame1, FrameWeights.y, albedo, normalDepth);
+    sampleFrame(Frame2, FrameWeights.z, albedo, normalDepth);
+    if (albedo.a < 0.5) {
+        discard;
+    }
+    vec3 baseColor = albedo.rgb / albedo.a;
+    normalDepth /= albedo.a;
+
+    // Baked depth runs from the near side of the bounding sphere (0) to the far side (1).
+    vec3 worldPos = WorldPos + ViewDir * (1.0 - 2.0 * normalDepth.a) * CenterRadius.w;
+    vec4 clip = projection * view * vec4(worldPos, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+
+    vec3 norm = normalize(rotate(Rotation, normalDepth.xyz * 2.0 - 1.0));
+    vec3 lightDir = -directionalLight;
+    vec3 diffuseIntensity = vec3(0);
+    vec3 specularIntensity = vec3(0);
+    float lambertFactor = dot(norm, normalize(lightDir));
+    if (lambertFactor > 0) {
+        diffuseIntensity = Material.y * directionalColor * lambertFactor;
+        vec3 eyeDir = normalize(cameraPos - worldPos);
+        vec3 reflectDir = normalize(reflect(-lightDir, norm));
+        float spec = dot(reflectDir, eyeDir);
+        if (spec > 0) {
+            specularIntensity = Material.z * directionalColor * pow(spec, Material.w);
+        }
+    }
+    vec3 lightIntensity = ambientColor * Material.x + diffuseIntensity + specularIntensity;
+    FragColor = vec4(lightIntensity * baseColor, 1);
+}
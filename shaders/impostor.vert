@@ -0,0 +1,74 @@
+#version 330
+// Expands each impostor instance into a quad facing the camera, and picks the three baked frames
+// nearest to the direction the instance is seen from.
+layout (location=0) in vec2 vCorner;
+layout (location=1) in vec4 iCenterRadius;
+layout (location=2) in vec4 iRotation;
+layout (location=3) in vec4 iMaterial;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform vec3 cameraPos;
+// The atlas is a frames x frames grid of views.
+uniform int frames;
+
+// The quad's point in the model's space, relative to the bounding sphere's center and radius.
+out vec3 LocalOffset;
+out vec3 WorldPos;
+flat out ivec2 Frame0;
+flat out ivec2 Frame1;
+flat out ivec2 Frame2;
+flat out vec3 FrameWeights;
+flat out vec3 ViewDir;
+flat out vec4 CenterRadius;
+flat out vec4 Rotation;
+flat out vec4 Material;
+
+vec3 rotateInverse(vec4 q, vec3 v) {
+    vec3 u = -q.xyz;
+    return v + 2.0 * cross(u, cross(u, v) + q.w * v);
+}
+
+// The inverse of hemiOctDecode in impostor.frag, for directions on the upper hemisphere.
+vec2 hemiOctEncode(vec3 v) {
+    v /= abs(v.x) + abs(v.y) + abs(v.z);
+    return vec2(v.x + v.z, v.x - v.z);
+}
+
+void main() {
+    vec3 center = iCenterRadius.xyz;
+    float radius = iCenterRadius.w;
+    vec3 toCamera = normalize(cameraPos - center);
+
+    // Views from below the model reuse the lowest ring of frames.
+    vec3 localDir = rotateInverse(iRotation, toCamera);
+    localDir.y = max(localDir.y, 0.0);
+    vec2 grid = (hemiOctEncode(normalize(localDir + vec3(0, 1e-5, 0))) * 0.5 + 0.5) * float(frames - 1);
+    vec2 cell = clamp(floor(grid), vec2(0), vec2(frames - 2));
+    vec2 f = grid - cell;
+    // Split the grid cell into two triangles, and blend the frames at the corners of the one the
+    // direction falls in by its barycentric coordinates.
+    ivec2 c = ivec2(cell);
+    if (f.x + f.y < 1.0) {
+        Frame0 = c;
+        FrameWeights = vec3(1.0 - f.x - f.y, f.x, f.y);
+    }
+    else {
+        Frame0 = c + ivec2(1, 1);
+        FrameWeights = vec3(f.x + f.y - 1.0, 1.0 - f.y, 1.0 - f.x);
+    }
+    Frame1 = c + ivec2(1, 0);
+    Frame2 = c + ivec2(0, 1);
+
+    vec3 worldUp = abs(toCamera.y) > 0.999 ? vec3(0, 0, -1) : vec3(0, 1, 0);
+    vec3 right = normalize(cross(worldUp, toCamera));
+    vec3 up = cross(toCamera, right);
+    WorldPos = center + (vCorner.x * right + vCorner.y * up) * radius;
+    LocalOffset = rotateInverse(iRotation, WorldPos - center) / radius;
+
+    ViewDir = toCamera;
+    CenterRadius = iCenterRadius;
+    Rotation = iRotation;
+    Material = iMaterial;
+    gl_Position = projection * view * vec4(WorldPos, 1.0);
+}
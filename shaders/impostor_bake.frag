@@ -0,0 +1,23 @@
+#version 330
+// Writes the unlit color and the model-space normal and depth of a model into an impostor frame.
+layout (location=0) out vec4 Albedo;
+layout (location=1) out vec4 NormalDepth;
+
+in vec2 TexCoord;
+in vec3 Normal;
+
+uniform sampler2D baseTexture;
+uniform float opacity;
+uniform float alphaCutoff;
+
+void main() {
+    vec4 color = texture(baseTexture, TexCoord);
+    color.a *= opacity;
+    if (color.a < alphaCutoff) {
+        discard;
+    }
+    // Impostors are alpha tested, so every covered texel is opaque.
+    Albedo = vec4(color.rgb, 1);
+    // The projection is orthographic, so window depth is linear across the bounding sphere.
+    NormalDepth = vec4(normalize(Normal) * 0.5 + 0.5, gl_FragCoord.z);
+}
@@ -0,0 +1,19 @@
+#version 330
+// Renders a model into one frame of an impostor atlas, in the model's own space.
+layout (location=0) in vec3 vPosition;
+layout (location=1) in vec3 vNormal;
+layout (location=2) in vec2 vTexCoord;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+uniform mat3 normalMatrix;
+
+out vec2 TexCoord;
+out vec3 Normal;
+
+void main() {
+    gl_Position = projection * view * model * vec4(vPosition, 1.0);
+    TexCoord = vTexCoord;
+    Normal = normalMatrix * vNormal;
+}
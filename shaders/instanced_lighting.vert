@@ -0,0 +1,42 @@
+#version 430
+// Like light_perspective.vert, but each instance's model and normal matrices come from the
+// instance buffer, through the list of instances that survived object_cull.comp.
+layout (location=0) in vec3 vPosition;
+layout (location=1) in vec3 vNormal;
+layout (location=2) in vec2 vTexCoord;
+
+// Matches GpuInstance in GpuObjectCuller.h.
+struct Instance {
+    mat4 model;
+    vec4 normalMatrix[3];
+    vec4 sphere;
+    uint batch;
+    uint padding0;
+    uint padding1;
+    uint padding2;
+};
+
+layout (std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout (std430, binding = 2) readonly buffer Visible { uint visibleInstances[]; };
+
+uniform mat4 projection;
+uniform mat4 view;
+// The first slot of the current batch in the visible list.
+uniform uint instanceBase;
+
+out vec2 TexCoord;
+out vec3 Normal;
+out vec3 FragWorldPos;
+
+void main() {
+    uint index = visibleInstances[instanceBase + uint(gl_InstanceID)];
+    mat4 model = instances[index].model;
+    mat3 normalMatrix = mat3(instances[index].normalMatrix[0].xyz, instances[index].normalMatrix[1].xyz,
+        instances[index].normalMatrix[2].xyz);
+
+    vec4 worldPos = model * vec4(vPosition, 1.0);
+    gl_Position = projection * view * worldPos;
+    TexCoord = vTexCoord;
+    Normal = normalMatrix * vNormal;
+    FragWorldPos = worldPos.xyz;
+}
@@ -8,6 +8,8 @@ layout (location=2) in vec2 vTexCoord;
 uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
+// The inverse transpose of the model matrix, computed once per draw on the CPU.
+uniform mat3 normalMatrix;
 
 out vec2 TexCoord;
 out vec3 Normal;
@@ -19,8 +21,7 @@ void main() {
     // Pass along the vertex texture coordinate.
     TexCoord = vTexCoord;
     // Transform the vertex normal from local space to world space, using the Normal matrix.
-    mat4 normalMatrix = transpose(inverse(model));
-    Normal = mat3(normalMatrix) * vNormal;
+    Normal = normalMatrix * vNormal;
     
     // TODO: transform the vertex position into world space, and assign it to FragWorldPos.
     FragWorldPos = vec3(model * vec4(vPosition, 1.0));
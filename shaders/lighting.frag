@@ -1,6 +1,8 @@
 #version 330
 // A fragment shader for rendering fragments in the Phong reflection model.
 layout (location=0) out vec4 FragColor;
+// Only written in weighted blended OIT mode: the accumulated coverage weight of the fragment.
+layout (location=1) out vec4 OitWeight;
 
 // Inputs: the texture coordinates, world-space normal, and world-space position
 // of this fragment, interpolated between its vertices.
@@ -27,6 +29,40 @@ uniform vec3 directionalColor;
 // Location of the camera.
 uniform vec3 viewPos;
 
+// Multiplies the alpha of the base texture.
+uniform float opacity;
+// Fragments with less alpha than this are discarded (alpha-masked meshes); 0 disables the test.
+uniform float alphaCutoff;
+// If set, write weighted blended order-independent transparency terms instead of a color.
+uniform bool weightedOit;
+
+// Reflection probes: the two nearest to the camera, prefiltered so that level
+// roughness * probeMaxLevel holds reflections of that roughness. See ReflectionProbes.
+uniform bool useReflections;
+uniform samplerCube reflectionProbe0;
+uniform samplerCube reflectionProbe1;
+uniform vec3 probePosition0;
+uniform vec3 probePosition1;
+uniform vec3 probeBoxMin0;
+uniform vec3 probeBoxMax0;
+uniform vec3 probeBoxMin1;
+uniform vec3 probeBoxMax1;
+uniform float probeMaxLevel;
+
+// Intersects the reflection ray with the probe's box, and returns the direction from the probe to
+// the hit point, so that reflections of nearby walls line up with the walls.
+vec3 parallaxCorrect(vec3 direction, vec3 probePosition, vec3 boxMin, vec3 boxMax) {
+    vec3 firstPlane = (boxMax - FragWorldPos) / direction;
+    vec3 secondPlane = (boxMin - FragWorldPos) / direction;
+    vec3 furthest = max(firstPlane, secondPlane);
+    float distance = min(min(furthest.x, furthest.y), furthest.z);
+    // Outside the box there is nothing to correct against.
+    if (distance <= 0.0) {
+        return direction;
+    }
+    return FragWorldPos + direction * distance - probePosition;
+}
+
 
 void main() {
     // TODO: using the lecture notes, compute ambientIntensity, diffuseIntensity, 
@@ -55,5 +91,40 @@ void main() {
     }
 
     vec3 lightIntensity = ambientIntensity + diffuseIntensity + specularIntensity;
-    FragColor = vec4(lightIntensity, 1) * texture(baseTexture, TexCoord);
-}
\ No newline at end of file
+    vec4 color = vec4(lightIntensity, 1) * texture(baseTexture, TexCoord);
+    color.a *= opacity;
+    if (color.a < alphaCutoff) {
+        discard;
+    }
+
+    if (useReflections) {
+        vec3 eyeDir = normalize(viewPos - FragWorldPos);
+        vec3 reflectDir = reflect(-eyeDir, norm);
+        // Map the Phong exponent to a roughness, so shinier materials get sharper reflections.
+        float roughness = sqrt(2.0 / (material.w + 2.0));
+        float level = roughness * probeMaxLevel;
+        vec3 reflection0 = textureLod(reflectionProbe0,
+            parallaxCorrect(reflectDir, probePosition0, probeBoxMin0, probeBoxMax0), level).rgb;
+        vec3 reflection1 = textureLod(reflectionProbe1,
+            parallaxCorrect(reflectDir, probePosition1, probeBoxMin1, probeBoxMax1), level).rgb;
+        // Each fragment weighs the probes by how near it is to them.
+        float distance0 = distance(FragWorldPos, probePosition0);
+        float distance1 = distance(FragWorldPos, probePosition1);
+        vec3 reflection = mix(reflection1, reflection0, distance1 / max(distance0 + distance1, 1e-4));
+        // Schlick's approximation, with the specular coefficient as the reflectance at normal incidence.
+        float fresnel = material.z + (1.0 - material.z) * pow(1.0 - max(dot(norm, eyeDir), 0.0), 5.0);
+        color.rgb += reflection * fresnel * (1.0 - roughness);
+    }
+
+    if (weightedOit) {
+        // McGuire and Bavoil 2013, equation 10: nearer and more opaque fragments weigh more.
+        float a = color.a;
+        float weight = clamp(pow(min(1.0, a * 10.0) + 0.01, 3.0) * 1e8
+            * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+        FragColor = vec4(color.rgb * a * weight, a);
+        OitWeight = vec4(a * weight);
+    }
+    else {
+        FragColor = color;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#version 330
+// Writes how far this fragment has moved on screen since the last frame, in texture coordinates.
+layout (location=0) out vec2 Motion;
+
+in vec4 CurrentClip;
+in vec4 PreviousClip;
+
+void main() {
+    Motion = (CurrentClip.xy / CurrentClip.w - PreviousClip.xy / PreviousClip.w) * 0.5;
+}
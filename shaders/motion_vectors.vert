@@ -0,0 +1,20 @@
+#version 330
+// Projects a vertex with this frame's and last frame's transforms, for TAA motion vectors.
+layout (location=0) in vec3 vPosition;
+
+// Rasterize with the jittered projection, so that depth matches the scene exactly.
+uniform mat4 jitteredViewProjection;
+uniform mat4 viewProjection;
+uniform mat4 previousViewProjection;
+uniform mat4 model;
+uniform mat4 previousModel;
+
+out vec4 CurrentClip;
+out vec4 PreviousClip;
+
+void main() {
+    vec4 position = vec4(vPosition, 1.0);
+    gl_Position = jitteredViewProjection * model * position;
+    CurrentClip = viewProjection * model * position;
+    PreviousClip = previousViewProjection * previousModel * position;
+}
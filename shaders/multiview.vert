@@ -0,0 +1,42 @@
+#version 330
+// Like light_perspective.vert, but draws one instance per view of a MultiViewRenderer group. Each
+// instance is projected with its view's matrix, moved into that view's rectangle of the viewport,
+// and clipped to it, so one draw covers every view of the group.
+layout (location=0) in vec3 vPosition;
+layout (location=1) in vec3 vNormal;
+layout (location=2) in vec2 vTexCoord;
+
+// Matches MultiViewRenderer::MAX_INSTANCED_VIEWS.
+const int MAX_VIEWS = 8;
+
+uniform mat4 viewProjections[MAX_VIEWS];
+// The scale (xy) and offset (zw) from each view's NDC to the group viewport's NDC.
+uniform vec4 viewportTransforms[MAX_VIEWS];
+// Bit i is set if view i sees this draw; other instances are clipped away.
+uniform uint viewMask;
+uniform mat4 model;
+uniform mat3 normalMatrix;
+
+out vec2 TexCoord;
+out vec3 Normal;
+out vec3 FragWorldPos;
+out float gl_ClipDistance[4];
+
+void main() {
+    int view = gl_InstanceID;
+    vec4 worldPos = model * vec4(vPosition, 1.0);
+    vec4 clip = viewProjections[view] * worldPos;
+
+    // The sides of the view's frustum are no longer the edges of the viewport, so clip to them.
+    float visible = (viewMask & (1u << uint(view))) != 0u ? 1.0 : 0.0;
+    gl_ClipDistance[0] = mix(-1.0, clip.w + clip.x, visible);
+    gl_ClipDistance[1] = mix(-1.0, clip.w - clip.x, visible);
+    gl_ClipDistance[2] = mix(-1.0, clip.w + clip.y, visible);
+    gl_ClipDistance[3] = mix(-1.0, clip.w - clip.y, visible);
+
+    vec4 transform = viewportTransforms[view];
+    gl_Position = vec4(clip.xy * transform.xy + transform.zw * clip.w, clip.z, clip.w);
+    TexCoord = vTexCoord;
+    Normal = normalMatrix * vNormal;
+    FragWorldPos = worldPos.xyz;
+}
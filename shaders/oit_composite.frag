@@ -0,0 +1,20 @@
+#version 330
+// Resolves weighted blended order-independent transparency: the weighted average color of the
+// transparent fragments, covering the background by one minus the product of their (1 - alpha).
+layout (location=0) out vec4 FragColor;
+
+uniform sampler2D accumulation;
+uniform sampler2D weights;
+
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    vec4 accum = texelFetch(accumulation, p, 0);
+    float revealage = accum.a;
+    // Nothing transparent covers this pixel.
+    if (revealage >= 1.0) {
+        discard;
+    }
+    float weightSum = texelFetch(weights, p, 0).r;
+    vec3 averageColor = accum.rgb / max(weightSum, 1e-5);
+    FragColor = vec4(averageColor, 1.0 - revealage);
+}
@@ -0,0 +1,14 @@
+#version 330
+// A soft round sprite.
+layout (location=0) out vec4 FragColor;
+
+in vec2 Corner;
+in vec4 Color;
+
+void main() {
+    float distance = length(Corner);
+    if (distance > 1.0) {
+        discard;
+    }
+    FragColor = vec4(Color.rgb, Color.a * (1.0 - smoothstep(0.4, 1.0, distance)));
+}
@@ -0,0 +1,42 @@
+#version 330
+// Draws one camera-facing quad per particle instance, as a 4-vertex triangle strip without a
+// vertex buffer. Particles that are not alive are moved outside the clip volume.
+layout (location=0) in vec4 positionAge;
+layout (location=1) in vec4 velocityLifetime;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec4 startColor;
+uniform vec4 endColor;
+uniform float startSize;
+uniform float endSize;
+// How far each particle's color is pulled towards a random color of its own, picked by its
+// (randomized) lifetime, which stays the same while it lives and whatever order it is drawn in.
+uniform float colorVariation;
+
+out vec2 Corner;
+out vec4 Color;
+
+vec3 randomColor(uint seed) {
+    seed = seed * 747796405u + 2891336453u;
+    return vec3(float(seed & 255u), float((seed >> 8u) & 255u), float((seed >> 16u) & 255u)) / 255.0;
+}
+
+void main() {
+    Corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    float age = positionAge.w;
+    float lifetime = velocityLifetime.w;
+    if (age < 0.0 || age >= lifetime) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        Color = vec4(0);
+        return;
+    }
+    float t = age / lifetime;
+    Color = mix(startColor, endColor, t);
+    Color.rgb = mix(Color.rgb, randomColor(floatBitsToUint(lifetime)), colorVariation);
+    float size = mix(startSize, endSize, t);
+
+    vec4 viewPosition = view * vec4(positionAge.xyz, 1.0);
+    viewPosition.xy += Corner * size;
+    gl_Position = projection * viewPosition;
+}
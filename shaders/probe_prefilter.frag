@@ -0,0 +1,76 @@
+#version 330
+// Prefilters one face of an environment cube map for a given roughness, by importance sampling
+// the GGX distribution around each texel's direction (Karis 2013, "Real Shading in Unreal
+// Engine 4"). The view direction is assumed to equal the normal.
+layout (location=0) out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform samplerCube environment;
+uniform float environmentSize;
+// The cube face being written, in GL_TEXTURE_CUBE_MAP_POSITIVE_X order.
+uniform int face;
+uniform float roughness;
+
+const uint SAMPLE_COUNT = 64u;
+const float PI = 3.14159265359;
+
+// The direction through a point of a cube face, with uv in [-1, 1], following the cube map
+// face selection rules of the GL specification.
+vec3 faceDirection(int face, vec2 uv) {
+    if (face == 0) return vec3(1.0, -uv.y, -uv.x);
+    if (face == 1) return vec3(-1.0, -uv.y, uv.x);
+    if (face == 2) return vec3(uv.x, 1.0, uv.y);
+    if (face == 3) return vec3(uv.x, -1.0, -uv.y);
+    if (face == 4) return vec3(uv.x, -uv.y, 1.0);
+    return vec3(-uv.x, -uv.y, -1.0);
+}
+
+// The Hammersley point set, for evenly spread samples.
+vec2 hammersley(uint i) {
+    uint bits = i;
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return vec2(float(i) / float(SAMPLE_COUNT), float(bits) * 2.3283064365386963e-10);
+}
+
+void main() {
+    vec3 n = normalize(faceDirection(face, TexCoord * 2.0 - 1.0));
+    if (roughness == 0.0) {
+        FragColor = vec4(textureLod(environment, n, 0.0).rgb, 1.0);
+        return;
+    }
+
+    vec3 up = abs(n.z) < 0.999 ? vec3(0, 0, 1) : vec3(1, 0, 0);
+    vec3 tangent = normalize(cross(up, n));
+    vec3 bitangent = cross(n, tangent);
+    float a = roughness * roughness;
+    // The solid angle of one texel of the environment's top level.
+    float texelSolidAngle = 4.0 * PI / (6.0 * environmentSize * environmentSize);
+
+    vec3 color = vec3(0);
+    float totalWeight = 0.0;
+    for (uint i = 0u; i < SAMPLE_COUNT; i++) {
+        vec2 xi = hammersley(i);
+        float phi = 2.0 * PI * xi.x;
+        float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (a * a - 1.0) * xi.y));
+        float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+        vec3 h = tangent * (cos(phi) * sinTheta) + bitangent * (sin(phi) * sinTheta) + n * cosTheta;
+        vec3 l = 2.0 * dot(n, h) * h - n;
+        float nDotL = dot(n, l);
+        if (nDotL > 0.0) {
+            // Sample a level whose texels cover about the solid angle of one sample, so that a
+            // few samples don't alias.
+            float d = a * a / (PI * pow(cosTheta * cosTheta * (a * a - 1.0) + 1.0, 2.0));
+            float pdf = d / 4.0;
+            float sampleSolidAngle = 1.0 / (float(SAMPLE_COUNT) * pdf + 1e-4);
+            float level = max(0.5 * log2(sampleSolidAngle / texelSolidAngle), 0.0);
+            color += textureLod(environment, l, level).rgb * nDotL;
+            totalWeight += nDotL;
+        }
+    }
+    FragColor = vec4(color / max(totalWeight, 1e-4), 1.0);
+}
@@ -0,0 +1,38 @@
+#version 330
+// A game of Pong that plays itself, for the attract mode of a render-to-texture screen: a ball
+// bouncing between two paddles that track it, over a dashed net, with scanlines.
+layout (location=0) out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform float time;
+uniform vec2 resolution;
+
+// A triangle wave in [0, 1] with the given period.
+float bounce(float t, float period) {
+    return abs(fract(t / period) * 2.0 - 1.0);
+}
+
+float box(vec2 p, vec2 center, vec2 halfSize) {
+    vec2 d = abs(p - center) - halfSize;
+    return step(max(d.x, d.y), 0.0);
+}
+
+void main() {
+    float aspect = resolution.x / resolution.y;
+    vec2 p = vec2(TexCoord.x * aspect, TexCoord.y);
+
+    vec2 ball = vec2(0.1 + bounce(time, 3.1) * (aspect - 0.2), 0.05 + bounce(time, 2.3) * 0.9);
+    // Each paddle follows the ball with some lag, so that it sometimes looks like a close call.
+    float leftPaddle = mix(0.5, 0.05 + bounce(time - 0.15, 2.3) * 0.9, 0.85);
+    float rightPaddle = mix(0.5, 0.05 + bounce(time - 0.25, 2.3) * 0.9, 0.85);
+
+    float lit = box(p, ball, vec2(0.015));
+    lit = max(lit, box(p, vec2(0.05, leftPaddle), vec2(0.012, 0.08)));
+    lit = max(lit, box(p, vec2(aspect - 0.05, rightPaddle), vec2(0.012, 0.08)));
+    lit = max(lit, box(p, vec2(aspect * 0.5, p.y), vec2(0.004, 0.5)) * step(0.5, fract(p.y * 12.0)));
+    lit = max(lit, (1.0 - box(p, vec2(aspect * 0.5, 0.5), vec2(aspect * 0.5 - 0.01, 0.49))) * 0.6);
+
+    float scanline = 0.75 + 0.25 * sin(gl_FragCoord.y * 3.14159);
+    FragColor = vec4(vec3(0.02, 0.05, 0.03) + vec3(0.6, 1.0, 0.7) * lit * scanline, 1.0);
+}
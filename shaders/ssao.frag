@@ -0,0 +1,66 @@
+#version 330
+// Screen-space ambient occlusion at half resolution: the fraction of a normal-oriented hemisphere
+// around each pixel that lies behind the depth buffer. Sample directions are rotated per pixel,
+// and per frame when the result is accumulated over time.
+layout (location=0) out float Occlusion;
+
+// From ssao_prepare.frag: view-space normal and depth.
+uniform sampler2D normalDepth;
+uniform mat4 projection;
+uniform int sampleCount;
+uniform float radius;
+uniform int frameIndex;
+
+const float GOLDEN_ANGLE = 2.39996323;
+const float BIAS = 0.02;
+
+vec3 viewPosition(vec2 uv, float z) {
+    vec2 ndc = uv * 2.0 - 1.0;
+    return vec3(-z * (ndc.x + projection[2][0]) / projection[0][0],
+        -z * (ndc.y + projection[2][1]) / projection[1][1], z);
+}
+
+// Interleaved gradient noise (Jimenez 2014): a per-pixel value in [0, 1) that looks random to the
+// eye but is cheap and spreads evenly over small neighborhoods.
+float pixelNoise(vec2 p) {
+    p += 5.588238 * float(frameIndex & 63);
+    return fract(52.9829189 * fract(dot(p, vec2(0.06711056, 0.00583715))));
+}
+
+void main() {
+    ivec2 size = textureSize(normalDepth, 0);
+    vec4 center = texelFetch(normalDepth, ivec2(gl_FragCoord.xy), 0);
+    if (center.w <= -1e5) {
+        Occlusion = 1.0;
+        return;
+    }
+    vec2 uv = gl_FragCoord.xy / vec2(size);
+    vec3 position = viewPosition(uv, center.w);
+    vec3 normal = center.xyz;
+
+    float rotation = pixelNoise(gl_FragCoord.xy) * 6.28318531;
+    vec3 randomVector = vec3(cos(rotation), sin(rotation), 0.0);
+    vec3 tangent = normalize(randomVector - normal * dot(randomVector, normal));
+    vec3 bitangent = cross(normal, tangent);
+
+    float occluded = 0.0;
+    for (int i = 0; i < sampleCount; i++) {
+        // A spiral over the hemisphere, with more samples close to the center.
+        float t = (float(i) + 0.5) / float(sampleCount);
+        float angle = float(i) * GOLDEN_ANGLE;
+        float elevation = sqrt(1.0 - t);
+        float spread = sqrt(t);
+        vec3 direction = vec3(cos(angle) * spread, sin(angle) * spread, elevation);
+        float scale = mix(0.1, 1.0, t * t);
+        vec3 samplePosition = position + (tangent * direction.x + bitangent * direction.y + normal * direction.z)
+            * radius * scale;
+
+        vec4 clip = projection * vec4(samplePosition, 1.0);
+        vec2 sampleUv = clip.xy / clip.w * 0.5 + 0.5;
+        float sceneZ = texture(normalDepth, sampleUv).w;
+        // Occluders far in front of the pixel are another object, not a crease.
+        float range = smoothstep(0.0, 1.0, radius / abs(position.z - sceneZ));
+        occluded += (sceneZ >= samplePosition.z + BIAS ? 1.0 : 0.0) * range;
+    }
+    Occlusion = 1.0 - occluded / float(sampleCount);
+}
@@ -0,0 +1,36 @@
+#version 330
+// Builds SSAO's half-resolution input: the view-space normal and depth of one of each 2x2 block of
+// scene pixels. Normals are reconstructed from neighboring depths, taking the neighbor on the
+// nearer side of any depth discontinuity.
+layout (location=0) out vec4 NormalDepth;
+
+uniform sampler2D sceneDepth;
+uniform mat4 projection;
+
+vec3 viewPosition(ivec2 p) {
+    ivec2 size = textureSize(sceneDepth, 0);
+    p = clamp(p, ivec2(0), size - 1);
+    float ndcZ = texelFetch(sceneDepth, p, 0).r * 2.0 - 1.0;
+    vec2 ndc = (vec2(p) + 0.5) / vec2(size) * 2.0 - 1.0;
+    float z = -projection[3][2] / (ndcZ + projection[2][2]);
+    return vec3(-z * (ndc.x + projection[2][0]) / projection[0][0],
+        -z * (ndc.y + projection[2][1]) / projection[1][1], z);
+}
+
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy) * 2;
+    float depth = texelFetch(sceneDepth, p, 0).r;
+    // Nothing was drawn here; SSAO leaves such pixels unoccluded.
+    if (depth >= 1.0) {
+        NormalDepth = vec4(0, 0, 1, -1e6);
+        return;
+    }
+    vec3 center = viewPosition(p);
+    vec3 left = viewPosition(p - ivec2(1, 0));
+    vec3 right = viewPosition(p + ivec2(1, 0));
+    vec3 down = viewPosition(p - ivec2(0, 1));
+    vec3 up = viewPosition(p + ivec2(0, 1));
+    vec3 dx = abs(right.z - center.z) < abs(center.z - left.z) ? right - center : center - left;
+    vec3 dy = abs(up.z - center.z) < abs(center.z - down.z) ? up - center : center - down;
+    NormalDepth = vec4(normalize(cross(dx, dy)), center.z);
+}
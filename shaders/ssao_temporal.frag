@@ -0,0 +1,42 @@
+#version 330
+// Blends this frame's half-resolution occlusion into the reprojected history, rejecting history
+// whose depth doesn't match the surface it is reprojected onto.
+layout (location=0) out vec2 OcclusionDepth;
+
+uniform sampler2D occlusion;
+uniform sampler2D normalDepth;
+// Occlusion and the view-space depth it was computed at, from the previous frame.
+uniform sampler2D history;
+uniform mat4 projection;
+// Maps this frame's view space to the previous frame's view space.
+uniform mat4 toPreviousView;
+uniform mat4 previousProjection;
+uniform bool historyValid;
+uniform float blendFactor;
+
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    ivec2 size = textureSize(occlusion, 0);
+    float current = texelFetch(occlusion, p, 0).r;
+    float z = texelFetch(normalDepth, p, 0).w;
+    OcclusionDepth = vec2(current, z);
+    if (!historyValid || z <= -1e5) {
+        return;
+    }
+
+    vec2 ndc = (vec2(p) + 0.5) / vec2(size) * 2.0 - 1.0;
+    vec3 position = vec3(-z * (ndc.x + projection[2][0]) / projection[0][0],
+        -z * (ndc.y + projection[2][1]) / projection[1][1], z);
+    vec4 previousPosition = toPreviousView * vec4(position, 1.0);
+    vec4 previousClip = previousProjection * previousPosition;
+    vec2 previousUv = previousClip.xy / previousClip.w * 0.5 + 0.5;
+    if (any(lessThan(previousUv, vec2(0))) || any(greaterThan(previousUv, vec2(1)))) {
+        return;
+    }
+    vec2 previous = texture(history, previousUv).rg;
+    // Disocclusions show a different surface in the history; start over there.
+    if (abs(previous.g - previousPosition.z) > 0.05 * abs(previousPosition.z)) {
+        return;
+    }
+    OcclusionDepth = vec2(mix(previous.r, current, blendFactor), z);
+}
@@ -0,0 +1,38 @@
+#version 330
+// Upsamples half-resolution occlusion to the scene, weighting the four nearest half-resolution
+// texels by how close their depth is to the pixel's, so occlusion doesn't bleed across edges.
+// The result is multiplied into the scene's color by blending.
+layout (location=0) out vec4 FragColor;
+
+uniform sampler2D occlusion;
+uniform sampler2D normalDepth;
+uniform sampler2D sceneDepth;
+uniform mat4 projection;
+
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(sceneDepth, p, 0).r;
+    if (depth >= 1.0) {
+        FragColor = vec4(1);
+        return;
+    }
+    float z = -projection[3][2] / (depth * 2.0 - 1.0 + projection[2][2]);
+
+    ivec2 halfSize = textureSize(occlusion, 0);
+    vec2 halfPosition = (vec2(p) + 0.5) * 0.5 - 0.5;
+    ivec2 base = ivec2(floor(halfPosition));
+    vec2 fraction = halfPosition - vec2(base);
+    float total = 0.0;
+    float weights = 0.0;
+    for (int y = 0; y <= 1; y++) {
+        for (int x = 0; x <= 1; x++) {
+            ivec2 texel = clamp(base + ivec2(x, y), ivec2(0), halfSize - 1);
+            float bilinear = (x == 1 ? fraction.x : 1.0 - fraction.x) * (y == 1 ? fraction.y : 1.0 - fraction.y);
+            float texelZ = texelFetch(normalDepth, texel, 0).w;
+            float weight = (bilinear + 1e-3) / (1e-3 + abs(texelZ - z) / abs(z));
+            total += texelFetch(occlusion, texel, 0).r * weight;
+            weights += weight;
+        }
+    }
+    FragColor = vec4(vec3(total / weights), 1);
+}
@@ -0,0 +1,49 @@
+#version 330
+// Blends the current frame into the reprojected history, with the history clamped to the range
+// of colors around the pixel in the current frame, which rejects stale history without blurring.
+layout (location=0) out vec4 FragColor;
+
+uniform sampler2D currentColor;
+uniform sampler2D historyColor;
+uniform sampler2D motionVectors;
+uniform sampler2D sceneDepth;
+// Maps this frame's NDC to last frame's clip space, for pixels without a motion vector.
+uniform mat4 reprojection;
+uniform bool historyValid;
+// How much of the current frame goes into each pixel.
+uniform float blendFactor;
+
+// Motion vectors are cleared to this before the motion vector pass.
+const float NO_MOTION = 1000.0;
+
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    ivec2 size = textureSize(currentColor, 0);
+    vec2 uv = (vec2(p) + 0.5) / vec2(size);
+    vec3 current = texelFetch(currentColor, p, 0).rgb;
+
+    vec3 neighborhoodMin = current;
+    vec3 neighborhoodMax = current;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            vec3 neighbor = texelFetch(currentColor, clamp(p + ivec2(x, y), ivec2(0), size - 1), 0).rgb;
+            neighborhoodMin = min(neighborhoodMin, neighbor);
+            neighborhoodMax = max(neighborhoodMax, neighbor);
+        }
+    }
+
+    vec2 motion = texelFetch(motionVectors, p, 0).xy;
+    if (motion.x >= NO_MOTION) {
+        float depth = texelFetch(sceneDepth, p, 0).r;
+        vec4 previous = reprojection * vec4(uv * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+        motion = uv - (previous.xy / previous.w * 0.5 + 0.5);
+    }
+    vec2 historyUv = uv - motion;
+    if (!historyValid || any(lessThan(historyUv, vec2(0))) || any(greaterThan(historyUv, vec2(1)))) {
+        FragColor = vec4(current, 1);
+        return;
+    }
+
+    vec3 history = clamp(texture(historyColor, historyUv).rgb, neighborhoodMin, neighborhoodMax);
+    FragColor = vec4(mix(history, current, blendFactor), 1);
+}
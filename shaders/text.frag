@@ -0,0 +1,19 @@
+#version 330
+// Turns a glyph's signed distance field into coverage, with an edge about one pixel wide
+// whatever the size the glyph is drawn at.
+layout (location=0) out vec4 FragColor;
+
+in vec2 TexCoord;
+in vec4 Color;
+
+uniform sampler2D atlas;
+
+void main() {
+    float distance = texture(atlas, TexCoord).r;
+    float width = max(fwidth(distance) * 0.75, 1e-4);
+    float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+    if (alpha <= 0.0) {
+        discard;
+    }
+    FragColor = vec4(Color.rgb, Color.a * alpha);
+}
@@ -0,0 +1,24 @@
+#version 330
+// Places the corners of glyph quads. World-space corners go through the camera; screen-space
+// ones are pixels from the top left of the viewport, put on the near plane.
+layout (location=0) in vec4 positionScreenSpace;
+layout (location=1) in vec2 texCoord;
+layout (location=2) in vec4 color;
+
+uniform mat4 viewProjection;
+uniform vec2 viewportSize;
+
+out vec2 TexCoord;
+out vec4 Color;
+
+void main() {
+    TexCoord = texCoord;
+    Color = color;
+    if (positionScreenSpace.w > 0.5) {
+        vec2 ndc = positionScreenSpace.xy / viewportSize * 2.0 - 1.0;
+        gl_Position = vec4(ndc.x, -ndc.y, -1.0, 1.0);
+    }
+    else {
+        gl_Position = viewProjection * vec4(positionScreenSpace.xyz, 1.0);
+    }
+}
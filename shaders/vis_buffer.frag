@@ -0,0 +1,10 @@
+#version 330
+// Writes which draw and which of its triangles covers this pixel. Draw IDs are offset by one so
+// that 0 can mean "no geometry".
+layout (location=0) out uvec2 Visibility;
+
+uniform uint drawId;
+
+void main() {
+    Visibility = uvec2(drawId + 1u, uint(gl_PrimitiveID));
+}
@@ -0,0 +1,12 @@
+#version 330
+// Converts each pixel's draw ID into a depth value, so that the resolve pass can select a
+// draw's pixels with an EQUAL depth test. Must match the depth computed in vis_resolve.vert.
+uniform usampler2D visibility;
+
+void main() {
+    uint id = texelFetch(visibility, ivec2(gl_FragCoord.xy), 0).x;
+    if (id == 0u) {
+        discard;
+    }
+    gl_FragDepth = float(id - 1u) / 65536.0;
+}
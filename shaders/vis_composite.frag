@@ -0,0 +1,12 @@
+#version 330
+// Copies the resolved visibility buffer color and the scene depth to the current framebuffer.
+layout (location=0) out vec4 FragColor;
+
+uniform sampler2D resolvedColor;
+uniform sampler2D sceneDepth;
+
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    FragColor = texelFetch(resolvedColor, p, 0);
+    gl_FragDepth = texelFetch(sceneDepth, p, 0).r;
+}
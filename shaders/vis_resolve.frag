@@ -0,0 +1,115 @@
+#version 330
+// Shades the pixels of one draw in the Phong reflection model, like lighting.frag, but fetches
+// the covering triangle from the visibility buffer and reconstructs its attributes instead of
+// receiving them from a vertex shader.
+layout (location=0) out vec4 FragColor;
+
+uniform usampler2D visibility;
+// The draw's vertices (two RGBA32F texels per vertex) and triangle indices.
+uniform samplerBuffer vertexData;
+uniform usamplerBuffer indexData;
+uniform uint drawId;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+uniform mat3 normalMatrix;
+uniform vec2 viewportSize;
+
+uniform sampler2D baseTexture;
+uniform vec4 material;
+uniform vec3 ambientColor;
+uniform vec3 directionalLight;
+uniform vec3 directionalColor;
+uniform vec3 viewPos;
+
+struct Corner {
+    vec3 position;
+    vec3 normal;
+    vec2 texCoord;
+};
+
+Corner fetchCorner(uint index) {
+    vec4 a = texelFetch(vertexData, int(index) * 2);
+    vec4 b = texelFetch(vertexData, int(index) * 2 + 1);
+    return Corner(a.xyz, vec3(a.w, b.xy), b.zw);
+}
+
+// Screen-space barycentric coordinates of p in the triangle (a, b, c).
+vec3 barycentrics(vec2 p, vec2 a, vec2 b, vec2 c) {
+    vec2 v0 = b - a;
+    vec2 v1 = c - a;
+    vec2 v2 = p - a;
+    float d = v0.x * v1.y - v1.x * v0.y;
+    float l1 = (v2.x * v1.y - v1.x * v2.y) / d;
+    float l2 = (v0.x * v2.y - v2.x * v0.y) / d;
+    return vec3(1.0 - l1 - l2, l1, l2);
+}
+
+vec3 perspectiveCorrect(vec3 screenBary, vec3 invW) {
+    vec3 b = screenBary * invW;
+    return b / (b.x + b.y + b.z);
+}
+
+void main() {
+    uvec2 vis = texelFetch(visibility, ivec2(gl_FragCoord.xy), 0).xy;
+    // The material depth test already selects this draw's pixels; this guards against depth
+    // quantization on unusual hardware.
+    if (vis.x != drawId + 1u) {
+        discard;
+    }
+
+    uint first = vis.y * 3u;
+    Corner v0 = fetchCorner(texelFetch(indexData, int(first)).r);
+    Corner v1 = fetchCorner(texelFetch(indexData, int(first + 1u)).r);
+    Corner v2 = fetchCorner(texelFetch(indexData, int(first + 2u)).r);
+
+    mat4 mvp = projection * view * model;
+    vec4 c0 = mvp * vec4(v0.position, 1.0);
+    vec4 c1 = mvp * vec4(v1.position, 1.0);
+    vec4 c2 = mvp * vec4(v2.position, 1.0);
+    vec3 invW = 1.0 / vec3(c0.w, c1.w, c2.w);
+    vec2 n0 = c0.xy * invW.x;
+    vec2 n1 = c1.xy * invW.y;
+    vec2 n2 = c2.xy * invW.z;
+
+    // Barycentrics at this pixel and its right and upper neighbours give texture gradients.
+    vec2 pixel = gl_FragCoord.xy / viewportSize * 2.0 - 1.0;
+    vec2 pixelStep = 2.0 / viewportSize;
+    vec3 b = perspectiveCorrect(barycentrics(pixel, n0, n1, n2), invW);
+    vec3 bx = perspectiveCorrect(barycentrics(pixel + vec2(pixelStep.x, 0.0), n0, n1, n2), invW);
+    vec3 by = perspectiveCorrect(barycentrics(pixel + vec2(0.0, pixelStep.y), n0, n1, n2), invW);
+
+    mat3x2 texCoords = mat3x2(v0.texCoord, v1.texCoord, v2.texCoord);
+    vec2 TexCoord = texCoords * b;
+    vec2 texCoordDx = texCoords * bx - TexCoord;
+    vec2 texCoordDy = texCoords * by - TexCoord;
+
+    vec3 localPos = mat3(v0.position, v1.position, v2.position) * b;
+    vec3 FragWorldPos = vec3(model * vec4(localPos, 1.0));
+    vec3 Normal = normalMatrix * (mat3(v0.normal, v1.normal, v2.normal) * b);
+
+    // The same Phong model as lighting.frag.
+    vec3 ambientIntensity = ambientColor * material.x;
+
+    vec3 diffuseIntensity = vec3(0);
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = -directionalLight;
+    float lambertFactor = dot(norm, normalize(lightDir));
+    if (lambertFactor > 0){
+        diffuseIntensity = material.y * directionalColor * lambertFactor;
+    }
+
+    vec3 specularIntensity = vec3(0);
+    if (lambertFactor > 0){
+        vec3 eyeDir = normalize(viewPos - FragWorldPos);
+        vec3 reflectDir = normalize(reflect(-lightDir, norm));
+        float spec = dot(reflectDir, eyeDir);
+        if (spec > 0){
+            specularIntensity = material.z * directionalColor * pow(spec, material.w);
+        }
+    }
+
+    vec3 lightIntensity = ambientIntensity + diffuseIntensity + specularIntensity;
+    FragColor = vec4(lightIntensity, 1) * textureGrad(baseTexture, TexCoord, texCoordDx, texCoordDy);
+}
@@ -0,0 +1,9 @@
+#version 330
+// A fullscreen triangle placed at the material depth of one draw; see vis_classify.frag.
+uniform uint drawId;
+
+void main() {
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    float depth = float(drawId) / 65536.0;
+    gl_Position = vec4(corner * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+}
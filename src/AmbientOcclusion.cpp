@@ -0,0 +1,199 @@
+#include "AmbientOcclusion.h"
+#include "FullscreenTriangle.h"
+#include <glad/glad.h>
+#include <algorithm>
+
+namespace {
+	struct AmbientOcclusionPreset {
+		int32_t sampleCount;
+		float radius;
+	};
+
+	// Indexed by AmbientOcclusionQuality.
+	const AmbientOcclusionPreset PRESETS[] = {
+		{ 0, 0 },
+		{ 6, 0.5f },
+		{ 12, 0.75f },
+		{ 24, 1.0f },
+	};
+
+	// How much of each new frame's occlusion goes into the history.
+	const float TEMPORAL_BLEND_FACTOR = 0.2f;
+
+	uint32_t createTarget(GLenum internalFormat, uint32_t width, uint32_t height, GLenum format, GLenum type,
+		GLenum filter) {
+		uint32_t texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		return texture;
+	}
+
+	uint32_t createFramebuffer(GLenum attachment, uint32_t texture) {
+		uint32_t framebuffer;
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+		return framebuffer;
+	}
+}
+
+AmbientOcclusion::AmbientOcclusion()
+	: m_quality(AmbientOcclusionQuality::Off), m_temporal(true), m_width(0), m_height(0),
+	m_depthTexture(0), m_depthFramebuffer(0), m_normalDepthTexture(0), m_normalDepthFramebuffer(0),
+	m_occlusionTexture(0), m_occlusionFramebuffer(0), m_historyTextures{ 0, 0 }, m_historyFramebuffers{ 0, 0 },
+	m_historyIndex(0), m_historyValid(false), m_frameIndex(0), m_previousView(1), m_previousProjection(1) {
+	m_prepareProgram.load("shaders/fullscreen.vert", "shaders/ssao_prepare.frag");
+	m_occlusionProgram.load("shaders/fullscreen.vert", "shaders/ssao.frag");
+	m_temporalProgram.load("shaders/fullscreen.vert", "shaders/ssao_temporal.frag");
+	m_upsampleProgram.load("shaders/fullscreen.vert", "shaders/ssao_upsample.frag");
+}
+
+void AmbientOcclusion::setQuality(AmbientOcclusionQuality quality) {
+	if (quality != m_quality) {
+		m_quality = quality;
+		m_historyValid = false;
+	}
+}
+
+void AmbientOcclusion::setTemporal(bool temporal) {
+	m_temporal = temporal;
+	m_historyValid = false;
+}
+
+void AmbientOcclusion::resize(uint32_t width, uint32_t height) {
+	if (m_depthTexture != 0) {
+		uint32_t textures[] = { m_depthTexture, m_normalDepthTexture, m_occlusionTexture,
+			m_historyTextures[0], m_historyTextures[1] };
+		glDeleteTextures(5, textures);
+		uint32_t framebuffers[] = { m_depthFramebuffer, m_normalDepthFramebuffer, m_occlusionFramebuffer,
+			m_historyFramebuffers[0], m_historyFramebuffers[1] };
+		glDeleteFramebuffers(5, framebuffers);
+	}
+	m_width = width;
+	m_height = height;
+	m_historyValid = false;
+	uint32_t halfWidth = std::max(1u, width / 2);
+	uint32_t halfHeight = std::max(1u, height / 2);
+
+	// Must match the window's depth format for the depth blit.
+	m_depthTexture = createTarget(GL_DEPTH24_STENCIL8, width, height, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8,
+		GL_NEAREST);
+	m_depthFramebuffer = createFramebuffer(GL_DEPTH_STENCIL_ATTACHMENT, m_depthTexture);
+	// Depths are never interpolated across edges; only the history is sampled between texels.
+	m_normalDepthTexture = createTarget(GL_RGBA32F, halfWidth, halfHeight, GL_RGBA, GL_FLOAT, GL_NEAREST);
+	m_normalDepthFramebuffer = createFramebuffer(GL_COLOR_ATTACHMENT0, m_normalDepthTexture);
+	m_occlusionTexture = createTarget(GL_R8, halfWidth, halfHeight, GL_RED, GL_UNSIGNED_BYTE, GL_NEAREST);
+	m_occlusionFramebuffer = createFramebuffer(GL_COLOR_ATTACHMENT0, m_occlusionTexture);
+	for (auto i = 0; i < 2; i++) {
+		m_historyTextures[i] = createTarget(GL_RG32F, halfWidth, halfHeight, GL_RG, GL_FLOAT, GL_LINEAR);
+		m_historyFramebuffers[i] = createFramebuffer(GL_COLOR_ATTACHMENT0, m_historyTextures[i]);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void AmbientOcclusion::apply(const glm::mat4& view, const glm::mat4& projection, uint32_t width, uint32_t height) {
+	if (m_quality == AmbientOcclusionQuality::Off || width == 0 || height == 0) {
+		return;
+	}
+	int32_t sceneFramebuffer;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &sceneFramebuffer);
+	if (width != m_width || height != m_height) {
+		resize(width, height);
+	}
+	auto& preset = PRESETS[static_cast<int32_t>(m_quality)];
+	uint32_t halfWidth = std::max(1u, width / 2);
+	uint32_t halfHeight = std::max(1u, height / 2);
+
+	// Resolve the (possibly multisampled) scene depth into our depth texture.
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_depthFramebuffer);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+	int32_t previousProgram;
+	int32_t previousViewport[4];
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	glDisable(GL_DEPTH_TEST);
+
+	// 1. Half-resolution normals and depths.
+	glViewport(0, 0, halfWidth, halfHeight);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_normalDepthFramebuffer);
+	m_prepareProgram.activate();
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	m_prepareProgram.setUniform("sceneDepth", 0);
+	m_prepareProgram.setUniform("projection", projection);
+	drawFullscreenTriangle();
+
+	// 2. Occlusion.
+	glBindFramebuffer(GL_FRAMEBUFFER, m_occlusionFramebuffer);
+	m_occlusionProgram.activate();
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, m_normalDepthTexture);
+	m_occlusionProgram.setUniform("normalDepth", 1);
+	m_occlusionProgram.setUniform("projection", projection);
+	m_occlusionProgram.setUniform("sampleCount", preset.sampleCount);
+	m_occlusionProgram.setUniform("radius", preset.radius);
+	// Without a history to average them, the sample directions stay the same every frame.
+	m_occlusionProgram.setUniform("frameIndex", m_temporal ? m_frameIndex : 0);
+	drawFullscreenTriangle();
+
+	// 3. Optionally, accumulation into the other history texture.
+	uint32_t occlusionTexture = m_occlusionTexture;
+	if (m_temporal) {
+		uint32_t next = 1 - m_historyIndex;
+		glBindFramebuffer(GL_FRAMEBUFFER, m_historyFramebuffers[next]);
+		m_temporalProgram.activate();
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, m_occlusionTexture);
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, m_historyTextures[m_historyIndex]);
+		m_temporalProgram.setUniform("normalDepth", 1);
+		m_temporalProgram.setUniform("occlusion", 2);
+		m_temporalProgram.setUniform("history", 3);
+		m_temporalProgram.setUniform("projection", projection);
+		m_temporalProgram.setUniform("toPreviousView", m_previousView * glm::inverse(view));
+		m_temporalProgram.setUniform("previousProjection", m_previousProjection);
+		m_temporalProgram.setUniform("historyValid", m_historyValid);
+		m_temporalProgram.setUniform("blendFactor", TEMPORAL_BLEND_FACTOR);
+		drawFullscreenTriangle();
+		m_historyIndex = next;
+		m_historyValid = true;
+		occlusionTexture = m_historyTextures[next];
+	}
+
+	// 4. Bilateral upsample, multiplied into the scene's color.
+	glViewport(0, 0, width, height);
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ZERO, GL_SRC_COLOR);
+	m_upsampleProgram.activate();
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, occlusionTexture);
+	m_upsampleProgram.setUniform("sceneDepth", 0);
+	m_upsampleProgram.setUniform("normalDepth", 1);
+	m_upsampleProgram.setUniform("occlusion", 2);
+	m_upsampleProgram.setUniform("projection", projection);
+	drawFullscreenTriangle();
+	glDisable(GL_BLEND);
+
+	for (auto unit = 3; unit >= 0; unit--) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	glEnable(GL_DEPTH_TEST);
+	glUseProgram(previousProgram);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+
+	m_previousView = view;
+	m_previousProjection = projection;
+	++m_frameIndex;
+}
@@ -42,3 +42,22 @@ void Animator::start() {
 	m_currentTime = 0;
 	nextAnimation();
 }
+
+AnimatorState Animator::state() const {
+	return AnimatorState{ m_currentTime, m_nextTransition, m_currentIndex,
+		m_currentAnimation != nullptr ? m_currentAnimation->currentTime() : 0 };
+}
+
+void Animator::restore(const AnimatorState& state) {
+	m_currentTime = state.currentTime;
+	m_nextTransition = state.nextTransition;
+	if (state.currentIndex >= 0 && state.currentIndex < m_animations.size()) {
+		m_currentIndex = state.currentIndex;
+		m_currentAnimation = m_animations[m_currentIndex].get();
+		m_currentAnimation->resume(state.animationTime);
+	}
+	else {
+		m_currentIndex = -1;
+		m_currentAnimation = nullptr;
+	}
+}
@@ -0,0 +1,230 @@
+#include "AntiAliasing.h"
+#include "FullscreenTriangle.h"
+#include "Mesh3D.h"
+#include <glad/glad.h>
+#include <utility>
+
+namespace {
+	// The number of jitter samples TAA cycles through.
+	const uint32_t JITTER_SAMPLES = 8;
+	// How much of each new frame TAA blends into its history.
+	const float TAA_BLEND_FACTOR = 0.1f;
+	// The value the motion vector target is cleared to, for pixels that no draw covers.
+	const float NO_MOTION = 1000.0f;
+
+	float halton(uint32_t index, uint32_t base) {
+		float result = 0;
+		float fraction = 1.0f / base;
+		for (; index > 0; index /= base) {
+			result += fraction * (index % base);
+			fraction /= base;
+		}
+		return result;
+	}
+
+	uint32_t createTarget(GLenum internalFormat, uint32_t width, uint32_t height, GLenum format, GLenum type,
+		GLenum filter) {
+		uint32_t texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		return texture;
+	}
+}
+
+AntiAliasing::AntiAliasing()
+	: m_mode(AntiAliasingMode::Off), m_width(0), m_height(0),
+	m_colorTexture(0), m_motionTexture(0), m_depthTexture(0), m_sceneFramebuffer(0),
+	m_historyTextures{ 0, 0 }, m_historyFramebuffers{ 0, 0 }, m_historyIndex(0), m_historyValid(false),
+	m_frameIndex(0), m_jitter(0), m_previousViewProjection(1) {
+	m_fxaaProgram.load("shaders/fullscreen.vert", "shaders/fxaa.frag");
+	m_motionProgram.load("shaders/motion_vectors.vert", "shaders/motion_vectors.frag");
+	m_resolveProgram.load("shaders/fullscreen.vert", "shaders/taa_resolve.frag");
+	m_compositeProgram.load("shaders/fullscreen.vert", "shaders/vis_composite.frag");
+}
+
+void AntiAliasing::setMode(AntiAliasingMode mode) {
+	if (mode != m_mode) {
+		m_mode = mode;
+		m_historyValid = false;
+		m_previousModels.clear();
+	}
+}
+
+glm::mat4 AntiAliasing::jitter(const glm::mat4& projection) const {
+	if (m_mode != AntiAliasingMode::Taa || m_width == 0 || m_height == 0) {
+		return projection;
+	}
+	// Shifting the third column offsets clip x and y by a multiple of w, which is a constant
+	// offset in NDC: a subpixel translation of the whole image.
+	glm::mat4 jittered = projection;
+	jittered[2][0] += m_jitter.x * 2.0f / m_width;
+	jittered[2][1] += m_jitter.y * 2.0f / m_height;
+	return jittered;
+}
+
+void AntiAliasing::resize(uint32_t width, uint32_t height) {
+	if (m_colorTexture != 0) {
+		uint32_t textures[] = { m_colorTexture, m_motionTexture, m_depthTexture,
+			m_historyTextures[0], m_historyTextures[1] };
+		glDeleteTextures(5, textures);
+		uint32_t framebuffers[] = { m_sceneFramebuffer, m_historyFramebuffers[0], m_historyFramebuffers[1] };
+		glDeleteFramebuffers(3, framebuffers);
+	}
+	m_width = width;
+	m_height = height;
+	m_historyValid = false;
+
+	// FXAA and the TAA history are sampled between texels, so both are filtered linearly. The
+	// depth target matches the window's format, so that DepthPyramid can blit from it.
+	m_colorTexture = createTarget(GL_RGBA8, width, height, GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR);
+	m_motionTexture = createTarget(GL_RG16F, width, height, GL_RG, GL_FLOAT, GL_NEAREST);
+	m_depthTexture = createTarget(GL_DEPTH24_STENCIL8, width, height, GL_DEPTH_STENCIL,
+		GL_UNSIGNED_INT_24_8, GL_NEAREST);
+	glGenFramebuffers(1, &m_sceneFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_motionTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+
+	for (auto i = 0; i < 2; i++) {
+		m_historyTextures[i] = createTarget(GL_RGBA8, width, height, GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR);
+		glGenFramebuffers(1, &m_historyFramebuffers[i]);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_historyFramebuffers[i]);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_historyTextures[i], 0);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void AntiAliasing::begin(uint32_t width, uint32_t height) {
+	if (m_mode == AntiAliasingMode::Off || width == 0 || height == 0) {
+		return;
+	}
+	if (width != m_width || height != m_height) {
+		resize(width, height);
+	}
+	// The scene writes only color; the motion vector attachment is filled in by resolve().
+	glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFramebuffer);
+	GLenum colorOnly = GL_COLOR_ATTACHMENT0;
+	glDrawBuffers(1, &colorOnly);
+}
+
+void AntiAliasing::renderMotionVectors(const std::vector<const std::vector<MeshDraw>*>& drawLists,
+	const glm::mat4& viewProjection, const glm::mat4& jitteredViewProjection) {
+	GLenum motionOnly = GL_COLOR_ATTACHMENT1;
+	glDrawBuffers(1, &motionOnly);
+	const float noMotion[] = { NO_MOTION, NO_MOTION, 0, 0 };
+	glClearBufferfv(GL_COLOR, 0, noMotion);
+
+	// Depth-test against the scene's own depth, without changing it, so that only the visible
+	// surface of each pixel writes its motion.
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_FALSE);
+	m_motionProgram.activate();
+	m_motionProgram.setUniform("viewProjection", viewProjection);
+	m_motionProgram.setUniform("jitteredViewProjection", jitteredViewProjection);
+	m_motionProgram.setUniform("previousViewProjection", m_previousViewProjection);
+	for (auto draws : drawLists) {
+		for (auto& draw : *draws) {
+			// A mesh seen for the first time has not moved.
+			auto previous = m_previousModels.find(draw.mesh);
+			m_motionProgram.setUniform("model", draw.model);
+			m_motionProgram.setUniform("previousModel",
+				previous != m_previousModels.end() ? previous->second : draw.model);
+			draw.mesh->renderGeometry();
+			m_currentModels[draw.mesh] = draw.model;
+		}
+	}
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+
+	GLenum colorOnly = GL_COLOR_ATTACHMENT0;
+	glDrawBuffers(1, &colorOnly);
+}
+
+void AntiAliasing::resolve(const std::vector<const std::vector<MeshDraw>*>& drawLists, const glm::mat4& view,
+	const glm::mat4& projection) {
+	if (m_mode == AntiAliasingMode::Off || m_width == 0) {
+		return;
+	}
+	int32_t previousProgram;
+	int32_t previousViewport[4];
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	glViewport(0, 0, m_width, m_height);
+
+	glm::mat4 viewProjection = projection * view;
+	uint32_t displayedTexture = m_colorTexture;
+	if (m_mode == AntiAliasingMode::Taa) {
+		renderMotionVectors(drawLists, viewProjection, jitter(projection) * view);
+
+		// Blend the frame into the other history texture, which is then displayed.
+		uint32_t next = 1 - m_historyIndex;
+		glBindFramebuffer(GL_FRAMEBUFFER, m_historyFramebuffers[next]);
+		glDisable(GL_DEPTH_TEST);
+		m_resolveProgram.activate();
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, m_historyTextures[m_historyIndex]);
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, m_motionTexture);
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+		m_resolveProgram.setUniform("currentColor", 0);
+		m_resolveProgram.setUniform("historyColor", 1);
+		m_resolveProgram.setUniform("motionVectors", 2);
+		m_resolveProgram.setUniform("sceneDepth", 3);
+		m_resolveProgram.setUniform("reprojection", m_previousViewProjection * glm::inverse(viewProjection));
+		m_resolveProgram.setUniform("historyValid", m_historyValid);
+		m_resolveProgram.setUniform("blendFactor", TAA_BLEND_FACTOR);
+		drawFullscreenTriangle();
+		glEnable(GL_DEPTH_TEST);
+
+		m_historyIndex = next;
+		m_historyValid = true;
+		displayedTexture = m_historyTextures[next];
+		std::swap(m_previousModels, m_currentModels);
+		m_currentModels.clear();
+	}
+
+	// Write the image and the scene depth to the window, so that later passes can still test
+	// against the scene.
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDepthFunc(GL_ALWAYS);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, displayedTexture);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	if (m_mode == AntiAliasingMode::Fxaa) {
+		m_fxaaProgram.activate();
+		m_fxaaProgram.setUniform("sceneColor", 0);
+		m_fxaaProgram.setUniform("sceneDepth", 1);
+	}
+	else {
+		m_compositeProgram.activate();
+		m_compositeProgram.setUniform("resolvedColor", 0);
+		m_compositeProgram.setUniform("sceneDepth", 1);
+	}
+	drawFullscreenTriangle();
+	glDepthFunc(GL_LESS);
+
+	for (auto unit = 3; unit >= 0; unit--) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	glUseProgram(previousProgram);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+
+	m_previousViewProjection = viewProjection;
+	++m_frameIndex;
+	uint32_t sample = m_frameIndex % JITTER_SAMPLES + 1;
+	m_jitter = glm::vec2(halton(sample, 2) - 0.5f, halton(sample, 3) - 0.5f);
+}
@@ -0,0 +1,561 @@
+#include "AssetReloader.h"
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <iostream>
+#include <string_view>
+
+namespace {
+	/**
+	 * @brief Whether an imported node has the same meshes and children, recursively, as an object
+	 * made from an earlier import. Only the object's first importedChildren children are compared.
+	 */
+	bool sameStructure(const Object3D& object, const ImportedNode& node, size_t importedChildren) {
+		if (object.getMeshes().size() != node.meshes.size() || importedChildren != node.children.size()
+			|| object.numberOfChildren() < importedChildren) {
+			return false;
+		}
+		for (size_t i = 0; i < node.children.size(); i++) {
+			auto& child = object.getChild(i);
+			if (!sameStructure(child, node.children[i], child.numberOfChildren())) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	uint64_t geometryHash(const ImportedMesh& mesh) {
+		// Vertex3D is nothing but floats, so hashing bytes hashes every field.
+		std::hash<std::string_view> hash;
+		uint64_t vertices = hash(std::string_view(reinterpret_cast<const char*>(mesh.vertices.data()),
+			mesh.vertices.size() * sizeof(Vertex3D)));
+		uint64_t faces = hash(std::string_view(reinterpret_cast<const char*>(mesh.faces.data()),
+			mesh.faces.size() * sizeof(uint32_t)));
+		return vertices ^ (faces + 0x9e3779b97f4a7c15ull + (vertices << 6) + (vertices >> 2));
+	}
+
+	/**
+	 * @brief Adds the textures of an object's meshes, and its children's, to a model's textures.
+	 */
+	void collectTextures(const Object3D& object, const std::unordered_map<uint32_t, std::string>& texturePaths,
+		std::unordered_map<std::string, Texture>& textures) {
+		for (auto& mesh : object.getMeshes()) {
+			for (auto& texture : mesh.getTextures()) {
+				auto path = texturePaths.find(texture.textureId);
+				if (path != texturePaths.end()) {
+					textures.insert(std::make_pair(path->second, Texture{ texture.textureId, "" }));
+				}
+			}
+		}
+		for (size_t i = 0; i < object.numberOfChildren(); i++) {
+			collectTextures(object.getChild(i), texturePaths, textures);
+		}
+	}
+
+	/**
+	 * @brief Counts the meshes of an object and its children, as flattenMeshes() would list them.
+	 */
+	size_t countMeshes(const Object3D& object) {
+		auto count = object.getMeshes().size();
+		for (size_t i = 0; i < object.numberOfChildren(); i++) {
+			count += countMeshes(object.getChild(i));
+		}
+		return count;
+	}
+
+	/**
+	 * @brief Lists the meshes of an object made from an import in the order the import's nodes list
+	 * them, depth first. Only the object's first importedChildren children are included.
+	 */
+	void flattenMeshes(Object3D& object, size_t importedChildren, std::vector<Mesh3D*>& meshes) {
+		for (auto& mesh : object.getMeshes()) {
+			meshes.push_back(&mesh);
+		}
+		for (size_t i = 0; i < importedChildren; i++) {
+			auto& child = object.getChild(i);
+			flattenMeshes(child, child.numberOfChildren(), meshes);
+		}
+	}
+}
+
+void AssetReloader::summarizeMeshes(const ImportedNode& node, std::vector<MeshSummary>& meshes) {
+	for (auto& mesh : node.meshes) {
+		MeshSummary summary{ geometryHash(mesh), glm::vec3(0), 0 };
+		Mesh3D::computeBounds(mesh.vertices, summary.boundsCenter, summary.boundsRadius);
+		meshes.push_back(summary);
+	}
+	for (auto& child : node.children) {
+		summarizeMeshes(child, meshes);
+	}
+}
+
+AssetReloader::AssetReloader(uint32_t workerThreads, GpuUploader* uploader) : m_uploader(uploader), m_stopping(false) {
+	for (uint32_t i = 0; i < std::max(1u, workerThreads); i++) {
+		m_workers.emplace_back(&AssetReloader::work, this);
+	}
+	m_watcher = std::thread(&AssetReloader::watch, this);
+}
+
+AssetReloader::~AssetReloader() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	m_watcher.join();
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+}
+
+void AssetReloader::watchFile(const std::filesystem::path& path, JobKind kind, const WatchedModel& model) {
+	auto key = path.string();
+	if (m_files.find(key) != m_files.end()) {
+		return;
+	}
+	std::error_code error;
+	auto lastWrite = std::filesystem::last_write_time(path, error);
+	m_files.insert(std::make_pair(key, WatchedFile{ error ? std::filesystem::file_time_type::min() : lastWrite,
+		kind, kind == JobKind::Model ? model.path : key, model.flipTextureCoords, model.profile }));
+}
+
+void AssetReloader::watchModelFiles(const WatchedModel& model) {
+	std::filesystem::path modelPath(model.path);
+	watchFile(modelPath, JobKind::Model, model);
+	// A glTF's geometry lives in the binary buffers next to it.
+	std::error_code error;
+	for (auto& entry : std::filesystem::directory_iterator(modelPath.parent_path(), error)) {
+		if (entry.path().extension() == ".bin") {
+			watchFile(entry.path(), JobKind::Model, model);
+		}
+	}
+	auto& images = m_modelImages[model.path];
+	for (auto& [path, texture] : model.textures) {
+		watchFile(path, JobKind::Image, model);
+		images.insert(path);
+	}
+}
+
+Object3D AssetReloader::load(const std::string& path, bool flipTextureCoords, TextureStreamer* streamer,
+	ImportProfile profile) {
+	auto imported = assimpImport(path, flipTextureCoords, {}, profile);
+	std::vector<MeshSummary> meshes;
+	summarizeMeshes(imported.root, meshes);
+	std::vector<uint64_t> meshHashes;
+	for (auto& mesh : meshes) {
+		meshHashes.push_back(mesh.geometryHash);
+	}
+	std::unordered_map<std::string, Texture> textures;
+	auto object = createImportedObject(imported, textures, streamer);
+	object.setName(path);
+	m_models.push_back(WatchedModel{ path, flipTextureCoords, profile, streamer, std::move(textures),
+		object.numberOfChildren(), std::move(meshHashes), 0 });
+	std::lock_guard<std::mutex> lock(m_mutex);
+	watchModelFiles(m_models.back());
+	return object;
+}
+
+void AssetReloader::watch() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	std::vector<std::string> paths;
+	std::vector<std::pair<std::string, std::filesystem::file_time_type>> changed;
+	while (true) {
+		if (m_wake.wait_for(lock, POLL_INTERVAL, [this] { return m_stopping; })) {
+			return;
+		}
+		paths.clear();
+		for (auto& [path, file] : m_files) {
+			paths.push_back(path);
+		}
+		lock.unlock();
+
+		// Files being replaced may briefly not exist; they are checked again next time.
+		changed.clear();
+		for (auto& path : paths) {
+			std::error_code error;
+			auto lastWrite = std::filesystem::last_write_time(path, error);
+			if (!error) {
+				changed.emplace_back(path, lastWrite);
+			}
+		}
+
+		lock.lock();
+		bool queued = false;
+		for (auto& [path, lastWrite] : changed) {
+			auto& file = m_files.at(path);
+			if (file.lastWrite == lastWrite) {
+				continue;
+			}
+			file.lastWrite = lastWrite;
+			// A target already waiting for a worker will be read after this change anyway.
+			auto queueKey = (file.kind == JobKind::Model ? "model:" : "image:") + file.target;
+			if (!m_queuedTargets.insert(queueKey).second) {
+				continue;
+			}
+			std::cout << "Reloading " << file.target << " after a change to " << path << std::endl;
+			Job job{ file.kind, file.target, file.flipTextureCoords, file.profile, {} };
+			if (file.kind == JobKind::Model) {
+				job.knownImages = m_modelImages[file.target];
+			}
+			m_jobs.push_back(std::move(job));
+			queued = true;
+		}
+		if (queued) {
+			m_wake.notify_all();
+		}
+	}
+}
+
+void AssetReloader::work() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_wake.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+		if (m_stopping) {
+			return;
+		}
+		auto job = std::move(m_jobs.front());
+		m_jobs.pop_front();
+		// Changes from now on need another job, since this one may already miss them.
+		m_queuedTargets.erase((job.kind == JobKind::Model ? "model:" : "image:") + job.path);
+		lock.unlock();
+
+		Result result{ job.kind, job.path, nullptr, {}, nullptr };
+		bool succeeded = true;
+		try {
+			if (job.kind == JobKind::Model) {
+				result.model = std::make_unique<ImportedModel>(
+					assimpImport(job.path, job.flipTextureCoords, job.knownImages, job.profile));
+				summarizeMeshes(result.model->root, result.meshes);
+			}
+			else {
+				result.image = std::make_unique<StbImage>();
+				result.image->loadFromFile(job.path);
+			}
+		}
+		catch (std::exception& e) {
+			std::cerr << "Could not reload " << job.path << ": " << e.what() << std::endl;
+			succeeded = false;
+		}
+
+		lock.lock();
+		if (succeeded) {
+			m_results.push_back(std::move(result));
+		}
+		else {
+			++m_stats.failures;
+		}
+	}
+}
+
+bool AssetReloader::canStage() const {
+	return m_uploader != nullptr && m_uploader->isAvailable();
+}
+
+void AssetReloader::applyImage(const std::string& path, std::shared_ptr<const StbImage> image) {
+	bool stage = false;
+	for (auto& model : m_models) {
+		auto texture = model.textures.find(path);
+		if (texture == model.textures.end()) {
+			continue;
+		}
+		// The streamer keeps its own copy of the mip chain and only uploads the coarse levels.
+		if (model.streamer != nullptr && model.streamer->reload(texture->second.textureId, *image)) {
+			++m_stats.texturesReloaded;
+		}
+		else if (canStage()) {
+			stage = true;
+		}
+		else {
+			Texture::reloadImage(texture->second.textureId, *image);
+			++m_stats.texturesReloaded;
+		}
+	}
+	if (stage) {
+		auto width = image->getWidth();
+		auto height = image->getHeight();
+		auto texels = image->getData();
+		auto ticket = m_uploader->uploadBuffer(texels, static_cast<size_t>(width) * height * 4, std::move(image));
+		m_stagedImages.push_back(StagedImage{ path, width, height, ticket });
+	}
+}
+
+void AssetReloader::uploadNewTextures(WatchedModel& model, ImportedModel& imported) {
+	for (auto& [path, image] : imported.images) {
+		if (model.textures.find(path) == model.textures.end()) {
+			Texture texture = model.streamer != nullptr ? model.streamer->load(image, "") : Texture::loadImage(image, "");
+			model.textures.insert(std::make_pair(path, texture));
+		}
+	}
+}
+
+bool AssetReloader::stageNewTextures(WatchedModel& model, Result& result) {
+	bool queued = std::any_of(m_stagedTextures.begin(), m_stagedTextures.end(),
+		[&model](const StagedTextures& staged) { return staged.result.path == model.path; });
+	std::vector<StagedTexture> textures;
+	// The streamer builds the mip chains of its textures in system memory, so it creates them here.
+	if (canStage() && model.streamer == nullptr) {
+		for (auto& [path, image] : result.model->images) {
+			if (model.textures.find(path) == model.textures.end()) {
+				auto ticket = m_uploader->uploadTexture(std::make_shared<const StbImage>(std::move(image)));
+				textures.push_back(StagedTexture{ path, ticket, 0 });
+			}
+		}
+	}
+	if (textures.empty() && !queued) {
+		return false;
+	}
+	m_stagedTextures.push_back(StagedTextures{ std::move(result), std::move(textures) });
+	return true;
+}
+
+void AssetReloader::updateNode(WatchedModel& model, Object3D& object, ImportedNode& node,
+	const std::vector<MeshSummary>& meshes, size_t& meshIndex, StagedModel& staged) {
+	// Setting the base transform counts as moving the object, so only do it if it changed.
+	if (node.baseTransform != object.getBaseTransform()) {
+		object.setBaseTransform(node.baseTransform);
+	}
+
+	auto& objectMeshes = object.getMeshes();
+	for (size_t i = 0; i < objectMeshes.size(); i++, meshIndex++) {
+		auto& mesh = objectMeshes[i];
+		auto& imported = node.meshes[i];
+		auto& summary = meshes[meshIndex];
+		if (summary.geometryHash == model.meshHashes[meshIndex]) {
+			++m_stats.meshesUnchanged;
+		}
+		else if (canStage()) {
+			auto vertexCount = static_cast<uint32_t>(imported.vertices.size());
+			auto faceCount = static_cast<uint32_t>(imported.faces.size());
+			auto vertexTicket = m_uploader->uploadBuffer(std::move(imported.vertices));
+			auto faceTicket = m_uploader->uploadBuffer(std::move(imported.faces));
+			staged.meshes.push_back(StagedMesh{ meshIndex, vertexTicket, faceTicket, vertexCount, faceCount,
+				summary.boundsCenter, summary.boundsRadius, std::move(imported.meshlets), 0, 0 });
+		}
+		else {
+			mesh.setGeometry(std::move(imported.vertices), std::move(imported.faces));
+			if (!imported.meshlets.empty()) {
+				mesh.setMeshlets(std::move(imported.meshlets));
+			}
+			++m_stats.meshesUploaded;
+		}
+		model.meshHashes[meshIndex] = summary.geometryHash;
+
+		std::vector<Texture> textures;
+		for (auto& texture : imported.textures) {
+			textures.push_back(Texture{ model.textures.at(texture.path).textureId, texture.samplerName });
+		}
+		mesh.setTextures(std::move(textures));
+		mesh.setAlphaMode(imported.alphaMode, imported.alphaCutoff);
+		mesh.setOpacity(imported.opacity);
+	}
+	for (size_t i = 0; i < node.children.size(); i++) {
+		updateNode(model, object.getChild(i), node.children[i], meshes, meshIndex, staged);
+	}
+}
+
+bool AssetReloader::applyModel(WatchedModel& model, Result& result, std::vector<Object3D>& objects) {
+	auto object = std::find_if(objects.begin(), objects.end(),
+		[&model](const Object3D& o) { return o.getName() == model.path; });
+	if (object == objects.end()) {
+		return false;
+	}
+	++m_stats.modelsReloaded;
+	auto& imported = *result.model;
+	uploadNewTextures(model, imported);
+
+	if (!sameStructure(*object, imported.root, model.importedChildren)) {
+		auto importedChildren = imported.root.children.size();
+		object->replaceContents(createImportedObject(imported, model.textures, model.streamer), model.importedChildren);
+		model.importedChildren = importedChildren;
+		model.meshHashes.clear();
+		for (auto& mesh : result.meshes) {
+			model.meshHashes.push_back(mesh.geometryHash);
+		}
+		++model.generation;
+		++m_stats.modelsRebuilt;
+		return true;
+	}
+
+	auto uploadedBefore = m_stats.meshesUploaded;
+	size_t meshIndex = 0;
+	StagedModel staged{ model.path, model.generation, {} };
+	updateNode(model, *object, imported.root, result.meshes, meshIndex, staged);
+	if (!staged.meshes.empty()) {
+		m_stagedModels.push_back(std::move(staged));
+	}
+	return m_stats.meshesUploaded != uploadedBefore;
+}
+
+uint32_t AssetReloader::applyStaged(std::vector<Object3D>& objects) {
+	if (m_stagedModels.empty() && m_stagedTextures.empty() && m_stagedImages.empty()) {
+		return 0;
+	}
+	m_uploader->poll();
+
+	// The uploader finishes jobs in order, so the first staged model that isn't ready ends the search.
+	uint32_t changedModels = 0;
+	while (!m_stagedModels.empty()) {
+		auto& staged = m_stagedModels.front();
+		bool ready = true;
+		for (auto& mesh : staged.meshes) {
+			if (mesh.vertexBuffer == 0) {
+				m_uploader->take(mesh.vertexTicket, mesh.vertexBuffer);
+			}
+			if (mesh.faceBuffer == 0) {
+				m_uploader->take(mesh.faceTicket, mesh.faceBuffer);
+			}
+			ready = ready && mesh.vertexBuffer != 0 && mesh.faceBuffer != 0;
+		}
+		if (!ready) {
+			break;
+		}
+
+		auto model = std::find_if(m_models.begin(), m_models.end(),
+			[&staged](const WatchedModel& m) { return m.path == staged.path; });
+		auto object = std::find_if(objects.begin(), objects.end(),
+			[&staged](const Object3D& o) { return o.getName() == staged.path; });
+		// A rebuild since the meshes were staged replaced the meshes they belong to.
+		if (model->generation == staged.generation && object != objects.end()) {
+			std::vector<Mesh3D*> meshes;
+			flattenMeshes(*object, model->importedChildren, meshes);
+			for (auto& mesh : staged.meshes) {
+				auto& target = *meshes[mesh.meshIndex];
+				target.copyGeometry(mesh.vertexBuffer, mesh.vertexCount, mesh.faceBuffer, mesh.faceCount,
+					mesh.boundsCenter, mesh.boundsRadius);
+				if (!mesh.meshlets.empty()) {
+					target.setMeshlets(std::move(mesh.meshlets));
+				}
+				++m_stats.meshesUploaded;
+			}
+			++changedModels;
+		}
+		// GL keeps the buffers alive until the copies queued from them are done.
+		for (auto& mesh : staged.meshes) {
+			glDeleteBuffers(1, &mesh.vertexBuffer);
+			glDeleteBuffers(1, &mesh.faceBuffer);
+		}
+		m_stagedModels.pop_front();
+	}
+
+	while (!m_stagedTextures.empty()) {
+		auto& staged = m_stagedTextures.front();
+		bool ready = true;
+		for (auto& texture : staged.textures) {
+			if (texture.textureId == 0) {
+				m_uploader->take(texture.ticket, texture.textureId);
+			}
+			ready = ready && texture.textureId != 0;
+		}
+		if (!ready) {
+			break;
+		}
+
+		auto model = std::find_if(m_models.begin(), m_models.end(),
+			[&staged](const WatchedModel& m) { return m.path == staged.result.path; });
+		for (auto& texture : staged.textures) {
+			// An earlier reload waiting in the queue may have created the same image's texture.
+			if (!model->textures.insert(std::make_pair(texture.path, Texture{ texture.textureId, "" })).second) {
+				glDeleteTextures(1, &texture.textureId);
+			}
+		}
+		if (applyModel(*model, staged.result, objects)) {
+			++changedModels;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			watchModelFiles(*model);
+		}
+		m_stagedTextures.pop_front();
+	}
+
+	while (!m_stagedImages.empty()) {
+		auto& staged = m_stagedImages.front();
+		uint32_t pixelBuffer;
+		if (!m_uploader->take(staged.ticket, pixelBuffer)) {
+			break;
+		}
+		for (auto& model : m_models) {
+			auto texture = model.textures.find(staged.path);
+			if (texture == model.textures.end()
+				|| (model.streamer != nullptr && model.streamer->levels(texture->second.textureId) != nullptr)) {
+				continue;
+			}
+			Texture::reloadImage(texture->second.textureId, staged.width, staged.height, pixelBuffer);
+			++m_stats.texturesReloaded;
+		}
+		glDeleteBuffers(1, &pixelBuffer);
+		m_stagedImages.pop_front();
+	}
+	return changedModels;
+}
+
+uint32_t AssetReloader::applyPending(std::vector<Object3D>& objects) {
+	std::deque<Result> results;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		results.swap(m_results);
+	}
+	if (results.empty() && m_stagedModels.empty() && m_stagedTextures.empty() && m_stagedImages.empty()) {
+		return 0;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	// Uploads staged by earlier calls go first, so that they never overwrite newer ones.
+	uint32_t changedModels = applyStaged(objects);
+	for (auto& result : results) {
+		if (result.kind == JobKind::Image) {
+			applyImage(result.path, std::move(result.image));
+			continue;
+		}
+		auto model = std::find_if(m_models.begin(), m_models.end(),
+			[&result](const WatchedModel& m) { return m.path == result.path; });
+		if (stageNewTextures(*model, result)) {
+			continue;
+		}
+		if (applyModel(*model, result, objects)) {
+			++changedModels;
+		}
+		// The new import may use images the old one didn't.
+		std::lock_guard<std::mutex> lock(m_mutex);
+		watchModelFiles(*model);
+	}
+	m_stats.lastApplyMilliseconds = static_cast<float>(
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	return changedModels;
+}
+
+void AssetReloader::watchLoaded(const Object3D& object, bool flipTextureCoords, TextureStreamer* streamer,
+	ImportProfile profile, const std::unordered_map<uint32_t, std::string>& texturePaths) {
+	std::unordered_map<std::string, Texture> textures;
+	collectTextures(object, texturePaths, textures);
+	// No import hashes to zero, so every mesh counts as changed on the first reload.
+	std::vector<uint64_t> meshHashes(countMeshes(object), 0);
+	m_models.push_back(WatchedModel{ object.getName(), flipTextureCoords, profile, streamer, std::move(textures),
+		object.numberOfChildren(), std::move(meshHashes), 0 });
+	std::lock_guard<std::mutex> lock(m_mutex);
+	watchModelFiles(m_models.back());
+}
+
+std::unordered_map<uint32_t, std::string> AssetReloader::texturePaths() const {
+	std::unordered_map<uint32_t, std::string> paths;
+	for (auto& model : m_models) {
+		for (auto& [path, texture] : model.textures) {
+			paths[texture.textureId] = path;
+		}
+	}
+	return paths;
+}
+
+AssetReloadStats AssetReloader::stats() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto stats = m_stats;
+	stats.watchedModels = static_cast<uint32_t>(m_models.size());
+	stats.watchedFiles = static_cast<uint32_t>(m_files.size());
+	stats.stagedUploads = static_cast<uint32_t>(m_stagedImages.size());
+	for (auto& staged : m_stagedTextures) {
+		stats.stagedUploads += static_cast<uint32_t>(staged.textures.size());
+	}
+	for (auto& staged : m_stagedModels) {
+		stats.stagedUploads += static_cast<uint32_t>(staged.meshes.size());
+	}
+	return stats;
+}
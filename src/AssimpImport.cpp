@@ -1,43 +1,219 @@
 #include "AssimpImport.h"
+#include "TextureStreamer.h"
+#include "VertexWeld.h"
 #include <iostream>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <assimp/GltfMaterial.h>
+#include <assimp/DefaultLogger.hpp>
+#include <assimp/LogStream.hpp>
+#include <chrono>
+#include <mutex>
 #include <filesystem>
 #include <unordered_map>
+#include <unordered_set>
 
 const size_t FLOATS_PER_VERTEX = 3;
 const size_t VERTICES_PER_FACE = 3;
+// Tolerances of the welding that follows balanced and max imports: positions relative to the size
+// of the mesh, normals and texture coordinates absolute.
+const float WELD_POSITION_TOLERANCE = 1e-5f;
+const float WELD_NORMAL_TOLERANCE = 1e-3f;
+const float WELD_TEXCOORD_TOLERANCE = 1e-5f;
 
-std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName, const std::filesystem::path& modelPath,
-	std::unordered_map<std::string, Texture>& loadedTextures) {
-	std::vector<Texture> textures;
+namespace {
+	typedef std::chrono::steady_clock Clock;
+
+	double millisecondsSince(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	/**
+	 * @brief Remembers the last step that logged its beginning during a timed import.
+	 */
+	class StepLog {
+	private:
+		std::string m_step;
+
+	public:
+		void write(const char* message) {
+			// Messages look like "Debug, T0: JoinVerticesProcess begin\n".
+			std::string text(message);
+			while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) {
+				text.pop_back();
+			}
+			const std::string suffix = " begin";
+			if (text.size() <= suffix.size() || text.compare(text.size() - suffix.size(), suffix.size(), suffix) != 0) {
+				return;
+			}
+			text.erase(text.size() - suffix.size());
+			auto nameStart = text.find_last_of(" :");
+			m_step = nameStart == std::string::npos ? text : text.substr(nameStart + 1);
+		}
+
+		std::string takeStep() {
+			return std::move(m_step);
+		}
+	};
+
+	// Serializes timed imports, which change Assimp's global logger.
+	std::mutex timingMutex;
+	// The logger that a ThreadStepLogs was attached to, guarded by timingMutex.
+	Assimp::Logger* stepLogger = nullptr;
+	// The log of the timed import running on this thread, if any.
+	thread_local StepLog* threadStepLog = nullptr;
+
+	/**
+	 * @brief Passes each message to the StepLog of the thread that logged it. It stays attached to
+	 * the global logger once attached, since changing the logger's streams would race with imports
+	 * logging on other threads. Those imports' messages are dropped here.
+	 */
+	class ThreadStepLogs : public Assimp::LogStream {
+	public:
+		void write(const char* message) override {
+			if (threadStepLog != nullptr) {
+				threadStepLog->write(message);
+			}
+		}
+	};
+
+	/**
+	 * @brief Splits the post-processing into steps at the boundaries Assimp reports before each
+	 * step of its pipeline, naming each by the step that logged its beginning within it. Steps that
+	 * don't apply to the import neither log nor take time, and are left out.
+	 */
+	class StepProgress : public Assimp::ProgressHandler {
+	private:
+		StepLog& m_log;
+		ImportTiming& m_timing;
+		Clock::time_point m_start;
+		Clock::time_point m_stepStart;
+		bool m_postProcessing;
+
+	public:
+		StepProgress(StepLog& log, ImportTiming& timing)
+			: m_log(log), m_timing(timing), m_start(Clock::now()), m_stepStart(m_start), m_postProcessing(false) {
+		}
+
+		bool Update(float percentage) override {
+			return true;
+		}
+
+		void UpdatePostProcess(int currentStep, int numberOfSteps) override {
+			auto now = Clock::now();
+			if (!m_postProcessing) {
+				m_postProcessing = true;
+				m_timing.readMilliseconds = std::chrono::duration<double, std::milli>(now - m_start).count();
+				m_log.takeStep();
+			}
+			else {
+				finishStep(now);
+			}
+			m_stepStart = now;
+		}
+
+		void finishStep(Clock::time_point now) {
+			auto step = m_log.takeStep();
+			if (!step.empty()) {
+				m_timing.steps.push_back(ImportStepTime{ step,
+					std::chrono::duration<double, std::milli>(now - m_stepStart).count() });
+			}
+			m_stepStart = now;
+		}
+	};
+}
+
+const char* importProfileName(ImportProfile profile) {
+	switch (profile) {
+	case ImportProfile::Fast:
+		return "fast";
+	case ImportProfile::Balanced:
+		return "balanced";
+	default:
+		return "max";
+	}
+}
+
+bool parseImportProfile(const std::string& name, ImportProfile& profile) {
+	for (auto candidate : { ImportProfile::Fast, ImportProfile::Balanced, ImportProfile::Max }) {
+		if (name == importProfileName(candidate)) {
+			profile = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+unsigned int importProfileFlags(ImportProfile profile) {
+	// Vertex3D has no tangents, so no profile but the preset computes them.
+	const unsigned int fast = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_SortByPType;
+	switch (profile) {
+	case ImportProfile::Fast:
+		return fast;
+	case ImportProfile::Balanced:
+		return fast | aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality
+			| aiProcess_RemoveRedundantMaterials | aiProcess_FindDegenerates | aiProcess_FindInvalidData
+			| aiProcess_GenUVCoords;
+	default:
+		return aiProcessPreset_TargetRealtime_MaxQuality;
+	}
+}
+
+std::vector<ImportedTexture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName,
+	const std::filesystem::path& modelPath, std::unordered_map<std::string, StbImage>& images,
+	const std::unordered_set<std::string>& skipImages) {
+	std::vector<ImportedTexture> textures;
 	for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
 	{
 		aiString name;
 		mat->GetTexture(type, i, &name);
 		std::filesystem::path texPath = modelPath.parent_path() / name.C_Str();
-		std::cout << "assinmpimport loading " << texPath << std::endl;
+		textures.push_back(ImportedTexture{ texPath.string(), typeName });
 
-		auto existing = loadedTextures.find(texPath.string());
-		if (existing != loadedTextures.end()) {
-			textures.push_back(existing->second);
-		}
-		else {
+		if (images.find(texPath.string()) == images.end() && skipImages.count(texPath.string()) == 0) {
+			std::cout << "assinmpimport loading " << texPath << std::endl;
 			StbImage image;
 			image.loadFromFile(texPath.string());
-			Texture tex = Texture::loadImage(image, typeName);
-			textures.push_back(tex);
-			loadedTextures.insert(std::make_pair(texPath.string(), tex));
+			images.insert(std::make_pair(texPath.string(), std::move(image)));
 		}
 	}
 	return textures;
 }
 
-Mesh3D fromAssimpMesh(const aiMesh* mesh, const aiScene* scene, const std::filesystem::path& modelPath,
-	std::unordered_map<std::string, Texture>& loadedTextures) {
-	std::vector<Vertex3D> vertices;
+/**
+ * @brief Welds a mesh's duplicate vertices: exactly equal ones after a fast import, which doesn't
+ * join them, or ones within the weld tolerances after the others, which already joined the exact
+ * duplicates.
+ */
+void weldImportedVertices(const aiMesh* mesh, const std::filesystem::path& modelPath, std::vector<Vertex3D>& vertices,
+	std::vector<uint32_t>& faces, ImportProfile profile, ImportTiming* timing) {
+	auto start = Clock::now();
+	WeldTolerance tolerance;
+	if (profile != ImportProfile::Fast) {
+		glm::vec3 center;
+		float radius;
+		Mesh3D::computeBounds(vertices, center, radius);
+		tolerance.position = 2 * radius * WELD_POSITION_TOLERANCE;
+		tolerance.normal = WELD_NORMAL_TOLERANCE;
+		tolerance.texCoord = WELD_TEXCOORD_TOLERANCE;
+	}
+	auto before = weldVertices(vertices, faces, tolerance);
+	if (timing != nullptr) {
+		timing->weldMilliseconds += millisecondsSince(start);
+		timing->verticesBeforeWeld += before;
+		timing->verticesAfterWeld += vertices.size();
+	}
+	else {
+		std::cout << "Welded " << modelPath.string() << " mesh \"" << mesh->mName.C_Str() << "\": " << before
+			<< " -> " << vertices.size() << " vertices" << std::endl;
+	}
+}
 
+ImportedMesh fromAssimpMesh(const aiMesh* mesh, const aiScene* scene, const std::filesystem::path& modelPath,
+	std::unordered_map<std::string, StbImage>& images, const std::unordered_set<std::string>& skipImages,
+	ImportProfile profile, ImportTiming* timing) {
+	std::vector<Vertex3D> vertices;
 	// TODO: fill in this vertices list, by iterating over each element of 
 	// the mVertices field of the aiMesh pointer. Each element of mVertices
 	// has x, y, and z values that you can use to construct a Vertex3D object.
@@ -69,83 +245,184 @@ Mesh3D fromAssimpMesh(const aiMesh* mesh, const aiScene* scene, const std::files
 		faces.push_back(meshFace.mIndices[2]);
 
 	}
+	weldImportedVertices(mesh, modelPath, vertices, faces, profile, timing);
 
 	// Load any base textures, specular maps, and normal maps associated with the mesh.
-	std::vector<Texture> textures = {};
+	std::vector<ImportedTexture> textures = {};
+	AlphaMode alphaMode = AlphaMode::Opaque;
+	float alphaCutoff = 0.5f;
+	float opacity = 1.0f;
 	if (mesh->mMaterialIndex >= 0)
 	{
 		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-		std::vector<Texture> diffuseMaps = loadMaterialTextures(material,
-			aiTextureType_DIFFUSE, "baseTexture", modelPath, loadedTextures);
+		auto diffuseMaps = loadMaterialTextures(material,
+			aiTextureType_DIFFUSE, "baseTexture", modelPath, images, skipImages);
 		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-		std::vector<Texture> specularMaps = loadMaterialTextures(material,
-			aiTextureType_SPECULAR, "specMap", modelPath, loadedTextures);
+		auto specularMaps = loadMaterialTextures(material,
+			aiTextureType_SPECULAR, "specMap", modelPath, images, skipImages);
 		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-		std::vector<Texture> normalMaps = loadMaterialTextures(material,
-			aiTextureType_HEIGHT, "normalMap", modelPath, loadedTextures);
+		auto normalMaps = loadMaterialTextures(material,
+			aiTextureType_HEIGHT, "normalMap", modelPath, images, skipImages);
 		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
 		normalMaps = loadMaterialTextures(material,
-			aiTextureType_NORMALS, "normalMap", modelPath, loadedTextures);
+			aiTextureType_NORMALS, "normalMap", modelPath, images, skipImages);
 		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+		// glTF materials declare how their alpha is used, and may scale the base texture's alpha.
+		aiString gltfAlphaMode;
+		if (material->Get(AI_MATKEY_GLTF_ALPHAMODE, gltfAlphaMode) == aiReturn_SUCCESS) {
+			std::string mode = gltfAlphaMode.C_Str();
+			if (mode == "MASK") {
+				alphaMode = AlphaMode::Mask;
+				material->Get(AI_MATKEY_GLTF_ALPHACUTOFF, alphaCutoff);
+			}
+			else if (mode == "BLEND") {
+				alphaMode = AlphaMode::Blend;
+			}
+		}
+		aiColor4D baseColor;
+		if (material->Get(AI_MATKEY_BASE_COLOR, baseColor) == aiReturn_SUCCESS) {
+			opacity = baseColor.a;
+		}
 	}
 
-	return Mesh3D(std::move(vertices), std::move(faces), std::move(textures));
-}
+	// Split large meshes into meshlets, so they can be culled piece by piece. Meshes that fit in a
+	// single meshlet gain nothing from it.
+	std::vector<Meshlet> meshlets;
+	if (faces.size() / VERTICES_PER_FACE > MAX_MESHLET_TRIANGLES) {
+		meshlets = buildMeshlets(vertices, faces);
+	}
 
+	return ImportedMesh{ std::move(vertices), std::move(faces), std::move(meshlets), std::move(textures),
+		alphaMode, alphaCutoff, opacity };
+}
 
+ImportedNode importAssimpNode(aiNode* node, const aiScene* scene, const std::filesystem::path& modelPath,
+	std::unordered_map<std::string, StbImage>& images, const std::unordered_set<std::string>& skipImages,
+	ImportProfile profile, ImportTiming* timing) {
+	ImportedNode imported;
+	// Load the aiNode's meshes.
+	for (auto i = 0; i < node->mNumMeshes; i++) {
+		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+		imported.meshes.push_back(fromAssimpMesh(mesh, scene, modelPath, images, skipImages, profile, timing));
+	}
+	for (auto i = 0; i < 4; i++) {
+		for (auto j = 0; j < 4; j++) {
+			imported.baseTransform[i][j] = node->mTransformation[j][i];
+		}
+	}
+	for (auto i = 0; i < node->mNumChildren; i++) {
+		imported.children.push_back(importAssimpNode(node->mChildren[i], scene, modelPath, images, skipImages, profile,
+			timing));
+	}
+	return imported;
+}
 
-Object3D assimpLoad(const std::string& path, bool flipTextureCoords) {
+ImportedModel assimpImport(const std::string& path, bool flipTextureCoords,
+	const std::unordered_set<std::string>& skipImages, ImportProfile profile, ImportTiming* timing) {
+	auto start = Clock::now();
+	// Every call has its own importer, so imports may run on several threads at once.
 	Assimp::Importer importer;
 
-	auto options = aiProcessPreset_TargetRealtime_MaxQuality;
+	auto options = importProfileFlags(profile);
 	if (flipTextureCoords) {
 		options |= aiProcess_FlipUVs;
 	}
-	const aiScene* scene = importer.ReadFile(path, options);
+
+	const aiScene* scene;
+	if (timing != nullptr) {
+		std::lock_guard<std::mutex> lock(timingMutex);
+		*timing = ImportTiming();
+		// Steps log their beginning at debugging severity, which is raised only while this import
+		// runs: formatting debug messages slows every import down. The logger is never destroyed,
+		// since untimed imports on other threads may be using it.
+		if (Assimp::DefaultLogger::isNullLogger()) {
+			Assimp::DefaultLogger::create(nullptr, Assimp::Logger::NORMAL, 0);
+		}
+		auto logger = Assimp::DefaultLogger::get();
+		if (logger != stepLogger) {
+			// The logger owns and deletes its streams.
+			logger->attachStream(new ThreadStepLogs(), Assimp::Logger::Debugging);
+			stepLogger = logger;
+		}
+		auto severity = logger->getLogSeverity();
+		if (severity == Assimp::Logger::NORMAL) {
+			logger->setLogSeverity(Assimp::Logger::DEBUGGING);
+		}
+		StepLog log;
+		threadStepLog = &log;
+		// The importer owns and deletes its progress handler.
+		auto progress = new StepProgress(log, *timing);
+		importer.SetProgressHandler(progress);
+		scene = importer.ReadFile(path, options);
+		progress->finishStep(Clock::now());
+		threadStepLog = nullptr;
+		logger->setLogSeverity(severity);
+		timing->postProcessMilliseconds = millisecondsSince(start) - timing->readMilliseconds;
+	}
+	else {
+		scene = importer.ReadFile(path, options);
+	}
 
 	// If the import failed, report it
 	if (nullptr == scene) {
 		auto* error = importer.GetErrorString();
 		std::cerr << "Error loading assimp file: " + std::string(error) << std::endl;
 		throw std::runtime_error("Error loading assimp file: " + std::string(error));
-
 	}
-	else {
 
+	auto convertStart = Clock::now();
+	ImportedModel model;
+	model.root = importAssimpNode(scene->mRootNode, scene, std::filesystem::path(path), model.images, skipImages,
+		profile, timing);
+	if (timing != nullptr) {
+		timing->convertMilliseconds = millisecondsSince(convertStart);
+		timing->totalMilliseconds = millisecondsSince(start);
 	}
-	std::vector<Mesh3D> meshes;
-	std::unordered_map<std::string, Texture> loadedTextures;
-	auto ret = processAssimpNode(scene->mRootNode, scene, std::filesystem::path(path), loadedTextures);
-	return ret;
+	return model;
 }
 
-Object3D processAssimpNode(aiNode* node, const aiScene* scene,
-	const std::filesystem::path& modelPath,
-	std::unordered_map<std::string, Texture>& loadedTextures) {
-
-	// Load the aiNode's meshes.
-	std::vector<Mesh3D> meshes;
-	for (auto i = 0; i < node->mNumMeshes; i++) {
-		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes.emplace_back(fromAssimpMesh(mesh, scene, modelPath, loadedTextures));
+Mesh3D createImportedMesh(ImportedMesh& mesh, const std::unordered_map<std::string, Texture>& loadedTextures) {
+	std::vector<Texture> textures;
+	for (auto& texture : mesh.textures) {
+		auto loaded = loadedTextures.at(texture.path);
+		textures.push_back(Texture{ loaded.textureId, texture.samplerName });
+	}
+	Mesh3D result(std::move(mesh.vertices), std::move(mesh.faces), std::move(textures));
+	result.setAlphaMode(mesh.alphaMode, mesh.alphaCutoff);
+	result.setOpacity(mesh.opacity);
+	if (!mesh.meshlets.empty()) {
+		result.setMeshlets(std::move(mesh.meshlets));
 	}
+	return result;
+}
 
-	std::vector<Texture> textures;
-	for (auto& p : loadedTextures) {
-		textures.push_back(p.second);
+Object3D createImportedNode(ImportedNode& node, const std::unordered_map<std::string, Texture>& loadedTextures) {
+	std::vector<Mesh3D> meshes;
+	for (auto& mesh : node.meshes) {
+		meshes.push_back(createImportedMesh(mesh, loadedTextures));
 	}
-	glm::mat4 baseTransform;
-	for (auto i = 0; i < 4; i++) {
-		for (auto j = 0; j < 4; j++) {
-			baseTransform[i][j] = node->mTransformation[j][i];
-		}
+	auto parent = Object3D(std::move(meshes), node.baseTransform);
+	for (auto& child : node.children) {
+		parent.addChild(createImportedNode(child, loadedTextures));
 	}
-	auto parent = Object3D(std::move(meshes), baseTransform);
+	return parent;
+}
 
-	for (auto i = 0; i < node->mNumChildren; i++) {
-		Object3D child = processAssimpNode(node->mChildren[i], scene, modelPath, loadedTextures);
-		parent.addChild(std::move(child));
+Object3D createImportedObject(ImportedModel& model, std::unordered_map<std::string, Texture>& loadedTextures,
+	TextureStreamer* streamer) {
+	for (auto& [path, image] : model.images) {
+		if (loadedTextures.find(path) == loadedTextures.end()) {
+			// The sampler name is chosen per mesh by createImportedMesh.
+			Texture texture = streamer != nullptr ? streamer->load(image, "") : Texture::loadImage(image, "");
+			loadedTextures.insert(std::make_pair(path, texture));
+		}
 	}
+	return createImportedNode(model.root, loadedTextures);
+}
 
-	return parent;
+Object3D assimpLoad(const std::string& path, bool flipTextureCoords, TextureStreamer* streamer,
+	std::unordered_map<std::string, Texture>* loadedTextures, ImportProfile profile) {
+	auto model = assimpImport(path, flipTextureCoords, {}, profile);
+	std::unordered_map<std::string, Texture> textures;
+	return createImportedObject(model, loadedTextures != nullptr ? *loadedTextures : textures, streamer);
 }
@@ -0,0 +1,71 @@
+#include "AudioBenchmark.h"
+#include "AudioMixer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace {
+	/**
+	 * @brief Mixes a few seconds of audio and prints the time spent per block.
+	 */
+	void measure(const std::string& label, const std::string& path, uint32_t voiceCount, AudioLoadMode loadMode,
+		uint32_t maxVoices) {
+		AudioMixer mixer;
+		mixer.setMaxVoices(maxVoices);
+		mixer.setListener(glm::vec3(0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+
+		// Spread the voices on a spiral around the listener, so they have a range of loudness.
+		AudioSourceSettings settings;
+		settings.loadMode = loadMode;
+		for (uint32_t i = 0; i < voiceCount; i++) {
+			auto source = mixer.addSource(path, settings);
+			float angle = i * 2.4f;
+			float distance = 2.0f + 30.0f * i / voiceCount;
+			mixer.setSourcePosition(source, glm::vec3(std::cos(angle), 0, std::sin(angle)) * distance);
+		}
+
+		const uint32_t BLOCKS = 400;
+		std::vector<float> block(MIXER_BLOCK_FRAMES * MIXER_CHANNELS);
+		std::chrono::duration<double, std::micro> decodeTime(0), mixTime(0);
+		uint64_t mixedVoices = 0;
+		for (uint32_t i = 0; i < BLOCKS; i++) {
+			auto start = std::chrono::steady_clock::now();
+			mixer.decodeAvailable();
+			auto decoded = std::chrono::steady_clock::now();
+			mixer.mix(block.data(), MIXER_BLOCK_FRAMES);
+			auto end = std::chrono::steady_clock::now();
+			// The first blocks fill every ring buffer at once; leave them out.
+			if (i >= 4) {
+				decodeTime += decoded - start;
+				mixTime += end - decoded;
+				mixedVoices += mixer.audibleVoices();
+			}
+		}
+
+		uint32_t measured = BLOCKS - 4;
+		double blockMicroseconds = 1.0e6 * MIXER_BLOCK_FRAMES / MIXER_SAMPLE_RATE;
+		double mixPerBlock = mixTime.count() / measured;
+		double decodePerBlock = decodeTime.count() / measured;
+		double averageMixed = static_cast<double>(mixedVoices) / measured;
+		AudioMixerStats stats = mixer.stats();
+		size_t totalBytes = stats.streamingBytes + stats.clipBytes;
+
+		std::cout << std::fixed << std::setprecision(2) << label << ": "
+			<< averageMixed << " of " << stats.voices << " voices mixed, "
+			<< mixPerBlock << " us mix + " << decodePerBlock << " us decode per block ("
+			<< 100.0 * (mixPerBlock + decodePerBlock) / blockMicroseconds << "% of real time), "
+			<< (averageMixed > 0 ? mixPerBlock / averageMixed : 0) << " us per mixed voice, "
+			<< totalBytes / 1024 << " KiB (" << stats.streamingBytes / 1024 << " KiB streaming, "
+			<< stats.clipBytes / 1024 << " KiB in " << stats.clips << " shared clips), "
+			<< totalBytes / std::max<uint32_t>(stats.voices, 1) / 1024 << " KiB per voice" << std::endl;
+	}
+}
+
+void runAudioBenchmark(const std::string& path, uint32_t voiceCount) {
+	measure("preloaded", path, voiceCount, AudioLoadMode::Preload, voiceCount);
+	measure("streamed", path, voiceCount, AudioLoadMode::Stream, voiceCount);
+	measure("preloaded, 16 voice limit", path, voiceCount, AudioLoadMode::Preload, 16);
+}
@@ -0,0 +1,532 @@
+#include "AudioMixer.h"
+#include "AudioRingBuffer.h"
+#include "SoundDecoder.h"
+#include <SFML/Audio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ARCADE_AUDIO_SSE2 1
+#endif
+
+namespace {
+	// Each streaming voice buffers this many output frames, about 0.19 seconds.
+	const size_t RING_FRAMES = 8192;
+	// Sources quieter than this (-60 dB) are culled.
+	const float AUDIBLE_GAIN = 0.001f;
+	const uint32_t DEFAULT_MAX_VOICES = 32;
+}
+
+/**
+ * @brief A playing source, with state owned by the decoding thread, the mixing thread, and
+ * shared parameters guarded by the mixer's mutex.
+ */
+struct Voice {
+	// Preloaded voices play a clip shared through the sound bank; streaming voices own a decoder
+	// (used by the decoding thread) and a ring buffer.
+	std::shared_ptr<const SoundClip> clip;
+	std::unique_ptr<SoundDecoder> decoder;
+	std::unique_ptr<AudioRingBuffer> ring;
+	// Spatial voices are mixed as mono and panned; others keep (or are upmixed to) stereo.
+	uint32_t channels;
+	bool loop;
+	uint64_t lengthFrames;
+
+	// Parameters set by the main thread, guarded by AudioMixer::m_mutex.
+	AudioSourceSettings settings;
+	glm::vec3 position;
+
+	// Mixing thread state: a copy of the parameters for the current block, the gains applied at
+	// the end of the previous block, and the gains wanted at the end of this one.
+	AudioSourceSettings mixSettings;
+	glm::vec3 mixPosition;
+	float gainLeft;
+	float gainRight;
+	float targetLeft;
+	float targetRight;
+
+	// Set by the mixer when the voice is culled or comes back; read by the decoder.
+	std::atomic<bool> audible;
+	// Set by the mixer when the ring buffer's contents are stale. Until the decoder has emptied the
+	// ring and seeked, and cleared the flag again, the mixer doesn't read from the ring.
+	std::atomic<bool> resync;
+	std::atomic<bool> finished;
+	// Set by the main thread; handled by the mixer.
+	std::atomic<bool> restart;
+	// Output frames played since the voice started, including while culled. For preloaded voices
+	// this is also the playback position.
+	std::atomic<uint64_t> framesPlayed;
+
+	Voice()
+		: channels(1), loop(true), lengthFrames(0), position(0), mixPosition(0), gainLeft(0), gainRight(0),
+		targetLeft(0), targetRight(0), audible(true), resync(false), finished(false), restart(false),
+		framesPlayed(0) {
+	}
+
+	bool isStreaming() const { return decoder != nullptr; }
+
+	/**
+	 * @brief True once the voice has played to its end and has nothing left to mix.
+	 */
+	bool isDone() const {
+		return finished && (!isStreaming() || (!resync && ring->available() == 0));
+	}
+};
+
+/**
+ * @brief Pulls blocks from an AudioMixer for the default audio device.
+ */
+class MixerStream : public sf::SoundStream {
+private:
+	AudioMixer& m_mixer;
+	std::vector<float> m_mix;
+	std::vector<int16_t> m_samples;
+
+protected:
+	bool onGetData(Chunk& data) override {
+		m_mixer.mix(m_mix.data(), MIXER_BLOCK_FRAMES);
+		convertToInt16(m_mix.data(), m_samples.data(), m_samples.size());
+		data.samples = m_samples.data();
+		data.sampleCount = m_samples.size();
+		return true;
+	}
+
+	void onSeek(sf::Time timeOffset) override {
+	}
+
+public:
+	MixerStream(AudioMixer& mixer)
+		: m_mixer(mixer), m_mix(MIXER_BLOCK_FRAMES * MIXER_CHANNELS), m_samples(MIXER_BLOCK_FRAMES * MIXER_CHANNELS) {
+		initialize(MIXER_CHANNELS, MIXER_SAMPLE_RATE);
+	}
+
+	~MixerStream() {
+		// SoundStream requires derived classes to stop the stream before they are destroyed.
+		stop();
+	}
+};
+
+namespace {
+	/**
+	 * @brief Decodes one chunk of a streaming voice into its ring buffer. Returns false if the ring
+	 * buffer is too full or the file has ended.
+	 */
+	bool decodeChunk(Voice& voice) {
+		if (voice.ring->space() < voice.decoder->maxChunkFrames() * voice.channels) {
+			return false;
+		}
+		const float* samples;
+		size_t frames = voice.decoder->decode(samples);
+		if (frames == 0) {
+			if (voice.loop) {
+				voice.decoder->rewind();
+				return true;
+			}
+			voice.finished = true;
+			return false;
+		}
+		voice.ring->write(samples, frames * voice.channels);
+		return true;
+	}
+
+	/**
+	 * @brief Moves a streaming voice's decoder to match how far the voice has played, after it was
+	 * culled or restarted.
+	 */
+	void resyncVoice(Voice& voice) {
+		uint64_t frame = voice.framesPlayed.load();
+		if (frame >= voice.lengthFrames) {
+			if (!voice.loop) {
+				voice.finished = true;
+				return;
+			}
+			frame %= voice.lengthFrames;
+		}
+		voice.decoder->seek(frame);
+	}
+
+	/**
+	 * @brief Distance attenuation and equal-power panning of a voice for the given listener.
+	 */
+	void computeGains(const Voice& voice, const glm::vec3& listenerPosition,
+		const glm::vec3& listenerRight, float& left, float& right) {
+		const AudioSourceSettings& settings = voice.mixSettings;
+		if (!settings.spatial) {
+			left = right = settings.volume;
+			return;
+		}
+
+		glm::vec3 toSource = voice.mixPosition - listenerPosition;
+		float distance = glm::length(toSource);
+		if (distance > settings.maxDistance) {
+			left = right = 0;
+			return;
+		}
+		float clamped = std::max(distance, settings.referenceDistance);
+		float attenuation = settings.referenceDistance
+			/ (settings.referenceDistance + settings.rolloff * (clamped - settings.referenceDistance));
+
+		// -1 is hard left, 1 hard right; a source at the listener's position is centered.
+		float pan = distance > 1e-4f ? glm::dot(toSource / distance, listenerRight) : 0.0f;
+		float angle = (pan + 1) * glm::pi<float>() / 4;
+		left = settings.volume * attenuation * std::cos(angle);
+		right = settings.volume * attenuation * std::sin(angle);
+	}
+
+	float loudness(const Voice& voice) {
+		return std::max(voice.targetLeft, voice.targetRight);
+	}
+
+	void mixStereo(float* out, const float* samples, uint32_t frames, float gainStart, float gainEnd) {
+		uint32_t count = frames * 2;
+		float gainStep = frames > 0 ? (gainEnd - gainStart) / frames : 0;
+		for (uint32_t i = 0; i < count; i++) {
+			out[i] += samples[i] * (gainStart + gainStep * (i / 2));
+		}
+	}
+
+	/**
+	 * @brief Mixes frames [first, first + count) of a block of the given length, with the voice's
+	 * gains ramped across the whole block.
+	 */
+	void mixSegment(float* out, const float* samples, uint32_t first, uint32_t count, uint32_t blockFrames,
+		const Voice& voice) {
+		float t0 = static_cast<float>(first) / blockFrames;
+		float t1 = static_cast<float>(first + count) / blockFrames;
+		float left0 = voice.gainLeft + (voice.targetLeft - voice.gainLeft) * t0;
+		float left1 = voice.gainLeft + (voice.targetLeft - voice.gainLeft) * t1;
+		if (voice.channels == 1) {
+			float right0 = voice.gainRight + (voice.targetRight - voice.gainRight) * t0;
+			float right1 = voice.gainRight + (voice.targetRight - voice.gainRight) * t1;
+			mixMonoToStereo(out + first * 2, samples, count, left0, right0, left1, right1);
+		}
+		else {
+			mixStereo(out + first * 2, samples, count, left0, left1);
+		}
+	}
+}
+
+void mixMonoToStereo(float* out, const float* samples, uint32_t frames,
+	float leftStart, float rightStart, float leftEnd, float rightEnd) {
+	if (frames == 0) {
+		return;
+	}
+	float leftStep = (leftEnd - leftStart) / frames;
+	float rightStep = (rightEnd - rightStart) / frames;
+	uint32_t i = 0;
+#ifdef ARCADE_AUDIO_SSE2
+	// Four frames per iteration: duplicate each mono sample into a (left, right) pair and
+	// multiply by the gains of two frames at a time.
+	__m128 gains = _mm_setr_ps(leftStart, rightStart, leftStart + leftStep, rightStart + rightStep);
+	__m128 gainStep = _mm_setr_ps(2 * leftStep, 2 * rightStep, 2 * leftStep, 2 * rightStep);
+	for (; i + 4 <= frames; i += 4) {
+		__m128 s = _mm_loadu_ps(samples + i);
+		__m128 low = _mm_unpacklo_ps(s, s);
+		__m128 high = _mm_unpackhi_ps(s, s);
+		__m128 out0 = _mm_loadu_ps(out + i * 2);
+		__m128 out1 = _mm_loadu_ps(out + i * 2 + 4);
+		out0 = _mm_add_ps(out0, _mm_mul_ps(low, gains));
+		gains = _mm_add_ps(gains, gainStep);
+		out1 = _mm_add_ps(out1, _mm_mul_ps(high, gains));
+		gains = _mm_add_ps(gains, gainStep);
+		_mm_storeu_ps(out + i * 2, out0);
+		_mm_storeu_ps(out + i * 2 + 4, out1);
+	}
+#endif
+	for (; i < frames; i++) {
+		out[i * 2] += samples[i] * (leftStart + leftStep * i);
+		out[i * 2 + 1] += samples[i] * (rightStart + rightStep * i);
+	}
+}
+
+void convertToInt16(const float* samples, int16_t* out, size_t count) {
+	size_t i = 0;
+#ifdef ARCADE_AUDIO_SSE2
+	// Scale and round to 32-bit integers, then pack with signed saturation.
+	const __m128 scale = _mm_set1_ps(32767.0f);
+	for (; i + 8 <= count; i += 8) {
+		__m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(samples + i), scale));
+		__m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(samples + i + 4), scale));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(a, b));
+	}
+#endif
+	for (; i < count; i++) {
+		float s = std::clamp(samples[i], -1.0f, 1.0f);
+		out[i] = static_cast<int16_t>(std::lround(s * 32767.0f));
+	}
+}
+
+AudioMixer::AudioMixer()
+	: m_listenerPosition(0), m_listenerRight(1, 0, 0), m_maxVoices(DEFAULT_MAX_VOICES), m_running(false),
+	m_sourceScratch(MIXER_BLOCK_FRAMES * MIXER_CHANNELS), m_audibleVoices(0) {
+}
+
+AudioMixer::~AudioMixer() {
+	stop();
+}
+
+AudioSourceId AudioMixer::addSource(const std::string& path, const AudioSourceSettings& settings) {
+	auto voice = std::make_unique<Voice>();
+	voice->channels = settings.spatial ? 1 : 2;
+	voice->loop = settings.loop;
+	voice->settings = settings;
+	voice->mixSettings = settings;
+
+	bool stream = settings.loadMode == AudioLoadMode::Stream
+		|| (settings.loadMode == AudioLoadMode::Auto && m_soundBank.shouldStream(path));
+	if (stream) {
+		voice->decoder = std::make_unique<SoundDecoder>(path, voice->channels);
+		voice->ring = std::make_unique<AudioRingBuffer>(RING_FRAMES * voice->channels);
+		voice->lengthFrames = voice->decoder->lengthFrames();
+	}
+	else {
+		voice->clip = m_soundBank.load(path, voice->channels);
+		voice->lengthFrames = voice->clip->frames;
+	}
+	// An empty sound would loop without ever playing a frame.
+	if (voice->lengthFrames == 0) {
+		throw std::runtime_error("Sound file " + path + " has no audio");
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_voices.push_back(std::move(voice));
+	return static_cast<AudioSourceId>(m_voices.size() - 1);
+}
+
+void AudioMixer::setSourcePosition(AudioSourceId source, const glm::vec3& position) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_voices[source]->position = position;
+}
+
+void AudioMixer::setSourceVolume(AudioSourceId source, float volume) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_voices[source]->settings.volume = volume;
+}
+
+void AudioMixer::restartSource(AudioSourceId source) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_voices[source]->restart = true;
+}
+
+void AudioMixer::setMaxVoices(uint32_t maxVoices) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_maxVoices = maxVoices;
+}
+
+void AudioMixer::setListener(const glm::vec3& position, const glm::vec3& front, const glm::vec3& up) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_listenerPosition = position;
+	m_listenerRight = glm::normalize(glm::cross(front, up));
+}
+
+void AudioMixer::start() {
+	if (m_running) {
+		return;
+	}
+	m_running = true;
+	m_decodeThread = std::thread(&AudioMixer::decodeLoop, this);
+	m_deviceStream = std::make_unique<MixerStream>(*this);
+	m_deviceStream->play();
+}
+
+void AudioMixer::stop() {
+	if (!m_running) {
+		return;
+	}
+	m_deviceStream.reset();
+	m_running = false;
+	m_decodeWake.notify_one();
+	m_decodeThread.join();
+}
+
+bool AudioMixer::decodeAvailable() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_decodeVoices.clear();
+		for (auto& voice : m_voices) {
+			if (voice->isStreaming()) {
+				m_decodeVoices.push_back(voice.get());
+			}
+		}
+	}
+
+	bool decoded = false;
+	for (auto* voice : m_decodeVoices) {
+		// Culled voices don't decode; they catch up with a seek when they become audible again.
+		if (!voice->audible) {
+			continue;
+		}
+		// The mixer stays off the ring while the flag is set, so it can be emptied from this side.
+		if (voice->resync) {
+			voice->ring->clear();
+			voice->finished = false;
+			resyncVoice(*voice);
+			voice->resync = false;
+		}
+		while (!voice->finished && !voice->resync && decodeChunk(*voice)) {
+			decoded = true;
+		}
+	}
+	return decoded;
+}
+
+void AudioMixer::decodeLoop() {
+	while (m_running) {
+		if (!decodeAvailable()) {
+			// Sleep until the mixer has consumed a block, or briefly if nothing happens.
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_decodeWake.wait_for(lock, std::chrono::milliseconds(10));
+		}
+	}
+}
+
+void AudioMixer::mix(float* out, uint32_t frames) {
+	std::fill(out, out + frames * MIXER_CHANNELS, 0.0f);
+	frames = std::min(frames, MIXER_BLOCK_FRAMES);
+
+	// Copy the parameters for this block, so the lock is held only briefly.
+	glm::vec3 listenerPosition, listenerRight;
+	uint32_t maxVoices;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		listenerPosition = m_listenerPosition;
+		listenerRight = m_listenerRight;
+		maxVoices = m_maxVoices;
+		m_mixVoices.clear();
+		for (auto& voice : m_voices) {
+			voice->mixSettings = voice->settings;
+			voice->mixPosition = voice->position;
+			m_mixVoices.push_back(voice.get());
+		}
+	}
+
+	// Find the audible voices, and fade out the quietest ones beyond the voice limit.
+	m_audibleScratch.clear();
+	for (auto* voice : m_mixVoices) {
+		if (voice->restart.exchange(false)) {
+			voice->framesPlayed = 0;
+			if (voice->isStreaming()) {
+				voice->resync = true;
+			}
+			voice->finished = voice->lengthFrames == 0;
+		}
+
+		voice->targetLeft = voice->targetRight = 0;
+		if (voice->isDone()) {
+			continue;
+		}
+		computeGains(*voice, listenerPosition, listenerRight, voice->targetLeft, voice->targetRight);
+		if (loudness(*voice) >= AUDIBLE_GAIN) {
+			m_audibleScratch.push_back(voice);
+		}
+		else {
+			voice->targetLeft = voice->targetRight = 0;
+		}
+	}
+	if (m_audibleScratch.size() > maxVoices) {
+		std::nth_element(m_audibleScratch.begin(), m_audibleScratch.begin() + maxVoices, m_audibleScratch.end(),
+			[](const Voice* a, const Voice* b) { return loudness(*a) > loudness(*b); });
+		for (auto i = m_audibleScratch.begin() + maxVoices; i != m_audibleScratch.end(); ++i) {
+			(*i)->targetLeft = (*i)->targetRight = 0;
+		}
+	}
+
+	uint32_t mixed = 0;
+	for (auto* voice : m_mixVoices) {
+		if (voice->isDone()) {
+			continue;
+		}
+		uint64_t played = voice->framesPlayed.load();
+
+		// Cull a voice once it has faded out: stop decoding it, but keep its playback position.
+		bool silent = voice->targetLeft == 0 && voice->targetRight == 0;
+		if (silent && voice->gainLeft == 0 && voice->gainRight == 0) {
+			voice->audible = false;
+			voice->framesPlayed = played + frames;
+			if (!voice->loop && played + frames >= voice->lengthFrames) {
+				voice->finished = true;
+			}
+			continue;
+		}
+		if (!voice->audible) {
+			if (voice->isStreaming()) {
+				voice->resync = true;
+			}
+			voice->audible = true;
+		}
+		++mixed;
+
+		if (voice->isStreaming()) {
+			// An underrun, or a resync the decoder hasn't done yet, plays silence for the rest of the block.
+			auto available = voice->resync ? 0 : static_cast<uint32_t>(
+				voice->ring->read(m_sourceScratch.data(), frames * voice->channels) / voice->channels);
+			mixSegment(out, m_sourceScratch.data(), 0, available, frames, *voice);
+		}
+		else {
+			// Mix straight from the shared clip, wrapping around if it loops.
+			const SoundClip& clip = *voice->clip;
+			uint32_t done = 0;
+			while (done < frames) {
+				uint64_t position = played + done;
+				if (voice->loop) {
+					position %= clip.frames;
+				}
+				if (position >= clip.frames) {
+					voice->finished = true;
+					break;
+				}
+				auto count = static_cast<uint32_t>(std::min<uint64_t>(frames - done, clip.frames - position));
+				mixSegment(out, clip.samples.data() + position * clip.channels, done, count, frames, *voice);
+				done += count;
+			}
+		}
+		voice->gainLeft = voice->targetLeft;
+		voice->gainRight = voice->targetRight;
+		voice->framesPlayed = played + frames;
+	}
+
+	m_audibleVoices = mixed;
+	m_decodeWake.notify_one();
+}
+
+void AudioMixer::renderToFile(const std::string& path, float seconds) {
+	if (m_running) {
+		throw std::runtime_error("Cannot render audio to a file while the mixer is playing");
+	}
+	sf::OutputSoundFile file;
+	if (!file.openFromFile(path, MIXER_SAMPLE_RATE, MIXER_CHANNELS)) {
+		throw std::runtime_error("Could not open " + path + " for writing");
+	}
+
+	std::vector<float> block(MIXER_BLOCK_FRAMES * MIXER_CHANNELS);
+	std::vector<int16_t> samples(MIXER_BLOCK_FRAMES * MIXER_CHANNELS);
+	auto totalFrames = static_cast<uint64_t>(seconds * MIXER_SAMPLE_RATE);
+	for (uint64_t done = 0; done < totalFrames; done += MIXER_BLOCK_FRAMES) {
+		auto frames = static_cast<uint32_t>(std::min<uint64_t>(MIXER_BLOCK_FRAMES, totalFrames - done));
+		decodeAvailable();
+		mix(block.data(), frames);
+		convertToInt16(block.data(), samples.data(), frames * MIXER_CHANNELS);
+		file.write(samples.data(), frames * MIXER_CHANNELS);
+	}
+}
+
+AudioMixerStats AudioMixer::stats() {
+	AudioMixerStats stats;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		stats.voices = static_cast<uint32_t>(m_voices.size());
+		for (auto& voice : m_voices) {
+			if (voice->isStreaming()) {
+				++stats.streamingVoices;
+				stats.streamingBytes += voice->ring->capacity() * sizeof(float) + voice->decoder->memoryUsage();
+			}
+		}
+	}
+	stats.mixedVoices = m_audibleVoices.load();
+	stats.clipBytes = m_soundBank.memoryUsage();
+	stats.clips = m_soundBank.clipCount();
+	return stats;
+}
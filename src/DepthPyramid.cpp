@@ -0,0 +1,119 @@
+#include "DepthPyramid.h"
+#include "FullscreenTriangle.h"
+#include <glad/glad.h>
+#include <algorithm>
+
+DepthPyramid::DepthPyramid()
+	: m_sourceWidth(0), m_sourceHeight(0), m_width(0), m_height(0), m_levels(0),
+	m_depthTexture(0), m_depthFramebuffer(0), m_pyramidTexture(0), m_pyramidFramebuffer(0) {
+	m_reduceProgram.load("shaders/fullscreen.vert", "shaders/depth_reduce.frag");
+}
+
+void DepthPyramid::resize(uint32_t width, uint32_t height) {
+	if (m_depthTexture != 0) {
+		glDeleteTextures(1, &m_depthTexture);
+		glDeleteTextures(1, &m_pyramidTexture);
+		glDeleteFramebuffers(1, &m_depthFramebuffer);
+		glDeleteFramebuffers(1, &m_pyramidFramebuffer);
+	}
+	m_sourceWidth = width;
+	m_sourceHeight = height;
+	m_width = std::max(1u, width / 2);
+	m_height = std::max(1u, height / 2);
+	m_levels = 1;
+	for (auto size = std::max(m_width, m_height); size > 1; size /= 2) {
+		++m_levels;
+	}
+
+	// The depth copy must have the same format as the window's depth buffer for the blit to succeed.
+	glGenTextures(1, &m_depthTexture);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL,
+		GL_UNSIGNED_INT_24_8, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	glGenFramebuffers(1, &m_depthFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_depthFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+
+	glGenTextures(1, &m_pyramidTexture);
+	glBindTexture(GL_TEXTURE_2D, m_pyramidTexture);
+	for (uint32_t level = 0; level < m_levels; level++) {
+		glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, std::max(1u, m_width >> level),
+			std::max(1u, m_height >> level), 0, GL_RED, GL_FLOAT, nullptr);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_levels - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &m_pyramidFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DepthPyramid::build(uint32_t width, uint32_t height) {
+	if (width == 0 || height == 0) {
+		return;
+	}
+	// The scene may be in the window or in an offscreen target; either is bound again afterwards.
+	int32_t sceneFramebuffer;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &sceneFramebuffer);
+	if (width != m_sourceWidth || height != m_sourceHeight) {
+		resize(width, height);
+	}
+
+	// Resolve the (possibly multisampled) scene depth buffer into our depth texture.
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_depthFramebuffer);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+	// Remember the state that the scene renderer expects to find again.
+	int32_t previousProgram;
+	int32_t previousViewport[4];
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	glDisable(GL_DEPTH_TEST);
+
+	m_reduceProgram.activate();
+	m_reduceProgram.setUniform("source", 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_pyramidFramebuffer);
+
+	for (uint32_t level = 0; level < m_levels; level++) {
+		// Reduce from the depth copy for the first level, then from the previous pyramid level.
+		// Restricting the sampled level range avoids a feedback loop with the attached level.
+		if (level == 0) {
+			glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+			m_reduceProgram.setUniform("sourceLevel", 0);
+		}
+		else {
+			glBindTexture(GL_TEXTURE_2D, m_pyramidTexture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+			m_reduceProgram.setUniform("sourceLevel", static_cast<int32_t>(level - 1));
+		}
+		uint32_t sourceWidth = level == 0 ? width : std::max(1u, m_width >> (level - 1));
+		uint32_t sourceHeight = level == 0 ? height : std::max(1u, m_height >> (level - 1));
+		m_reduceProgram.setUniform("sourceSize", glm::ivec2(sourceWidth, sourceHeight));
+
+		uint32_t levelWidth = std::max(1u, m_width >> level);
+		uint32_t levelHeight = std::max(1u, m_height >> level);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_pyramidTexture, level);
+		glViewport(0, 0, levelWidth, levelHeight);
+		drawFullscreenTriangle();
+	}
+
+	glBindTexture(GL_TEXTURE_2D, m_pyramidTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_levels - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glEnable(GL_DEPTH_TEST);
+	glUseProgram(previousProgram);
+}
@@ -0,0 +1,554 @@
+#include "GeometryCodec.h"
+#include "Mesh3D.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ARCADE_GEOMETRY_SSE2 1
+#endif
+
+namespace {
+	const size_t CHANNELS = sizeof(Vertex3D) / sizeof(uint32_t);
+	const size_t PLANES = sizeof(Vertex3D);
+	static_assert(sizeof(Vertex3D) == 32, "Vertex3D must be eight 32-bit fields");
+
+	// Codes are at most this long, so that one table lookup decodes any symbol.
+	const uint32_t MAX_CODE_LENGTH = 12;
+	const uint32_t TABLE_SIZE = 1 << MAX_CODE_LENGTH;
+	// Huffman-coded planes are split into this many independent bit streams.
+	const size_t STREAMS = 4;
+
+	enum PlaneMode : uint8_t {
+		Constant = 0,
+		Raw = 1,
+		Huffman = 2
+	};
+
+	[[noreturn]] void corrupt() {
+		throw std::runtime_error("Encoded geometry is corrupt");
+	}
+
+	uint32_t zigzag(uint32_t delta) {
+		return (delta << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(delta) >> 31);
+	}
+
+	uint32_t unzigzag(uint32_t value) {
+		return (value >> 1) ^ (0u - (value & 1));
+	}
+
+	void writeVarint(std::vector<uint8_t>& out, uint32_t value) {
+		while (value >= 0x80) {
+			out.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	uint32_t readVarint(const uint8_t*& p, const uint8_t* end) {
+		uint32_t value = 0;
+		for (uint32_t shift = 0; shift < 35; shift += 7) {
+			if (p == end) {
+				corrupt();
+			}
+			uint8_t byte = *p++;
+			value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+			if (byte < 0x80) {
+				return value;
+			}
+		}
+		corrupt();
+	}
+
+	template <typename T>
+	void writeValue(std::vector<uint8_t>& out, T value) {
+		auto bytes = reinterpret_cast<const uint8_t*>(&value);
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	template <typename T>
+	T readValue(const uint8_t*& p, const uint8_t* end) {
+		if (static_cast<size_t>(end - p) < sizeof(T)) {
+			corrupt();
+		}
+		T value;
+		std::memcpy(&value, p, sizeof(T));
+		p += sizeof(T);
+		return value;
+	}
+
+	/**
+	 * @brief Huffman code lengths for the byte counts, limited to MAX_CODE_LENGTH by flattening the
+	 * counts until the tree is shallow enough. Needs at least two distinct bytes.
+	 */
+	std::array<uint8_t, 256> codeLengths(const std::array<uint32_t, 256>& counts) {
+		std::array<uint64_t, 256> weights;
+		std::copy(counts.begin(), counts.end(), weights.begin());
+		while (true) {
+			typedef std::pair<uint64_t, int> Node;
+			std::priority_queue<Node, std::vector<Node>, std::greater<Node>> queue;
+			std::vector<int> parents;
+			for (int symbol = 0; symbol < 256; symbol++) {
+				parents.push_back(-1);
+				if (weights[symbol] > 0) {
+					queue.push(Node(weights[symbol], symbol));
+				}
+			}
+			while (queue.size() > 1) {
+				auto first = queue.top();
+				queue.pop();
+				auto second = queue.top();
+				queue.pop();
+				int parent = static_cast<int>(parents.size());
+				parents.push_back(-1);
+				parents[first.second] = parent;
+				parents[second.second] = parent;
+				queue.push(Node(first.first + second.first, parent));
+			}
+
+			std::array<uint8_t, 256> lengths{};
+			uint32_t longest = 0;
+			for (int symbol = 0; symbol < 256; symbol++) {
+				if (weights[symbol] == 0) {
+					continue;
+				}
+				uint32_t length = 0;
+				for (int node = symbol; parents[node] >= 0; node = parents[node]) {
+					length++;
+				}
+				lengths[symbol] = static_cast<uint8_t>(std::min(length, 255u));
+				longest = std::max(longest, length);
+			}
+			if (longest <= MAX_CODE_LENGTH) {
+				return lengths;
+			}
+			for (auto& weight : weights) {
+				weight = weight > 0 ? (weight + 1) / 2 : 0;
+			}
+		}
+	}
+
+	/**
+	 * @brief Canonical codes for the lengths, bit-reversed since they are written least significant
+	 * bit first. Throws unless the lengths describe a complete code.
+	 */
+	std::array<uint16_t, 256> canonicalCodes(const std::array<uint8_t, 256>& lengths) {
+		std::array<uint16_t, 256> codes{};
+		uint32_t code = 0;
+		uint32_t space = 0;
+		for (uint32_t length = 1; length <= MAX_CODE_LENGTH; length++) {
+			for (int symbol = 0; symbol < 256; symbol++) {
+				if (lengths[symbol] != length) {
+					continue;
+				}
+				uint32_t reversed = 0;
+				for (uint32_t bit = 0; bit < length; bit++) {
+					reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+				}
+				codes[symbol] = static_cast<uint16_t>(reversed);
+				code++;
+				space += TABLE_SIZE >> length;
+			}
+			code <<= 1;
+		}
+		if (space != TABLE_SIZE) {
+			corrupt();
+		}
+		return codes;
+	}
+
+	void encodePlane(std::vector<uint8_t>& out, const uint8_t* plane, size_t count, bool allowConstant) {
+		std::array<uint32_t, 256> counts{};
+		for (size_t i = 0; i < count; i++) {
+			counts[plane[i]]++;
+		}
+		auto distinct = std::count_if(counts.begin(), counts.end(), [](uint32_t c) { return c > 0; });
+		if (distinct <= 1 && allowConstant) {
+			out.push_back(Constant);
+			out.push_back(count > 0 ? plane[0] : 0);
+			return;
+		}
+		// A single symbol has no Huffman code.
+		if (distinct <= 1) {
+			out.push_back(Raw);
+			out.insert(out.end(), plane, plane + count);
+			return;
+		}
+
+		auto lengths = codeLengths(counts);
+		auto codes = canonicalCodes(lengths);
+		size_t bits = 0;
+		for (int symbol = 0; symbol < 256; symbol++) {
+			bits += static_cast<size_t>(counts[symbol]) * lengths[symbol];
+		}
+		// Each stream may end in a partial byte.
+		size_t huffmanBytes = 1 + 128 + STREAMS * sizeof(uint32_t) + bits / 8 + STREAMS;
+		if (huffmanBytes >= 1 + count) {
+			out.push_back(Raw);
+			out.insert(out.end(), plane, plane + count);
+			return;
+		}
+
+		out.push_back(Huffman);
+		for (int symbol = 0; symbol < 256; symbol += 2) {
+			out.push_back(static_cast<uint8_t>(lengths[symbol] | (lengths[symbol + 1] << 4)));
+		}
+		auto sizesOffset = out.size();
+		out.resize(out.size() + STREAMS * sizeof(uint32_t));
+		auto segment = (count + STREAMS - 1) / STREAMS;
+		for (size_t stream = 0; stream < STREAMS; stream++) {
+			auto streamStart = out.size();
+			uint64_t buffer = 0;
+			uint32_t buffered = 0;
+			for (size_t i = stream * segment; i < std::min(count, (stream + 1) * segment); i++) {
+				buffer |= static_cast<uint64_t>(codes[plane[i]]) << buffered;
+				buffered += lengths[plane[i]];
+				while (buffered >= 8) {
+					out.push_back(static_cast<uint8_t>(buffer));
+					buffer >>= 8;
+					buffered -= 8;
+				}
+			}
+			if (buffered > 0) {
+				out.push_back(static_cast<uint8_t>(buffer));
+			}
+			auto streamBytes = static_cast<uint32_t>(out.size() - streamStart);
+			std::memcpy(out.data() + sizesOffset + stream * sizeof(uint32_t), &streamBytes, sizeof(streamBytes));
+		}
+	}
+
+	/**
+	 * @brief Reads bits least significant first, and zeros past the end of the stream, which a
+	 * valid stream never consumes.
+	 */
+	class BitReader {
+	private:
+		const uint8_t* m_p;
+		const uint8_t* m_begin;
+		const uint8_t* m_end;
+		uint64_t m_buffer;
+		uint32_t m_bits;
+		size_t m_padding;
+
+	public:
+		BitReader() : BitReader(nullptr, nullptr) {}
+
+		BitReader(const uint8_t* begin, const uint8_t* end)
+			: m_p(begin), m_begin(begin), m_end(end), m_buffer(0), m_bits(0), m_padding(0) {}
+
+		/**
+		 * @brief Tops the buffer up to at least 56 bits.
+		 */
+		void refill() {
+			if (m_end - m_p >= 8) {
+				uint64_t next;
+				std::memcpy(&next, m_p, sizeof(next));
+				m_buffer |= next << m_bits;
+				m_p += (63 - m_bits) >> 3;
+				m_bits |= 56;
+				return;
+			}
+			while (m_bits <= 56) {
+				if (m_p < m_end) {
+					m_buffer |= static_cast<uint64_t>(*m_p++) << m_bits;
+				}
+				else {
+					m_padding++;
+				}
+				m_bits += 8;
+			}
+		}
+
+		uint32_t peek() const {
+			return static_cast<uint32_t>(m_buffer) & (TABLE_SIZE - 1);
+		}
+
+		void consume(uint32_t bits) {
+			m_buffer >>= bits;
+			m_bits -= bits;
+		}
+
+		bool overran() const {
+			return (m_p - m_begin + m_padding) * 8 - m_bits > static_cast<size_t>(m_end - m_begin) * 8;
+		}
+	};
+
+	const uint8_t* decodePlane(const uint8_t* p, const uint8_t* end, uint8_t* plane, size_t count) {
+		auto mode = readValue<uint8_t>(p, end);
+		if (mode == Constant) {
+			std::memset(plane, readValue<uint8_t>(p, end), count);
+			return p;
+		}
+		if (mode == Raw) {
+			if (static_cast<size_t>(end - p) < count) {
+				corrupt();
+			}
+			std::memcpy(plane, p, count);
+			return p + count;
+		}
+		if (mode != Huffman || end - p < 128) {
+			corrupt();
+		}
+
+		std::array<uint8_t, 256> lengths;
+		for (int symbol = 0; symbol < 256; symbol += 2) {
+			lengths[symbol] = p[symbol / 2] & 15;
+			lengths[symbol + 1] = p[symbol / 2] >> 4;
+			if (lengths[symbol] > MAX_CODE_LENGTH || lengths[symbol + 1] > MAX_CODE_LENGTH) {
+				corrupt();
+			}
+		}
+		p += 128;
+		auto codes = canonicalCodes(lengths);
+		// Every entry holds the symbol whose code its low bits start with, and that code's length.
+		std::array<uint16_t, TABLE_SIZE> table;
+		for (int symbol = 0; symbol < 256; symbol++) {
+			if (lengths[symbol] == 0) {
+				continue;
+			}
+			for (uint32_t entry = codes[symbol]; entry < TABLE_SIZE; entry += 1u << lengths[symbol]) {
+				table[entry] = static_cast<uint16_t>((symbol << 4) | lengths[symbol]);
+			}
+		}
+
+		// The plane is split into a segment per stream, decoded side by side so that the lookups of
+		// one stream overlap with those of the others.
+		std::array<BitReader, STREAMS> readers;
+		std::array<uint8_t*, STREAMS> outputs;
+		std::array<size_t, STREAMS> sizes;
+		auto segment = (count + STREAMS - 1) / STREAMS;
+		auto streamStart = p + STREAMS * sizeof(uint32_t);
+		for (size_t stream = 0; stream < STREAMS; stream++) {
+			auto streamBytes = readValue<uint32_t>(p, end);
+			if (static_cast<size_t>(end - streamStart) < streamBytes) {
+				corrupt();
+			}
+			readers[stream] = BitReader(streamStart, streamStart + streamBytes);
+			streamStart += streamBytes;
+			auto first = std::min(count, stream * segment);
+			outputs[stream] = plane + first;
+			sizes[stream] = std::min(count, first + segment) - first;
+		}
+
+		auto decode = [&table](BitReader& reader, uint8_t* output) {
+			auto entry = table[reader.peek()];
+			*output = static_cast<uint8_t>(entry >> 4);
+			reader.consume(entry & 15);
+		};
+		// Only the last segment may be shorter. A refill leaves at least 56 bits, enough for four codes.
+		// The readers are copied to locals, which the compiler keeps in registers.
+		size_t i = 0;
+		auto r0 = readers[0], r1 = readers[1], r2 = readers[2], r3 = readers[3];
+		for (; i + 4 <= sizes[STREAMS - 1]; i += 4) {
+			r0.refill();
+			r1.refill();
+			r2.refill();
+			r3.refill();
+			for (size_t k = 0; k < 4; k++) {
+				decode(r0, outputs[0] + i + k);
+				decode(r1, outputs[1] + i + k);
+				decode(r2, outputs[2] + i + k);
+				decode(r3, outputs[3] + i + k);
+			}
+		}
+		readers = { r0, r1, r2, r3 };
+		for (size_t stream = 0; stream < STREAMS; stream++) {
+			for (size_t j = i; j < sizes[stream]; j++) {
+				readers[stream].refill();
+				decode(readers[stream], outputs[stream] + j);
+			}
+			if (readers[stream].overran()) {
+				corrupt();
+			}
+		}
+		return streamStart;
+	}
+
+#ifdef ARCADE_GEOMETRY_SSE2
+	/**
+	 * @brief Sums the zigzag-coded differences of 16 vertices of one field, given as four byte
+	 * planes, into four registers of four vertices each.
+	 */
+	void sumChannel(const uint8_t* const* planes, size_t first, __m128i& carry, __m128i* values) {
+		__m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + first));
+		__m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + first));
+		__m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2] + first));
+		__m128i b3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[3] + first));
+		__m128i low01 = _mm_unpacklo_epi8(b0, b1);
+		__m128i high01 = _mm_unpackhi_epi8(b0, b1);
+		__m128i low23 = _mm_unpacklo_epi8(b2, b3);
+		__m128i high23 = _mm_unpackhi_epi8(b2, b3);
+		values[0] = _mm_unpacklo_epi16(low01, low23);
+		values[1] = _mm_unpackhi_epi16(low01, low23);
+		values[2] = _mm_unpacklo_epi16(high01, high23);
+		values[3] = _mm_unpackhi_epi16(high01, high23);
+
+		const __m128i one = _mm_set1_epi32(1);
+		for (int g = 0; g < 4; g++) {
+			__m128i z = values[g];
+			__m128i x = _mm_xor_si128(_mm_srli_epi32(z, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(z, one)));
+			x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+			x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+			x = _mm_add_epi32(x, carry);
+			carry = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+			values[g] = x;
+		}
+	}
+
+	/**
+	 * @brief Writes four fields of four vertices, given per field, into the vertices.
+	 */
+	void storeTransposed(const __m128i* fields, size_t g, uint8_t* vertices, size_t fieldOffset) {
+		__m128i t0 = _mm_unpacklo_epi32(fields[0 * 4 + g], fields[1 * 4 + g]);
+		__m128i t1 = _mm_unpacklo_epi32(fields[2 * 4 + g], fields[3 * 4 + g]);
+		__m128i t2 = _mm_unpackhi_epi32(fields[0 * 4 + g], fields[1 * 4 + g]);
+		__m128i t3 = _mm_unpackhi_epi32(fields[2 * 4 + g], fields[3 * 4 + g]);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(vertices + 0 * sizeof(Vertex3D) + fieldOffset), _mm_unpacklo_epi64(t0, t1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(vertices + 1 * sizeof(Vertex3D) + fieldOffset), _mm_unpackhi_epi64(t0, t1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(vertices + 2 * sizeof(Vertex3D) + fieldOffset), _mm_unpacklo_epi64(t2, t3));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(vertices + 3 * sizeof(Vertex3D) + fieldOffset), _mm_unpackhi_epi64(t2, t3));
+	}
+#endif
+}
+
+std::vector<uint8_t> encodeVertices(const std::vector<Vertex3D>& vertices) {
+	auto count = vertices.size();
+	std::vector<uint8_t> planes(count * PLANES);
+	std::array<uint32_t, CHANNELS> previous{};
+	for (size_t i = 0; i < count; i++) {
+		std::array<uint32_t, CHANNELS> fields;
+		std::memcpy(fields.data(), &vertices[i], sizeof(Vertex3D));
+		for (size_t c = 0; c < CHANNELS; c++) {
+			auto z = zigzag(fields[c] - previous[c]);
+			for (size_t b = 0; b < 4; b++) {
+				planes[(c * 4 + b) * count + i] = static_cast<uint8_t>(z >> (8 * b));
+			}
+		}
+		previous = fields;
+	}
+
+	std::vector<uint8_t> out;
+	writeValue(out, static_cast<uint32_t>(count));
+	// The first plane is never constant, so that it takes at least a bit per vertex, and the
+	// decoder can reject counts that the data is too small to hold before allocating anything.
+	for (size_t plane = 0; plane < PLANES; plane++) {
+		encodePlane(out, planes.data() + plane * count, count, plane > 0);
+	}
+	return out;
+}
+
+std::vector<Vertex3D> decodeVertices(const uint8_t* data, size_t size) {
+	auto end = data + size;
+	auto p = data;
+	size_t count = readValue<uint32_t>(p, end);
+	if (count == 0) {
+		return {};
+	}
+	// The first plane takes at least a bit per vertex.
+	if (count > size * 8) {
+		corrupt();
+	}
+	std::vector<uint8_t> planes(count * PLANES);
+	for (size_t plane = 0; plane < PLANES; plane++) {
+		p = decodePlane(p, end, planes.data() + plane * count, count);
+	}
+
+	std::vector<Vertex3D> vertices(count, Vertex3D(0, 0, 0, 0, 0, 0, 0, 0));
+	auto out = reinterpret_cast<uint8_t*>(vertices.data());
+	const uint8_t* planePointers[PLANES];
+	for (size_t plane = 0; plane < PLANES; plane++) {
+		planePointers[plane] = planes.data() + plane * count;
+	}
+
+	size_t i = 0;
+	std::array<uint32_t, CHANNELS> previous{};
+#ifdef ARCADE_GEOMETRY_SSE2
+	__m128i carries[CHANNELS];
+	for (auto& carry : carries) {
+		carry = _mm_setzero_si128();
+	}
+	for (; i + 16 <= count; i += 16) {
+		__m128i fields[CHANNELS * 4];
+		for (size_t c = 0; c < CHANNELS; c++) {
+			sumChannel(planePointers + c * 4, i, carries[c], fields + c * 4);
+		}
+		for (size_t g = 0; g < 4; g++) {
+			auto group = out + (i + g * 4) * sizeof(Vertex3D);
+			storeTransposed(fields, g, group, 0);
+			storeTransposed(fields + 16, g, group, 16);
+		}
+	}
+	for (size_t c = 0; c < CHANNELS; c++) {
+		previous[c] = static_cast<uint32_t>(_mm_cvtsi128_si32(carries[c]));
+	}
+#endif
+	for (; i < count; i++) {
+		std::array<uint32_t, CHANNELS> fields;
+		for (size_t c = 0; c < CHANNELS; c++) {
+			uint32_t z = 0;
+			for (size_t b = 0; b < 4; b++) {
+				z |= static_cast<uint32_t>(planePointers[c * 4 + b][i]) << (8 * b);
+			}
+			fields[c] = previous[c] + unzigzag(z);
+		}
+		std::memcpy(out + i * sizeof(Vertex3D), fields.data(), sizeof(Vertex3D));
+		previous = fields;
+	}
+	return vertices;
+}
+
+std::vector<uint8_t> encodeIndices(const std::vector<uint32_t>& faces) {
+	std::vector<uint8_t> out;
+	writeValue(out, static_cast<uint32_t>(faces.size()));
+	uint32_t previous = 0;
+	size_t i = 0;
+	for (; i + 3 <= faces.size(); i += 3) {
+		uint32_t a = faces[i], b = faces[i + 1], c = faces[i + 2];
+		if (b < a && b <= c) {
+			std::tie(a, b, c) = std::make_tuple(b, c, a);
+		}
+		else if (c < a && c < b) {
+			std::tie(a, b, c) = std::make_tuple(c, a, b);
+		}
+		writeVarint(out, zigzag(a - previous));
+		writeVarint(out, b - a);
+		writeVarint(out, c - a);
+		previous = a;
+	}
+	// Index buffers are triangle lists, but any leftover indices are kept anyway.
+	for (; i < faces.size(); i++) {
+		writeVarint(out, zigzag(faces[i] - previous));
+		previous = faces[i];
+	}
+	return out;
+}
+
+std::vector<uint32_t> decodeIndices(const uint8_t* data, size_t size) {
+	auto end = data + size;
+	auto p = data;
+	size_t count = readValue<uint32_t>(p, end);
+	// Every index takes at least one byte.
+	if (count > size) {
+		corrupt();
+	}
+	std::vector<uint32_t> faces(count);
+	uint32_t previous = 0;
+	size_t i = 0;
+	for (; i + 3 <= count; i += 3) {
+		uint32_t a = previous + unzigzag(readVarint(p, end));
+		faces[i] = a;
+		faces[i + 1] = a + readVarint(p, end);
+		faces[i + 2] = a + readVarint(p, end);
+		previous = a;
+	}
+	for (; i < count; i++) {
+		faces[i] = previous + unzigzag(readVarint(p, end));
+		previous = faces[i];
+	}
+	return faces;
+}
@@ -0,0 +1,280 @@
+#include "GpuObjectCuller.h"
+#include "DepthPyramid.h"
+#include "Frustum.h"
+#include "Mesh3D.h"
+#include "MeshletCuller.h"
+#include "Object3D.h"
+#include "ReflectionProbes.h"
+#include "Transform.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <tuple>
+
+namespace {
+	// The texture unit used for the Hi-Z pyramid, far above the units used by mesh textures.
+	const int32_t HI_Z_TEXTURE_UNIT = 15;
+	const uint32_t CULL_GROUP_SIZE = 64;
+
+	/**
+	 * @brief The world-space bounding sphere of a mesh drawn with the given model matrix.
+	 */
+	glm::vec4 worldSphere(const Mesh3D& mesh, const glm::mat4& model) {
+		float scale = std::max(glm::length(glm::vec3(model[0])),
+			std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		return glm::vec4(glm::vec3(model * glm::vec4(mesh.getBoundsCenter(), 1)), mesh.getBoundsRadius() * scale);
+	}
+
+	void packNormalMatrix(const glm::mat4& model, glm::vec4* columns) {
+		glm::mat3 normal = normalMatrix(model);
+		for (int column = 0; column < 3; column++) {
+			columns[column] = glm::vec4(normal[column], 0);
+		}
+	}
+
+	void uploadBuffer(uint32_t buffer, size_t size, const void* data) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, size, data, GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+}
+
+GpuObjectCuller::GpuObjectCuller()
+	: m_supported(GLAD_GL_VERSION_4_3), m_instanceBuffer(0), m_visibleBuffer(0), m_commandBuffer(0),
+	m_commandTemplateBuffer(0), m_stagingBuffer(0), m_instanceCount(0), m_lastUploadCount(0),
+	m_totalUploadCount(0), m_view(1), m_projection(1), m_depthPyramid(nullptr),
+	m_ambientColor(0), m_directionalLight(0, 0, -1), m_directionalColor(1), m_viewPos(0), m_reflectionProbes(nullptr) {
+	if (!m_supported) {
+		return;
+	}
+	m_cullProgram.loadCompute("shaders/object_cull.comp");
+	m_drawProgram.load("shaders/instanced_lighting.vert", "shaders/lighting.frag");
+	m_scatterProgram.loadCompute("shaders/transform_scatter.comp");
+	uint32_t buffers[5];
+	glGenBuffers(5, buffers);
+	m_instanceBuffer = buffers[0];
+	m_visibleBuffer = buffers[1];
+	m_commandBuffer = buffers[2];
+	m_commandTemplateBuffer = buffers[3];
+	m_stagingBuffer = buffers[4];
+}
+
+void GpuObjectCuller::build(const std::vector<Object3D>& objects) {
+	if (!m_supported) {
+		return;
+	}
+
+	// Gather the draws to cull, remembering which object and draw each came from. Blended meshes
+	// are left to the sorted forward path.
+	std::vector<MeshDraw> draws;
+	m_trackedObjects.clear();
+	m_mappings.clear();
+	for (auto& object : objects) {
+		m_drawScratch.clear();
+		object.collectDraws(m_drawScratch);
+		TrackedObject tracked{ object.transformVersion(), static_cast<uint32_t>(m_mappings.size()), 0 };
+		for (uint32_t i = 0; i < m_drawScratch.size(); i++) {
+			if (m_drawScratch[i].mesh->getAlphaMode() != AlphaMode::Blend) {
+				m_mappings.push_back(InstanceMapping{ i, static_cast<uint32_t>(draws.size()) });
+				draws.push_back(m_drawScratch[i]);
+				++tracked.mappingCount;
+			}
+		}
+		m_trackedObjects.push_back(tracked);
+	}
+
+	// Group the draws into batches of the same mesh and material.
+	std::map<std::tuple<const Mesh3D*, float, float, float, float>, uint32_t> batchIndices;
+	m_instanceBatches.clear();
+	m_instanceBatches.reserve(draws.size());
+	m_batches.clear();
+	for (auto& draw : draws) {
+		auto key = std::make_tuple(draw.mesh, draw.material.x, draw.material.y, draw.material.z, draw.material.w);
+		auto found = batchIndices.find(key);
+		if (found == batchIndices.end()) {
+			found = batchIndices.emplace(key, static_cast<uint32_t>(m_batches.size())).first;
+			m_batches.push_back(Batch{ draw.mesh, draw.material, 0, 0 });
+		}
+		m_instanceBatches.push_back(found->second);
+		++m_batches[found->second].instanceCount;
+	}
+
+	// Each batch owns a range of the visible list as long as its instance count.
+	std::vector<DrawElementsIndirectCommand> commands;
+	commands.reserve(m_batches.size());
+	uint32_t slot = 0;
+	for (auto& batch : m_batches) {
+		batch.firstSlot = slot;
+		slot += batch.instanceCount;
+		commands.push_back(DrawElementsIndirectCommand{ batch.mesh->getFaceCount(), 0, 0, 0, batch.firstSlot });
+	}
+
+	std::vector<GpuInstance> instances;
+	instances.reserve(draws.size());
+	for (size_t i = 0; i < draws.size(); i++) {
+		auto& draw = draws[i];
+		GpuInstance instance{};
+		instance.model = draw.model;
+		packNormalMatrix(draw.model, instance.normalMatrix);
+		instance.sphere = worldSphere(*draw.mesh, draw.model);
+		instance.batch = m_instanceBatches[i];
+		instances.push_back(instance);
+	}
+	m_instanceCount = static_cast<uint32_t>(instances.size());
+
+	uploadBuffer(m_instanceBuffer, instances.size() * sizeof(GpuInstance), instances.data());
+	uploadBuffer(m_visibleBuffer, std::max<size_t>(m_instanceCount, 1) * sizeof(uint32_t), nullptr);
+	uploadBuffer(m_commandTemplateBuffer, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), nullptr,
+		GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	m_pendingUpdates.clear();
+}
+
+void GpuObjectCuller::syncTransforms(const std::vector<Object3D>& objects) {
+	size_t count = std::min(objects.size(), m_trackedObjects.size());
+	for (size_t i = 0; i < count; i++) {
+		auto& tracked = m_trackedObjects[i];
+		uint64_t version = objects[i].transformVersion();
+		if (version == tracked.transformVersion) {
+			continue;
+		}
+		tracked.transformVersion = version;
+
+		m_drawScratch.clear();
+		objects[i].collectDraws(m_drawScratch);
+		for (uint32_t m = tracked.firstMapping; m < tracked.firstMapping + tracked.mappingCount; m++) {
+			updateInstance(m_mappings[m].instance, m_drawScratch[m_mappings[m].drawIndex].model);
+		}
+	}
+}
+
+void GpuObjectCuller::updateInstance(uint32_t instance, const glm::mat4& model) {
+	GpuTransformUpdate update{};
+	update.instance = instance;
+	update.model = model;
+	packNormalMatrix(model, update.normalMatrix);
+	update.sphere = worldSphere(*m_batches[m_instanceBatches[instance]].mesh, model);
+	m_pendingUpdates.push_back(update);
+}
+
+void GpuObjectCuller::flushUpdates() {
+	m_lastUploadCount = static_cast<uint32_t>(m_pendingUpdates.size());
+	m_totalUploadCount += m_lastUploadCount;
+	if (m_pendingUpdates.empty()) {
+		return;
+	}
+
+	// Orphan the staging buffer each time, so the driver never waits for last frame's scatter.
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_stagingBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, m_pendingUpdates.size() * sizeof(GpuTransformUpdate),
+		m_pendingUpdates.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	m_scatterProgram.activate();
+	m_scatterProgram.setUniform("updateCount", m_lastUploadCount);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_instanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_stagingBuffer);
+	glDispatchCompute((m_lastUploadCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	m_pendingUpdates.clear();
+}
+
+void GpuObjectCuller::setLighting(const glm::vec3& ambientColor, const glm::vec3& directionalLight,
+	const glm::vec3& directionalColor, const glm::vec3& viewPos) {
+	m_ambientColor = ambientColor;
+	m_directionalLight = directionalLight;
+	m_directionalColor = directionalColor;
+	m_viewPos = viewPos;
+}
+
+void GpuObjectCuller::setView(const glm::mat4& view, const glm::mat4& projection) {
+	m_view = view;
+	m_projection = projection;
+}
+
+void GpuObjectCuller::setDepthPyramid(const DepthPyramid* pyramid) {
+	m_depthPyramid = pyramid;
+}
+
+void GpuObjectCuller::setReflectionProbes(const ReflectionProbes* probes) {
+	m_reflectionProbes = probes;
+}
+
+void GpuObjectCuller::cull() {
+	// Start every batch's command with zero instances.
+	glBindBuffer(GL_COPY_READ_BUFFER, m_commandTemplateBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+		m_batches.size() * sizeof(DrawElementsIndirectCommand));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	Frustum frustum = Frustum::fromMatrix(m_projection * m_view);
+	m_cullProgram.activate();
+	m_cullProgram.setUniform("instanceCount", m_instanceCount);
+	for (auto i = 0; i < 6; i++) {
+		m_cullProgram.setUniform("frustumPlanes[" + std::to_string(i) + "]", frustum.planes[i]);
+	}
+	m_cullProgram.setUniform("view", m_view);
+	m_cullProgram.setUniform("projection", m_projection);
+
+	bool useOcclusion = m_depthPyramid != nullptr && m_depthPyramid->isBuilt();
+	m_cullProgram.setUniform("useOcclusion", useOcclusion);
+	if (useOcclusion) {
+		glActiveTexture(GL_TEXTURE0 + HI_Z_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, m_depthPyramid->texture());
+		m_cullProgram.setUniform("depthPyramid", HI_Z_TEXTURE_UNIT);
+		m_cullProgram.setUniform("pyramidSize", glm::vec2(m_depthPyramid->width(), m_depthPyramid->height()));
+		m_cullProgram.setUniform("pyramidLevels", static_cast<int32_t>(m_depthPyramid->levels()));
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_instanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_visibleBuffer);
+	glDispatchCompute((m_instanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GpuObjectCuller::render() {
+	if (!m_supported || m_instanceCount == 0) {
+		return;
+	}
+	int32_t previousProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+
+	flushUpdates();
+	cull();
+
+	m_drawProgram.activate();
+	m_drawProgram.setUniform("view", m_view);
+	m_drawProgram.setUniform("projection", m_projection);
+	m_drawProgram.setUniform("ambientColor", m_ambientColor);
+	m_drawProgram.setUniform("directionalLight", m_directionalLight);
+	m_drawProgram.setUniform("directionalColor", m_directionalColor);
+	m_drawProgram.setUniform("viewPos", m_viewPos);
+	m_drawProgram.setUniform("weightedOit", false);
+	if (m_reflectionProbes != nullptr) {
+		m_reflectionProbes->apply(m_drawProgram, m_viewPos);
+	}
+	else {
+		ReflectionProbes::disable(m_drawProgram);
+	}
+
+	// One draw per batch, however many of its instances survived.
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_instanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_visibleBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	for (size_t i = 0; i < m_batches.size(); i++) {
+		auto& batch = m_batches[i];
+		m_drawProgram.setUniform("instanceBase", batch.firstSlot);
+		m_drawProgram.setUniform("material", batch.material);
+		batch.mesh->renderIndirect(m_drawProgram, i * sizeof(DrawElementsIndirectCommand));
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	glUseProgram(previousProgram);
+}
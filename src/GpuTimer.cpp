@@ -0,0 +1,48 @@
+#include "GpuTimer.h"
+#include <glad/glad.h>
+
+GpuTimer::GpuTimer() : m_next(0), m_totalMilliseconds(0), m_samples(0) {
+	glGenQueries(QUERY_COUNT, m_queries.data());
+	m_pending.fill(false);
+}
+
+void GpuTimer::collect() {
+	for (size_t i = 0; i < QUERY_COUNT; i++) {
+		if (!m_pending[i]) {
+			continue;
+		}
+		int32_t available = 0;
+		glGetQueryObjectiv(m_queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			uint64_t nanoseconds = 0;
+			glGetQueryObjectui64v(m_queries[i], GL_QUERY_RESULT, &nanoseconds);
+			m_totalMilliseconds += nanoseconds / 1.0e6;
+			++m_samples;
+			m_pending[i] = false;
+		}
+	}
+}
+
+void GpuTimer::begin() {
+	collect();
+	// If every query is still in flight, drop the oldest measurement rather than waiting on it.
+	m_pending[m_next] = false;
+	glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+}
+
+void GpuTimer::end() {
+	glEndQuery(GL_TIME_ELAPSED);
+	m_pending[m_next] = true;
+	m_next = (m_next + 1) % QUERY_COUNT;
+}
+
+double GpuTimer::averageMilliseconds() const {
+	return m_samples == 0 ? 0 : m_totalMilliseconds / m_samples;
+}
+
+void GpuTimer::reset() {
+	// Measurements still in flight belong to the interval being discarded.
+	m_pending.fill(false);
+	m_totalMilliseconds = 0;
+	m_samples = 0;
+}
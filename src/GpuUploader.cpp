@@ -0,0 +1,155 @@
+#include "GpuUploader.h"
+#include "Texture.h"
+#include <SFML/Window/Context.hpp>
+#include <chrono>
+
+GpuUploader::GpuUploader(const sf::ContextSettings& settings)
+	: m_nextTicket(1), m_stopping(false), m_started(false), m_available(false) {
+	m_thread = std::thread(&GpuUploader::run, this, settings);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_wake.wait(lock, [this] { return m_started; });
+}
+
+GpuUploader::~GpuUploader() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	m_thread.join();
+
+	// The thread is gone, so nothing else touches these.
+	for (auto& finished : m_finished) {
+		glDeleteSync(finished.fence);
+	}
+	for (auto& finished : m_fenced) {
+		glDeleteSync(finished.fence);
+	}
+	m_fenced.insert(m_fenced.end(), m_finished.begin(), m_finished.end());
+	for (auto& [ticket, finished] : m_ready) {
+		m_fenced.push_back(finished);
+	}
+	for (auto& finished : m_fenced) {
+		if (finished.kind == JobKind::Buffer) {
+			glDeleteBuffers(1, &finished.objectId);
+		}
+		else {
+			glDeleteTextures(1, &finished.objectId);
+		}
+	}
+}
+
+void GpuUploader::run(sf::ContextSettings settings) {
+	// SFML shares every context it creates with every other, the window's included. Function
+	// pointers were loaded by gladLoadGL on the render thread, and are the same for both contexts.
+	sf::Context context(settings, 1, 1);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_available = context.setActive(true) && GLAD_GL_VERSION_3_2;
+		m_started = true;
+	}
+	m_wake.notify_all();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_available) {
+		m_wake.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+		if (m_stopping) {
+			break;
+		}
+		auto job = std::move(m_jobs.front());
+		m_jobs.pop_front();
+		lock.unlock();
+
+		auto start = std::chrono::steady_clock::now();
+		auto objectId = perform(job);
+		// Flushing makes sure the fence reaches the GPU, so that the render thread, which only ever
+		// polls it, eventually sees it signalled.
+		auto fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+		auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		job.owner.reset();
+
+		lock.lock();
+		m_finished.push_back(Finished{ job.ticket, objectId, job.kind, fence });
+		if (job.kind == JobKind::Buffer) {
+			++m_stats.buffersUploaded;
+		}
+		else {
+			++m_stats.texturesUploaded;
+		}
+		m_stats.bytesUploaded += job.bytes;
+		m_stats.lastJobMilliseconds = static_cast<float>(elapsed);
+	}
+}
+
+uint32_t GpuUploader::perform(const Job& job) {
+	if (job.kind == JobKind::Texture) {
+		return Texture::loadImage(*static_cast<const StbImage*>(job.data), "").textureId;
+	}
+	uint32_t buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, job.bytes, job.data, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return buffer;
+}
+
+GpuUploader::Ticket GpuUploader::submit(JobKind kind, const void* data, size_t bytes,
+	std::shared_ptr<const void> owner) {
+	Ticket ticket;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		ticket = m_nextTicket++;
+		m_jobs.push_back(Job{ ticket, kind, data, bytes, std::move(owner) });
+	}
+	m_wake.notify_all();
+	return ticket;
+}
+
+GpuUploader::Ticket GpuUploader::uploadBuffer(const void* data, size_t bytes, std::shared_ptr<const void> owner) {
+	return submit(JobKind::Buffer, data, bytes, std::move(owner));
+}
+
+GpuUploader::Ticket GpuUploader::uploadTexture(std::shared_ptr<const StbImage> image) {
+	auto bytes = static_cast<size_t>(image->getWidth()) * image->getHeight() * 4;
+	auto data = image.get();
+	return submit(JobKind::Texture, data, bytes, std::move(image));
+}
+
+void GpuUploader::poll() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_fenced.insert(m_fenced.end(), m_finished.begin(), m_finished.end());
+		m_finished.clear();
+	}
+	// A timeout of 0 only tests the fence. Fences signal in the order they were inserted, so the
+	// first unsignalled one ends the search.
+	size_t signalled = 0;
+	for (; signalled < m_fenced.size(); signalled++) {
+		auto status = glClientWaitSync(m_fenced[signalled].fence, 0, 0);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			break;
+		}
+		glDeleteSync(m_fenced[signalled].fence);
+		m_ready[m_fenced[signalled].ticket] = m_fenced[signalled];
+	}
+	m_fenced.erase(m_fenced.begin(), m_fenced.begin() + signalled);
+}
+
+bool GpuUploader::take(Ticket ticket, uint32_t& objectId) {
+	auto ready = m_ready.find(ticket);
+	if (ready == m_ready.end()) {
+		return false;
+	}
+	objectId = ready->second.objectId;
+	m_ready.erase(ready);
+	return true;
+}
+
+GpuUploadStats GpuUploader::stats() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto stats = m_stats;
+	stats.queuedJobs = static_cast<uint32_t>(m_jobs.size());
+	stats.pendingFences = static_cast<uint32_t>(m_finished.size() + m_fenced.size());
+	return stats;
+}
@@ -0,0 +1,280 @@
+#include "HlodBuilder.h"
+#include "FullscreenTriangle.h"
+#include "Mesh3D.h"
+#include "MeshDraw.h"
+#include "Transform.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <optional>
+#include <unordered_map>
+
+namespace {
+	/**
+	 * @brief Identifies one merged vertex: source vertices that fall in the same grid cell, sample
+	 * the same atlas slot with the same UV repeat, and face roughly the same way are merged.
+	 */
+	struct ClusterKey {
+		glm::ivec3 cell;
+		glm::ivec2 uvRepeat;
+		uint32_t slot;
+		uint32_t normalBucket;
+
+		bool operator==(const ClusterKey& other) const {
+			return cell == other.cell && uvRepeat == other.uvRepeat && slot == other.slot
+				&& normalBucket == other.normalBucket;
+		}
+	};
+
+	struct ClusterKeyHash {
+		size_t operator()(const ClusterKey& key) const {
+			size_t hash = static_cast<uint32_t>(key.cell.x) * 73856093u;
+			hash ^= static_cast<uint32_t>(key.cell.y) * 19349663u;
+			hash ^= static_cast<uint32_t>(key.cell.z) * 83492791u;
+			hash ^= static_cast<uint32_t>(key.uvRepeat.x) * 2654435761u;
+			hash ^= static_cast<uint32_t>(key.uvRepeat.y) * 40503u;
+			return hash ^ (key.slot << 3) ^ key.normalBucket;
+		}
+	};
+
+	/**
+	 * @brief Which of the six axis directions a normal is closest to, so that the two sides of a
+	 * thin wall are never merged into one vertex.
+	 */
+	uint32_t normalBucket(const glm::vec3& normal) {
+		glm::vec3 a = glm::abs(normal);
+		uint32_t axis = a.x >= a.y && a.x >= a.z ? 0 : a.y >= a.z ? 1 : 2;
+		return axis * 2 + (normal[axis] < 0 ? 1 : 0);
+	}
+
+	/**
+	 * @brief The world-space sphere around the bounding spheres of the given draws.
+	 */
+	glm::vec4 drawBounds(const std::vector<MeshDraw>& draws) {
+		glm::vec3 boundsMin(INFINITY), boundsMax(-INFINITY);
+		std::vector<glm::vec4> spheres;
+		for (auto& draw : draws) {
+			glm::vec3 center = glm::vec3(draw.model * glm::vec4(draw.mesh->getBoundsCenter(), 1));
+			float scale = std::max(glm::length(glm::vec3(draw.model[0])),
+				std::max(glm::length(glm::vec3(draw.model[1])), glm::length(glm::vec3(draw.model[2]))));
+			spheres.emplace_back(center, draw.mesh->getBoundsRadius() * scale);
+			boundsMin = glm::min(boundsMin, center - spheres.back().w);
+			boundsMax = glm::max(boundsMax, center + spheres.back().w);
+		}
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		float radius = 0;
+		for (auto& sphere : spheres) {
+			radius = std::max(radius, glm::distance(center, glm::vec3(sphere)) + sphere.w);
+		}
+		return glm::vec4(center, radius);
+	}
+
+	const Texture* findBaseTexture(const Mesh3D& mesh) {
+		for (auto& texture : mesh.getTextures()) {
+			if (texture.samplerName == "baseTexture") {
+				return &texture;
+			}
+		}
+		return nullptr;
+	}
+}
+
+HlodBuilder::HlodBuilder(float clusterSize, uint32_t atlasSlotSize, uint32_t simplifyResolution)
+	: m_clusterSize(clusterSize), m_atlasSlotSize(atlasSlotSize), m_simplifyResolution(simplifyResolution) {
+	m_copyProgram.load("shaders/fullscreen.vert", "shaders/atlas_copy.frag");
+}
+
+std::vector<HlodCluster> HlodBuilder::build(const std::vector<Object3D>& objects,
+	const std::vector<size_t>& candidates) {
+	std::map<std::pair<int32_t, int32_t>, std::vector<size_t>> cells;
+	std::vector<MeshDraw> draws;
+	for (auto index : candidates) {
+		draws.clear();
+		objects[index].collectDraws(draws);
+		if (draws.empty()) {
+			continue;
+		}
+		glm::vec4 bounds = drawBounds(draws);
+		auto cell = std::make_pair(static_cast<int32_t>(std::floor(bounds.x / m_clusterSize)),
+			static_cast<int32_t>(std::floor(bounds.z / m_clusterSize)));
+		cells[cell].push_back(index);
+	}
+
+	std::vector<HlodCluster> clusters;
+	for (auto& [cell, members] : cells) {
+		if (members.size() >= 2) {
+			auto cluster = buildCluster(objects, std::move(members));
+			if (cluster.proxyTriangles > 0) {
+				clusters.push_back(std::move(cluster));
+			}
+		}
+	}
+	return clusters;
+}
+
+bool HlodBuilder::isCurrent(const HlodCluster& cluster, const std::vector<Object3D>& objects) {
+	uint64_t version = 0;
+	for (auto index : cluster.members) {
+		version += objects[index].transformVersion();
+	}
+	return version == cluster.transformVersion;
+}
+
+HlodCluster HlodBuilder::buildCluster(const std::vector<Object3D>& objects, std::vector<size_t>&& members) {
+	// Blended meshes can't be merged into an alpha-tested proxy, so they are left out.
+	std::vector<MeshDraw> draws;
+	std::vector<MeshDraw> memberDraws;
+	uint64_t transformVersion = 0;
+	for (auto index : members) {
+		memberDraws.clear();
+		objects[index].collectDraws(memberDraws);
+		for (auto& draw : memberDraws) {
+			if (draw.mesh->getAlphaMode() != AlphaMode::Blend) {
+				draws.push_back(draw);
+			}
+		}
+		transformVersion += objects[index].transformVersion();
+	}
+	glm::vec4 bounds = drawBounds(draws);
+
+	// 1. Give every distinct base texture a slot in the atlas. The last slot stays white, for
+	// meshes without a texture.
+	std::unordered_map<uint32_t, uint32_t> slots;
+	std::vector<uint32_t> slotTextures;
+	for (auto& draw : draws) {
+		auto* texture = findBaseTexture(*draw.mesh);
+		if (texture != nullptr && slots.emplace(texture->textureId, static_cast<uint32_t>(slotTextures.size())).second) {
+			slotTextures.push_back(texture->textureId);
+		}
+	}
+	auto whiteSlot = static_cast<uint32_t>(slotTextures.size());
+	auto grid = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(whiteSlot + 1))));
+	uint32_t atlasSize = grid * m_atlasSlotSize;
+
+	uint32_t atlas, framebuffer;
+	glGenTextures(1, &atlas);
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlasSize, atlasSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlas, 0);
+
+	int32_t previousProgram;
+	int32_t previousViewport[4];
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+	const float white[] = { 1, 1, 1, 1 };
+	glClearBufferfv(GL_COLOR, 0, white);
+	m_copyProgram.activate();
+	m_copyProgram.setUniform("sourceTexture", 0);
+	glActiveTexture(GL_TEXTURE0);
+	for (uint32_t slot = 0; slot < whiteSlot; slot++) {
+		glViewport((slot % grid) * m_atlasSlotSize, (slot / grid) * m_atlasSlotSize, m_atlasSlotSize, m_atlasSlotSize);
+		glBindTexture(GL_TEXTURE_2D, slotTextures[slot]);
+		drawFullscreenTriangle();
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glUseProgram(previousProgram);
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// 2. Merge the members' triangles in world space, snapping vertices to a grid. Triangles are
+	// shifted by whole UV repeats to start in [0, 1); the atlas can't repeat, so triangles that
+	// span more than one repeat are clamped, which is invisible at the distances proxies are used.
+	float cellSize = 2 * bounds.w / m_simplifyResolution;
+	glm::vec3 origin = glm::vec3(bounds) - bounds.w;
+	float halfTexel = 0.5f / m_atlasSlotSize;
+	std::unordered_map<ClusterKey, uint32_t, ClusterKeyHash> merged;
+	std::vector<glm::vec3> positionSums, normalSums;
+	std::vector<glm::vec2> uvSums;
+	std::vector<uint32_t> counts;
+	std::vector<uint32_t> proxyFaces;
+	std::vector<Vertex3D> sourceVertices;
+	std::vector<uint32_t> sourceFaces;
+	uint32_t sourceTriangles = 0;
+	bool masked = false;
+	for (auto& draw : draws) {
+		draw.mesh->readGeometry(sourceVertices, sourceFaces);
+		sourceTriangles += static_cast<uint32_t>(sourceFaces.size() / 3);
+		masked = masked || draw.mesh->getAlphaMode() == AlphaMode::Mask;
+		auto* texture = findBaseTexture(*draw.mesh);
+		uint32_t slot = texture != nullptr ? slots[texture->textureId] : whiteSlot;
+		glm::vec2 slotOrigin = glm::vec2(slot % grid, slot / grid) / static_cast<float>(grid);
+		glm::mat3 normals = normalMatrix(draw.model);
+
+		for (size_t t = 0; t + 2 < sourceFaces.size(); t += 3) {
+			glm::vec2 minUv(INFINITY);
+			for (int corner = 0; corner < 3; corner++) {
+				auto& v = sourceVertices[sourceFaces[t + corner]];
+				minUv = glm::min(minUv, glm::vec2(v.u, v.v));
+			}
+			glm::ivec2 repeat = texture != nullptr ? glm::ivec2(glm::floor(minUv)) : glm::ivec2(0);
+
+			uint32_t corners[3];
+			for (int corner = 0; corner < 3; corner++) {
+				auto& v = sourceVertices[sourceFaces[t + corner]];
+				glm::vec3 position = glm::vec3(draw.model * glm::vec4(v.x, v.y, v.z, 1));
+				glm::vec3 normal = glm::normalize(normals * glm::vec3(v.nx, v.ny, v.nz));
+				glm::vec2 uv = texture != nullptr
+					? glm::clamp(glm::vec2(v.u, v.v) - glm::vec2(repeat), 0.0f, 1.0f) : glm::vec2(0.5f);
+				uv = slotOrigin + (halfTexel + uv * (1 - 2 * halfTexel)) / static_cast<float>(grid);
+
+				ClusterKey key{ glm::ivec3(glm::floor((position - origin) / cellSize)), repeat, slot,
+					normalBucket(normal) };
+				auto found = merged.emplace(key, static_cast<uint32_t>(counts.size()));
+				if (found.second) {
+					positionSums.push_back(glm::vec3(0));
+					normalSums.push_back(glm::vec3(0));
+					uvSums.push_back(glm::vec2(0));
+					counts.push_back(0);
+				}
+				uint32_t index = found.first->second;
+				positionSums[index] += position;
+				normalSums[index] += normal;
+				uvSums[index] += uv;
+				++counts[index];
+				corners[corner] = index;
+			}
+			// Triangles smaller than a cell collapse, and are dropped.
+			if (corners[0] != corners[1] && corners[1] != corners[2] && corners[0] != corners[2]) {
+				proxyFaces.insert(proxyFaces.end(), corners, corners + 3);
+			}
+		}
+	}
+
+	auto proxyTriangles = static_cast<uint32_t>(proxyFaces.size() / 3);
+	std::vector<Vertex3D> proxyVertices;
+	proxyVertices.reserve(counts.size());
+	for (size_t i = 0; i < counts.size(); i++) {
+		glm::vec3 position = positionSums[i] / static_cast<float>(counts[i]);
+		float normalLength = glm::length(normalSums[i]);
+		glm::vec3 normal = normalLength > 0 ? normalSums[i] / normalLength : glm::vec3(0, 1, 0);
+		glm::vec2 uv = uvSums[i] / static_cast<float>(counts[i]);
+		proxyVertices.emplace_back(position.x, position.y, position.z, normal.x, normal.y, normal.z, uv.x, uv.y);
+	}
+	if (proxyFaces.empty()) {
+		// Keep the mesh constructible; the caller discards clusters without triangles.
+		proxyVertices.emplace_back(0, 0, 0, 0, 1, 0, 0, 0);
+		proxyFaces = { 0, 0, 0 };
+	}
+
+	Mesh3D proxyMesh(std::move(proxyVertices), std::move(proxyFaces), Texture{ atlas, "baseTexture" });
+	if (masked) {
+		proxyMesh.setAlphaMode(AlphaMode::Mask);
+	}
+	Object3D proxy(std::vector<Mesh3D>{ proxyMesh });
+	proxy.setMaterial(objects[members.front()].getMaterial());
+
+	return HlodCluster{ std::move(members), glm::vec3(bounds), bounds.w, transformVersion, std::move(proxy),
+		sourceTriangles, proxyTriangles };
+}
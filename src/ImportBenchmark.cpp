@@ -0,0 +1,194 @@
+#include "ImportBenchmark.h"
+#include "AssimpImport.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+	const ImportProfile PROFILES[] = { ImportProfile::Fast, ImportProfile::Balanced, ImportProfile::Max };
+	// Positions are compared to this fraction of the model's size, normals and texture coordinates
+	// to these absolute steps.
+	const float POSITION_TOLERANCE = 1e-5f;
+	const float NORMAL_TOLERANCE = 1e-3f;
+	const float TEXCOORD_TOLERANCE = 1e-4f;
+
+	const size_t VALUES_PER_CORNER = 8;
+	// Three corners, then the material.
+	typedef std::array<int64_t, 3 * VALUES_PER_CORNER + 1> TriangleKey;
+
+	struct ProfileResult {
+		ImportTiming timing;
+		size_t meshCount = 0;
+		size_t vertexCount = 0;
+		std::vector<TriangleKey> triangles;
+	};
+
+	/**
+	 * @brief Gives every distinct combination of textures and alpha settings a number, shared by
+	 * all profiles of a model.
+	 */
+	int64_t materialKey(const ImportedMesh& mesh, std::unordered_map<std::string, int64_t>& materials) {
+		std::string key = std::to_string(static_cast<int>(mesh.alphaMode)) + " " + std::to_string(mesh.alphaCutoff)
+			+ " " + std::to_string(mesh.opacity);
+		for (auto& texture : mesh.textures) {
+			key += " " + texture.samplerName + "=" + texture.path;
+		}
+		return materials.insert(std::make_pair(key, static_cast<int64_t>(materials.size()))).first->second;
+	}
+
+	void measureBounds(const ImportedNode& node, const glm::mat4& parent, glm::vec3& minCorner, glm::vec3& maxCorner) {
+		glm::mat4 model = parent * node.baseTransform;
+		for (auto& mesh : node.meshes) {
+			for (auto& v : mesh.vertices) {
+				glm::vec3 p(model * glm::vec4(v.x, v.y, v.z, 1));
+				minCorner = glm::min(minCorner, p);
+				maxCorner = glm::max(maxCorner, p);
+			}
+		}
+		for (auto& child : node.children) {
+			measureBounds(child, model, minCorner, maxCorner);
+		}
+	}
+
+	/**
+	 * @brief Appends every triangle of the hierarchy in world space, snapped to the tolerances, with
+	 * its corners rotated so the smallest comes first. Merging, splitting and reordering meshes,
+	 * vertices or triangles then leaves the sorted list unchanged.
+	 */
+	void collectTriangles(const ImportedNode& node, const glm::mat4& parent, float positionStep,
+		std::unordered_map<std::string, int64_t>& materials, ProfileResult& result) {
+		glm::mat4 model = parent * node.baseTransform;
+		glm::mat3 normals = glm::transpose(glm::inverse(glm::mat3(model)));
+		for (auto& mesh : node.meshes) {
+			++result.meshCount;
+			result.vertexCount += mesh.vertices.size();
+			int64_t material = materialKey(mesh, materials);
+			for (size_t f = 0; f + 2 < mesh.faces.size(); f += 3) {
+				std::array<std::array<int64_t, VALUES_PER_CORNER>, 3> corners;
+				for (size_t c = 0; c < 3; c++) {
+					auto& v = mesh.vertices[mesh.faces[f + c]];
+					glm::vec3 p(model * glm::vec4(v.x, v.y, v.z, 1));
+					glm::vec3 n = normals * glm::vec3(v.nx, v.ny, v.nz);
+					n = glm::length(n) > 0 ? glm::normalize(n) : n;
+					float values[VALUES_PER_CORNER] = { p.x / positionStep, p.y / positionStep, p.z / positionStep,
+						n.x / NORMAL_TOLERANCE, n.y / NORMAL_TOLERANCE, n.z / NORMAL_TOLERANCE,
+						v.u / TEXCOORD_TOLERANCE, v.v / TEXCOORD_TOLERANCE };
+					for (size_t i = 0; i < VALUES_PER_CORNER; i++) {
+						corners[c][i] = static_cast<int64_t>(std::llround(values[i]));
+					}
+				}
+				auto first = std::min_element(corners.begin(), corners.end()) - corners.begin();
+				TriangleKey key;
+				for (size_t c = 0; c < 3; c++) {
+					auto& corner = corners[(first + c) % 3];
+					std::copy(corner.begin(), corner.end(), key.begin() + c * VALUES_PER_CORNER);
+				}
+				key.back() = material;
+				result.triangles.push_back(key);
+			}
+		}
+		for (auto& child : node.children) {
+			collectTriangles(child, model, positionStep, materials, result);
+		}
+	}
+
+	/**
+	 * @brief How many triangles of two sorted lists match one to one.
+	 */
+	size_t countMatches(const std::vector<TriangleKey>& a, const std::vector<TriangleKey>& b) {
+		size_t matches = 0;
+		auto i = a.begin();
+		auto j = b.begin();
+		while (i != a.end() && j != b.end()) {
+			if (*i < *j) {
+				++i;
+			}
+			else if (*j < *i) {
+				++j;
+			}
+			else {
+				++matches;
+				++i;
+				++j;
+			}
+		}
+		return matches;
+	}
+
+	void benchmarkModel(const std::string& path, bool flipTextureCoords) {
+		// A first import reads the files into the OS cache and decodes the images, which the timed
+		// imports then skip, so that they measure only Assimp and the conversion to meshes.
+		auto warmup = assimpImport(path, flipTextureCoords, {}, ImportProfile::Max);
+		std::unordered_set<std::string> images;
+		for (auto& [image, data] : warmup.images) {
+			images.insert(image);
+		}
+		glm::vec3 minCorner(std::numeric_limits<float>::max());
+		glm::vec3 maxCorner(std::numeric_limits<float>::lowest());
+		measureBounds(warmup.root, glm::mat4(1), minCorner, maxCorner);
+		float size = glm::length(maxCorner - minCorner);
+		float positionStep = std::max(size * POSITION_TOLERANCE, std::numeric_limits<float>::min());
+
+		std::unordered_map<std::string, int64_t> materials;
+		std::vector<ProfileResult> results;
+		for (auto profile : PROFILES) {
+			ProfileResult result;
+			auto model = assimpImport(path, flipTextureCoords, images, profile, &result.timing);
+			collectTriangles(model.root, glm::mat4(1), positionStep, materials, result);
+			std::sort(result.triangles.begin(), result.triangles.end());
+			results.push_back(std::move(result));
+		}
+
+		std::cout << path << std::endl;
+		auto& reference = results.back();
+		const char* cheapestIdentical = nullptr;
+		for (size_t p = 0; p < results.size(); p++) {
+			auto& result = results[p];
+			auto& timing = result.timing;
+			std::cout << std::fixed << std::setprecision(1) << "  " << std::left << std::setw(9)
+				<< (std::string(importProfileName(PROFILES[p])) + ":") << std::right << timing.totalMilliseconds
+				<< " ms (read " << timing.readMilliseconds << ", post-process " << timing.postProcessMilliseconds
+				<< ", convert " << timing.convertMilliseconds << "); " << result.meshCount << " meshes, "
+				<< result.vertexCount << " vertices, " << result.triangles.size() << " triangles";
+			if (p + 1 < results.size()) {
+				auto matches = countMatches(result.triangles, reference.triangles);
+				bool identical = matches == result.triangles.size() && matches == reference.triangles.size();
+				if (identical) {
+					std::cout << ", same triangles as max";
+					if (cheapestIdentical == nullptr) {
+						cheapestIdentical = importProfileName(PROFILES[p]);
+					}
+				}
+				else {
+					std::cout << ", " << result.triangles.size() - matches << " triangles not in max, "
+						<< reference.triangles.size() - matches << " of max's missing";
+				}
+			}
+			std::cout << std::endl << "    ";
+			std::cout << std::setprecision(2);
+			for (auto& step : timing.steps) {
+				std::cout << step.name << " " << step.milliseconds << " ms  ";
+			}
+			std::cout << "welding " << timing.weldMilliseconds << " ms (" << timing.verticesBeforeWeld << " -> "
+				<< timing.verticesAfterWeld << " vertices)" << std::endl;
+		}
+		std::cout << "  cheapest profile with max's triangles: "
+			<< (cheapestIdentical != nullptr ? cheapestIdentical : importProfileName(ImportProfile::Max)) << std::endl;
+	}
+}
+
+void runImportBenchmark(const std::vector<std::string>& modelPaths, bool flipTextureCoords) {
+	for (auto& path : modelPaths) {
+		try {
+			benchmarkModel(path, flipTextureCoords);
+		}
+		catch (std::runtime_error& e) {
+			std::cerr << path << ": " << e.what() << std::endl;
+		}
+	}
+}
@@ -0,0 +1,143 @@
+#include "ImpostorBaker.h"
+#include "Mesh3D.h"
+#include "MeshDraw.h"
+#include "Object3D.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+	/**
+	 * @brief Maps a point of [-1, 1]^2 to a direction on the upper (+y) hemisphere.
+	 */
+	glm::vec3 hemiOctDecode(const glm::vec2& e) {
+		glm::vec2 t = glm::vec2(e.x + e.y, e.x - e.y) * 0.5f;
+		return glm::normalize(glm::vec3(t.x, 1 - std::abs(t.x) - std::abs(t.y), t.y));
+	}
+
+	/**
+	 * @brief The view matrix of a frame looking along -direction at center. Must match
+	 * frameBasis in impostor.frag.
+	 */
+	glm::mat4 frameView(const glm::vec3& direction, const glm::vec3& center) {
+		glm::vec3 worldUp = std::abs(direction.y) > 0.999f ? glm::vec3(0, 0, -1) : glm::vec3(0, 1, 0);
+		glm::vec3 right = glm::normalize(glm::cross(worldUp, direction));
+		glm::vec3 up = glm::cross(direction, right);
+		glm::mat4 view(1);
+		for (int i = 0; i < 3; i++) {
+			view[i] = glm::vec4(right[i], up[i], direction[i], 0);
+		}
+		view[3] = glm::vec4(-glm::dot(right, center), -glm::dot(up, center), -glm::dot(direction, center), 1);
+		return view;
+	}
+
+	uint32_t createAtlas(uint32_t size) {
+		uint32_t texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		return texture;
+	}
+}
+
+ImpostorBaker::ImpostorBaker() {
+	m_bakeProgram.load("shaders/impostor_bake.vert", "shaders/impostor_bake.frag");
+}
+
+Impostor ImpostorBaker::bake(const Object3D& object, uint32_t frames, uint32_t frameSize) {
+	if (frames < 2) {
+		throw std::runtime_error("An impostor needs at least 2x2 frames");
+	}
+
+	// Bake in the object's own space, so that the impostor can be placed with any transform.
+	std::vector<MeshDraw> draws;
+	object.collectDraws(draws);
+	glm::mat4 toObject = object.getTransform().inverseMatrix();
+	glm::vec3 boundsMin(INFINITY), boundsMax(-INFINITY);
+	for (auto& draw : draws) {
+		draw.model = toObject * draw.model;
+		glm::vec3 center = glm::vec3(draw.model * glm::vec4(draw.mesh->getBoundsCenter(), 1));
+		float scale = std::max(glm::length(glm::vec3(draw.model[0])),
+			std::max(glm::length(glm::vec3(draw.model[1])), glm::length(glm::vec3(draw.model[2]))));
+		float radius = draw.mesh->getBoundsRadius() * scale;
+		boundsMin = glm::min(boundsMin, center - radius);
+		boundsMax = glm::max(boundsMax, center + radius);
+	}
+	Impostor impostor{ 0, 0, frames, frameSize, (boundsMin + boundsMax) * 0.5f, 0 };
+	for (auto& draw : draws) {
+		glm::vec3 center = glm::vec3(draw.model * glm::vec4(draw.mesh->getBoundsCenter(), 1));
+		float scale = std::max(glm::length(glm::vec3(draw.model[0])),
+			std::max(glm::length(glm::vec3(draw.model[1])), glm::length(glm::vec3(draw.model[2]))));
+		impostor.radius = std::max(impostor.radius,
+			glm::distance(center, impostor.center) + draw.mesh->getBoundsRadius() * scale);
+	}
+
+	uint32_t atlasSize = frames * frameSize;
+	impostor.albedoTexture = createAtlas(atlasSize);
+	impostor.normalDepthTexture = createAtlas(atlasSize);
+	uint32_t depthBuffer, framebuffer;
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlasSize, atlasSize);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, impostor.albedoTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, impostor.normalDepthTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	const GLenum attachments[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, attachments);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("Impostor framebuffer is incomplete");
+	}
+
+	int32_t previousProgram;
+	int32_t previousViewport[4];
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+	// Empty texels are transparent, face the viewer and lie at the far side of the sphere.
+	const float noAlbedo[] = { 0, 0, 0, 0 };
+	const float noNormal[] = { 0.5f, 0.5f, 1, 1 };
+	const float farDepth = 1.0f;
+	glClearBufferfv(GL_COLOR, 0, noAlbedo);
+	glClearBufferfv(GL_COLOR, 1, noNormal);
+	glClearBufferfv(GL_DEPTH, 0, &farDepth);
+
+	// Each frame sees exactly the bounding sphere, with depth 0 at its near side and 1 at its far side.
+	float r = impostor.radius;
+	m_bakeProgram.activate();
+	m_bakeProgram.setUniform("projection", glm::ortho(-r, r, -r, r, -r, r));
+	for (uint32_t j = 0; j < frames; j++) {
+		for (uint32_t i = 0; i < frames; i++) {
+			glm::vec2 gridPoint = glm::vec2(i, j) / static_cast<float>(frames - 1) * 2.0f - 1.0f;
+			glViewport(i * frameSize, j * frameSize, frameSize, frameSize);
+			m_bakeProgram.setUniform("view", frameView(hemiOctDecode(gridPoint), impostor.center));
+			for (auto& draw : draws) {
+				if (draw.mesh->getAlphaMode() == AlphaMode::Blend) {
+					continue;
+				}
+				m_bakeProgram.setUniform("model", draw.model);
+				m_bakeProgram.setUniform("normalMatrix", normalMatrix(draw.model));
+				draw.mesh->render(m_bakeProgram);
+			}
+		}
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &depthBuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glUseProgram(previousProgram);
+
+	glBindTexture(GL_TEXTURE_2D, impostor.albedoTexture);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, impostor.normalDepthTexture);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return impostor;
+}
@@ -0,0 +1,135 @@
+#include "ImpostorRenderer.h"
+#include "Object3D.h"
+#include <glad/glad.h>
+#include <algorithm>
+
+namespace {
+	// Texture units for the atlases, above those used by mesh textures.
+	const int32_t ALBEDO_UNIT = 11;
+	const int32_t NORMAL_DEPTH_UNIT = 12;
+}
+
+ImpostorRenderer::ImpostorRenderer()
+	: m_vao(0), m_quadBuffer(0), m_instanceBuffer(0), m_instanceCapacity(0),
+	m_ambientColor(0), m_directionalLight(0, 0, -1), m_directionalColor(1), m_instancesDrawn(0) {
+	m_program.load("shaders/impostor.vert", "shaders/impostor.frag");
+
+	const float corners[] = { -1, -1, 1, -1, -1, 1, 1, 1 };
+	glGenVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+	glGenBuffers(1, &m_quadBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_quadBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
+	glEnableVertexAttribArray(0);
+
+	// Per-instance attributes; their pointers are set for each impostor's range in render().
+	glGenBuffers(1, &m_instanceBuffer);
+	for (uint32_t attribute = 1; attribute <= 3; attribute++) {
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribDivisor(attribute, 1);
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+uint32_t ImpostorRenderer::addImpostor(const Impostor& impostor) {
+	m_impostors.push_back(impostor);
+	m_instances.emplace_back();
+	return static_cast<uint32_t>(m_impostors.size() - 1);
+}
+
+glm::vec4 ImpostorRenderer::worldBounds(uint32_t impostor, const Object3D& object) const {
+	auto& baked = m_impostors[impostor];
+	auto& transform = object.getTransform();
+	glm::vec3 center = glm::vec3(transform.toMatrix() * glm::vec4(baked.center, 1));
+	float scale = std::max(std::abs(transform.scale.x), std::max(std::abs(transform.scale.y), std::abs(transform.scale.z)));
+	return glm::vec4(center, baked.radius * scale);
+}
+
+void ImpostorRenderer::setLighting(const glm::vec3& ambientColor, const glm::vec3& directionalLight,
+	const glm::vec3& directionalColor) {
+	m_ambientColor = ambientColor;
+	m_directionalLight = directionalLight;
+	m_directionalColor = directionalColor;
+}
+
+void ImpostorRenderer::clear() {
+	for (auto& instances : m_instances) {
+		instances.clear();
+	}
+}
+
+void ImpostorRenderer::submit(uint32_t impostor, const Object3D& object) {
+	auto& rotation = object.getRotation();
+	m_instances[impostor].push_back(ImpostorInstance{ worldBounds(impostor, object),
+		glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w), object.getMaterial() });
+}
+
+void ImpostorRenderer::render(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos) {
+	// Upload every impostor's instances into one buffer, back to back.
+	size_t total = 0;
+	for (auto& instances : m_instances) {
+		total += instances.size();
+	}
+	m_instancesDrawn = static_cast<uint32_t>(total);
+	if (total == 0) {
+		return;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	if (total > m_instanceCapacity) {
+		m_instanceCapacity = std::max(total, m_instanceCapacity * 2);
+	}
+	glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(ImpostorInstance), nullptr, GL_STREAM_DRAW);
+	size_t offset = 0;
+	for (auto& instances : m_instances) {
+		glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(ImpostorInstance),
+			instances.size() * sizeof(ImpostorInstance), instances.data());
+		offset += instances.size();
+	}
+
+	int32_t previousProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	m_program.activate();
+	m_program.setUniform("view", view);
+	m_program.setUniform("projection", projection);
+	m_program.setUniform("cameraPos", cameraPos);
+	m_program.setUniform("ambientColor", m_ambientColor);
+	m_program.setUniform("directionalLight", m_directionalLight);
+	m_program.setUniform("directionalColor", m_directionalColor);
+	m_program.setUniform("albedoAtlas", ALBEDO_UNIT);
+	m_program.setUniform("normalDepthAtlas", NORMAL_DEPTH_UNIT);
+
+	glBindVertexArray(m_vao);
+	offset = 0;
+	for (size_t i = 0; i < m_impostors.size(); i++) {
+		auto count = m_instances[i].size();
+		if (count == 0) {
+			continue;
+		}
+		auto& impostor = m_impostors[i];
+		m_program.setUniform("frames", static_cast<int32_t>(impostor.frames));
+		m_program.setUniform("frameSize", static_cast<float>(impostor.frameSize));
+		glActiveTexture(GL_TEXTURE0 + ALBEDO_UNIT);
+		glBindTexture(GL_TEXTURE_2D, impostor.albedoTexture);
+		glActiveTexture(GL_TEXTURE0 + NORMAL_DEPTH_UNIT);
+		glBindTexture(GL_TEXTURE_2D, impostor.normalDepthTexture);
+
+		// Without base-instance draws in GL 3.3, point the instance attributes at this range instead.
+		auto base = reinterpret_cast<const void*>(offset * sizeof(ImpostorInstance));
+		for (uint32_t attribute = 1; attribute <= 3; attribute++) {
+			glVertexAttribPointer(attribute, 4, GL_FLOAT, GL_FALSE, sizeof(ImpostorInstance),
+				static_cast<const char*>(base) + (attribute - 1) * sizeof(glm::vec4));
+		}
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(count));
+		offset += count;
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0 + ALBEDO_UNIT);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glUseProgram(previousProgram);
+}
@@ -1,6 +1,9 @@
 #include <iostream>
 #include "Mesh3D.h"
+#include "MeshletCuller.h"
 #include <glad/glad.h>
+#include <algorithm>
+#include <limits>
 
 
 Mesh3D::Mesh3D(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces,
@@ -9,7 +12,11 @@ Mesh3D::Mesh3D(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces,
 }
 
 Mesh3D::Mesh3D(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces, std::vector<Texture>&& textures)
-	: m_vertexCount(vertices.size()), m_faceCount(faces.size()), m_textures(textures) {
+	: m_vertexCount(vertices.size()), m_faceCount(faces.size()), m_textures(textures), m_meshletBuffer(0),
+	m_alphaMode(AlphaMode::Opaque), m_alphaCutoff(0.5f), m_opacity(1) {
+	static_assert(sizeof(Vertex3D) == 32, "Vertex3D must span exactly two RGBA32F texels");
+
+	computeBounds(vertices, m_boundsCenter, m_boundsRadius);
 
 	// Generate a vertex array object on the GPU.
 	glGenVertexArrays(1, &m_vao);
@@ -17,11 +24,10 @@ Mesh3D::Mesh3D(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces,
 	glBindVertexArray(m_vao);
 
 	// Generate a vertex buffer object on the GPU.
-	uint32_t vbo;
-	glGenBuffers(1, &vbo);
+	glGenBuffers(1, &m_vbo);
 
 	// "Bind" the newly-generated vbo, which makes future functions operate on that specific object.
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
 	// This vbo is now associated with m_vao.
 	// Copy the contents of the vertices list to the buffer that lives on the GPU.
 	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex3D), &vertices[0], GL_STATIC_DRAW);
@@ -39,26 +45,132 @@ Mesh3D::Mesh3D(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces,
 
 
 	// Generate a second buffer, to store the indices of each triangle in the mesh.
-	uint32_t ebo;
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glGenBuffers(1, &m_ebo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, faces.size() * sizeof(uint32_t), &faces[0], GL_STATIC_DRAW);
 
 	// Unbind the vertex array, so no one else can accidentally mess with it.
 	glBindVertexArray(0);
+
+	// Expose both buffers to shaders as texture buffers, which share the buffers' storage.
+	glGenTextures(1, &m_vertexTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, m_vertexTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_vbo);
+	glGenTextures(1, &m_indexTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, m_indexTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, m_ebo);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void Mesh3D::computeBounds(const std::vector<Vertex3D>& vertices, glm::vec3& center, float& radius) {
+	glm::vec3 minCorner(std::numeric_limits<float>::max());
+	glm::vec3 maxCorner(std::numeric_limits<float>::lowest());
+	for (auto& v : vertices) {
+		minCorner = glm::min(minCorner, glm::vec3(v.x, v.y, v.z));
+		maxCorner = glm::max(maxCorner, glm::vec3(v.x, v.y, v.z));
+	}
+	center = vertices.empty() ? glm::vec3(0) : (minCorner + maxCorner) * 0.5f;
+	radius = 0;
+	for (auto& v : vertices) {
+		radius = std::max(radius, glm::distance(center, glm::vec3(v.x, v.y, v.z)));
+	}
+}
+
+void Mesh3D::setGeometry(std::vector<Vertex3D>&& vertices, std::vector<uint32_t>&& faces) {
+	computeBounds(vertices, m_boundsCenter, m_boundsRadius);
+	m_vertexCount = vertices.size();
+	m_faceCount = faces.size();
+	// Respecifying the existing buffers keeps the vertex array's bindings and the texture buffer
+	// views valid, since both refer to the buffer objects rather than to their storage.
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+	glBufferData(GL_COPY_WRITE_BUFFER, vertices.size() * sizeof(Vertex3D), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+	glBufferData(GL_COPY_WRITE_BUFFER, faces.size() * sizeof(uint32_t), faces.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	// Meshlets index the old element buffer.
+	m_meshlets.clear();
+}
+
+void Mesh3D::copyGeometry(uint32_t vertexBuffer, uint32_t vertexCount, uint32_t indexBuffer, uint32_t faceCount,
+	const glm::vec3& boundsCenter, float boundsRadius) {
+	m_boundsCenter = boundsCenter;
+	m_boundsRadius = boundsRadius;
+	m_vertexCount = vertexCount;
+	m_faceCount = faceCount;
+	// Binding the source buffers here is also what makes their contents, written by another
+	// context, visible to this one.
+	glBindBuffer(GL_COPY_READ_BUFFER, vertexBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+	glBufferData(GL_COPY_WRITE_BUFFER, vertexCount * sizeof(Vertex3D), nullptr, GL_STATIC_DRAW);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, vertexCount * sizeof(Vertex3D));
+	glBindBuffer(GL_COPY_READ_BUFFER, indexBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+	glBufferData(GL_COPY_WRITE_BUFFER, faceCount * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, faceCount * sizeof(uint32_t));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	m_meshlets.clear();
+}
+
+void Mesh3D::setTextures(std::vector<Texture>&& textures) {
+	m_textures = std::move(textures);
 }
 
 void Mesh3D::addTexture(Texture texture) {
 	m_textures.push_back(texture);
 }
 
-void Mesh3D::render(ShaderProgram& program) const {
-	glBindVertexArray(m_vao);
+void Mesh3D::setAlphaMode(AlphaMode mode, float cutoff) {
+	m_alphaMode = mode;
+	m_alphaCutoff = cutoff;
+}
+
+void Mesh3D::setOpacity(float opacity) {
+	m_opacity = opacity;
+}
+
+void Mesh3D::setMeshlets(std::vector<Meshlet>&& meshlets) {
+	m_meshlets = std::move(meshlets);
+	if (m_meshletBuffer == 0) {
+		glGenBuffers(1, &m_meshletBuffer);
+	}
+	// The buffer is only ever read as a shader storage buffer, but COPY_WRITE_BUFFER is a valid
+	// upload target on contexts that don't support storage buffers.
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_meshletBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, m_meshlets.size() * sizeof(Meshlet), m_meshlets.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void Mesh3D::readGeometry(std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces) const {
+	vertices.assign(m_vertexCount, Vertex3D(0, 0, 0, 0, 0, 0, 0, 0));
+	faces.resize(m_faceCount);
+	glBindBuffer(GL_COPY_READ_BUFFER, m_vbo);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, m_vertexCount * sizeof(Vertex3D), vertices.data());
+	glBindBuffer(GL_COPY_READ_BUFFER, m_ebo);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, m_faceCount * sizeof(uint32_t), faces.data());
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void Mesh3D::bindTextures(ShaderProgram& program) const {
 	for (auto i = 0; i < m_textures.size(); i++) {
 		program.setUniform(m_textures[i].samplerName, i);
 		glActiveTexture(GL_TEXTURE0 + i);
 		glBindTexture(GL_TEXTURE_2D, m_textures[i].textureId);
 	}
+	// A cutoff of 0 never discards anything, so only masked meshes are alpha tested.
+	program.setUniform("opacity", m_opacity);
+	program.setUniform("alphaCutoff", m_alphaMode == AlphaMode::Mask ? m_alphaCutoff : 0.0f);
+}
+
+void Mesh3D::renderGeometry() const {
+	glBindVertexArray(m_vao);
+	glDrawElements(GL_TRIANGLES, m_faceCount, GL_UNSIGNED_INT, nullptr);
+	glBindVertexArray(0);
+}
+
+void Mesh3D::render(ShaderProgram& program) const {
+	glBindVertexArray(m_vao);
+	bindTextures(program);
 
 	// Draw the vertex array, using its "element buffer" to identify the faces.
 	glDrawElements(GL_TRIANGLES, m_faceCount, GL_UNSIGNED_INT, nullptr);
@@ -67,6 +179,37 @@ void Mesh3D::render(ShaderProgram& program) const {
 	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+void Mesh3D::render(ShaderProgram& program, MeshletCuller& culler, const glm::mat4& model) const {
+	if (m_meshlets.empty()) {
+		render(program);
+		return;
+	}
+
+	glBindVertexArray(m_vao);
+	bindTextures(program);
+
+	// Let the culler decide which ranges of the element buffer to draw.
+	culler.drawVisible(*this, model, program);
+
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Mesh3D::renderIndirect(ShaderProgram& program, size_t commandOffset) const {
+	glBindVertexArray(m_vao);
+	bindTextures(program);
+	glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(commandOffset));
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Mesh3D::renderInstanced(ShaderProgram& program, uint32_t instanceCount) const {
+	glBindVertexArray(m_vao);
+	bindTextures(program);
+	glDrawElementsInstanced(GL_TRIANGLES, m_faceCount, GL_UNSIGNED_INT, nullptr, instanceCount);
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
 
 Mesh3D Mesh3D::square(const std::vector<Texture>& textures) {
 	return Mesh3D(
@@ -0,0 +1,179 @@
+#include "Meshlet.h"
+#include "Mesh3D.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+	glm::vec3 positionOf(const Vertex3D& v) {
+		return glm::vec3(v.x, v.y, v.z);
+	}
+
+	/**
+	 * @brief Computes a bounding sphere around the given vertices with Ritter's algorithm.
+	 */
+	void computeBoundingSphere(const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& meshletVertices,
+		Meshlet& meshlet) {
+		// Start from the two points that are farthest apart along the axis of greatest extent.
+		glm::vec3 minPoint[3], maxPoint[3];
+		for (auto axis = 0; axis < 3; axis++) {
+			minPoint[axis] = maxPoint[axis] = positionOf(vertices[meshletVertices[0]]);
+		}
+		for (auto index : meshletVertices) {
+			glm::vec3 p = positionOf(vertices[index]);
+			for (auto axis = 0; axis < 3; axis++) {
+				if (p[axis] < minPoint[axis][axis]) {
+					minPoint[axis] = p;
+				}
+				if (p[axis] > maxPoint[axis][axis]) {
+					maxPoint[axis] = p;
+				}
+			}
+		}
+		int widest = 0;
+		float widestDistance = 0;
+		for (auto axis = 0; axis < 3; axis++) {
+			float d = glm::distance(minPoint[axis], maxPoint[axis]);
+			if (d > widestDistance) {
+				widest = axis;
+				widestDistance = d;
+			}
+		}
+		glm::vec3 center = (minPoint[widest] + maxPoint[widest]) * 0.5f;
+		float radius = widestDistance * 0.5f;
+
+		// Grow the sphere to cover any point left outside of it.
+		for (auto index : meshletVertices) {
+			glm::vec3 p = positionOf(vertices[index]);
+			float d = glm::distance(p, center);
+			if (d > radius) {
+				float newRadius = (radius + d) * 0.5f;
+				center = center + (p - center) * ((newRadius - radius) / d);
+				radius = newRadius;
+			}
+		}
+		meshlet.center = center;
+		meshlet.radius = radius;
+	}
+
+	/**
+	 * @brief Computes the normal cone of the meshlet's triangles, following the approach of
+	 * meshoptimizer: the cone axis is the average triangle normal, and the apex is placed behind
+	 * every triangle's plane so that the test is conservative.
+	 */
+	void computeNormalCone(const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& faces,
+		Meshlet& meshlet) {
+		// A cutoff greater than 1 can never be reached, which disables cone culling.
+		meshlet.coneAxis = glm::vec3(0, 0, 1);
+		meshlet.coneCutoff = 2.0f;
+		meshlet.coneApex = meshlet.center;
+
+		std::vector<glm::vec3> normals;
+		normals.reserve(meshlet.indexCount / 3);
+		glm::vec3 normalSum(0);
+		for (auto i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; i += 3) {
+			glm::vec3 p0 = positionOf(vertices[faces[i]]);
+			glm::vec3 p1 = positionOf(vertices[faces[i + 1]]);
+			glm::vec3 p2 = positionOf(vertices[faces[i + 2]]);
+			glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(n);
+			// Degenerate triangles are invisible from every direction.
+			if (area == 0) {
+				continue;
+			}
+			n = n / area;
+			normals.push_back(n);
+			normalSum += n;
+		}
+
+		float sumLength = glm::length(normalSum);
+		if (normals.empty() || sumLength == 0) {
+			return;
+		}
+		glm::vec3 axis = normalSum / sumLength;
+
+		float minDot = 1;
+		for (auto& n : normals) {
+			minDot = std::min(minDot, glm::dot(axis, n));
+		}
+		// A cone this wide is nearly always partially front-facing; don't bother testing it.
+		if (minDot <= 0.1f) {
+			return;
+		}
+
+		// Move the apex back along the axis until it is behind every triangle's plane.
+		float maxT = 0;
+		size_t normalIndex = 0;
+		for (auto i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; i += 3) {
+			glm::vec3 p0 = positionOf(vertices[faces[i]]);
+			glm::vec3 p1 = positionOf(vertices[faces[i + 1]]);
+			glm::vec3 p2 = positionOf(vertices[faces[i + 2]]);
+			if (glm::length(glm::cross(p1 - p0, p2 - p0)) == 0) {
+				continue;
+			}
+			const glm::vec3& n = normals[normalIndex++];
+			float dc = glm::dot(meshlet.center - p0, n);
+			float dn = glm::dot(axis, n);
+			maxT = std::max(maxT, dc / dn);
+		}
+
+		meshlet.coneAxis = axis;
+		meshlet.coneCutoff = std::sqrt(1 - minDot * minDot);
+		meshlet.coneApex = meshlet.center - axis * maxT;
+	}
+
+	void finishMeshlet(const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& faces,
+		const std::vector<uint32_t>& meshletVertices, Meshlet& meshlet) {
+		meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+		meshlet.padding[0] = meshlet.padding[1] = 0;
+		computeBoundingSphere(vertices, meshletVertices, meshlet);
+		computeNormalCone(vertices, faces, meshlet);
+	}
+}
+
+std::vector<Meshlet> buildMeshlets(const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& faces) {
+	std::vector<Meshlet> meshlets;
+	if (faces.empty()) {
+		return meshlets;
+	}
+
+	// For each vertex, the index of the last meshlet that referenced it. This lets us count a
+	// triangle's new vertices without clearing a lookup table for every meshlet.
+	const uint32_t NONE = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> lastMeshlet(vertices.size(), NONE);
+	std::vector<uint32_t> meshletVertices;
+	meshletVertices.reserve(MAX_MESHLET_VERTICES);
+
+	Meshlet current{};
+	uint32_t currentId = 0;
+
+	for (uint32_t i = 0; i + 2 < faces.size(); i += 3) {
+		uint32_t a = faces[i], b = faces[i + 1], c = faces[i + 2];
+		uint32_t newVertices = (lastMeshlet[a] != currentId)
+			+ (lastMeshlet[b] != currentId && b != a)
+			+ (lastMeshlet[c] != currentId && c != a && c != b);
+
+		// Start a new meshlet if this triangle would overflow the current one.
+		if (meshletVertices.size() + newVertices > MAX_MESHLET_VERTICES
+			|| current.indexCount / 3 + 1 > MAX_MESHLET_TRIANGLES) {
+			finishMeshlet(vertices, faces, meshletVertices, current);
+			meshlets.push_back(current);
+
+			current = Meshlet{};
+			current.indexOffset = i;
+			meshletVertices.clear();
+			++currentId;
+		}
+
+		for (auto v : { a, b, c }) {
+			if (lastMeshlet[v] != currentId) {
+				lastMeshlet[v] = currentId;
+				meshletVertices.push_back(v);
+			}
+		}
+		current.indexCount += 3;
+	}
+
+	finishMeshlet(vertices, faces, meshletVertices, current);
+	meshlets.push_back(current);
+	return meshlets;
+}
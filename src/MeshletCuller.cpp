@@ -0,0 +1,158 @@
+#include "MeshletCuller.h"
+#include "DepthPyramid.h"
+#include "Frustum.h"
+#include "Mesh3D.h"
+#include "Transform.h"
+#include <algorithm>
+#include <string>
+
+namespace {
+	// The texture unit used for the Hi-Z pyramid, far above the units used by mesh textures.
+	const int32_t HI_Z_TEXTURE_UNIT = 15;
+	const uint32_t CULL_GROUP_SIZE = 64;
+}
+
+MeshletCuller::MeshletCuller(bool preferGpu)
+	: m_useGpu(preferGpu && GLAD_GL_VERSION_4_3), m_hasDrawCount(GLAD_GL_VERSION_4_6),
+	m_commandBuffer(0), m_commandCapacity(0), m_countBuffer(0),
+	m_view(1), m_projection(1), m_cameraPos(0), m_depthPyramid(nullptr),
+	m_meshletsTested(0), m_meshletsDrawn(0) {
+	if (m_useGpu) {
+		m_cullProgram.loadCompute("shaders/meshlet_cull.comp");
+		glGenBuffers(1, &m_commandBuffer);
+		glGenBuffers(1, &m_countBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_countBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+}
+
+void MeshletCuller::setView(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos) {
+	m_view = view;
+	m_projection = projection;
+	m_cameraPos = cameraPos;
+}
+
+void MeshletCuller::setDepthPyramid(const DepthPyramid* pyramid) {
+	m_depthPyramid = pyramid;
+}
+
+void MeshletCuller::resetStatistics() {
+	m_meshletsTested = 0;
+	m_meshletsDrawn = 0;
+}
+
+void MeshletCuller::drawVisible(const Mesh3D& mesh, const glm::mat4& model, ShaderProgram& drawProgram) {
+	if (m_useGpu) {
+		drawVisibleGpu(mesh, model, drawProgram);
+	}
+	else {
+		drawVisibleCpu(mesh, model);
+	}
+}
+
+void MeshletCuller::drawVisibleCpu(const Mesh3D& mesh, const glm::mat4& model) {
+	// Test in the mesh's local space: the frustum planes of projection*view*model are local-space
+	// planes, and a back-facing cone stays back-facing under any affine transformation.
+	Frustum frustum = Frustum::fromMatrix(m_projection * m_view * model);
+	glm::vec3 localCamera = glm::vec3(inverseAffine(model) * glm::vec4(m_cameraPos, 1));
+
+	m_counts.clear();
+	m_offsets.clear();
+	uint32_t rangeEnd = 0;
+	for (auto& meshlet : mesh.getMeshlets()) {
+		++m_meshletsTested;
+		if (!frustum.intersectsSphere(meshlet.center, meshlet.radius)) {
+			continue;
+		}
+		if (glm::dot(glm::normalize(meshlet.coneApex - localCamera), meshlet.coneAxis) >= meshlet.coneCutoff) {
+			continue;
+		}
+		++m_meshletsDrawn;
+
+		// Meshlets are contiguous in the index buffer, so neighbouring survivors share one draw.
+		if (!m_counts.empty() && rangeEnd == meshlet.indexOffset) {
+			m_counts.back() += meshlet.indexCount;
+		}
+		else {
+			m_counts.push_back(meshlet.indexCount);
+			m_offsets.push_back(reinterpret_cast<const void*>(
+				static_cast<uintptr_t>(meshlet.indexOffset) * sizeof(uint32_t)));
+		}
+		rangeEnd = meshlet.indexOffset + meshlet.indexCount;
+	}
+
+	if (!m_counts.empty()) {
+		glMultiDrawElements(GL_TRIANGLES, m_counts.data(), GL_UNSIGNED_INT, m_offsets.data(),
+			static_cast<GLsizei>(m_counts.size()));
+	}
+}
+
+void MeshletCuller::drawVisibleGpu(const Mesh3D& mesh, const glm::mat4& model, ShaderProgram& drawProgram) {
+	auto meshletCount = static_cast<uint32_t>(mesh.getMeshlets().size());
+	m_meshletsTested += meshletCount;
+
+	// Grow the shared command buffer to fit the largest mesh seen so far.
+	if (meshletCount > m_commandCapacity) {
+		m_commandCapacity = meshletCount;
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, m_commandCapacity * sizeof(DrawElementsIndirectCommand),
+			nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	// Reset the draw count. Without a GPU-side draw count we draw every slot, so unused slots
+	// must hold empty commands.
+	uint32_t zero = 0;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_countBuffer);
+	glClearBufferData(GL_COPY_WRITE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	if (!m_hasDrawCount) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandBuffer);
+		glClearBufferData(GL_COPY_WRITE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glm::mat4 modelView = m_view * model;
+	Frustum frustum = Frustum::fromMatrix(m_projection * modelView);
+	glm::vec3 localCamera = glm::vec3(inverseAffine(model) * glm::vec4(m_cameraPos, 1));
+	float modelScale = std::max(glm::length(glm::vec3(modelView[0])),
+		std::max(glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))));
+
+	m_cullProgram.activate();
+	m_cullProgram.setUniform("meshletCount", meshletCount);
+	for (auto i = 0; i < 6; i++) {
+		m_cullProgram.setUniform("frustumPlanes[" + std::to_string(i) + "]", frustum.planes[i]);
+	}
+	m_cullProgram.setUniform("localCameraPos", localCamera);
+	m_cullProgram.setUniform("modelView", modelView);
+	m_cullProgram.setUniform("projection", m_projection);
+	m_cullProgram.setUniform("modelScale", modelScale);
+
+	bool useOcclusion = m_depthPyramid != nullptr && m_depthPyramid->isBuilt();
+	m_cullProgram.setUniform("useOcclusion", useOcclusion);
+	if (useOcclusion) {
+		glActiveTexture(GL_TEXTURE0 + HI_Z_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, m_depthPyramid->texture());
+		m_cullProgram.setUniform("depthPyramid", HI_Z_TEXTURE_UNIT);
+		m_cullProgram.setUniform("pyramidSize", glm::vec2(m_depthPyramid->width(), m_depthPyramid->height()));
+		m_cullProgram.setUniform("pyramidLevels", static_cast<int32_t>(m_depthPyramid->levels()));
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mesh.getMeshletBuffer());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_countBuffer);
+	glDispatchCompute((meshletCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+	drawProgram.activate();
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	if (m_hasDrawCount) {
+		glBindBuffer(GL_PARAMETER_BUFFER, m_countBuffer);
+		glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0, meshletCount, 0);
+		glBindBuffer(GL_PARAMETER_BUFFER, 0);
+	}
+	else {
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, meshletCount, 0);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
@@ -0,0 +1,126 @@
+#include "MjpegVideo.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+	/**
+	 * @brief Returns the end of the JPEG image that starts with the SOI marker at start, or 0 if
+	 * the image is truncated or malformed. Segments are skipped by their lengths, so thumbnails
+	 * embedded in metadata don't end the image early.
+	 */
+	size_t findImageEnd(const std::vector<uint8_t>& data, size_t start) {
+		size_t pos = start + 2;
+		while (pos + 1 < data.size()) {
+			if (data[pos] != 0xFF) {
+				return 0;
+			}
+			uint8_t marker = data[pos + 1];
+			if (marker == 0xFF) {
+				// Fill byte before a marker.
+				pos++;
+				continue;
+			}
+			if (marker == 0xD9) {
+				return pos + 2;
+			}
+			if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+				pos += 2;
+				continue;
+			}
+			if (pos + 3 >= data.size()) {
+				return 0;
+			}
+			size_t length = (static_cast<size_t>(data[pos + 2]) << 8) | data[pos + 3];
+			pos += 2 + length;
+			if (marker == 0xDA) {
+				// Entropy-coded data runs to the next marker other than a stuffed zero or a restart.
+				while (pos + 1 < data.size() && !(data[pos] == 0xFF && data[pos + 1] != 0x00
+					&& !(data[pos + 1] >= 0xD0 && data[pos + 1] <= 0xD7))) {
+					pos++;
+				}
+			}
+		}
+		return 0;
+	}
+}
+
+MjpegVideo::MjpegVideo(const std::string& path, float frameRate) : m_width(0), m_height(0), m_frameRate(frameRate) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Could not open video " + path);
+	}
+	m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	size_t pos = 0;
+	while (pos + 1 < m_data.size()) {
+		if (m_data[pos] != 0xFF || m_data[pos + 1] != 0xD8) {
+			pos++;
+			continue;
+		}
+		size_t end = findImageEnd(m_data, pos);
+		if (end == 0) {
+			// Resynchronize on the next start of image.
+			pos += 2;
+			continue;
+		}
+		m_frames.push_back(FrameRange{ pos, end - pos });
+		pos = end;
+	}
+	if (m_frames.empty()) {
+		throw std::runtime_error("No JPEG frames in video " + path);
+	}
+
+	int32_t width, height, channels;
+	if (!stbi_info_from_memory(m_data.data() + m_frames[0].offset, static_cast<int32_t>(m_frames[0].size),
+		&width, &height, &channels)) {
+		throw std::runtime_error("Could not read the first frame of video " + path);
+	}
+	m_width = static_cast<uint32_t>(width);
+	m_height = static_cast<uint32_t>(height);
+}
+
+bool MjpegVideo::decode(uint32_t frame, uint32_t reduction, uint8_t* output) const {
+	auto& range = m_frames[frame];
+	int32_t width, height, channels;
+	uint8_t* pixels = stbi_load_from_memory(m_data.data() + range.offset, static_cast<int32_t>(range.size),
+		&width, &height, &channels, 4);
+	if (pixels == nullptr) {
+		return false;
+	}
+	if (static_cast<uint32_t>(width) != m_width || static_cast<uint32_t>(height) != m_height) {
+		stbi_image_free(pixels);
+		return false;
+	}
+
+	uint32_t outWidth = reducedSize(m_width, reduction);
+	uint32_t outHeight = reducedSize(m_height, reduction);
+	if (reduction == 1) {
+		std::copy(pixels, pixels + static_cast<size_t>(m_width) * m_height * 4, output);
+	}
+	else {
+		for (uint32_t y = 0; y < outHeight; y++) {
+			for (uint32_t x = 0; x < outWidth; x++) {
+				uint32_t sum[4] = { 0, 0, 0, 0 };
+				uint32_t count = 0;
+				for (uint32_t j = y * reduction; j < std::min((y + 1) * reduction, m_height); j++) {
+					for (uint32_t i = x * reduction; i < std::min((x + 1) * reduction, m_width); i++) {
+						const uint8_t* texel = pixels + (static_cast<size_t>(j) * m_width + i) * 4;
+						for (uint32_t c = 0; c < 4; c++) {
+							sum[c] += texel[c];
+						}
+						count++;
+					}
+				}
+				uint8_t* out = output + (static_cast<size_t>(y) * outWidth + x) * 4;
+				for (uint32_t c = 0; c < 4; c++) {
+					out[c] = static_cast<uint8_t>((sum[c] + count / 2) / count);
+				}
+			}
+		}
+	}
+	stbi_image_free(pixels);
+	return true;
+}
@@ -0,0 +1,250 @@
+#include "MultiViewRenderer.h"
+#include "Mesh3D.h"
+#include "RadixSort.h"
+#include "ReflectionProbes.h"
+#include "RenderQueue.h"
+#include "Transform.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+	// Views whose eyes are closer than this share specular lighting, and so can be instanced.
+	const float EYE_TOLERANCE = 0.1f;
+
+	glm::vec4 worldSphere(const MeshDraw& draw) {
+		glm::vec3 center = glm::vec3(draw.model * glm::vec4(draw.mesh->getBoundsCenter(), 1));
+		float scale = std::max(glm::length(glm::vec3(draw.model[0])),
+			std::max(glm::length(glm::vec3(draw.model[1])), glm::length(glm::vec3(draw.model[2]))));
+		return glm::vec4(center, draw.mesh->getBoundsRadius() * scale);
+	}
+}
+
+MultiViewRenderer::MultiViewRenderer()
+	: m_combinedMin(0), m_combinedMax(0), m_ambientColor(0), m_directionalLight(0, 0, -1),
+	m_directionalColor(1), m_reflectionProbes(nullptr), m_drawsTested(0), m_viewDraws(0), m_drawCalls(0) {
+	m_program.load("shaders/multiview.vert", "shaders/lighting.frag");
+}
+
+void MultiViewRenderer::setViews(const std::vector<RenderView>& views) {
+	if (views.size() > MAX_VIEWS) {
+		throw std::runtime_error("MultiViewRenderer supports at most " + std::to_string(MAX_VIEWS) + " views");
+	}
+	m_views = views;
+
+	// The combined volume is the box around the corners of every view's frustum.
+	m_frustums.clear();
+	m_combinedMin = glm::vec3(std::numeric_limits<float>::max());
+	m_combinedMax = glm::vec3(-std::numeric_limits<float>::max());
+	for (auto& view : m_views) {
+		glm::mat4 viewProjection = view.projection * view.view;
+		m_frustums.push_back(Frustum::fromMatrix(viewProjection));
+		glm::mat4 inverse = glm::inverse(viewProjection);
+		for (auto corner = 0; corner < 8; corner++) {
+			glm::vec4 ndc((corner & 1) ? 1 : -1, (corner & 2) ? 1 : -1, (corner & 4) ? 1 : -1, 1);
+			glm::vec4 world = inverse * ndc;
+			glm::vec3 point = glm::vec3(world) / world.w;
+			m_combinedMin = glm::min(m_combinedMin, point);
+			m_combinedMax = glm::max(m_combinedMax, point);
+		}
+	}
+	buildGroups();
+}
+
+void MultiViewRenderer::setLighting(const glm::vec3& ambientColor, const glm::vec3& directionalLight,
+	const glm::vec3& directionalColor) {
+	m_ambientColor = ambientColor;
+	m_directionalLight = directionalLight;
+	m_directionalColor = directionalColor;
+}
+
+void MultiViewRenderer::setReflectionProbes(const ReflectionProbes* probes) {
+	m_reflectionProbes = probes;
+}
+
+void MultiViewRenderer::buildGroups() {
+	m_groups.clear();
+	for (uint32_t i = 0; i < m_views.size(); i++) {
+		auto& view = m_views[i];
+		auto group = std::find_if(m_groups.begin(), m_groups.end(), [&](const ViewGroup& g) {
+			auto& first = m_views[g.views.front()];
+			return g.views.size() < MAX_INSTANCED_VIEWS && first.framebuffer == view.framebuffer
+				&& glm::distance(first.position, view.position) < EYE_TOLERANCE;
+		});
+		if (group == m_groups.end()) {
+			m_groups.push_back(ViewGroup{ { i }, view.viewport });
+			continue;
+		}
+		// The group draws into the rectangle around all of its views.
+		glm::ivec2 low = glm::min(glm::ivec2(group->viewport), glm::ivec2(view.viewport));
+		glm::ivec2 high = glm::max(glm::ivec2(group->viewport) + glm::ivec2(group->viewport.z, group->viewport.w),
+			glm::ivec2(view.viewport) + glm::ivec2(view.viewport.z, view.viewport.w));
+		group->viewport = glm::ivec4(low, high - low);
+		group->views.push_back(i);
+	}
+}
+
+void MultiViewRenderer::cullBucket(const std::vector<MeshDraw>& draws, std::vector<VisibleDraw>& visible) {
+	visible.clear();
+	for (auto& draw : draws) {
+		++m_drawsTested;
+		glm::vec4 sphere = worldSphere(draw);
+		glm::vec3 center(sphere);
+		// Anything outside the combined volume is outside every view, and costs one test.
+		glm::vec3 closest = glm::clamp(center, m_combinedMin, m_combinedMax);
+		if (glm::dot(closest - center, closest - center) > sphere.w * sphere.w) {
+			continue;
+		}
+		uint32_t mask = 0;
+		for (uint32_t v = 0; v < m_frustums.size(); v++) {
+			if (m_frustums[v].intersectsSphere(center, sphere.w)) {
+				mask |= 1u << v;
+			}
+		}
+		if (mask != 0) {
+			visible.push_back(VisibleDraw{ draw, mask });
+			for (auto bits = mask; bits != 0; bits &= bits - 1) {
+				++m_viewDraws;
+			}
+		}
+	}
+}
+
+void MultiViewRenderer::cull(const RenderQueue& queue) {
+	m_drawsTested = 0;
+	m_viewDraws = 0;
+	cullBucket(queue.getOpaque(), m_opaque);
+	cullBucket(queue.getMasked(), m_masked);
+	cullBucket(queue.getBlended(), m_blended);
+	sortBlended();
+}
+
+void MultiViewRenderer::sortBlended() {
+	if (m_views.empty()) {
+		return;
+	}
+	// One order serves every view; it is exact for views that share an eye.
+	glm::vec3 eye(0);
+	for (auto& view : m_views) {
+		eye = eye + view.position;
+	}
+	eye = eye / static_cast<float>(m_views.size());
+
+	auto count = static_cast<uint32_t>(m_blended.size());
+	m_sortKeys.resize(count);
+	m_sortOrder.resize(count);
+	for (uint32_t i = 0; i < count; i++) {
+		auto& draw = m_blended[i].draw;
+		glm::vec3 center = glm::vec3(draw.model * glm::vec4(draw.mesh->getBoundsCenter(), 1));
+		// Negated, so that ascending keys are farthest first.
+		m_sortKeys[i] = floatToSortableKey(-glm::distance(center, eye));
+		m_sortOrder[i] = i;
+	}
+	radixSort(m_sortKeys, m_sortOrder, m_scratchKeys, m_scratchOrder);
+
+	m_sorted.clear();
+	for (auto index : m_sortOrder) {
+		m_sorted.push_back(m_blended[index]);
+	}
+	std::swap(m_blended, m_sorted);
+}
+
+void MultiViewRenderer::render() {
+	m_drawCalls = 0;
+	if (m_views.empty()) {
+		return;
+	}
+	int32_t previousProgram;
+	int32_t previousFramebuffer;
+	int32_t previousViewport[4];
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+	m_program.activate();
+	m_program.setUniform("ambientColor", m_ambientColor);
+	m_program.setUniform("directionalLight", m_directionalLight);
+	m_program.setUniform("directionalColor", m_directionalColor);
+	m_program.setUniform("weightedOit", false);
+	for (auto i = 0; i < 4; i++) {
+		glEnable(GL_CLIP_DISTANCE0 + i);
+	}
+	for (auto& group : m_groups) {
+		renderGroup(group);
+	}
+	for (auto i = 0; i < 4; i++) {
+		glDisable(GL_CLIP_DISTANCE0 + i);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glUseProgram(previousProgram);
+}
+
+void MultiViewRenderer::renderGroup(const ViewGroup& group) {
+	auto& first = m_views[group.views.front()];
+	glBindFramebuffer(GL_FRAMEBUFFER, first.framebuffer);
+
+	// Clear only the views' own rectangles; other views may share the framebuffer.
+	glEnable(GL_SCISSOR_TEST);
+	for (auto index : group.views) {
+		auto& viewport = m_views[index].viewport;
+		glScissor(viewport.x, viewport.y, viewport.z, viewport.w);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+	glDisable(GL_SCISSOR_TEST);
+
+	glViewport(group.viewport.x, group.viewport.y, group.viewport.z, group.viewport.w);
+	for (uint32_t i = 0; i < group.views.size(); i++) {
+		auto& view = m_views[group.views[i]];
+		// Maps the view's NDC onto its rectangle within the group's viewport.
+		glm::vec2 scale = glm::vec2(view.viewport.z, view.viewport.w) / glm::vec2(group.viewport.z, group.viewport.w);
+		glm::vec2 offset = (2.0f * glm::vec2(view.viewport.x - group.viewport.x, view.viewport.y - group.viewport.y)
+			+ glm::vec2(view.viewport.z, view.viewport.w)) / glm::vec2(group.viewport.z, group.viewport.w) - 1.0f;
+		auto index = std::to_string(i);
+		m_program.setUniform("viewProjections[" + index + "]", view.projection * view.view);
+		m_program.setUniform("viewportTransforms[" + index + "]", glm::vec4(scale, offset));
+	}
+	m_program.setUniform("viewPos", first.position);
+	if (m_reflectionProbes != nullptr) {
+		m_reflectionProbes->apply(m_program, first.position);
+	}
+	else {
+		ReflectionProbes::disable(m_program);
+	}
+
+	renderBucket(group, m_opaque);
+	renderBucket(group, m_masked);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_FALSE);
+	renderBucket(group, m_blended);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+}
+
+void MultiViewRenderer::renderBucket(const ViewGroup& group, const std::vector<VisibleDraw>& draws) {
+	auto instanceCount = static_cast<uint32_t>(group.views.size());
+	for (auto& visible : draws) {
+		// Translate the draw's mask from view indices to instance indices within the group.
+		uint32_t groupMask = 0;
+		for (uint32_t i = 0; i < instanceCount; i++) {
+			if (visible.viewMask & (1u << group.views[i])) {
+				groupMask |= 1u << i;
+			}
+		}
+		if (groupMask == 0) {
+			continue;
+		}
+		auto& draw = visible.draw;
+		m_program.setUniform("viewMask", groupMask);
+		m_program.setUniform("material", draw.material);
+		m_program.setUniform("model", draw.model);
+		m_program.setUniform("normalMatrix", normalMatrix(draw.model));
+		draw.mesh->renderInstanced(m_program, instanceCount);
+		++m_drawCalls;
+	}
+}
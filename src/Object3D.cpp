@@ -1,17 +1,10 @@
 #include "Object3D.h"
 #include "ShaderProgram.h"
 #include <glm/ext.hpp>
+#include <algorithm>
 
 glm::mat4 Object3D::buildModelMatrix() const {
-	auto m = glm::translate(glm::mat4(1), m_position);
-	m = glm::translate(m, m_center * m_scale);
-	m = glm::rotate(m, m_orientation[2], glm::vec3(0, 0, 1));
-	m = glm::rotate(m, m_orientation[0], glm::vec3(1, 0, 0));
-	m = glm::rotate(m, m_orientation[1], glm::vec3(0, 1, 0));
-	m = glm::scale(m, m_scale);
-	m = glm::translate(m, -m_center);
-	m = m * m_baseTransform;
-	return m;
+	return m_transform.toMatrix() * m_baseTransform;
 }
 
 Object3D::Object3D(std::vector<Mesh3D>&& meshes)
@@ -19,28 +12,35 @@ Object3D::Object3D(std::vector<Mesh3D>&& meshes)
 }
 
 Object3D::Object3D(std::vector<Mesh3D>&& meshes, const glm::mat4& baseTransform)
-	: m_meshes(meshes), m_position(), m_orientation(), m_scale(1.0),
-	m_center(), m_baseTransform(baseTransform), m_material(0.1, 1.0, 0.3, 4)
+	: m_meshes(meshes), m_transform(), m_baseTransform(baseTransform), m_transformVersion(0),
+	m_material(0.1, 1.0, 0.3, 4)
 {
 }
 
 const glm::vec3& Object3D::getPosition() const {
-	return m_position;
+	return m_transform.translation;
 }
 
-const glm::vec3& Object3D::getOrientation() const {
-	return m_orientation;
+/**
+ * @brief Gets the object's rotation as Euler angles, in the order applied by setOrientation.
+ */
+glm::vec3 Object3D::getOrientation() const {
+	return Transform::quatToEuler(m_transform.rotation);
+}
+
+const glm::quat& Object3D::getRotation() const {
+	return m_transform.rotation;
 }
 
 const glm::vec3& Object3D::getScale() const {
-	return m_scale;
+	return m_transform.scale;
 }
 
 /**
  * @brief Gets the center of the object's rotation.
  */
 const glm::vec3& Object3D::getCenter() const {
-	return m_center;
+	return m_transform.pivot;
 }
 
 const std::string& Object3D::getName() const {
@@ -51,6 +51,22 @@ const glm::vec4& Object3D::getMaterial() const {
 	return m_material;
 }
 
+const Transform& Object3D::getTransform() const {
+	return m_transform;
+}
+
+const glm::mat4& Object3D::getBaseTransform() const {
+	return m_baseTransform;
+}
+
+std::vector<Mesh3D>& Object3D::getMeshes() {
+	return m_meshes;
+}
+
+const std::vector<Mesh3D>& Object3D::getMeshes() const {
+	return m_meshes;
+}
+
 size_t Object3D::numberOfChildren() const {
 	return m_children.size();
 }
@@ -64,15 +80,26 @@ Object3D& Object3D::getChild(size_t index) {
 }
 
 void Object3D::setPosition(const glm::vec3& position) {
-	m_position = position;
+	m_transform.translation = position;
+	++m_transformVersion;
 }
 
+/**
+ * @brief Sets the object's rotation from Euler angles, applied around Y, then X, then Z.
+ */
 void Object3D::setOrientation(const glm::vec3& orientation) {
-	m_orientation = orientation;
+	m_transform.rotation = Transform::eulerToQuat(orientation);
+	++m_transformVersion;
+}
+
+void Object3D::setRotation(const glm::quat& rotation) {
+	m_transform.rotation = rotation;
+	++m_transformVersion;
 }
 
 void Object3D::setScale(const glm::vec3& scale) {
-	m_scale = scale;
+	m_transform.scale = scale;
+	++m_transformVersion;
 }
 
 /**
@@ -81,51 +108,116 @@ void Object3D::setScale(const glm::vec3& scale) {
  */
 void Object3D::setCenter(const glm::vec3& center)
 {
-	m_center = center;
+	m_transform.pivot = center;
+	++m_transformVersion;
 }
 
 void Object3D::setName(const std::string& name) {
 	m_name = name;
 }
 
+void Object3D::setBaseTransform(const glm::mat4& baseTransform) {
+	m_baseTransform = baseTransform;
+	++m_transformVersion;
+}
+
 void Object3D::setMaterial(const glm::vec4& material) {
 	m_material = material;
 }
 
+void Object3D::setTransform(const Transform& transform) {
+	m_transform = transform;
+	++m_transformVersion;
+}
+
 void Object3D::move(const glm::vec3& offset) {
-	m_position = m_position + offset;
+	m_transform.translation = m_transform.translation + offset;
+	++m_transformVersion;
 }
 
+/**
+ * @brief Rotates the object by the given Euler angles, relative to its current orientation.
+ * For rotations around a single axis this is the same as adding to the angles.
+ */
 void Object3D::rotate(const glm::vec3& rotation) {
-	m_orientation = m_orientation + rotation;
+	m_transform.rotation = glm::normalize(m_transform.rotation * Transform::eulerToQuat(rotation));
+	++m_transformVersion;
 }
 
 void Object3D::grow(const glm::vec3& growth) {
-	m_scale = m_scale * growth;
+	m_transform.scale = m_transform.scale * growth;
+	++m_transformVersion;
 }
 
 void Object3D::addChild(Object3D&& child) {
 	m_children.emplace_back(child);
 }
 
-void Object3D::render(ShaderProgram& shaderProgram) const {
-	renderRecursive(shaderProgram, glm::mat4(1));
+/**
+ * @brief Takes the meshes, base transform and children of another object, such as a new import of
+ * the same model, keeping this object's transform, material and name. Only the first
+ * replacedChildren children are replaced; those added after them are kept.
+ */
+void Object3D::replaceContents(Object3D&& other, size_t replacedChildren) {
+	m_meshes = std::move(other.m_meshes);
+	m_baseTransform = other.m_baseTransform;
+	replacedChildren = std::min(replacedChildren, m_children.size());
+	m_children.erase(m_children.begin(), m_children.begin() + replacedChildren);
+	m_children.insert(m_children.begin(), std::make_move_iterator(other.m_children.begin()),
+		std::make_move_iterator(other.m_children.end()));
+	++m_transformVersion;
+}
+
+uint64_t Object3D::transformVersion() const {
+	// Versions only ever increase, so the sum changes whenever any of them does.
+	uint64_t version = m_transformVersion;
+	for (auto& child : m_children) {
+		version += child.transformVersion();
+	}
+	return version;
+}
+
+void Object3D::render(ShaderProgram& shaderProgram, MeshletCuller* culler) const {
+	renderRecursive(shaderProgram, glm::mat4(1), culler);
 }
 
 /**
  * @brief Renders the object and its children, recursively.
  * @param parentMatrix the model matrix of this object's parent in the model hierarchy.
+ * @param culler if not null, culls the meshlets of each mesh before drawing.
  */
-void Object3D::renderRecursive(ShaderProgram& shaderProgram, const glm::mat4& parentMatrix) const {
+void Object3D::renderRecursive(ShaderProgram& shaderProgram, const glm::mat4& parentMatrix,
+	MeshletCuller* culler) const {
 	// This object's true model matrix is the combination of its parent's matrix and the object's matrix.
 	glm::mat4 trueModel = parentMatrix * buildModelMatrix();
 	shaderProgram.setUniform("model", trueModel);
+	shaderProgram.setUniform("normalMatrix", normalMatrix(trueModel));
 	// Render each mesh in the object.
 	for (auto& mesh : m_meshes) {
-		mesh.render(shaderProgram);
+		if (culler != nullptr) {
+			mesh.render(shaderProgram, *culler, trueModel);
+		}
+		else {
+			mesh.render(shaderProgram);
+		}
 	}
 	// Render the children of the object.
 	for (auto& child : m_children) {
-		child.renderRecursive(shaderProgram, trueModel);
+		child.renderRecursive(shaderProgram, trueModel, culler);
+	}
+}
+
+void Object3D::collectDraws(std::vector<MeshDraw>& draws) const {
+	collectDrawsRecursive(draws, glm::mat4(1), m_material);
+}
+
+void Object3D::collectDrawsRecursive(std::vector<MeshDraw>& draws, const glm::mat4& parentMatrix,
+	const glm::vec4& material) const {
+	glm::mat4 trueModel = parentMatrix * buildModelMatrix();
+	for (auto& mesh : m_meshes) {
+		draws.push_back(MeshDraw{ &mesh, trueModel, material });
+	}
+	for (auto& child : m_children) {
+		child.collectDrawsRecursive(draws, trueModel, material);
 	}
 }
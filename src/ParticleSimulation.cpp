@@ -0,0 +1,121 @@
+#include "ParticleSimulation.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ARCADE_PARTICLES_SSE2 1
+#endif
+
+namespace {
+	const float TWO_PI = 6.28318531f;
+
+	float random01(uint32_t particle, uint32_t seed, uint32_t stream) {
+		return particleHash(particle * 4 + stream + particleHash(seed)) * (1.0f / 4294967296.0f);
+	}
+
+	void respawn(ParticleArrays& p, uint32_t i, const ParticleSpawn& spawn, uint32_t seed) {
+		// A random direction within the cone: the direction plus a random point of a disk
+		// perpendicular to it.
+		glm::vec3 helper = std::abs(spawn.direction.y) < 0.99f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+		glm::vec3 tangent = glm::normalize(glm::cross(spawn.direction, helper));
+		glm::vec3 bitangent = glm::cross(spawn.direction, tangent);
+		float angle = TWO_PI * random01(i, seed, 0);
+		float radius = spawn.spread * std::sqrt(random01(i, seed, 1));
+		glm::vec3 direction = glm::normalize(spawn.direction
+			+ (tangent * std::cos(angle) + bitangent * std::sin(angle)) * radius);
+		glm::vec3 velocity = direction * (spawn.speed * (0.75f + 0.5f * random01(i, seed, 2)));
+
+		p.age[i] = std::max(0.0f, p.age[i] - p.lifetime[i]);
+		p.lifetime[i] = spawn.lifetime * (0.75f + 0.5f * random01(i, seed, 3));
+		p.positionX[i] = spawn.position.x;
+		p.positionY[i] = spawn.position.y;
+		p.positionZ[i] = spawn.position.z;
+		p.velocityX[i] = velocity.x;
+		p.velocityY[i] = velocity.y;
+		p.velocityZ[i] = velocity.z;
+	}
+}
+
+void ParticleArrays::resize(size_t count) {
+	for (auto array : { &positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ, &age, &lifetime }) {
+		array->resize(count);
+	}
+}
+
+uint32_t particleHash(uint32_t value) {
+	uint32_t state = value * 747796405u + 2891336453u;
+	uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+void initializeParticles(ParticleArrays& particles, uint32_t first, uint32_t count, float lifetime) {
+	for (uint32_t i = 0; i < count; i++) {
+		// A lifetime of 0 makes each particle spawn as soon as its age reaches 0.
+		particles.age[first + i] = -lifetime * (i + 1) / count;
+		particles.lifetime[first + i] = 0;
+		particles.positionX[first + i] = particles.positionY[first + i] = particles.positionZ[first + i] = 0;
+		particles.velocityX[first + i] = particles.velocityY[first + i] = particles.velocityZ[first + i] = 0;
+	}
+}
+
+bool particleSimdAvailable() {
+#ifdef ARCADE_PARTICLES_SSE2
+	return true;
+#else
+	return false;
+#endif
+}
+
+void simulateParticles(ParticleArrays& particles, uint32_t first, uint32_t count, const ParticleSpawn& spawn,
+	float dt, uint32_t seed, bool useSimd) {
+	float damping = std::max(0.0f, 1.0f - spawn.drag * dt);
+	glm::vec3 gravityStep = spawn.gravity * dt;
+	uint32_t i = first;
+	uint32_t end = first + count;
+#ifdef ARCADE_PARTICLES_SSE2
+	if (useSimd) {
+		// Integrate four particles at a time, whether alive or not: particles that are not born
+		// yet are never drawn, and respawning resets everything that drifted. Only the respawns,
+		// rare in any one frame, are handled one by one.
+		const __m128 dtVector = _mm_set1_ps(dt);
+		const __m128 dampingVector = _mm_set1_ps(damping);
+		const __m128 gravityX = _mm_set1_ps(gravityStep.x);
+		const __m128 gravityY = _mm_set1_ps(gravityStep.y);
+		const __m128 gravityZ = _mm_set1_ps(gravityStep.z);
+		for (; i + 4 <= end; i += 4) {
+			__m128 age = _mm_add_ps(_mm_loadu_ps(&particles.age[i]), dtVector);
+			_mm_storeu_ps(&particles.age[i], age);
+
+			__m128 vx = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&particles.velocityX[i]), gravityX), dampingVector);
+			__m128 vy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&particles.velocityY[i]), gravityY), dampingVector);
+			__m128 vz = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&particles.velocityZ[i]), gravityZ), dampingVector);
+			_mm_storeu_ps(&particles.velocityX[i], vx);
+			_mm_storeu_ps(&particles.velocityY[i], vy);
+			_mm_storeu_ps(&particles.velocityZ[i], vz);
+			_mm_storeu_ps(&particles.positionX[i], _mm_add_ps(_mm_loadu_ps(&particles.positionX[i]), _mm_mul_ps(vx, dtVector)));
+			_mm_storeu_ps(&particles.positionY[i], _mm_add_ps(_mm_loadu_ps(&particles.positionY[i]), _mm_mul_ps(vy, dtVector)));
+			_mm_storeu_ps(&particles.positionZ[i], _mm_add_ps(_mm_loadu_ps(&particles.positionZ[i]), _mm_mul_ps(vz, dtVector)));
+
+			int dead = _mm_movemask_ps(_mm_cmpge_ps(age, _mm_loadu_ps(&particles.lifetime[i])));
+			for (uint32_t lane = 0; dead != 0; lane++, dead >>= 1) {
+				if (dead & 1) {
+					respawn(particles, i + lane, spawn, seed);
+				}
+			}
+		}
+	}
+#endif
+	for (; i < end; i++) {
+		particles.age[i] += dt;
+		particles.velocityX[i] = (particles.velocityX[i] + gravityStep.x) * damping;
+		particles.velocityY[i] = (particles.velocityY[i] + gravityStep.y) * damping;
+		particles.velocityZ[i] = (particles.velocityZ[i] + gravityStep.z) * damping;
+		particles.positionX[i] += particles.velocityX[i] * dt;
+		particles.positionY[i] += particles.velocityY[i] * dt;
+		particles.positionZ[i] += particles.velocityZ[i] * dt;
+		if (particles.age[i] >= particles.lifetime[i]) {
+			respawn(particles, i, spawn, seed);
+		}
+	}
+}
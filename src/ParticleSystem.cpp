@@ -0,0 +1,260 @@
+#include "ParticleSystem.h"
+#include "Object3D.h"
+#include "RadixSort.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+static_assert(sizeof(ParticleSystem::GpuParticle) == 32, "GpuParticle must match particle_simulate.comp");
+
+namespace {
+	const uint32_t SIMULATE_GROUP_SIZE = 256;
+	// Longer frames (a breakpoint, a window drag) are simulated as this long, so that bursts of
+	// particles don't all respawn at once.
+	const float MAX_STEP = 0.1f;
+
+	ParticleSystem::GpuParticle pack(const ParticleArrays& particles, uint32_t i) {
+		return ParticleSystem::GpuParticle{
+			glm::vec4(particles.positionX[i], particles.positionY[i], particles.positionZ[i], particles.age[i]),
+			glm::vec4(particles.velocityX[i], particles.velocityY[i], particles.velocityZ[i], particles.lifetime[i])
+		};
+	}
+}
+
+ParticleSystem::ParticleSystem(bool preferGpu)
+	: m_density(1), m_layoutChanged(false), m_gpuSupported(preferGpu && GLAD_GL_VERSION_4_3),
+	m_useSimd(particleSimdAvailable()), m_seed(0), m_cpuBuffer(0), m_gpuBuffers{ 0, 0 }, m_gpuIndex(0),
+	m_gpuParticleCount(0), m_vao(0), m_cpuMilliseconds(0) {
+	if (m_gpuSupported) {
+		m_simulateProgram.loadCompute("shaders/particle_simulate.comp");
+		glGenBuffers(2, m_gpuBuffers);
+	}
+	m_renderProgram.load("shaders/particle.vert", "shaders/particle.frag");
+	glGenBuffers(1, &m_cpuBuffer);
+	glGenVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribDivisor(0, 1);
+	glVertexAttribDivisor(1, 1);
+	glBindVertexArray(0);
+}
+
+uint32_t ParticleSystem::addEmitter(const Object3D& node, const ParticleEmitterSettings& settings) {
+	m_emitters.push_back(Emitter{ &node, settings, m_gpuSupported && settings.blend == ParticleBlend::Additive, 0, 0 });
+	m_layoutChanged = true;
+	return static_cast<uint32_t>(m_emitters.size() - 1);
+}
+
+void ParticleSystem::setDensity(float density) {
+	m_density = density;
+	m_layoutChanged = true;
+}
+
+uint32_t ParticleSystem::particleCount() const {
+	uint32_t count = 0;
+	for (auto& emitter : m_emitters) {
+		count += emitter.count;
+	}
+	return count;
+}
+
+void ParticleSystem::layout() {
+	uint32_t cpuCount = 0;
+	m_gpuParticleCount = 0;
+	for (auto& emitter : m_emitters) {
+		emitter.count = std::max(1u, static_cast<uint32_t>(std::ceil(
+			emitter.settings.rate * emitter.settings.lifetime * m_density)));
+		if (emitter.onGpu) {
+			emitter.first = m_gpuParticleCount;
+			m_gpuParticleCount += emitter.count;
+		}
+		else {
+			// Start every CPU range at a multiple of four, for the SIMD path.
+			emitter.first = cpuCount;
+			cpuCount = (cpuCount + emitter.count + 3) & ~3u;
+		}
+	}
+
+	m_cpuParticles.resize(cpuCount);
+	ParticleArrays gpuInitial;
+	gpuInitial.resize(m_gpuParticleCount);
+	for (auto& emitter : m_emitters) {
+		initializeParticles(emitter.onGpu ? gpuInitial : m_cpuParticles, emitter.first, emitter.count,
+			emitter.settings.lifetime);
+	}
+
+	// The padding between CPU ranges is never drawn.
+	m_packed.assign(cpuCount, GpuParticle{ glm::vec4(0, 0, 0, -1), glm::vec4(0) });
+	glBindBuffer(GL_ARRAY_BUFFER, m_cpuBuffer);
+	glBufferData(GL_ARRAY_BUFFER, m_packed.size() * sizeof(GpuParticle), nullptr, GL_STREAM_DRAW);
+	if (m_gpuSupported) {
+		std::vector<GpuParticle> initial(m_gpuParticleCount);
+		for (uint32_t i = 0; i < m_gpuParticleCount; i++) {
+			initial[i] = pack(gpuInitial, i);
+		}
+		for (auto buffer : m_gpuBuffers) {
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+			glBufferData(GL_ARRAY_BUFFER, initial.size() * sizeof(GpuParticle), initial.data(), GL_DYNAMIC_COPY);
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	m_layoutChanged = false;
+}
+
+ParticleSpawn ParticleSystem::spawnOf(const Emitter& emitter) const {
+	auto& settings = emitter.settings;
+	auto& rotation = emitter.node->getRotation();
+	ParticleSpawn spawn;
+	spawn.position = emitter.node->getPosition() + rotation * settings.offset;
+	spawn.direction = glm::normalize(rotation * settings.direction);
+	spawn.spread = settings.spread;
+	spawn.speed = settings.speed;
+	spawn.lifetime = settings.lifetime;
+	spawn.gravity = settings.gravity;
+	spawn.drag = settings.drag;
+	return spawn;
+}
+
+void ParticleSystem::update(float dt) {
+	if (m_layoutChanged) {
+		layout();
+	}
+	dt = std::min(dt, MAX_STEP);
+	++m_seed;
+
+	auto start = std::chrono::steady_clock::now();
+	for (auto& emitter : m_emitters) {
+		if (!emitter.onGpu) {
+			simulateParticles(m_cpuParticles, emitter.first, emitter.count, spawnOf(emitter), dt, m_seed, m_useSimd);
+		}
+	}
+	m_cpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (m_gpuParticleCount == 0) {
+		return;
+	}
+	int32_t previousProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	m_simulateProgram.activate();
+	m_simulateProgram.setUniform("dt", dt);
+	m_simulateProgram.setUniform("seed", m_seed);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_gpuBuffers[m_gpuIndex]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_gpuBuffers[1 - m_gpuIndex]);
+	for (auto& emitter : m_emitters) {
+		if (!emitter.onGpu) {
+			continue;
+		}
+		auto spawn = spawnOf(emitter);
+		m_simulateProgram.setUniform("firstParticle", emitter.first);
+		m_simulateProgram.setUniform("particleCount", emitter.count);
+		m_simulateProgram.setUniform("spawnPosition", spawn.position);
+		m_simulateProgram.setUniform("spawnDirection", spawn.direction);
+		m_simulateProgram.setUniform("spread", spawn.spread);
+		m_simulateProgram.setUniform("speed", spawn.speed);
+		m_simulateProgram.setUniform("lifetime", spawn.lifetime);
+		m_simulateProgram.setUniform("gravity", spawn.gravity);
+		m_simulateProgram.setUniform("drag", spawn.drag);
+		glDispatchCompute((emitter.count + SIMULATE_GROUP_SIZE - 1) / SIMULATE_GROUP_SIZE, 1, 1);
+	}
+	// The written buffer is drawn as vertex attributes next.
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	m_gpuIndex = 1 - m_gpuIndex;
+	glUseProgram(previousProgram);
+}
+
+void ParticleSystem::packCpuEmitter(const Emitter& emitter, const glm::vec3& cameraPos) {
+	if (emitter.settings.blend == ParticleBlend::Additive) {
+		for (uint32_t i = 0; i < emitter.count; i++) {
+			m_packed[emitter.first + i] = pack(m_cpuParticles, emitter.first + i);
+		}
+		return;
+	}
+	m_sortKeys.resize(emitter.count);
+	m_sortOrder.resize(emitter.count);
+	for (uint32_t i = 0; i < emitter.count; i++) {
+		auto index = emitter.first + i;
+		glm::vec3 offset = glm::vec3(m_cpuParticles.positionX[index], m_cpuParticles.positionY[index],
+			m_cpuParticles.positionZ[index]) - cameraPos;
+		// Negated, so that ascending keys are farthest first.
+		m_sortKeys[i] = floatToSortableKey(-glm::dot(offset, offset));
+		m_sortOrder[i] = index;
+	}
+	radixSort(m_sortKeys, m_sortOrder, m_scratchKeys, m_scratchOrder);
+	for (uint32_t i = 0; i < emitter.count; i++) {
+		m_packed[emitter.first + i] = pack(m_cpuParticles, m_sortOrder[i]);
+	}
+}
+
+void ParticleSystem::render(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos) {
+	if (m_emitters.empty() || m_layoutChanged) {
+		return;
+	}
+	auto start = std::chrono::steady_clock::now();
+	bool anyCpu = false;
+	for (auto& emitter : m_emitters) {
+		if (!emitter.onGpu) {
+			packCpuEmitter(emitter, cameraPos);
+			anyCpu = true;
+		}
+	}
+	if (anyCpu) {
+		// Orphan the previous frame's data rather than wait for the GPU to finish with it.
+		glBindBuffer(GL_ARRAY_BUFFER, m_cpuBuffer);
+		glBufferData(GL_ARRAY_BUFFER, m_packed.size() * sizeof(GpuParticle), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, m_packed.size() * sizeof(GpuParticle), m_packed.data());
+	}
+	m_cpuMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	// Alpha-blended emitters go first, farthest first; additive ones can go in any order after.
+	m_emitterOrder.clear();
+	for (uint32_t i = 0; i < m_emitters.size(); i++) {
+		m_emitterOrder.push_back(i);
+	}
+	std::sort(m_emitterOrder.begin(), m_emitterOrder.end(), [&](uint32_t a, uint32_t b) {
+		auto& first = m_emitters[a];
+		auto& second = m_emitters[b];
+		if (first.settings.blend != second.settings.blend) {
+			return first.settings.blend == ParticleBlend::Alpha;
+		}
+		return glm::distance(first.node->getPosition(), cameraPos) > glm::distance(second.node->getPosition(), cameraPos);
+	});
+
+	int32_t previousProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	m_renderProgram.activate();
+	m_renderProgram.setUniform("view", view);
+	m_renderProgram.setUniform("projection", projection);
+	glEnable(GL_BLEND);
+	glDepthMask(GL_FALSE);
+	glBindVertexArray(m_vao);
+	for (auto index : m_emitterOrder) {
+		auto& emitter = m_emitters[index];
+		auto& settings = emitter.settings;
+		if (settings.blend == ParticleBlend::Additive) {
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+		}
+		else {
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		}
+		m_renderProgram.setUniform("startColor", settings.startColor);
+		m_renderProgram.setUniform("endColor", settings.endColor);
+		m_renderProgram.setUniform("startSize", settings.startSize);
+		m_renderProgram.setUniform("endSize", settings.endSize);
+		m_renderProgram.setUniform("colorVariation", settings.colorVariation);
+
+		// Point the instance attributes at the emitter's range of whichever buffer holds it.
+		glBindBuffer(GL_ARRAY_BUFFER, emitter.onGpu ? m_gpuBuffers[m_gpuIndex] : m_cpuBuffer);
+		auto offset = static_cast<uintptr_t>(emitter.first) * sizeof(GpuParticle);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), reinterpret_cast<const void*>(offset));
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(GpuParticle),
+			reinterpret_cast<const void*>(offset + sizeof(glm::vec4)));
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, emitter.count);
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+	glUseProgram(previousProgram);
+}
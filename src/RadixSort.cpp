@@ -0,0 +1,54 @@
+#include "RadixSort.h"
+#include <cstring>
+#include <utility>
+
+uint32_t floatToSortableKey(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	// Negative floats sort in reverse bit order, so flip all of their bits; positive floats only
+	// need to move above the negatives.
+	return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+void radixSort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values,
+	std::vector<uint32_t>& scratchKeys, std::vector<uint32_t>& scratchValues) {
+	const size_t count = keys.size();
+	if (count < 2) {
+		return;
+	}
+	scratchKeys.resize(count);
+	scratchValues.resize(count);
+
+	// Histogram all four digits in a single pass over the keys.
+	uint32_t histograms[4][256] = {};
+	for (auto key : keys) {
+		++histograms[0][key & 0xFF];
+		++histograms[1][(key >> 8) & 0xFF];
+		++histograms[2][(key >> 16) & 0xFF];
+		++histograms[3][key >> 24];
+	}
+
+	for (auto pass = 0; pass < 4; pass++) {
+		uint32_t* histogram = histograms[pass];
+		uint32_t shift = pass * 8;
+		// If every key has the same digit, this pass would not move anything.
+		if (histogram[(keys[0] >> shift) & 0xFF] == count) {
+			continue;
+		}
+
+		// Turn the histogram into starting offsets, then scatter.
+		uint32_t offset = 0;
+		for (auto digit = 0; digit < 256; digit++) {
+			uint32_t digitCount = histogram[digit];
+			histogram[digit] = offset;
+			offset += digitCount;
+		}
+		for (size_t i = 0; i < count; i++) {
+			uint32_t destination = histogram[(keys[i] >> shift) & 0xFF]++;
+			scratchKeys[destination] = keys[i];
+			scratchValues[destination] = values[i];
+		}
+		std::swap(keys, scratchKeys);
+		std::swap(values, scratchValues);
+	}
+}
@@ -0,0 +1,270 @@
+#include "ReflectionProbes.h"
+#include "Frustum.h"
+#include "FullscreenTriangle.h"
+#include "Mesh3D.h"
+#include "RenderQueue.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// Texture units of the two probes sampled by lighting.frag, above those used by other passes.
+	const int32_t PROBE_UNIT_0 = 13;
+	const int32_t PROBE_UNIT_1 = 14;
+	// Timing statistics are restarted this often, so the estimate follows changes in the scene.
+	const uint32_t TIMING_WINDOW_FRAMES = 120;
+
+	// The view direction and up vector of each cube face, in GL_TEXTURE_CUBE_MAP_POSITIVE_X order.
+	const glm::vec3 FACE_DIRECTIONS[6] = {
+		{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }
+	};
+	const glm::vec3 FACE_UPS[6] = {
+		{ 0, -1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, -1, 0 }, { 0, -1, 0 }
+	};
+
+	uint32_t createCubemap(uint32_t size, uint32_t levels) {
+		uint32_t texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+		for (uint32_t level = 0; level < levels; level++) {
+			for (uint32_t face = 0; face < 6; face++) {
+				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGBA16F, size >> level, size >> level,
+					0, GL_RGBA, GL_FLOAT, nullptr);
+			}
+		}
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+		return texture;
+	}
+}
+
+ReflectionProbes::ReflectionProbes(uint32_t size)
+	: m_size(size), m_currentProbe(0), m_currentStep(0), m_timedFrames(0), m_timedSteps(0), m_lastSteps(0) {
+	// Stop at 8x8 faces: rougher reflections than that are no longer worth a level.
+	m_levels = 1;
+	while ((m_size >> m_levels) >= 8) {
+		++m_levels;
+	}
+
+	int32_t previousProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	m_captureProgram.load("shaders/light_perspective.vert", "shaders/lighting.frag");
+	m_captureProgram.activate();
+	// Probes see the scene without reflections, and from a fixed 90 degree view per face.
+	disable(m_captureProgram);
+	m_captureProgram.setUniform("projection", glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 200.0f));
+	m_prefilterProgram.load("shaders/fullscreen.vert", "shaders/probe_prefilter.frag");
+	glUseProgram(previousProgram);
+
+	// The scratch cube map needs a full mip chain, which prefiltering samples to avoid aliasing.
+	uint32_t fullLevels = 1;
+	while ((m_size >> fullLevels) > 0) {
+		++fullLevels;
+	}
+	m_captureCubemap = createCubemap(m_size, fullLevels);
+	glGenRenderbuffers(1, &m_captureDepth);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_captureDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_size, m_size);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glGenFramebuffers(1, &m_captureFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_captureFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_captureDepth);
+	glGenFramebuffers(1, &m_prefilterFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// Filter across cube face edges, which the rough levels would otherwise show as seams.
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+}
+
+size_t ReflectionProbes::addProbe(const glm::vec3& position, const glm::vec3& boxMin, const glm::vec3& boxMax,
+	bool isStatic) {
+	m_probes.push_back(ReflectionProbe{ position, boxMin, boxMax, isStatic, createCubemap(m_size, m_levels), false });
+	return m_probes.size() - 1;
+}
+
+void ReflectionProbes::setLighting(const glm::vec3& ambientColor, const glm::vec3& directionalLight,
+	const glm::vec3& directionalColor) {
+	int32_t previousProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	m_captureProgram.activate();
+	m_captureProgram.setUniform("ambientColor", ambientColor);
+	m_captureProgram.setUniform("directionalLight", directionalLight);
+	m_captureProgram.setUniform("directionalColor", directionalColor);
+	glUseProgram(previousProgram);
+}
+
+void ReflectionProbes::bakeStatic(const std::vector<MeshDraw>& draws) {
+	for (auto& probe : m_probes) {
+		if (probe.isStatic) {
+			for (uint32_t step = 0; step < STEPS_PER_UPDATE; step++) {
+				runStep(probe, step, draws);
+			}
+		}
+	}
+}
+
+void ReflectionProbes::update(const std::vector<MeshDraw>& draws, float budgetMilliseconds) {
+	m_lastSteps = 0;
+	bool anyDynamic = std::any_of(m_probes.begin(), m_probes.end(),
+		[](const ReflectionProbe& probe) { return !probe.isStatic; });
+	if (!anyDynamic) {
+		return;
+	}
+
+	// Until a step has been timed, run one step per frame.
+	uint32_t steps = 1;
+	if (m_timer.samples() > 0 && m_timedSteps > 0) {
+		double stepMilliseconds = m_timer.averageMilliseconds() * m_timedFrames / m_timedSteps;
+		steps = static_cast<uint32_t>(std::clamp(budgetMilliseconds / std::max(stepMilliseconds, 1e-3),
+			1.0, static_cast<double>(STEPS_PER_UPDATE)));
+	}
+
+	m_timer.begin();
+	for (uint32_t i = 0; i < steps; i++) {
+		while (m_probes[m_currentProbe].isStatic) {
+			m_currentProbe = (m_currentProbe + 1) % m_probes.size();
+		}
+		runStep(m_probes[m_currentProbe], m_currentStep, draws);
+		if (++m_currentStep == STEPS_PER_UPDATE) {
+			m_currentStep = 0;
+			m_currentProbe = (m_currentProbe + 1) % m_probes.size();
+		}
+	}
+	m_timer.end();
+	m_lastSteps = steps;
+	m_timedSteps += steps;
+	if (++m_timedFrames == TIMING_WINDOW_FRAMES) {
+		m_timer.reset();
+		m_timedFrames = 0;
+		m_timedSteps = 0;
+	}
+}
+
+void ReflectionProbes::runStep(ReflectionProbe& probe, uint32_t step, const std::vector<MeshDraw>& draws) {
+	int32_t previousProgram;
+	int32_t previousViewport[4];
+	int32_t previousFramebuffer;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	if (step < 6) {
+		captureFace(probe, step, draws);
+	}
+	else {
+		prefilterFace(probe, step - 6);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glUseProgram(previousProgram);
+}
+
+void ReflectionProbes::captureFace(const ReflectionProbe& probe, uint32_t face, const std::vector<MeshDraw>& draws) {
+	glBindFramebuffer(GL_FRAMEBUFFER, m_captureFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+		m_captureCubemap, 0);
+	glViewport(0, 0, m_size, m_size);
+	const float black[] = { 0, 0, 0, 1 };
+	const float farDepth = 1.0f;
+	glClearBufferfv(GL_COLOR, 0, black);
+	glClearBufferfv(GL_DEPTH, 0, &farDepth);
+
+	glm::mat4 view = glm::lookAt(probe.position, probe.position + FACE_DIRECTIONS[face], FACE_UPS[face]);
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 200.0f);
+	Frustum frustum = Frustum::fromMatrix(projection * view);
+	m_faceDraws.clear();
+	for (auto& draw : draws) {
+		glm::vec3 center = glm::vec3(draw.model * glm::vec4(draw.mesh->getBoundsCenter(), 1));
+		float scale = std::max(glm::length(glm::vec3(draw.model[0])),
+			std::max(glm::length(glm::vec3(draw.model[1])), glm::length(glm::vec3(draw.model[2]))));
+		if (frustum.intersectsSphere(center, draw.mesh->getBoundsRadius() * scale)) {
+			m_faceDraws.push_back(draw);
+		}
+	}
+
+	m_captureProgram.activate();
+	m_captureProgram.setUniform("view", view);
+	m_captureProgram.setUniform("viewPos", probe.position);
+	RenderQueue::render(m_faceDraws, m_captureProgram, nullptr);
+
+	if (face == 5) {
+		glBindTexture(GL_TEXTURE_CUBE_MAP, m_captureCubemap);
+		glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	}
+}
+
+void ReflectionProbes::prefilterFace(ReflectionProbe& probe, uint32_t face) {
+	glBindFramebuffer(GL_FRAMEBUFFER, m_prefilterFramebuffer);
+	m_prefilterProgram.activate();
+	m_prefilterProgram.setUniform("environment", 0);
+	m_prefilterProgram.setUniform("environmentSize", static_cast<float>(m_size));
+	m_prefilterProgram.setUniform("face", static_cast<int32_t>(face));
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_captureCubemap);
+	for (uint32_t level = 0; level < m_levels; level++) {
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+			probe.cubemap, level);
+		glViewport(0, 0, m_size >> level, m_size >> level);
+		m_prefilterProgram.setUniform("roughness", static_cast<float>(level) / (m_levels - 1));
+		drawFullscreenTriangle();
+	}
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+	if (face == 5) {
+		probe.valid = true;
+	}
+}
+
+void ReflectionProbes::apply(ShaderProgram& program, const glm::vec3& position) const {
+	const ReflectionProbe* nearest[2] = { nullptr, nullptr };
+	float nearestDistance[2] = { INFINITY, INFINITY };
+	for (auto& probe : m_probes) {
+		if (!probe.valid) {
+			continue;
+		}
+		float distance = glm::distance(position, probe.position);
+		if (distance < nearestDistance[0]) {
+			nearest[1] = nearest[0];
+			nearestDistance[1] = nearestDistance[0];
+			nearest[0] = &probe;
+			nearestDistance[0] = distance;
+		}
+		else if (distance < nearestDistance[1]) {
+			nearest[1] = &probe;
+			nearestDistance[1] = distance;
+		}
+	}
+	if (nearest[0] == nullptr) {
+		disable(program);
+		return;
+	}
+	if (nearest[1] == nullptr) {
+		nearest[1] = nearest[0];
+	}
+
+	program.setUniform("useReflections", true);
+	program.setUniform("probeMaxLevel", static_cast<float>(m_levels - 1));
+	for (int i = 0; i < 2; i++) {
+		auto suffix = std::to_string(i);
+		program.setUniform("reflectionProbe" + suffix, i == 0 ? PROBE_UNIT_0 : PROBE_UNIT_1);
+		program.setUniform("probePosition" + suffix, nearest[i]->position);
+		program.setUniform("probeBoxMin" + suffix, nearest[i]->boxMin);
+		program.setUniform("probeBoxMax" + suffix, nearest[i]->boxMax);
+		glActiveTexture(GL_TEXTURE0 + (i == 0 ? PROBE_UNIT_0 : PROBE_UNIT_1));
+		glBindTexture(GL_TEXTURE_CUBE_MAP, nearest[i]->cubemap);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void ReflectionProbes::disable(ShaderProgram& program) {
+	program.setUniform("useReflections", false);
+	program.setUniform("reflectionProbe0", PROBE_UNIT_0);
+	program.setUniform("reflectionProbe1", PROBE_UNIT_1);
+}
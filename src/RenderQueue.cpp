@@ -0,0 +1,75 @@
+#include "RenderQueue.h"
+#include "Mesh3D.h"
+#include "Object3D.h"
+#include "RadixSort.h"
+#include "Transform.h"
+#include <glad/glad.h>
+#include <utility>
+
+void RenderQueue::clear() {
+	m_opaque.clear();
+	m_masked.clear();
+	m_blended.clear();
+}
+
+void RenderQueue::submit(const Object3D& object) {
+	m_collected.clear();
+	object.collectDraws(m_collected);
+	for (auto& draw : m_collected) {
+		switch (draw.mesh->getAlphaMode()) {
+		case AlphaMode::Opaque:
+			m_opaque.push_back(draw);
+			break;
+		case AlphaMode::Mask:
+			m_masked.push_back(draw);
+			break;
+		case AlphaMode::Blend:
+			m_blended.push_back(draw);
+			break;
+		}
+	}
+}
+
+void RenderQueue::sortBlended(const glm::mat4& view) {
+	auto count = static_cast<uint32_t>(m_blended.size());
+	m_sortKeys.resize(count);
+	m_sortOrder.resize(count);
+	for (uint32_t i = 0; i < count; i++) {
+		auto& draw = m_blended[i];
+		glm::vec4 center = view * (draw.model * glm::vec4(draw.mesh->getBoundsCenter(), 1));
+		// View-space z is negative in front of the camera, so ascending z is back to front.
+		m_sortKeys[i] = floatToSortableKey(center.z);
+		m_sortOrder[i] = i;
+	}
+	radixSort(m_sortKeys, m_sortOrder, m_scratchKeys, m_scratchOrder);
+
+	m_sorted.clear();
+	for (auto index : m_sortOrder) {
+		m_sorted.push_back(m_blended[index]);
+	}
+	std::swap(m_blended, m_sorted);
+}
+
+void RenderQueue::render(const std::vector<MeshDraw>& draws, ShaderProgram& program, MeshletCuller* culler) {
+	for (auto& draw : draws) {
+		program.setUniform("material", draw.material);
+		program.setUniform("model", draw.model);
+		program.setUniform("normalMatrix", normalMatrix(draw.model));
+		if (culler != nullptr) {
+			draw.mesh->render(program, *culler, draw.model);
+		}
+		else {
+			draw.mesh->render(program);
+		}
+	}
+}
+
+void RenderQueue::renderBlended(ShaderProgram& program, MeshletCuller* culler) const {
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// Blended surfaces are still hidden by opaque ones, but must not hide each other.
+	glDepthMask(GL_FALSE);
+	render(m_blended, program, culler);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+}
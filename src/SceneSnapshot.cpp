@@ -0,0 +1,488 @@
+#include "SceneSnapshot.h"
+#include "GeometryCodec.h"
+#include "TextureStreamer.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+	const char SNAPSHOT_MAGIC[8] = { 'A', 'R', 'C', 'S', 'N', 'A', 'P', '\0' };
+	const char STATE_MAGIC[8] = { 'A', 'R', 'C', 'S', 'T', 'A', 'T', 'E' };
+	// Bump whenever the layout of the file changes, so that old files are ignored. The state file
+	// started out sharing the snapshot's version, and has kept the value it had when they split.
+	const uint32_t SNAPSHOT_VERSION = 3;
+	const uint32_t STATE_VERSION = 2;
+
+	typedef TextureStreamer::MipLevel MipLevel;
+
+	/**
+	 * @brief Appends plain values, arrays and strings to a byte buffer.
+	 */
+	class SnapshotWriter {
+	private:
+		std::vector<char> m_data;
+
+	public:
+		void bytes(const void* data, size_t size) {
+			auto begin = static_cast<const char*>(data);
+			m_data.insert(m_data.end(), begin, begin + size);
+		}
+
+		template <typename T>
+		void value(const T& value) {
+			bytes(&value, sizeof(T));
+		}
+
+		template <typename T>
+		void array(const std::vector<T>& values) {
+			value(static_cast<uint64_t>(values.size()));
+			bytes(values.data(), values.size() * sizeof(T));
+		}
+
+		void string(const std::string& text) {
+			value(static_cast<uint32_t>(text.size()));
+			bytes(text.data(), text.size());
+		}
+
+		void append(const SnapshotWriter& other) {
+			bytes(other.m_data.data(), other.m_data.size());
+		}
+
+		/**
+		 * @brief Writes the buffer to a temporary file, then renames it over the given path.
+		 */
+		void save(const std::string& path) const {
+			auto temporaryPath = path + ".tmp";
+			{
+				std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+				file.write(m_data.data(), m_data.size());
+				if (!file) {
+					throw std::runtime_error("Could not write " + temporaryPath);
+				}
+			}
+			std::filesystem::rename(temporaryPath, path);
+		}
+	};
+
+	/**
+	 * @brief Reads back what a SnapshotWriter wrote, throwing rather than reading past the end.
+	 */
+	class SnapshotReader {
+	private:
+		std::vector<char> m_data;
+		size_t m_offset;
+
+	public:
+		SnapshotReader(std::vector<char>&& data) : m_data(std::move(data)), m_offset(0) {}
+
+		void bytes(void* data, size_t size) {
+			if (size > m_data.size() - m_offset) {
+				throw std::runtime_error("Scene snapshot is truncated");
+			}
+			std::memcpy(data, m_data.data() + m_offset, size);
+			m_offset += size;
+		}
+
+		template <typename T>
+		T value() {
+			T result;
+			bytes(&result, sizeof(T));
+			return result;
+		}
+
+		template <typename T>
+		std::vector<T> array(const T& filler = T()) {
+			auto count = value<uint64_t>();
+			if (count > (m_data.size() - m_offset) / sizeof(T)) {
+				throw std::runtime_error("Scene snapshot is truncated");
+			}
+			std::vector<T> result(count, filler);
+			bytes(result.data(), count * sizeof(T));
+			return result;
+		}
+
+		/**
+		 * @brief Returns a byte array in place rather than copying it, along with its size.
+		 */
+		const uint8_t* byteArray(size_t& size) {
+			auto count = value<uint64_t>();
+			if (count > m_data.size() - m_offset) {
+				throw std::runtime_error("Scene snapshot is truncated");
+			}
+			auto data = reinterpret_cast<const uint8_t*>(m_data.data() + m_offset);
+			size = static_cast<size_t>(count);
+			m_offset += size;
+			return data;
+		}
+
+		std::string string() {
+			auto size = value<uint32_t>();
+			if (size > m_data.size() - m_offset) {
+				throw std::runtime_error("Scene snapshot is truncated");
+			}
+			std::string result(m_data.data() + m_offset, size);
+			m_offset += size;
+			return result;
+		}
+	};
+
+	/**
+	 * @brief Reads a whole file with a single read, or returns false if it can't be opened.
+	 */
+	bool readFile(const std::string& path, std::vector<char>& data) {
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) {
+			return false;
+		}
+		auto size = static_cast<size_t>(file.tellg());
+		data.resize(size);
+		file.seekg(0);
+		file.read(data.data(), size);
+		return static_cast<bool>(file);
+	}
+
+	bool readHeader(SnapshotReader& reader, const char magic[8], uint32_t version) {
+		char fileMagic[8];
+		reader.bytes(fileMagic, sizeof(fileMagic));
+		return std::memcmp(fileMagic, magic, sizeof(fileMagic)) == 0 && reader.value<uint32_t>() == version;
+	}
+
+	/**
+	 * @brief Reads every level of a texture that wasn't made by the streamer back from VRAM.
+	 */
+	std::vector<MipLevel> readTextureLevels(uint32_t textureId) {
+		std::vector<MipLevel> levels;
+		glBindTexture(GL_TEXTURE_2D, textureId);
+		int32_t maxLevel;
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+		for (int32_t level = 0; level <= maxLevel; level++) {
+			int32_t width, height;
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+			if (width == 0 || height == 0) {
+				break;
+			}
+			MipLevel mip{ static_cast<uint32_t>(width), static_cast<uint32_t>(height),
+				std::vector<uint8_t>(width * height * 4) };
+			glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, mip.texels.data());
+			levels.push_back(std::move(mip));
+			if (width == 1 && height == 1) {
+				break;
+			}
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return levels;
+	}
+
+	/**
+	 * @brief Creates a texture from a complete mip chain, without a streamer.
+	 */
+	uint32_t createTexture(const std::vector<MipLevel>& levels) {
+		uint32_t texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<int32_t>(levels.size()) - 1);
+		for (size_t level = 0; level < levels.size(); level++) {
+			glTexImage2D(GL_TEXTURE_2D, static_cast<int32_t>(level), GL_RGBA, levels[level].width,
+				levels[level].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[level].texels.data());
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return texture;
+	}
+
+	/**
+	 * @brief Assigns indices to the distinct meshes and textures of a scene, and records its nodes.
+	 */
+	struct SnapshotTables {
+		// Meshes are told apart by their vertex buffer's texture view, which copies share.
+		std::unordered_map<uint32_t, uint32_t> meshIndices;
+		std::vector<const Mesh3D*> meshes;
+		std::unordered_map<uint32_t, uint32_t> textureIndices;
+		std::vector<uint32_t> textures;
+
+		void addNode(const Object3D& object, SnapshotWriter& nodes) {
+			nodes.string(object.getName());
+			nodes.value(object.getBaseTransform());
+			nodes.value(object.getTransform());
+			nodes.value(object.getMaterial());
+			nodes.value(static_cast<uint32_t>(object.getMeshes().size()));
+			for (auto& mesh : object.getMeshes()) {
+				auto inserted = meshIndices.insert(std::make_pair(mesh.getVertexTexture(),
+					static_cast<uint32_t>(meshes.size())));
+				if (inserted.second) {
+					meshes.push_back(&mesh);
+					for (auto& texture : mesh.getTextures()) {
+						if (textureIndices.insert(std::make_pair(texture.textureId,
+							static_cast<uint32_t>(textures.size()))).second) {
+							textures.push_back(texture.textureId);
+						}
+					}
+				}
+				nodes.value(inserted.first->second);
+			}
+			nodes.value(static_cast<uint32_t>(object.numberOfChildren()));
+			for (size_t i = 0; i < object.numberOfChildren(); i++) {
+				addNode(object.getChild(i), nodes);
+			}
+		}
+	};
+
+	Object3D readNode(SnapshotReader& reader, const std::vector<Mesh3D>& meshes) {
+		auto name = reader.string();
+		auto baseTransform = reader.value<glm::mat4>();
+		auto transform = reader.value<Transform>();
+		auto material = reader.value<glm::vec4>();
+		auto meshCount = reader.value<uint32_t>();
+		std::vector<Mesh3D> nodeMeshes;
+		for (uint32_t i = 0; i < meshCount; i++) {
+			auto index = reader.value<uint32_t>();
+			if (index >= meshes.size()) {
+				throw std::runtime_error("Scene snapshot has an unknown mesh");
+			}
+			nodeMeshes.push_back(meshes[index]);
+		}
+
+		Object3D object(std::move(nodeMeshes), baseTransform);
+		object.setName(name);
+		object.setTransform(transform);
+		object.setMaterial(material);
+		auto childCount = reader.value<uint32_t>();
+		for (uint32_t i = 0; i < childCount; i++) {
+			object.addChild(readNode(reader, meshes));
+		}
+		return object;
+	}
+}
+
+uint64_t assetStamp(const std::filesystem::path& directory) {
+	// Combine every file's path, size and modification time without depending on the order
+	// they are listed in.
+	uint64_t stamp = 0;
+	std::error_code error;
+	for (auto& entry : std::filesystem::recursive_directory_iterator(directory, error)) {
+		if (!entry.is_regular_file(error)) {
+			continue;
+		}
+		uint64_t hash = std::hash<std::string>{}(entry.path().string());
+		hash = hash * 31 + entry.file_size(error);
+		hash = hash * 31 + static_cast<uint64_t>(entry.last_write_time(error).time_since_epoch().count());
+		stamp += hash * 0x9E3779B97F4A7C15ull;
+	}
+	return stamp;
+}
+
+void saveSceneSnapshot(const std::string& path, const std::vector<Object3D>& objects,
+	const std::vector<size_t>& modelObjects, uint64_t assetStamp, const TextureStreamer* streamer,
+	const std::unordered_map<uint32_t, std::string>& texturePaths) {
+	SnapshotTables tables;
+	SnapshotWriter nodes;
+	for (auto& object : objects) {
+		tables.addNode(object, nodes);
+	}
+
+	SnapshotWriter writer;
+	writer.bytes(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	writer.value(SNAPSHOT_VERSION);
+	writer.value(assetStamp);
+
+	writer.value(static_cast<uint32_t>(tables.textures.size()));
+	for (auto textureId : tables.textures) {
+		auto streamed = streamer != nullptr ? streamer->levels(textureId) : nullptr;
+		auto levels = streamed != nullptr ? *streamed : readTextureLevels(textureId);
+		auto texturePath = texturePaths.find(textureId);
+		writer.string(texturePath != texturePaths.end() ? texturePath->second : "");
+		writer.value(static_cast<uint32_t>(levels.size()));
+		for (auto& level : levels) {
+			writer.value(level.width);
+			writer.value(level.height);
+			writer.array(level.texels);
+		}
+	}
+
+	std::vector<Vertex3D> vertices;
+	std::vector<uint32_t> faces;
+	writer.value(static_cast<uint32_t>(tables.meshes.size()));
+	for (auto mesh : tables.meshes) {
+		mesh->readGeometry(vertices, faces);
+		writer.array(encodeVertices(vertices));
+		writer.array(encodeIndices(faces));
+		writer.array(mesh->getMeshlets());
+		writer.value(static_cast<uint32_t>(mesh->getTextures().size()));
+		for (auto& texture : mesh->getTextures()) {
+			writer.value(tables.textureIndices.at(texture.textureId));
+			writer.string(texture.samplerName);
+		}
+		writer.value(mesh->getAlphaMode());
+		writer.value(mesh->getAlphaCutoff());
+		writer.value(mesh->getOpacity());
+	}
+
+	// The nodes were gathered first, to find the distinct meshes and textures, but are read last.
+	writer.value(static_cast<uint32_t>(objects.size()));
+	writer.append(nodes);
+	writer.array(std::vector<uint64_t>(modelObjects.begin(), modelObjects.end()));
+	writer.save(path);
+}
+
+bool loadSceneSnapshot(const std::string& path, uint64_t assetStamp, std::vector<Object3D>& objects,
+	std::vector<size_t>& modelObjects, TextureStreamer* streamer,
+	std::unordered_map<uint32_t, std::string>& texturePaths) {
+	std::vector<char> data;
+	if (!readFile(path, data)) {
+		return false;
+	}
+	SnapshotReader reader(std::move(data));
+	if (!readHeader(reader, SNAPSHOT_MAGIC, SNAPSHOT_VERSION) || reader.value<uint64_t>() != assetStamp) {
+		return false;
+	}
+
+	// The textures are deleted again if the rest of the file turns out to be corrupt.
+	std::vector<uint32_t> textures;
+	std::vector<std::string> paths;
+	try {
+		auto textureCount = reader.value<uint32_t>();
+		for (uint32_t i = 0; i < textureCount; i++) {
+			paths.push_back(reader.string());
+			// A chain that halves 32 bit sizes down to 1 can't be longer than 33 levels.
+			auto levelCount = reader.value<uint32_t>();
+			if (levelCount == 0 || levelCount > 33) {
+				throw std::runtime_error("Scene snapshot has a texture with a wrong number of levels");
+			}
+			std::vector<MipLevel> levels(levelCount);
+			for (size_t j = 0; j < levels.size(); j++) {
+				auto& level = levels[j];
+				level.width = reader.value<uint32_t>();
+				level.height = reader.value<uint32_t>();
+				level.texels = reader.array<uint8_t>();
+				// Each level must halve the one before, down to 1, and hold exactly its RGBA texels.
+				bool sized = j == 0 ? level.width > 0 && level.height > 0
+					: level.width == std::max(1u, levels[j - 1].width / 2)
+						&& level.height == std::max(1u, levels[j - 1].height / 2);
+				if (!sized || level.texels.size() % 4 != 0
+					|| level.texels.size() / 4 != static_cast<uint64_t>(level.width) * level.height) {
+					throw std::runtime_error("Scene snapshot has a texture level of the wrong size");
+				}
+			}
+			textures.push_back(streamer != nullptr ? streamer->loadLevels(std::move(levels), "").textureId
+				: createTexture(levels));
+		}
+
+		std::vector<Mesh3D> meshes;
+		auto meshCount = reader.value<uint32_t>();
+		for (uint32_t i = 0; i < meshCount; i++) {
+			size_t size;
+			auto encoded = reader.byteArray(size);
+			auto vertices = decodeVertices(encoded, size);
+			encoded = reader.byteArray(size);
+			auto faces = decodeIndices(encoded, size);
+			auto meshlets = reader.array<Meshlet>();
+			// Drawing trusts the faces and meshlets, so a corrupt one must not reach the GPU.
+			if (faces.size() % 3 != 0) {
+				throw std::runtime_error("Scene snapshot has a mesh with a partial triangle");
+			}
+			for (auto index : faces) {
+				if (index >= vertices.size()) {
+					throw std::runtime_error("Scene snapshot has a mesh with an unknown vertex");
+				}
+			}
+			for (auto& meshlet : meshlets) {
+				if (meshlet.indexOffset > faces.size() || meshlet.indexCount > faces.size() - meshlet.indexOffset) {
+					throw std::runtime_error("Scene snapshot has a meshlet outside its mesh");
+				}
+			}
+			std::vector<Texture> meshTextures(reader.value<uint32_t>());
+			for (auto& texture : meshTextures) {
+				auto index = reader.value<uint32_t>();
+				if (index >= textures.size()) {
+					throw std::runtime_error("Scene snapshot has an unknown texture");
+				}
+				texture.textureId = textures[index];
+				texture.samplerName = reader.string();
+			}
+			auto alphaMode = reader.value<AlphaMode>();
+			if (alphaMode != AlphaMode::Opaque && alphaMode != AlphaMode::Mask && alphaMode != AlphaMode::Blend) {
+				throw std::runtime_error("Scene snapshot has an unknown alpha mode");
+			}
+			auto alphaCutoff = reader.value<float>();
+			auto opacity = reader.value<float>();
+
+			Mesh3D mesh(std::move(vertices), std::move(faces), std::move(meshTextures));
+			mesh.setAlphaMode(alphaMode, alphaCutoff);
+			mesh.setOpacity(opacity);
+			if (!meshlets.empty()) {
+				mesh.setMeshlets(std::move(meshlets));
+			}
+			meshes.push_back(mesh);
+		}
+
+		auto objectCount = reader.value<uint32_t>();
+		auto firstObject = objects.size();
+		for (uint32_t i = 0; i < objectCount; i++) {
+			objects.push_back(readNode(reader, meshes));
+		}
+		for (auto index : reader.array<uint64_t>()) {
+			if (index >= objectCount) {
+				throw std::runtime_error("Scene snapshot has an unknown model");
+			}
+			modelObjects.push_back(firstObject + static_cast<size_t>(index));
+		}
+	}
+	catch (...) {
+		for (auto texture : textures) {
+			if (streamer == nullptr || !streamer->unload(texture)) {
+				glDeleteTextures(1, &texture);
+			}
+		}
+		throw;
+	}
+	for (size_t i = 0; i < textures.size(); i++) {
+		if (!paths[i].empty()) {
+			texturePaths[textures[i]] = paths[i];
+		}
+	}
+	return true;
+}
+
+void saveSceneState(const std::string& path, const SceneState& state) {
+	SnapshotWriter writer;
+	writer.bytes(STATE_MAGIC, sizeof(STATE_MAGIC));
+	writer.value(STATE_VERSION);
+	writer.array(state.objectTransforms);
+	writer.array(state.objectMaterials);
+	writer.array(state.animators);
+	writer.value(state.cameraPos);
+	writer.value(state.cameraYaw);
+	writer.value(state.cameraPitch);
+	writer.save(path);
+}
+
+bool loadSceneState(const std::string& path, SceneState& state) {
+	std::vector<char> data;
+	if (!readFile(path, data)) {
+		return false;
+	}
+	try {
+		SnapshotReader reader(std::move(data));
+		if (!readHeader(reader, STATE_MAGIC, STATE_VERSION)) {
+			return false;
+		}
+		state.objectTransforms = reader.array<Transform>();
+		state.objectMaterials = reader.array<glm::vec4>();
+		state.animators = reader.array<AnimatorState>();
+		state.cameraPos = reader.value<glm::vec3>();
+		state.cameraYaw = reader.value<float>();
+		state.cameraPitch = reader.value<float>();
+	}
+	catch (std::runtime_error&) {
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,86 @@
+#include "ScreenContent.h"
+#include "Frustum.h"
+#include "FullscreenTriangle.h"
+#include "Mesh3D.h"
+#include "Object3D.h"
+#include "ReflectionProbes.h"
+#include "RenderQueue.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// How far either side of its target the security camera pans, in radians, and how fast.
+	const float PAN_ANGLE = 0.6f;
+	const float PAN_SPEED = 0.25f;
+}
+
+ShaderScreenContent::ShaderScreenContent(const std::string& fragmentPath) {
+	m_program.load("shaders/fullscreen.vert", fragmentPath);
+}
+
+void ShaderScreenContent::render(const ScreenFrame& frame) {
+	m_program.activate();
+	m_program.setUniform("time", frame.time);
+	m_program.setUniform("resolution", glm::vec2(frame.width, frame.height));
+	glDisable(GL_DEPTH_TEST);
+	drawFullscreenTriangle();
+	glEnable(GL_DEPTH_TEST);
+}
+
+SceneCameraContent::SceneCameraContent(const std::vector<Object3D>& objects, const glm::vec3& position,
+	const glm::vec3& target, float fieldOfView)
+	: m_objects(objects), m_position(position), m_target(target), m_fieldOfView(fieldOfView) {
+	int32_t previousProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	m_program.load("shaders/light_perspective.vert", "shaders/lighting.frag");
+	m_program.activate();
+	ReflectionProbes::disable(m_program);
+	m_program.setUniform("viewPos", m_position);
+	glUseProgram(previousProgram);
+}
+
+void SceneCameraContent::setLighting(const glm::vec3& ambientColor, const glm::vec3& directionalLight,
+	const glm::vec3& directionalColor) {
+	int32_t previousProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	m_program.activate();
+	m_program.setUniform("ambientColor", ambientColor);
+	m_program.setUniform("directionalLight", directionalLight);
+	m_program.setUniform("directionalColor", directionalColor);
+	glUseProgram(previousProgram);
+}
+
+void SceneCameraContent::render(const ScreenFrame& frame) {
+	glm::vec3 toTarget = m_target - m_position;
+	float pan = PAN_ANGLE * std::sin(frame.time * PAN_SPEED);
+	glm::vec3 direction = glm::vec3(glm::rotate(glm::mat4(1), pan, glm::vec3(0, 1, 0)) * glm::vec4(toTarget, 0));
+	glm::mat4 view = glm::lookAt(m_position, m_position + direction, glm::vec3(0, 1, 0));
+	glm::mat4 projection = glm::perspective(m_fieldOfView, static_cast<float>(frame.width) / frame.height, 0.1f, 200.0f);
+	Frustum frustum = Frustum::fromMatrix(projection * view);
+
+	m_draws.clear();
+	for (auto& object : m_objects) {
+		object.collectDraws(m_draws);
+	}
+	m_visibleDraws.clear();
+	for (auto& draw : m_draws) {
+		auto& textures = draw.mesh->getTextures();
+		bool showsScreen = std::any_of(textures.begin(), textures.end(),
+			[&](const Texture& texture) { return texture.textureId == frame.texture; });
+		if (draw.mesh->getAlphaMode() == AlphaMode::Blend || showsScreen) {
+			continue;
+		}
+		glm::vec3 center = glm::vec3(draw.model * glm::vec4(draw.mesh->getBoundsCenter(), 1));
+		float scale = std::max(glm::length(glm::vec3(draw.model[0])),
+			std::max(glm::length(glm::vec3(draw.model[1])), glm::length(glm::vec3(draw.model[2]))));
+		if (frustum.intersectsSphere(center, draw.mesh->getBoundsRadius() * scale)) {
+			m_visibleDraws.push_back(draw);
+		}
+	}
+
+	m_program.activate();
+	m_program.setUniform("view", view);
+	m_program.setUniform("projection", projection);
+	RenderQueue::render(m_visibleDraws, m_program, nullptr);
+}
@@ -0,0 +1,156 @@
+#include "ScreenRenderTargets.h"
+#include "Frustum.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <limits>
+
+namespace {
+	// Timing statistics are restarted this often, so the estimate follows changes in content.
+	const uint32_t TIMING_WINDOW_FRAMES = 120;
+}
+
+ScreenRenderTargets::ScreenRenderTargets()
+	: m_timedFrames(0), m_timedRefreshes(0), m_lastRefreshes(0), m_lastDue(0), m_frozenScreens(0),
+	m_fullRateScreens(0) {
+}
+
+ScreenRenderTargets::~ScreenRenderTargets() {
+	for (auto& screen : m_screens) {
+		glDeleteFramebuffers(1, &screen.framebuffer);
+		glDeleteRenderbuffers(1, &screen.depth);
+		glDeleteTextures(1, &screen.texture);
+	}
+}
+
+uint32_t ScreenRenderTargets::addScreen(std::unique_ptr<ScreenContent> content, uint32_t width, uint32_t height) {
+	Screen screen{ std::move(content), width, height, 0, 0, 0, glm::vec3(0), 0, 0, 0, 0, false };
+
+	uint32_t levels = 1;
+	while ((std::max(width, height) >> levels) > 0) {
+		++levels;
+	}
+	glGenTextures(1, &screen.texture);
+	glBindTexture(GL_TEXTURE_2D, screen.texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glGenRenderbuffers(1, &screen.depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, screen.depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	int32_t previousFramebuffer;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGenFramebuffers(1, &screen.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, screen.framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, screen.texture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, screen.depth);
+	// Black, with a complete mip chain, until the first refresh.
+	const float black[] = { 0, 0, 0, 1 };
+	glClearBufferfv(GL_COLOR, 0, black);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_screens.push_back(std::move(screen));
+	return static_cast<uint32_t>(m_screens.size() - 1);
+}
+
+void ScreenRenderTargets::setBounds(uint32_t screen, const glm::vec3& center, float radius) {
+	m_screens[screen].center = center;
+	m_screens[screen].radius = radius;
+}
+
+void ScreenRenderTargets::update(float dt, const glm::mat4& view, const glm::mat4& projection,
+	const glm::vec3& cameraPos, uint32_t viewportHeight, float budgetMilliseconds) {
+	Frustum frustum = Frustum::fromMatrix(projection * view);
+	m_dueScreens.clear();
+	m_frozenScreens = 0;
+	m_fullRateScreens = 0;
+	for (uint32_t i = 0; i < m_screens.size(); i++) {
+		auto& screen = m_screens[i];
+		screen.time += dt;
+		screen.sinceRefresh += dt;
+		if (!frustum.intersectsSphere(screen.center, screen.radius)) {
+			screen.interval = -1;
+			++m_frozenScreens;
+			continue;
+		}
+		// The diameter of the screen's bounding sphere in pixels, as projected at its distance.
+		float distance = std::max(glm::distance(screen.center, cameraPos), 1e-3f);
+		float pixels = screen.radius * projection[1][1] / distance * viewportHeight;
+		if (pixels >= FULL_RATE_PIXELS) {
+			screen.interval = 0;
+			++m_fullRateScreens;
+		}
+		else {
+			screen.interval = 1 / std::max(MIN_RATE_HZ, MAX_RATE_HZ * pixels / FULL_RATE_PIXELS);
+		}
+		if (!screen.valid || screen.sinceRefresh >= screen.interval) {
+			m_dueScreens.push_back(i);
+		}
+	}
+	m_lastDue = static_cast<uint32_t>(m_dueScreens.size());
+	m_lastRefreshes = 0;
+	if (m_dueScreens.empty()) {
+		return;
+	}
+
+	// Screens never rendered go first, then those furthest past their interval.
+	auto overdue = [&](uint32_t index) {
+		auto& screen = m_screens[index];
+		return screen.valid ? screen.sinceRefresh / std::max(screen.interval, 1e-3f) : std::numeric_limits<float>::max();
+	};
+	std::sort(m_dueScreens.begin(), m_dueScreens.end(), [&](uint32_t a, uint32_t b) { return overdue(a) > overdue(b); });
+
+	// Until a refresh has been timed, refresh one screen per frame.
+	uint32_t refreshes = 1;
+	if (m_timer.samples() > 0 && m_timedRefreshes > 0) {
+		double refreshMilliseconds = m_timer.averageMilliseconds() * m_timedFrames / m_timedRefreshes;
+		refreshes = static_cast<uint32_t>(std::clamp(budgetMilliseconds / std::max(refreshMilliseconds, 1e-3),
+			1.0, static_cast<double>(m_dueScreens.size())));
+	}
+
+	int32_t previousProgram;
+	int32_t previousViewport[4];
+	int32_t previousFramebuffer;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	m_timer.begin();
+	for (uint32_t i = 0; i < refreshes; i++) {
+		refresh(m_screens[m_dueScreens[i]]);
+	}
+	m_timer.end();
+	m_lastRefreshes = refreshes;
+	m_timedRefreshes += refreshes;
+	if (++m_timedFrames == TIMING_WINDOW_FRAMES) {
+		m_timer.reset();
+		m_timedFrames = 0;
+		m_timedRefreshes = 0;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glUseProgram(previousProgram);
+}
+
+void ScreenRenderTargets::refresh(Screen& screen) {
+	glBindFramebuffer(GL_FRAMEBUFFER, screen.framebuffer);
+	glViewport(0, 0, screen.width, screen.height);
+	const float black[] = { 0, 0, 0, 1 };
+	const float farDepth = 1.0f;
+	glClearBufferfv(GL_COLOR, 0, black);
+	glClearBufferfv(GL_DEPTH, 0, &farDepth);
+	screen.content->render(ScreenFrame{ screen.width, screen.height, screen.texture, screen.time, screen.sinceRefresh });
+
+	glBindTexture(GL_TEXTURE_2D, screen.texture);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	screen.sinceRefresh = 0;
+	screen.valid = true;
+}
@@ -0,0 +1,197 @@
+#include "SdfFont.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+	struct PixelGlyph {
+		char character;
+		// Rows from top to bottom; '#' is a lit pixel.
+		const char* rows[SdfFont::GLYPH_ROWS];
+	};
+
+	const PixelGlyph PIXEL_FONT[] = {
+		{ ' ', { "     ", "     ", "     ", "     ", "     ", "     ", "     " } },
+		{ '!', { "  #  ", "  #  ", "  #  ", "  #  ", "  #  ", "     ", "  #  " } },
+		{ '"', { " # # ", " # # ", "     ", "     ", "     ", "     ", "     " } },
+		{ '#', { " # # ", " # # ", "#####", " # # ", "#####", " # # ", " # # " } },
+		{ '%', { "##   ", "##  #", "   # ", "  #  ", " #   ", "#  ##", "   ##" } },
+		{ '&', { " ##  ", "#  # ", "# #  ", " #   ", "# # #", "#  # ", " ## #" } },
+		{ '\'', { "  #  ", "  #  ", "     ", "     ", "     ", "     ", "     " } },
+		{ '(', { "   # ", "  #  ", " #   ", " #   ", " #   ", "  #  ", "   # " } },
+		{ ')', { " #   ", "  #  ", "   # ", "   # ", "   # ", "  #  ", " #   " } },
+		{ '*', { "     ", "  #  ", "# # #", " ### ", "# # #", "  #  ", "     " } },
+		{ '+', { "     ", "  #  ", "  #  ", "#####", "  #  ", "  #  ", "     " } },
+		{ ',', { "     ", "     ", "     ", "     ", "  ## ", "   # ", "  #  " } },
+		{ '-', { "     ", "     ", "     ", "#####", "     ", "     ", "     " } },
+		{ '.', { "     ", "     ", "     ", "     ", "     ", " ##  ", " ##  " } },
+		{ '/', { "     ", "    #", "   # ", "  #  ", " #   ", "#    ", "     " } },
+		{ '0', { " ### ", "#   #", "#  ##", "# # #", "##  #", "#   #", " ### " } },
+		{ '1', { "  #  ", " ##  ", "  #  ", "  #  ", "  #  ", "  #  ", " ### " } },
+		{ '2', { " ### ", "#   #", "    #", "   # ", "  #  ", " #   ", "#####" } },
+		{ '3', { "#####", "   # ", "  #  ", "   # ", "    #", "#   #", " ### " } },
+		{ '4', { "   # ", "  ## ", " # # ", "#  # ", "#####", "   # ", "   # " } },
+		{ '5', { "#####", "#    ", "#### ", "    #", "    #", "#   #", " ### " } },
+		{ '6', { "  ## ", " #   ", "#    ", "#### ", "#   #", "#   #", " ### " } },
+		{ '7', { "#####", "    #", "   # ", "  #  ", " #   ", " #   ", " #   " } },
+		{ '8', { " ### ", "#   #", "#   #", " ### ", "#   #", "#   #", " ### " } },
+		{ '9', { " ### ", "#   #", "#   #", " ####", "    #", "   # ", " ##  " } },
+		{ ':', { "     ", " ##  ", " ##  ", "     ", " ##  ", " ##  ", "     " } },
+		{ ';', { "     ", " ##  ", " ##  ", "     ", " ##  ", "  #  ", " #   " } },
+		{ '<', { "   # ", "  #  ", " #   ", "#    ", " #   ", "  #  ", "   # " } },
+		{ '=', { "     ", "     ", "#####", "     ", "#####", "     ", "     " } },
+		{ '>', { " #   ", "  #  ", "   # ", "    #", "   # ", "  #  ", " #   " } },
+		{ '?', { " ### ", "#   #", "    #", "   # ", "  #  ", "     ", "  #  " } },
+		{ '@', { " ### ", "#   #", "    #", " ## #", "# # #", "# # #", " ### " } },
+		{ 'A', { " ### ", "#   #", "#   #", "#####", "#   #", "#   #", "#   #" } },
+		{ 'B', { "#### ", "#   #", "#   #", "#### ", "#   #", "#   #", "#### " } },
+		{ 'C', { " ### ", "#   #", "#    ", "#    ", "#    ", "#   #", " ### " } },
+		{ 'D', { "#### ", "#   #", "#   #", "#   #", "#   #", "#   #", "#### " } },
+		{ 'E', { "#####", "#    ", "#    ", "#### ", "#    ", "#    ", "#####" } },
+		{ 'F', { "#####", "#    ", "#    ", "#### ", "#    ", "#    ", "#    " } },
+		{ 'G', { " ### ", "#   #", "#    ", "# ###", "#   #", "#   #", " ####" } },
+		{ 'H', { "#   #", "#   #", "#   #", "#####", "#   #", "#   #", "#   #" } },
+		{ 'I', { " ### ", "  #  ", "  #  ", "  #  ", "  #  ", "  #  ", " ### " } },
+		{ 'J', { "  ###", "   # ", "   # ", "   # ", "   # ", "#  # ", " ##  " } },
+		{ 'K', { "#   #", "#  # ", "# #  ", "##   ", "# #  ", "#  # ", "#   #" } },
+		{ 'L', { "#    ", "#    ", "#    ", "#    ", "#    ", "#    ", "#####" } },
+		{ 'M', { "#   #", "## ##", "# # #", "# # #", "#   #", "#   #", "#   #" } },
+		{ 'N', { "#   #", "#   #", "##  #", "# # #", "#  ##", "#   #", "#   #" } },
+		{ 'O', { " ### ", "#   #", "#   #", "#   #", "#   #", "#   #", " ### " } },
+		{ 'P', { "#### ", "#   #", "#   #", "#### ", "#    ", "#    ", "#    " } },
+		{ 'Q', { " ### ", "#   #", "#   #", "#   #", "# # #", "#  # ", " ## #" } },
+		{ 'R', { "#### ", "#   #", "#   #", "#### ", "# #  ", "#  # ", "#   #" } },
+		{ 'S', { " ####", "#    ", "#    ", " ### ", "    #", "    #", "#### " } },
+		{ 'T', { "#####", "  #  ", "  #  ", "  #  ", "  #  ", "  #  ", "  #  " } },
+		{ 'U', { "#   #", "#   #", "#   #", "#   #", "#   #", "#   #", " ### " } },
+		{ 'V', { "#   #", "#   #", "#   #", "#   #", "#   #", " # # ", "  #  " } },
+		{ 'W', { "#   #", "#   #", "#   #", "# # #", "# # #", "# # #", " # # " } },
+		{ 'X', { "#   #", "#   #", " # # ", "  #  ", " # # ", "#   #", "#   #" } },
+		{ 'Y', { "#   #", "#   #", " # # ", "  #  ", "  #  ", "  #  ", "  #  " } },
+		{ 'Z', { "#####", "    #", "   # ", "  #  ", " #   ", "#    ", "#####" } },
+		{ '_', { "     ", "     ", "     ", "     ", "     ", "     ", "#####" } },
+	};
+	const uint32_t PIXEL_GLYPH_COUNT = sizeof(PIXEL_FONT) / sizeof(PIXEL_FONT[0]);
+
+	const uint32_t CELLS_PER_ROW = SdfFont::PAGE_SIZE / SdfFont::CELL_SIZE;
+	const uint32_t CELLS_PER_PAGE = CELLS_PER_ROW * CELLS_PER_ROW;
+
+	bool isLit(const PixelGlyph& glyph, int32_t column, int32_t row) {
+		if (column < 0 || row < 0 || column >= static_cast<int32_t>(SdfFont::GLYPH_COLUMNS)
+			|| row >= static_cast<int32_t>(SdfFont::GLYPH_ROWS)) {
+			return false;
+		}
+		// Rows count up from the bottom here, as texture rows do.
+		return glyph.rows[SdfFont::GLYPH_ROWS - 1 - row][column] == '#';
+	}
+
+	/**
+	 * @brief Writes the distance field of one glyph into its cell, in font pixels converted to
+	 * [0, 1] with the edge at 0.5. The distance is exact: to the nearest lit pixel square from
+	 * outside, and to the nearest unlit one from inside.
+	 */
+	void rasterizeGlyph(const PixelGlyph& glyph, uint8_t* page, uint32_t cellX, uint32_t cellY) {
+		const float padX = static_cast<float>((SdfFont::CELL_SIZE - SdfFont::GLYPH_COLUMNS * SdfFont::CELL_SCALE) / 2);
+		const float padY = static_cast<float>((SdfFont::CELL_SIZE - SdfFont::GLYPH_ROWS * SdfFont::CELL_SCALE) / 2);
+		const float reach = SdfFont::SPREAD / SdfFont::CELL_SCALE;
+		for (uint32_t y = 0; y < SdfFont::CELL_SIZE; y++) {
+			for (uint32_t x = 0; x < SdfFont::CELL_SIZE; x++) {
+				float u = (x + 0.5f - padX) / SdfFont::CELL_SCALE;
+				float v = (y + 0.5f - padY) / SdfFont::CELL_SCALE;
+				auto column = static_cast<int32_t>(std::floor(u));
+				auto row = static_cast<int32_t>(std::floor(v));
+				bool inside = isLit(glyph, column, row);
+
+				// Only squares within the spread can be nearer than it.
+				float nearest = reach;
+				auto radius = static_cast<int32_t>(std::ceil(reach)) + 1;
+				for (int32_t j = row - radius; j <= row + radius; j++) {
+					for (int32_t i = column - radius; i <= column + radius; i++) {
+						if (isLit(glyph, i, j) == inside) {
+							continue;
+						}
+						float dx = std::max({ i - u, 0.0f, u - (i + 1) });
+						float dy = std::max({ j - v, 0.0f, v - (j + 1) });
+						nearest = std::min(nearest, std::sqrt(dx * dx + dy * dy));
+					}
+				}
+				float distance = inside ? nearest : -nearest;
+				float value = std::clamp(0.5f + 0.5f * distance / reach, 0.0f, 1.0f);
+				page[(cellY + y) * SdfFont::PAGE_SIZE + cellX + x] = static_cast<uint8_t>(std::lround(value * 255.0f));
+			}
+		}
+	}
+}
+
+SdfFont::SdfFont(uint32_t threads) : m_buildThreads(0), m_buildMilliseconds(0) {
+	auto start = std::chrono::steady_clock::now();
+	m_glyphIndex.fill(-1);
+	uint32_t pageCount = (PIXEL_GLYPH_COUNT + CELLS_PER_PAGE - 1) / CELLS_PER_PAGE;
+	std::vector<std::vector<uint8_t>> pages(pageCount, std::vector<uint8_t>(PAGE_SIZE * PAGE_SIZE, 0));
+	for (uint32_t i = 0; i < PIXEL_GLYPH_COUNT; i++) {
+		uint32_t cell = i % CELLS_PER_PAGE;
+		glm::vec2 corner(cell % CELLS_PER_ROW * CELL_SIZE, cell / CELLS_PER_ROW * CELL_SIZE);
+		m_glyphs.push_back(SdfGlyph{ i / CELLS_PER_PAGE, corner / static_cast<float>(PAGE_SIZE),
+			(corner + glm::vec2(CELL_SIZE)) / static_cast<float>(PAGE_SIZE) });
+		m_glyphIndex[static_cast<uint8_t>(PIXEL_FONT[i].character)] = static_cast<int32_t>(i);
+	}
+	if (m_glyphIndex['?'] < 0) {
+		throw std::runtime_error("The pixel font has no '?' glyph");
+	}
+
+	// Glyphs are interleaved across the workers; each writes only its own glyphs' cells.
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	m_buildThreads = std::min(threads, PIXEL_GLYPH_COUNT);
+	auto work = [&](uint32_t worker) {
+		for (uint32_t i = worker; i < PIXEL_GLYPH_COUNT; i += m_buildThreads) {
+			uint32_t cell = i % CELLS_PER_PAGE;
+			rasterizeGlyph(PIXEL_FONT[i], pages[i / CELLS_PER_PAGE].data(),
+				cell % CELLS_PER_ROW * CELL_SIZE, cell / CELLS_PER_ROW * CELL_SIZE);
+		}
+	};
+	std::vector<std::thread> workers;
+	for (uint32_t worker = 1; worker < m_buildThreads; worker++) {
+		workers.emplace_back(work, worker);
+	}
+	work(0);
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	// Uploads stay on this thread, which owns the context.
+	m_pages.resize(pageCount);
+	glGenTextures(pageCount, m_pages.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (uint32_t i = 0; i < pageCount; i++) {
+		glBindTexture(GL_TEXTURE_2D, m_pages[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, PAGE_SIZE, PAGE_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, pages[i].data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	m_buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+SdfFont::~SdfFont() {
+	if (!m_pages.empty()) {
+		glDeleteTextures(static_cast<int32_t>(m_pages.size()), m_pages.data());
+	}
+}
+
+const SdfGlyph& SdfFont::glyph(char c) const {
+	auto code = static_cast<uint8_t>(c);
+	if (code >= 'a' && code <= 'z') {
+		code = static_cast<uint8_t>(code - 'a' + 'A');
+	}
+	int32_t index = code < m_glyphIndex.size() ? m_glyphIndex[code] : -1;
+	return m_glyphs[index >= 0 ? index : m_glyphIndex['?']];
+}
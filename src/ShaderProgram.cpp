@@ -90,6 +90,53 @@ void ShaderProgram::load(const std::string& vertexShaderPath, const std::string&
     glDeleteShader(fragment);
 }
 
+void ShaderProgram::loadCompute(const std::string& computeShaderPath)
+{
+    std::string computeCode;
+    std::ifstream cShaderFile;
+    cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    try
+    {
+        cShaderFile.open(computeShaderPath);
+        std::stringstream cShaderStream;
+        cShaderStream << cShaderFile.rdbuf();
+        cShaderFile.close();
+        computeCode = cShaderStream.str();
+    }
+    catch (std::ifstream::failure& e)
+    {
+        throw std::runtime_error("Failed to locate compute shader file");
+    }
+
+    const char* cShaderCode = computeCode.c_str();
+
+    unsigned int compute;
+    int success;
+    char infoLog[512];
+
+    compute = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(compute, 1, &cShaderCode, NULL);
+    glCompileShader(compute);
+    glGetShaderiv(compute, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(compute, 512, NULL, infoLog);
+        throw std::runtime_error(infoLog);
+    };
+
+    m_programId = glCreateProgram();
+    glAttachShader(m_programId, compute);
+    glLinkProgram(m_programId);
+    glGetProgramiv(m_programId, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(m_programId, 512, NULL, infoLog);
+        throw std::runtime_error(infoLog);
+    }
+
+    glDeleteShader(compute);
+}
+
 void ShaderProgram::activate()
 {
     glUseProgram(m_programId);
@@ -105,9 +152,14 @@ void ShaderProgram::setUniform(const std::string& uniformName, int32_t value)
     glUniform1i(glGetUniformLocation(m_programId, uniformName.c_str()), value);
 }
 
+void ShaderProgram::setUniform(const std::string& uniformName, uint32_t value)
+{
+    glUniform1ui(glGetUniformLocation(m_programId, uniformName.c_str()), value);
+}
+
 void ShaderProgram::setUniform(const std::string& uniformName, float value)
 {
-    glUniform1f(glGetUniformLocation(m_programId, uniformName.c_str()), (int)value);
+    glUniform1f(glGetUniformLocation(m_programId, uniformName.c_str()), value);
 }
 
 void ShaderProgram::setUniform(const std::string& uniformName, const glm::vec2& value)
@@ -115,6 +167,11 @@ void ShaderProgram::setUniform(const std::string& uniformName, const glm::vec2&
     glUniform2fv(glGetUniformLocation(m_programId, uniformName.c_str()), 1, &value[0]);
 }
 
+void ShaderProgram::setUniform(const std::string& uniformName, const glm::ivec2& value)
+{
+    glUniform2iv(glGetUniformLocation(m_programId, uniformName.c_str()), 1, &value[0]);
+}
+
 void ShaderProgram::setUniform(const std::string& uniformName, const glm::vec3& value)
 {
     glUniform3fv(glGetUniformLocation(m_programId, uniformName.c_str()), 1, &value[0]);
@@ -0,0 +1,69 @@
+#include "SoundBank.h"
+#include "SoundDecoder.h"
+#include <SFML/Audio.hpp>
+#include <stdexcept>
+
+SoundBank::SoundBank(float streamThresholdSeconds) : m_streamThreshold(streamThresholdSeconds) {
+}
+
+bool SoundBank::shouldStream(const std::string& path) const {
+	sf::InputSoundFile file;
+	if (!file.openFromFile(path)) {
+		throw std::runtime_error("Could not open sound file " + path);
+	}
+	double seconds = static_cast<double>(file.getSampleCount()) / file.getChannelCount() / file.getSampleRate();
+	return seconds > m_streamThreshold;
+}
+
+std::shared_ptr<const SoundClip> SoundBank::load(const std::string& path, uint32_t channels) {
+	auto key = std::make_pair(path, channels);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto found = m_clips.find(key);
+		if (found != m_clips.end()) {
+			return found->second;
+		}
+	}
+
+	// Decode without holding the lock; if two threads race to load the same clip, the first
+	// one stored wins.
+	SoundDecoder decoder(path, channels);
+	auto clip = std::make_shared<SoundClip>();
+	clip->channels = channels;
+	clip->samples.reserve((decoder.lengthFrames() + decoder.maxChunkFrames()) * channels);
+	const float* samples;
+	while (size_t frames = decoder.decode(samples)) {
+		clip->samples.insert(clip->samples.end(), samples, samples + frames * channels);
+	}
+	clip->samples.shrink_to_fit();
+	clip->frames = clip->samples.size() / channels;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_clips.emplace(key, std::move(clip)).first->second;
+}
+
+void SoundBank::unloadUnused() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto i = m_clips.begin(); i != m_clips.end();) {
+		if (i->second.use_count() == 1) {
+			i = m_clips.erase(i);
+		}
+		else {
+			++i;
+		}
+	}
+}
+
+size_t SoundBank::memoryUsage() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t bytes = 0;
+	for (auto& [key, clip] : m_clips) {
+		bytes += clip->samples.capacity() * sizeof(float);
+	}
+	return bytes;
+}
+
+size_t SoundBank::clipCount() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_clips.size();
+}
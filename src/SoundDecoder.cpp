@@ -0,0 +1,90 @@
+#include "SoundDecoder.h"
+#include "AudioMixer.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+SoundDecoder::SoundDecoder(const std::string& path, uint32_t channels)
+	: m_channels(channels), m_phase(0), m_history{ 0, 0 } {
+	if (!m_file.openFromFile(path)) {
+		throw std::runtime_error("Could not open sound file " + path);
+	}
+	m_fileChannels = m_file.getChannelCount();
+	m_fileFrames = m_file.getSampleCount() / m_fileChannels;
+	m_step = static_cast<double>(m_file.getSampleRate()) / MIXER_SAMPLE_RATE;
+
+	m_fileScratch.resize(CHUNK_FRAMES * m_fileChannels);
+	m_convertScratch.resize(CHUNK_FRAMES * m_channels);
+	m_outputScratch.resize(maxChunkFrames() * m_channels);
+}
+
+uint64_t SoundDecoder::lengthFrames() const {
+	return static_cast<uint64_t>(std::ceil(m_fileFrames / m_step));
+}
+
+size_t SoundDecoder::maxChunkFrames() const {
+	return static_cast<size_t>(std::ceil(CHUNK_FRAMES / m_step)) + 1;
+}
+
+size_t SoundDecoder::memoryUsage() const {
+	return m_fileScratch.capacity() * sizeof(int16_t)
+		+ (m_convertScratch.capacity() + m_outputScratch.capacity()) * sizeof(float);
+}
+
+size_t SoundDecoder::decode(const float*& samples) {
+	uint64_t framesRead = m_file.read(m_fileScratch.data(), CHUNK_FRAMES * m_fileChannels) / m_fileChannels;
+	if (framesRead == 0) {
+		return 0;
+	}
+
+	// Convert to floats with the output channel count: downmix for mono, duplicate mono for stereo.
+	const float scale = 1.0f / 32768.0f;
+	for (uint64_t f = 0; f < framesRead; f++) {
+		const int16_t* frame = m_fileScratch.data() + f * m_fileChannels;
+		if (m_channels == 1) {
+			float sum = 0;
+			for (uint32_t c = 0; c < m_fileChannels; c++) {
+				sum += frame[c];
+			}
+			m_convertScratch[f] = sum * scale / m_fileChannels;
+		}
+		else {
+			m_convertScratch[f * 2] = frame[0] * scale;
+			m_convertScratch[f * 2 + 1] = frame[m_fileChannels > 1 ? 1 : 0] * scale;
+		}
+	}
+
+	// Resample linearly. Position 0 is the last frame of the previous chunk (the history), and
+	// position k is frame k - 1 of this chunk.
+	size_t outputFrames = 0;
+	double pos = m_phase;
+	while (pos < framesRead) {
+		auto index = static_cast<size_t>(pos);
+		auto frac = static_cast<float>(pos - index);
+		for (uint32_t c = 0; c < m_channels; c++) {
+			float a = index == 0 ? m_history[c] : m_convertScratch[(index - 1) * m_channels + c];
+			float b = m_convertScratch[index * m_channels + c];
+			m_outputScratch[outputFrames * m_channels + c] = a + (b - a) * frac;
+		}
+		++outputFrames;
+		pos += m_step;
+	}
+	m_phase = pos - framesRead;
+	for (uint32_t c = 0; c < m_channels; c++) {
+		m_history[c] = m_convertScratch[(framesRead - 1) * m_channels + c];
+	}
+
+	samples = m_outputScratch.data();
+	return outputFrames;
+}
+
+void SoundDecoder::seek(uint64_t frame) {
+	auto fileFrame = std::min(static_cast<uint64_t>(frame * m_step), m_fileFrames);
+	m_file.seek(fileFrame * m_fileChannels);
+	m_phase = 0;
+	m_history[0] = m_history[1] = 0;
+}
+
+void SoundDecoder::rewind() {
+	m_file.seek(0);
+}
@@ -0,0 +1,179 @@
+#include "TextRenderer.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
+static_assert(sizeof(TextRenderer::TextVertex) == 32, "TextVertex must match the attributes of text.vert");
+
+namespace {
+	const int32_t ATLAS_UNIT = 0;
+
+	uint32_t packColor(const glm::vec4& color) {
+		auto channel = [](float value, uint32_t shift) {
+			return static_cast<uint32_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f) << shift;
+		};
+		// Little-endian, so that the bytes read as R, G, B, A.
+		return channel(color.x, 0) | channel(color.y, 8) | channel(color.z, 16) | channel(color.w, 24);
+	}
+}
+
+TextRenderer::TextRenderer()
+	: m_vao(0), m_vertexBuffer(0), m_indexBuffer(0), m_indexedQuads(0), m_stringCount(0), m_pendingMilliseconds(0),
+	m_lastStringCount(0), m_lastGlyphCount(0), m_lastDrawCount(0), m_cpuMilliseconds(0) {
+	m_program.load("shaders/text.vert", "shaders/text.frag");
+	m_pages.resize(m_font.pageCount());
+
+	glGenVertexArrays(1, &m_vao);
+	glGenBuffers(1, &m_vertexBuffer);
+	glGenBuffers(1, &m_indexBuffer);
+	glBindVertexArray(m_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), reinterpret_cast<const void*>(offsetof(TextVertex, position)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), reinterpret_cast<const void*>(offsetof(TextVertex, texCoord)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TextVertex), reinterpret_cast<const void*>(offsetof(TextVertex, color)));
+	// The element buffer binding is part of the VAO's state.
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	reserveIndices(1024);
+}
+
+TextRenderer::~TextRenderer() {
+	glDeleteVertexArrays(1, &m_vao);
+	uint32_t buffers[] = { m_vertexBuffer, m_indexBuffer };
+	glDeleteBuffers(2, buffers);
+}
+
+void TextRenderer::reserveIndices(uint32_t quads) {
+	if (quads <= m_indexedQuads) {
+		return;
+	}
+	m_indexedQuads = std::max(quads, m_indexedQuads * 2);
+	// Every quad is two triangles of the same four-vertex pattern, so one index buffer serves any
+	// range of quads.
+	std::vector<uint32_t> indices;
+	indices.reserve(m_indexedQuads * 6);
+	for (uint32_t i = 0; i < m_indexedQuads; i++) {
+		uint32_t first = i * 4;
+		for (uint32_t corner : { 0u, 1u, 2u, 2u, 1u, 3u }) {
+			indices.push_back(first + corner);
+		}
+	}
+	glBindVertexArray(m_vao);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+	glBindVertexArray(0);
+}
+
+void TextRenderer::addQuads(const std::string& text, const glm::vec4& color, bool screenSpace,
+	const glm::mat4& transform, const glm::vec2& origin, float height) {
+	auto start = std::chrono::steady_clock::now();
+	uint32_t packedColor = packColor(color);
+	float flag = screenSpace ? 1.0f : 0.0f;
+	float quadSize = SdfFont::QUAD_SIZE * height;
+	// Screen space counts pixels downwards, so glyphs are flipped there.
+	float up = screenSpace ? -1.0f : 1.0f;
+	glm::vec2 pen = origin;
+	for (char c : text) {
+		if (c != ' ') {
+			auto& glyph = m_font.glyph(c);
+			glm::vec2 corner = pen + glm::vec2(SdfFont::QUAD_OFFSET_X, up * SdfFont::QUAD_OFFSET_Y) * height;
+			glm::vec2 corners[] = {
+				corner,
+				corner + glm::vec2(quadSize, 0),
+				corner + glm::vec2(0, up * quadSize),
+				corner + glm::vec2(quadSize, up * quadSize)
+			};
+			glm::vec2 texCoords[] = {
+				glyph.uvMin,
+				glm::vec2(glyph.uvMax.x, glyph.uvMin.y),
+				glm::vec2(glyph.uvMin.x, glyph.uvMax.y),
+				glyph.uvMax
+			};
+			auto& quads = screenSpace ? m_pages[glyph.page].screen : m_pages[glyph.page].world;
+			for (uint32_t i = 0; i < 4; i++) {
+				glm::vec3 position = screenSpace ? glm::vec3(corners[i], 0)
+					: glm::vec3(transform * glm::vec4(corners[i], 0, 1));
+				quads.push_back(TextVertex{ position, flag, texCoords[i], packedColor, 0 });
+			}
+		}
+		pen.x += SdfFont::ADVANCE * height;
+	}
+	++m_stringCount;
+	m_pendingMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TextRenderer::addWorldText(const std::string& text, const glm::mat4& transform, float height, const glm::vec4& color) {
+	addQuads(text, color, false, transform, glm::vec2(0), height);
+}
+
+void TextRenderer::addScreenText(const std::string& text, const glm::vec2& position, float height, const glm::vec4& color) {
+	// The pen runs along the baseline, one cap height below the top.
+	addQuads(text, color, true, glm::mat4(1), position + glm::vec2(0, height), height);
+}
+
+void TextRenderer::render(const glm::mat4& view, const glm::mat4& projection, uint32_t width, uint32_t height) {
+	auto start = std::chrono::steady_clock::now();
+	m_uploadScratch.clear();
+	for (auto& page : m_pages) {
+		m_uploadScratch.insert(m_uploadScratch.end(), page.world.begin(), page.world.end());
+		m_uploadScratch.insert(m_uploadScratch.end(), page.screen.begin(), page.screen.end());
+	}
+	auto quadCount = static_cast<uint32_t>(m_uploadScratch.size() / 4);
+	m_lastStringCount = m_stringCount;
+	m_lastGlyphCount = quadCount;
+	m_lastDrawCount = 0;
+	m_stringCount = 0;
+	if (quadCount == 0 || width == 0 || height == 0) {
+		for (auto& page : m_pages) {
+			page.world.clear();
+			page.screen.clear();
+		}
+		m_cpuMilliseconds = m_pendingMilliseconds;
+		m_pendingMilliseconds = 0;
+		return;
+	}
+	reserveIndices(quadCount);
+	// Orphan the previous frame's quads rather than wait for the GPU to finish with them.
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, m_uploadScratch.size() * sizeof(TextVertex), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, m_uploadScratch.size() * sizeof(TextVertex), m_uploadScratch.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	int32_t previousProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	m_program.activate();
+	m_program.setUniform("viewProjection", projection * view);
+	m_program.setUniform("viewportSize", glm::vec2(width, height));
+	m_program.setUniform("atlas", ATLAS_UNIT);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_FALSE);
+	glBindVertexArray(m_vao);
+	glActiveTexture(GL_TEXTURE0 + ATLAS_UNIT);
+	uint32_t firstQuad = 0;
+	for (uint32_t i = 0; i < m_pages.size(); i++) {
+		auto& page = m_pages[i];
+		auto pageQuads = static_cast<uint32_t>((page.world.size() + page.screen.size()) / 4);
+		if (pageQuads > 0) {
+			glBindTexture(GL_TEXTURE_2D, m_font.pageTexture(i));
+			glDrawElements(GL_TRIANGLES, pageQuads * 6, GL_UNSIGNED_INT,
+				reinterpret_cast<const void*>(static_cast<uintptr_t>(firstQuad) * 6 * sizeof(uint32_t)));
+			++m_lastDrawCount;
+		}
+		firstQuad += pageQuads;
+		page.world.clear();
+		page.screen.clear();
+	}
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+	glUseProgram(previousProgram);
+	m_cpuMilliseconds = m_pendingMilliseconds
+		+ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	m_pendingMilliseconds = 0;
+}
@@ -0,0 +1,301 @@
+#include "TextureStreamer.h"
+#include "Mesh3D.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// Levels no larger than this are always resident, so every texture can be sampled at once.
+	const uint32_t COARSE_LEVEL_SIZE = 64;
+	const uint32_t BYTES_PER_TEXEL = 4;
+
+	/**
+	 * @brief Box-filters an RGBA8 level down to half its size; odd edges reuse their last texel.
+	 */
+	std::vector<uint8_t> downsample(const std::vector<uint8_t>& texels, uint32_t width, uint32_t height,
+		uint32_t newWidth, uint32_t newHeight) {
+		std::vector<uint8_t> result(newWidth * newHeight * BYTES_PER_TEXEL);
+		for (uint32_t y = 0; y < newHeight; y++) {
+			uint32_t y0 = std::min(2 * y, height - 1);
+			uint32_t y1 = std::min(2 * y + 1, height - 1);
+			for (uint32_t x = 0; x < newWidth; x++) {
+				uint32_t x0 = std::min(2 * x, width - 1);
+				uint32_t x1 = std::min(2 * x + 1, width - 1);
+				for (uint32_t c = 0; c < BYTES_PER_TEXEL; c++) {
+					uint32_t sum = texels[(y0 * width + x0) * BYTES_PER_TEXEL + c]
+						+ texels[(y0 * width + x1) * BYTES_PER_TEXEL + c]
+						+ texels[(y1 * width + x0) * BYTES_PER_TEXEL + c]
+						+ texels[(y1 * width + x1) * BYTES_PER_TEXEL + c];
+					result[(y * newWidth + x) * BYTES_PER_TEXEL + c] = static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+		}
+		return result;
+	}
+}
+
+TextureStreamer::TextureStreamer(size_t budgetBytes, size_t uploadBytesPerFrame)
+	: m_budgetBytes(budgetBytes), m_uploadBytesPerFrame(uploadBytesPerFrame) {
+	m_stats.budgetBytes = budgetBytes;
+}
+
+void TextureStreamer::buildLevels(StreamedTexture& texture, const StbImage& image) {
+	auto width = static_cast<uint32_t>(image.getWidth());
+	auto height = static_cast<uint32_t>(image.getHeight());
+	const uint8_t* data = image.getData();
+	texture.levels.clear();
+	texture.levels.push_back(MipLevel{ width, height,
+		std::vector<uint8_t>(data, data + width * height * BYTES_PER_TEXEL) });
+	while (width > 1 || height > 1) {
+		uint32_t newWidth = std::max(width / 2, 1u);
+		uint32_t newHeight = std::max(height / 2, 1u);
+		auto& previous = texture.levels.back();
+		texture.levels.push_back(MipLevel{ newWidth, newHeight,
+			downsample(previous.texels, width, height, newWidth, newHeight) });
+		width = newWidth;
+		height = newHeight;
+	}
+
+	chooseCoarseLevel(texture);
+}
+
+void TextureStreamer::chooseCoarseLevel(StreamedTexture& texture) {
+	auto lastLevel = static_cast<uint32_t>(texture.levels.size() - 1);
+	texture.coarseLevel = 0;
+	while (texture.coarseLevel < lastLevel
+		&& std::max(texture.levels[texture.coarseLevel].width, texture.levels[texture.coarseLevel].height)
+			> COARSE_LEVEL_SIZE) {
+		++texture.coarseLevel;
+	}
+}
+
+void TextureStreamer::uploadCoarseLevels(StreamedTexture& texture) {
+	auto lastLevel = static_cast<uint32_t>(texture.levels.size() - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, lastLevel);
+	// Levels finer than the coarse ones stay undefined until they are streamed in; the texture is
+	// complete as long as the base level is the finest defined one.
+	for (uint32_t level = texture.coarseLevel; level <= lastLevel; level++) {
+		auto& mip = texture.levels[level];
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+			mip.texels.data());
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.coarseLevel);
+
+	texture.residentLevel = texture.coarseLevel;
+	texture.requestedLevel = texture.coarseLevel;
+	texture.wantedLevel = texture.coarseLevel;
+}
+
+Texture TextureStreamer::create(StreamedTexture&& texture, const std::string& samplerName) {
+	glGenTextures(1, &texture.textureId);
+	glBindTexture(GL_TEXTURE_2D, texture.textureId);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	uploadCoarseLevels(texture);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_textureIndices[texture.textureId] = m_textures.size();
+	m_textures.push_back(std::move(texture));
+	return Texture{ m_textures.back().textureId, samplerName };
+}
+
+Texture TextureStreamer::load(const StbImage& image, const std::string& samplerName) {
+	StreamedTexture texture;
+	buildLevels(texture, image);
+	return create(std::move(texture), samplerName);
+}
+
+Texture TextureStreamer::loadLevels(std::vector<MipLevel>&& levels, const std::string& samplerName) {
+	StreamedTexture texture;
+	texture.levels = std::move(levels);
+	chooseCoarseLevel(texture);
+	return create(std::move(texture), samplerName);
+}
+
+const std::vector<TextureStreamer::MipLevel>* TextureStreamer::levels(uint32_t textureId) const {
+	auto found = m_textureIndices.find(textureId);
+	return found == m_textureIndices.end() ? nullptr : &m_textures[found->second].levels;
+}
+
+bool TextureStreamer::reload(uint32_t textureId, const StbImage& image) {
+	auto found = m_textureIndices.find(textureId);
+	if (found == m_textureIndices.end()) {
+		return false;
+	}
+	auto& texture = m_textures[found->second];
+	glBindTexture(GL_TEXTURE_2D, textureId);
+	// Free every level of the old image, whose sizes may not match the new one's.
+	for (auto level = texture.residentLevel; level < texture.levels.size(); level++) {
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+	buildLevels(texture, image);
+	uploadCoarseLevels(texture);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return true;
+}
+
+bool TextureStreamer::unload(uint32_t textureId) {
+	auto found = m_textureIndices.find(textureId);
+	if (found == m_textureIndices.end()) {
+		return false;
+	}
+	// Move the last texture into the freed slot.
+	auto index = found->second;
+	m_textureIndices.erase(found);
+	if (index != m_textures.size() - 1) {
+		m_textures[index] = std::move(m_textures.back());
+		m_textureIndices[m_textures[index].textureId] = index;
+	}
+	m_textures.pop_back();
+	glDeleteTextures(1, &textureId);
+	return true;
+}
+
+void TextureStreamer::beginFrame() {
+	for (auto& texture : m_textures) {
+		texture.requestedLevel = texture.coarseLevel;
+	}
+}
+
+void TextureStreamer::requestDraws(const std::vector<MeshDraw>& draws, const glm::mat4& view,
+	const glm::mat4& projection, uint32_t viewportHeight) {
+	// A sphere of radius r at view distance d covers about r * projection[1][1] / d of the
+	// viewport's half height.
+	float pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+	for (auto& draw : draws) {
+		auto& mesh = *draw.mesh;
+		glm::mat4 modelView = view * draw.model;
+		glm::vec3 center = glm::vec3(modelView * glm::vec4(mesh.getBoundsCenter(), 1));
+		float scale = std::max(glm::length(glm::vec3(modelView[0])),
+			std::max(glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))));
+		float radius = mesh.getBoundsRadius() * scale;
+		float distance = glm::length(center);
+
+		// Assume the mesh's UVs span its texture once: the level whose size matches the mesh's
+		// on-screen diameter has about one texel per pixel. A camera inside the sphere needs level 0.
+		float pixels = distance > radius ? 2.0f * radius * pixelsPerUnit / distance : INFINITY;
+		for (auto& meshTexture : mesh.getTextures()) {
+			auto found = m_textureIndices.find(meshTexture.textureId);
+			if (found == m_textureIndices.end()) {
+				continue;
+			}
+			auto& texture = m_textures[found->second];
+			auto& base = texture.levels[0];
+			float texels = static_cast<float>(std::max(base.width, base.height));
+			uint32_t level = 0;
+			if (pixels < texels) {
+				level = static_cast<uint32_t>(std::max(0.0f, std::floor(std::log2(texels / std::max(pixels, 1.0f)))));
+			}
+			texture.requestedLevel = std::min(texture.requestedLevel, level);
+		}
+	}
+}
+
+size_t TextureStreamer::bytesFrom(const StreamedTexture& texture, uint32_t level) const {
+	size_t bytes = 0;
+	for (auto i = level; i < texture.levels.size(); i++) {
+		bytes += texture.levels[i].texels.size();
+	}
+	return bytes;
+}
+
+void TextureStreamer::applyBudget() {
+	size_t total = 0;
+	for (auto& texture : m_textures) {
+		texture.wantedLevel = texture.requestedLevel;
+		total += bytesFrom(texture, texture.wantedLevel);
+	}
+
+	// Drop the largest wanted level in the scene until everything fits. Each step at least halves
+	// that texture's footprint, so few steps are needed; coarse levels are never dropped.
+	while (total > m_budgetBytes) {
+		StreamedTexture* largest = nullptr;
+		for (auto& texture : m_textures) {
+			if (texture.wantedLevel < texture.coarseLevel && (largest == nullptr
+				|| texture.levels[texture.wantedLevel].texels.size() > largest->levels[largest->wantedLevel].texels.size())) {
+				largest = &texture;
+			}
+		}
+		if (largest == nullptr) {
+			break;
+		}
+		total -= largest->levels[largest->wantedLevel].texels.size();
+		++largest->wantedLevel;
+	}
+}
+
+void TextureStreamer::loadLevel(StreamedTexture& texture, uint32_t level) {
+	auto& mip = texture.levels[level];
+	glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+		mip.texels.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	texture.residentLevel = level;
+	++m_stats.levelsLoaded;
+}
+
+void TextureStreamer::evictTo(StreamedTexture& texture, uint32_t level) {
+	// Stop sampling the levels before freeing them, so the texture is never incomplete.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	for (auto i = texture.residentLevel; i < level; i++) {
+		glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		++m_stats.levelsEvicted;
+	}
+	texture.residentLevel = level;
+}
+
+void TextureStreamer::update() {
+	applyBudget();
+
+	// Evict first, so that the memory is free before anything new is loaded.
+	for (auto& texture : m_textures) {
+		if (texture.residentLevel < texture.wantedLevel) {
+			glBindTexture(GL_TEXTURE_2D, texture.textureId);
+			evictTo(texture, texture.wantedLevel);
+		}
+	}
+
+	// Load one level per texture per pass, coarse to fine, so that every texture sharpens a little
+	// each frame instead of one texture taking the whole upload allowance. The first upload of a
+	// frame always goes ahead, so levels larger than the allowance still load eventually.
+	size_t uploaded = 0;
+	bool progress = true;
+	while (progress) {
+		progress = false;
+		for (auto& texture : m_textures) {
+			if (texture.residentLevel <= texture.wantedLevel) {
+				continue;
+			}
+			size_t bytes = texture.levels[texture.residentLevel - 1].texels.size();
+			if (uploaded > 0 && uploaded + bytes > m_uploadBytesPerFrame) {
+				continue;
+			}
+			glBindTexture(GL_TEXTURE_2D, texture.textureId);
+			loadLevel(texture, texture.residentLevel - 1);
+			uploaded += bytes;
+			progress = true;
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+TextureStreamingStats TextureStreamer::stats() const {
+	TextureStreamingStats stats = m_stats;
+	stats.textures = static_cast<uint32_t>(m_textures.size());
+	stats.residentBytes = 0;
+	stats.fullBytes = 0;
+	stats.pendingTextures = 0;
+	stats.budgetLimitedTextures = 0;
+	for (auto& texture : m_textures) {
+		stats.residentBytes += bytesFrom(texture, texture.residentLevel);
+		stats.fullBytes += bytesFrom(texture, 0);
+		if (texture.residentLevel > texture.wantedLevel) {
+			++stats.pendingTextures;
+		}
+		if (texture.wantedLevel > texture.requestedLevel) {
+			++stats.budgetLimitedTextures;
+		}
+	}
+	return stats;
+}
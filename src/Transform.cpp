@@ -0,0 +1,79 @@
+#include "Transform.h"
+#include <algorithm>
+#include <cmath>
+
+Transform::Transform() : translation(0), rotation(1, 0, 0, 0), scale(1), pivot(0) {
+}
+
+glm::quat Transform::eulerToQuat(const glm::vec3& euler) {
+	return glm::angleAxis(euler.z, glm::vec3(0, 0, 1))
+		* glm::angleAxis(euler.x, glm::vec3(1, 0, 0))
+		* glm::angleAxis(euler.y, glm::vec3(0, 1, 0));
+}
+
+glm::vec3 Transform::quatToEuler(const glm::quat& rotation) {
+	// For R = Rz * Rx * Ry: R[row 2][col 1] = sin(x), and the rest of row 2 and column 1 give y
+	// and z. glm matrices are indexed [column][row].
+	glm::mat3 r = glm::mat3_cast(rotation);
+	float sinX = std::clamp(r[1][2], -1.0f, 1.0f);
+	float x = std::asin(sinX);
+	if (std::abs(sinX) > 0.9999f) {
+		// Gimbal lock: only the sum of y and z is known, so put all of it in z.
+		return glm::vec3(x, 0, std::atan2(r[0][1], r[0][0]));
+	}
+	return glm::vec3(x, std::atan2(-r[0][2], r[2][2]), std::atan2(-r[1][0], r[1][1]));
+}
+
+glm::mat4 Transform::toMatrix() const {
+	glm::mat3 r = glm::mat3_cast(rotation);
+	glm::mat4 m(1);
+	m[0] = glm::vec4(r[0] * scale.x, 0);
+	m[1] = glm::vec4(r[1] * scale.y, 0);
+	m[2] = glm::vec4(r[2] * scale.z, 0);
+	glm::vec3 linearPivot = glm::mat3(m) * pivot;
+	m[3] = glm::vec4(translation + pivot * scale - linearPivot, 1);
+	return m;
+}
+
+glm::mat4 Transform::inverseMatrix() const {
+	// The inverse of R * S is S^-1 * R^T: the rows of R, divided by the scale.
+	glm::mat3 rt = glm::transpose(glm::mat3_cast(rotation));
+	glm::vec3 inverseScale = 1.0f / scale;
+	glm::mat4 m(1);
+	for (int column = 0; column < 3; column++) {
+		m[column] = glm::vec4(rt[column] * inverseScale, 0);
+	}
+	glm::vec3 forward = translation + pivot * scale - glm::mat3_cast(rotation) * (pivot * scale);
+	m[3] = glm::vec4(-(glm::mat3(m) * forward), 1);
+	return m;
+}
+
+glm::mat3 Transform::normalMatrix() const {
+	glm::mat3 r = glm::mat3_cast(rotation);
+	return glm::mat3(r[0] / scale.x, r[1] / scale.y, r[2] / scale.z);
+}
+
+Transform Transform::interpolate(const Transform& a, const Transform& b, float t) {
+	Transform result;
+	result.translation = glm::mix(a.translation, b.translation, t);
+	result.rotation = glm::slerp(a.rotation, b.rotation, t);
+	result.scale = glm::mix(a.scale, b.scale, t);
+	result.pivot = glm::mix(a.pivot, b.pivot, t);
+	return result;
+}
+
+glm::mat4 inverseAffine(const glm::mat4& m) {
+	glm::mat3 inverseLinear = glm::inverse(glm::mat3(m));
+	glm::mat4 result(inverseLinear);
+	result[3] = glm::vec4(-(inverseLinear * glm::vec3(m[3])), 1);
+	return result;
+}
+
+glm::mat3 normalMatrix(const glm::mat4& model) {
+	// The inverse transpose of a 3x3 matrix with columns (a, b, c) has columns
+	// (b x c, c x a, a x b) / det.
+	glm::vec3 a(model[0]), b(model[1]), c(model[2]);
+	glm::vec3 bc = glm::cross(b, c);
+	float inverseDet = 1.0f / glm::dot(a, bc);
+	return glm::mat3(bc * inverseDet, glm::cross(c, a) * inverseDet, glm::cross(a, b) * inverseDet);
+}
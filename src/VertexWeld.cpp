@@ -0,0 +1,60 @@
+#include "VertexWeld.h"
+#include "Mesh3D.h"
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+	typedef std::array<int64_t, 8> VertexKey;
+
+	struct VertexKeyHash {
+		size_t operator()(const VertexKey& key) const {
+			uint64_t hash = 14695981039346656037ull;
+			for (auto value : key) {
+				hash = (hash ^ static_cast<uint64_t>(value)) * 1099511628211ull;
+			}
+			return static_cast<size_t>(hash ^ (hash >> 32));
+		}
+	};
+
+	int64_t keyOf(float value, float step) {
+		if (step > 0) {
+			return static_cast<int64_t>(std::llround(value / step));
+		}
+		// Adding zero turns -0 into +0, so that the two compare equal as bits, as they do as floats.
+		value += 0.0f;
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+}
+
+size_t weldVertices(std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces, const WeldTolerance& tolerance) {
+	auto before = vertices.size();
+	std::unordered_map<VertexKey, uint32_t, VertexKeyHash> welded;
+	welded.reserve(vertices.size());
+	// Maps every original vertex to its welded one, once the index buffer has referenced it.
+	const uint32_t UNASSIGNED = UINT32_MAX;
+	std::vector<uint32_t> remap(vertices.size(), UNASSIGNED);
+	std::vector<Vertex3D> weldedVertices;
+	weldedVertices.reserve(vertices.size());
+
+	for (auto& index : faces) {
+		auto& mapped = remap[index];
+		if (mapped == UNASSIGNED) {
+			auto& v = vertices[index];
+			VertexKey key = { keyOf(v.x, tolerance.position), keyOf(v.y, tolerance.position),
+				keyOf(v.z, tolerance.position), keyOf(v.nx, tolerance.normal), keyOf(v.ny, tolerance.normal),
+				keyOf(v.nz, tolerance.normal), keyOf(v.u, tolerance.texCoord), keyOf(v.v, tolerance.texCoord) };
+			auto inserted = welded.insert(std::make_pair(key, static_cast<uint32_t>(weldedVertices.size())));
+			if (inserted.second) {
+				weldedVertices.push_back(v);
+			}
+			mapped = inserted.first->second;
+		}
+		index = mapped;
+	}
+	vertices = std::move(weldedVertices);
+	return before;
+}
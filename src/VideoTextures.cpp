@@ -0,0 +1,282 @@
+#include "VideoTextures.h"
+#include "Frustum.h"
+#include <glad/glad.h>
+#include <algorithm>
+
+namespace {
+	size_t frameBytes(const MjpegVideo& source, uint32_t reduction) {
+		return static_cast<size_t>(MjpegVideo::reducedSize(source.width(), reduction))
+			* MjpegVideo::reducedSize(source.height(), reduction) * 4;
+	}
+}
+
+VideoTextures::VideoTextures(uint32_t workerThreads, uint32_t ringSize, size_t uploadBytesPerUpdate)
+	: m_ringSize(std::max(1u, ringSize)), m_uploadBytesPerUpdate(uploadBytesPerUpdate), m_nextUploadVideo(0),
+	m_stopping(false) {
+	for (uint32_t i = 0; i < std::max(1u, workerThreads); i++) {
+		m_workers.emplace_back(&VideoTextures::work, this);
+	}
+}
+
+VideoTextures::~VideoTextures() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+	for (auto& video : m_videos) {
+		for (auto& slot : video->slots) {
+			if (slot.mapped != nullptr) {
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			}
+			glDeleteBuffers(1, &slot.buffer);
+		}
+		glDeleteTextures(1, &video->texture);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+uint32_t VideoTextures::addVideo(const std::string& path, float frameRate) {
+	auto video = std::make_unique<Video>();
+	video->source = std::make_unique<MjpegVideo>(path, frameRate);
+	auto& source = *video->source;
+
+	glGenTextures(1, &video->texture);
+	glBindTexture(GL_TEXTURE_2D, video->texture);
+	// Frames change too often to be worth mipmapping.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	std::vector<uint8_t> black(frameBytes(source, 1), 0);
+	for (size_t i = 3; i < black.size(); i += 4) {
+		black[i] = 255;
+	}
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, source.width(), source.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, black.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+	video->textureReduction = 1;
+
+	// Every buffer of the ring holds a full-resolution frame, whatever the reduction of its frames.
+	video->slots.resize(m_ringSize);
+	for (auto& slot : video->slots) {
+		glGenBuffers(1, &slot.buffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, black.size(), nullptr, GL_STREAM_DRAW);
+		slot.mapped = nullptr;
+		slot.state = SlotState::Free;
+		slot.frame = 0;
+		slot.reduction = 1;
+		slot.staleAfter = 0;
+		slot.decoded = false;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	video->center = glm::vec3(0);
+	video->radius = 0;
+	video->time = 0;
+	video->targetFrame = 0;
+	video->anyRequested = false;
+	video->requestedFrame = 0;
+	video->anyShown = false;
+	video->shownFrame = 0;
+	video->step = 1;
+	video->reduction = 1;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_videos.push_back(std::move(video));
+	return static_cast<uint32_t>(m_videos.size() - 1);
+}
+
+void VideoTextures::setBounds(uint32_t video, const glm::vec3& center, float radius) {
+	m_videos[video]->center = center;
+	m_videos[video]->radius = radius;
+}
+
+void VideoTextures::work() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_wake.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+		if (m_stopping) {
+			return;
+		}
+		auto job = m_jobs.front();
+		m_jobs.pop_front();
+		auto& video = *job.video;
+		auto& slot = video.slots[job.slot];
+		uint64_t frame = slot.frame;
+		uint32_t reduction = slot.reduction;
+		uint64_t staleAfter = slot.staleAfter;
+		uint8_t* output = slot.mapped;
+		lock.unlock();
+
+		// The slot stays mapped and owned by this thread until it is marked ready.
+		bool decoded = video.targetFrame.load() <= staleAfter
+			&& video.source->decode(static_cast<uint32_t>(frame % video.source->frameCount()), reduction, output);
+
+		lock.lock();
+		slot.decoded = decoded;
+		slot.state = SlotState::Ready;
+		if (decoded) {
+			++m_stats.framesDecoded;
+		}
+	}
+}
+
+void VideoTextures::release(Slot& slot) {
+	// A slot that was never uploaded keeps its mapping for the next frame decoded into it.
+	slot.state = SlotState::Free;
+	++m_stats.framesDropped;
+}
+
+void VideoTextures::uploadReady(size_t& budgetUsed) {
+	for (size_t n = 0; n < m_videos.size(); n++) {
+		auto& video = *m_videos[(m_nextUploadVideo + n) % m_videos.size()];
+		// The newest decoded frame supersedes any older ones.
+		Slot* newest = nullptr;
+		for (auto& slot : video.slots) {
+			if (slot.state != SlotState::Ready) {
+				continue;
+			}
+			if (!slot.decoded) {
+				release(slot);
+			}
+			else if (newest == nullptr || slot.frame > newest->frame) {
+				if (newest != nullptr) {
+					release(*newest);
+				}
+				newest = &slot;
+			}
+			else {
+				release(slot);
+			}
+		}
+		if (newest == nullptr) {
+			continue;
+		}
+		if (video.anyShown && newest->frame <= video.shownFrame) {
+			release(*newest);
+			continue;
+		}
+		size_t bytes = frameBytes(*video.source, newest->reduction);
+		if (budgetUsed > 0 && budgetUsed + bytes > m_uploadBytesPerUpdate) {
+			// Left for the next update, unless a newer frame supersedes it first.
+			continue;
+		}
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, newest->buffer);
+		// Unmapping fails if the buffer's contents were lost (a mode switch, say).
+		bool intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+		newest->mapped = nullptr;
+		newest->state = SlotState::Free;
+		if (!intact) {
+			++m_stats.framesDropped;
+			continue;
+		}
+		auto width = MjpegVideo::reducedSize(video.source->width(), newest->reduction);
+		auto height = MjpegVideo::reducedSize(video.source->height(), newest->reduction);
+		glBindTexture(GL_TEXTURE_2D, video.texture);
+		if (newest->reduction != video.textureReduction) {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			video.textureReduction = newest->reduction;
+		}
+		// Sourced from the bound pixel buffer, so the copy doesn't stall this thread.
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		budgetUsed += bytes;
+		video.shownFrame = newest->frame;
+		video.anyShown = true;
+		++m_stats.framesUploaded;
+	}
+	// Rotate which video goes first, so that a tight budget doesn't starve the last ones.
+	if (!m_videos.empty()) {
+		m_nextUploadVideo = (m_nextUploadVideo + 1) % m_videos.size();
+	}
+}
+
+void VideoTextures::requestNext(Video& video) {
+	uint64_t target = video.targetFrame.load();
+	uint64_t wanted = target - target % video.step;
+	if (video.anyRequested && wanted <= video.requestedFrame) {
+		return;
+	}
+	auto free = std::find_if(video.slots.begin(), video.slots.end(),
+		[](const Slot& slot) { return slot.state == SlotState::Free; });
+	if (free == video.slots.end()) {
+		// Every buffer is still decoding or waiting to upload; the frames that pass meanwhile are
+		// counted as dropped by the next request.
+		return;
+	}
+	if (free->mapped == nullptr) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, free->buffer);
+		// Invalidating lets the driver hand out fresh memory if the GPU still reads the old data.
+		free->mapped = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+			frameBytes(*video.source, 1), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+		if (free->mapped == nullptr) {
+			return;
+		}
+	}
+	if (video.anyRequested) {
+		uint64_t passed = (wanted - video.requestedFrame) / video.step;
+		if (passed > 1) {
+			m_stats.framesDropped += passed - 1;
+		}
+	}
+	free->frame = wanted;
+	free->reduction = video.reduction;
+	free->staleAfter = wanted + static_cast<uint64_t>(m_ringSize) * video.step;
+	free->decoded = false;
+	free->state = SlotState::Decoding;
+	video.requestedFrame = wanted;
+	video.anyRequested = true;
+	m_jobs.push_back(DecodeJob{ &video, static_cast<uint32_t>(free - video.slots.begin()) });
+	m_wake.notify_one();
+}
+
+void VideoTextures::update(float dt, const glm::mat4& viewProjection, const glm::vec3& cameraPos) {
+	auto frustum = Frustum::fromMatrix(viewProjection);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.fullRateVideos = 0;
+	m_stats.reducedVideos = 0;
+	for (auto& video : m_videos) {
+		if (!frustum.intersectsSphere(video->center, video->radius)) {
+			video->step = 4;
+			video->reduction = 4;
+		}
+		else if (glm::distance(video->center, cameraPos) - video->radius > REDUCED_DISTANCE) {
+			video->step = 2;
+			video->reduction = 2;
+		}
+		else {
+			video->step = 1;
+			video->reduction = 1;
+		}
+		if (video->step == 1) {
+			++m_stats.fullRateVideos;
+		}
+		else {
+			++m_stats.reducedVideos;
+		}
+		video->time += dt;
+		video->targetFrame = static_cast<uint64_t>(video->time * video->source->frameRate());
+	}
+
+	size_t budgetUsed = 0;
+	uploadReady(budgetUsed);
+	for (auto& video : m_videos) {
+		requestNext(*video);
+	}
+	m_stats.bytesUploadedLastUpdate = budgetUsed;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+VideoTextureStats VideoTextures::stats() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto stats = m_stats;
+	stats.videos = static_cast<uint32_t>(m_videos.size());
+	return stats;
+}
@@ -0,0 +1,165 @@
+#include "VisibilityBuffer.h"
+#include "FullscreenTriangle.h"
+#include "Mesh3D.h"
+#include "Transform.h"
+#include <glad/glad.h>
+#include <algorithm>
+
+namespace {
+	// Texture units used by the resolve pass, above those used by mesh textures.
+	const int32_t VISIBILITY_UNIT = 8;
+	const int32_t VERTEX_DATA_UNIT = 9;
+	const int32_t INDEX_DATA_UNIT = 10;
+
+	uint32_t createTarget(GLenum internalFormat, uint32_t width, uint32_t height, GLenum format, GLenum type) {
+		uint32_t texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+		// Integer and depth targets are only ever read with texelFetch.
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		return texture;
+	}
+}
+
+VisibilityBuffer::VisibilityBuffer()
+	: m_width(0), m_height(0), m_visibilityTexture(0), m_depthTexture(0), m_visibilityFramebuffer(0),
+	m_colorTexture(0), m_materialDepthTexture(0), m_resolveFramebuffer(0),
+	m_ambientColor(0), m_directionalLight(0, 0, -1), m_directionalColor(1), m_viewPos(0) {
+	m_visibilityProgram.load("shaders/vis_buffer.vert", "shaders/vis_buffer.frag");
+	m_classifyProgram.load("shaders/fullscreen.vert", "shaders/vis_classify.frag");
+	m_resolveProgram.load("shaders/vis_resolve.vert", "shaders/vis_resolve.frag");
+	m_compositeProgram.load("shaders/fullscreen.vert", "shaders/vis_composite.frag");
+}
+
+void VisibilityBuffer::setLighting(const glm::vec3& ambientColor, const glm::vec3& directionalLight,
+	const glm::vec3& directionalColor, const glm::vec3& viewPos) {
+	m_ambientColor = ambientColor;
+	m_directionalLight = directionalLight;
+	m_directionalColor = directionalColor;
+	m_viewPos = viewPos;
+}
+
+void VisibilityBuffer::resize(uint32_t width, uint32_t height) {
+	if (m_visibilityTexture != 0) {
+		uint32_t textures[] = { m_visibilityTexture, m_depthTexture, m_colorTexture, m_materialDepthTexture };
+		glDeleteTextures(4, textures);
+		uint32_t framebuffers[] = { m_visibilityFramebuffer, m_resolveFramebuffer };
+		glDeleteFramebuffers(2, framebuffers);
+	}
+	m_width = width;
+	m_height = height;
+
+	m_visibilityTexture = createTarget(GL_RG32UI, width, height, GL_RG_INTEGER, GL_UNSIGNED_INT);
+	m_depthTexture = createTarget(GL_DEPTH_COMPONENT24, width, height, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT);
+	glGenFramebuffers(1, &m_visibilityFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_visibilityFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_visibilityTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+
+	m_colorTexture = createTarget(GL_RGBA8, width, height, GL_RGBA, GL_UNSIGNED_BYTE);
+	m_materialDepthTexture = createTarget(GL_DEPTH_COMPONENT32F, width, height, GL_DEPTH_COMPONENT, GL_FLOAT);
+	glGenFramebuffers(1, &m_resolveFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_resolveFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_materialDepthTexture, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void VisibilityBuffer::render(const std::vector<MeshDraw>& draws, const glm::mat4& view,
+	const glm::mat4& projection, uint32_t width, uint32_t height) {
+	if (width == 0 || height == 0) {
+		return;
+	}
+	int32_t sceneFramebuffer;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &sceneFramebuffer);
+	if (width != m_width || height != m_height) {
+		resize(width, height);
+	}
+	auto drawCount = static_cast<uint32_t>(std::min<size_t>(draws.size(), MAX_VISIBILITY_DRAWS));
+
+	int32_t previousProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+
+	// 1. Visibility: rasterize draw and triangle IDs.
+	glBindFramebuffer(GL_FRAMEBUFFER, m_visibilityFramebuffer);
+	const uint32_t noDraw[] = { 0, 0, 0, 0 };
+	const float farDepth = 1.0f;
+	glClearBufferuiv(GL_COLOR, 0, noDraw);
+	glClearBufferfv(GL_DEPTH, 0, &farDepth);
+	m_visibilityProgram.activate();
+	m_visibilityProgram.setUniform("view", view);
+	m_visibilityProgram.setUniform("projection", projection);
+	for (uint32_t i = 0; i < drawCount; i++) {
+		m_visibilityProgram.setUniform("model", draws[i].model);
+		m_visibilityProgram.setUniform("drawId", i);
+		draws[i].mesh->renderGeometry();
+	}
+
+	glActiveTexture(GL_TEXTURE0 + VISIBILITY_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_visibilityTexture);
+
+	// 2. Classify: turn every pixel's draw ID into a material depth.
+	glBindFramebuffer(GL_FRAMEBUFFER, m_resolveFramebuffer);
+	const float black[] = { 0, 0, 0, 1 };
+	glClearBufferfv(GL_COLOR, 0, black);
+	glClearBufferfv(GL_DEPTH, 0, &farDepth);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthFunc(GL_ALWAYS);
+	m_classifyProgram.activate();
+	m_classifyProgram.setUniform("visibility", VISIBILITY_UNIT);
+	drawFullscreenTriangle();
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+	// 3. Resolve: shade each draw's pixels, and only those, once.
+	glDepthFunc(GL_EQUAL);
+	glDepthMask(GL_FALSE);
+	m_resolveProgram.activate();
+	m_resolveProgram.setUniform("visibility", VISIBILITY_UNIT);
+	m_resolveProgram.setUniform("vertexData", VERTEX_DATA_UNIT);
+	m_resolveProgram.setUniform("indexData", INDEX_DATA_UNIT);
+	m_resolveProgram.setUniform("view", view);
+	m_resolveProgram.setUniform("projection", projection);
+	m_resolveProgram.setUniform("viewportSize", glm::vec2(width, height));
+	m_resolveProgram.setUniform("ambientColor", m_ambientColor);
+	m_resolveProgram.setUniform("directionalLight", m_directionalLight);
+	m_resolveProgram.setUniform("directionalColor", m_directionalColor);
+	m_resolveProgram.setUniform("viewPos", m_viewPos);
+	for (uint32_t i = 0; i < drawCount; i++) {
+		auto& draw = draws[i];
+		m_resolveProgram.setUniform("drawId", i);
+		m_resolveProgram.setUniform("model", draw.model);
+		m_resolveProgram.setUniform("normalMatrix", normalMatrix(draw.model));
+		m_resolveProgram.setUniform("material", draw.material);
+		glActiveTexture(GL_TEXTURE0 + VERTEX_DATA_UNIT);
+		glBindTexture(GL_TEXTURE_BUFFER, draw.mesh->getVertexTexture());
+		glActiveTexture(GL_TEXTURE0 + INDEX_DATA_UNIT);
+		glBindTexture(GL_TEXTURE_BUFFER, draw.mesh->getIndexTexture());
+		draw.mesh->bindTextures(m_resolveProgram);
+		drawFullscreenTriangle();
+	}
+	glDepthMask(GL_TRUE);
+
+	// 4. Composite: copy color and scene depth to the scene's framebuffer, which may be the
+	// multisampled window and so can't be the target of a blit.
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+	glDepthFunc(GL_ALWAYS);
+	m_compositeProgram.activate();
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	m_compositeProgram.setUniform("resolvedColor", 0);
+	m_compositeProgram.setUniform("sceneDepth", 1);
+	drawFullscreenTriangle();
+	glDepthFunc(GL_LESS);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(previousProgram);
+}
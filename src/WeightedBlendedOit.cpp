@@ -0,0 +1,94 @@
+#include "WeightedBlendedOit.h"
+#include "FullscreenTriangle.h"
+#include <glad/glad.h>
+
+WeightedBlendedOit::WeightedBlendedOit()
+	: m_width(0), m_height(0), m_accumTexture(0), m_weightTexture(0), m_depthTexture(0), m_framebuffer(0),
+	m_sceneFramebuffer(0) {
+	m_compositeProgram.load("shaders/fullscreen.vert", "shaders/oit_composite.frag");
+}
+
+void WeightedBlendedOit::resize(uint32_t width, uint32_t height) {
+	if (m_framebuffer != 0) {
+		uint32_t textures[] = { m_accumTexture, m_weightTexture, m_depthTexture };
+		glDeleteTextures(3, textures);
+		glDeleteFramebuffers(1, &m_framebuffer);
+	}
+	m_width = width;
+	m_height = height;
+
+	auto createTarget = [&](GLenum internalFormat, GLenum format, GLenum type) {
+		uint32_t texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		return texture;
+	};
+	m_accumTexture = createTarget(GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+	m_weightTexture = createTarget(GL_R16F, GL_RED, GL_HALF_FLOAT);
+	// Must match the window's depth format for the depth blit in begin().
+	m_depthTexture = createTarget(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_accumTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_weightTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+	const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void WeightedBlendedOit::begin(uint32_t width, uint32_t height) {
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_sceneFramebuffer);
+	if (width != m_width || height != m_height) {
+		resize(width, height);
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_sceneFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+	// Revealage starts at 1 (nothing covers the background yet); the sums start at 0.
+	const float emptyAccum[] = { 0, 0, 0, 1 };
+	const float emptyWeight[] = { 0, 0, 0, 0 };
+	glClearBufferfv(GL_COLOR, 0, emptyAccum);
+	glClearBufferfv(GL_COLOR, 1, emptyWeight);
+
+	// Color channels add up; alpha multiplies by (1 - alpha). Applied to both targets, this also
+	// sums the weights in the R16F target.
+	glEnable(GL_BLEND);
+	glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_FALSE);
+}
+
+void WeightedBlendedOit::end() {
+	int32_t previousProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFramebuffer);
+	glDisable(GL_DEPTH_TEST);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	m_compositeProgram.activate();
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_accumTexture);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, m_weightTexture);
+	m_compositeProgram.setUniform("accumulation", 0);
+	m_compositeProgram.setUniform("weights", 1);
+	drawFullscreenTriangle();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_BLEND);
+	glDepthMask(GL_TRUE);
+	glEnable(GL_DEPTH_TEST);
+	glUseProgram(previousProgram);
+}
@@ -10,9 +10,14 @@ We now transform local space vertices to clip space using uniform matrices in th
 */
 #define _USE_MATH_DEFINES
 #include <glad/glad.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <filesystem>
+#include <fstream>
+#include <unordered_map>
 #include <math.h>
 
 #include "AssimpImport.h"
@@ -20,6 +25,32 @@ We now transform local space vertices to clip space using uniform matrices in th
 #include "Object3D.h"
 #include "Animator.h"
 #include "ShaderProgram.h"
+#include "MeshletCuller.h"
+#include "DepthPyramid.h"
+#include "VisibilityBuffer.h"
+#include "GpuTimer.h"
+#include "RenderQueue.h"
+#include "WeightedBlendedOit.h"
+#include "GpuObjectCuller.h"
+#include "TextureStreamer.h"
+#include "ImpostorBaker.h"
+#include "ImpostorRenderer.h"
+#include "HlodBuilder.h"
+#include "ReflectionProbes.h"
+#include "AntiAliasing.h"
+#include "MultiViewRenderer.h"
+#include "AmbientOcclusion.h"
+#include "ParticleSystem.h"
+#include "ParticleBenchmark.h"
+#include "TextRenderer.h"
+#include "VideoTextures.h"
+#include "ScreenRenderTargets.h"
+#include "GpuUploader.h"
+#include "AssetReloader.h"
+#include "SceneSnapshot.h"
+#include "AudioMixer.h"
+#include "AudioBenchmark.h"
+#include "ImportBenchmark.h"
 #include <SFML/Window/Event.hpp>
 #include <SFML/Window/Window.hpp>
 #include <SFML/Audio.hpp>
@@ -28,8 +59,43 @@ struct Scene {
 	ShaderProgram program;
 	std::vector<Object3D> objects;
 	std::vector<Animator> animators;
+	// Indices of the imported models, which may be drawn as impostors or merged into HLOD proxies
+	// when far away. The room itself never is.
+	std::vector<size_t> modelObjects;
+	// Indices of the UFO and of the cabinets, in the order of ARCADE_CABINETS. See findArcadeModels.
+	size_t ufoObject = 0;
+	std::vector<size_t> cabinetObjects;
 };
 
+/**
+ * @brief Objects whose bounding sphere is farther than this from the camera are drawn as impostors.
+ */
+const float IMPOSTOR_DISTANCE = 30;
+
+/**
+ * @brief Clusters whose bounding sphere is farther than this from the camera are drawn as their
+ * merged proxy.
+ */
+const float HLOD_DISTANCE = 45;
+
+/**
+ * @brief The GPU time per frame that refreshing the dynamic reflection probes may take.
+ */
+const float PROBE_BUDGET_MILLISECONDS = 1.0f;
+
+/**
+ * @brief The GPU time per frame that refreshing the render-to-texture screens may take.
+ */
+const float SCREEN_BUDGET_MILLISECONDS = 1.0f;
+
+/**
+ * @brief Where the resolved scene is cached after a full import, and where the running scene's
+ * state is saved every STATE_SAVE_SECONDS, so that a restart picks up where the last run stopped.
+ */
+const std::string SNAPSHOT_PATH = "arcade.snapshot";
+const std::string STATE_PATH = "arcade.state";
+const float STATE_SAVE_SECONDS = 2.0f;
+
 /**
  * @brief Constructs a shader program that applies the Phong reflection model.
  */
@@ -62,49 +128,431 @@ ShaderProgram texturingShader() {
 }
 
 /**
- * @brief Loads an image from the given path into an OpenGL texture.
+ * @brief Loads an image from the given path into an OpenGL texture, whose mip levels are streamed
+ * if a streamer is given.
  */
-Texture loadTexture(const std::filesystem::path& path, const std::string& samplerName = "baseTexture") {
+Texture loadTexture(const std::filesystem::path& path, const std::string& samplerName = "baseTexture",
+	TextureStreamer* streamer = nullptr) {
 	StbImage i;
 	i.loadFromFile(path.string());
-	return Texture::loadImage(i, samplerName);
+	return streamer != nullptr ? streamer->load(i, samplerName) : Texture::loadImage(i, samplerName);
+}
+
+/**
+ * @brief How an arcade cabinet stands in the room.
+ */
+struct CabinetPlacement {
+	// The folder of the cabinet's model, which may also hold its attract sound, video and screen.
+	std::string folder;
+	glm::vec3 position;
+	float scale;
+	// Counterclockwise turn around the vertical axis, in radians.
+	float yaw;
+};
+
+/**
+ * @brief Where arcadeScene places each cabinet. Every cabinet's model is "scene.gltf" in its folder.
+ */
+const std::vector<CabinetPlacement> ARCADE_CABINETS = {
+	{ "models/pacman", glm::vec3(-35, -10, -35), 0.14f, glm::pi<float>() / 4 },
+	{ "models/finalFight", glm::vec3(-10, -10, -40), 13.5f, 0 },
+	{ "models/streetFighter", glm::vec3(8, 5, -30), 16, glm::pi<float>() / 6 },
+	{ "models/pixelPoro", glm::vec3(37, -10, -34), 3.5f, -glm::pi<float>() / 4 },
+	{ "models/kirby", glm::vec3(40, -10, -12), 1, -glm::pi<float>() / 2 },
+	{ "models/cyberSwing", glm::vec3(40, -10, 10), 1.1f, 0 },
+	{ "models/ddr", glm::vec3(82, -10, -12), 4, -3 * glm::pi<float>() / 4 },
+	{ "models/diablo", glm::vec3(12, 0, 40), 14, glm::pi<float>() / 2 },
+	{ "models/rune", glm::vec3(-5, -10, 40), 0.31f, 5 * glm::pi<float>() / 6 },
+	{ "models/mortalKombat", glm::vec3(-54, 3, 80), 14, 5 * glm::pi<float>() / 6 },
+	{ "models/spaceInvaders", glm::vec3(-40, 3, 15), 0.065f, glm::pi<float>() / 4 },
+	{ "models/donkeyKong", glm::vec3(-40, 0, -15), 3.5f, glm::pi<float>() / 2 },
+};
+
+const std::string UFO_MODEL = "models/ufo/scene.gltf";
+
+std::string cabinetModel(const CabinetPlacement& cabinet) {
+	return cabinet.folder + "/scene.gltf";
+}
+
+/**
+ * @brief Every model arcadeScene loads, which --compare-import-profiles imports by default.
+ */
+std::vector<std::string> arcadeModels() {
+	std::vector<std::string> models;
+	for (auto& cabinet : ARCADE_CABINETS) {
+		models.push_back(cabinetModel(cabinet));
+	}
+	models.push_back(UFO_MODEL);
+	return models;
+}
+
+/**
+ * @brief The import profile of a model: the one named in an "import.profile" file in its folder
+ * ("fast", "balanced" or "max", as suggested by --compare-import-profiles), or max if there is none.
+ */
+ImportProfile modelImportProfile(const std::filesystem::path& modelPath) {
+	auto profilePath = modelPath.parent_path() / "import.profile";
+	std::ifstream file(profilePath);
+	std::string name;
+	auto profile = ImportProfile::Max;
+	if (file >> name && !parseImportProfile(name, profile)) {
+		std::cerr << "Unknown import profile \"" << name << "\" in " << profilePath.string() << std::endl;
+	}
+	return profile;
+}
+
+/**
+ * @brief Adds the background music and every cabinet's attract sound to the mixer: a cabinet with
+ * an "attract.wav" in its model folder plays it as a positioned, looping sound.
+ */
+void addArcadeSounds(AudioMixer& mixer) {
+	AudioSourceSettings music;
+	music.spatial = false;
+	mixer.addSource("models/retroMusic.wav", music);
+
+	AudioSourceSettings attract;
+	attract.volume = 0.8f;
+	attract.referenceDistance = 4;
+	attract.maxDistance = 40;
+	for (auto& cabinet : ARCADE_CABINETS) {
+		auto path = std::filesystem::path(cabinet.folder) / "attract.wav";
+		if (std::filesystem::exists(path)) {
+			auto source = mixer.addSource(path.string(), attract);
+			mixer.setSourcePosition(source, cabinet.position);
+		}
+	}
+}
+
+/**
+ * @brief The title on a cabinet's marquee, from its model folder: "models/finalFight" becomes
+ * "FINAL FIGHT".
+ */
+std::string marqueeTitle(const std::string& folder) {
+	auto name = std::filesystem::path(folder).filename().string();
+	std::string title;
+	for (char c : name) {
+		if (std::isupper(static_cast<unsigned char>(c)) && !title.empty()) {
+			title += ' ';
+		}
+		title += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+	}
+	return title;
+}
+
+/**
+ * @brief Adds every cabinet's marquee and high-score table, floating above it and turned to face
+ * the middle of the room.
+ */
+void addCabinetText(TextRenderer& text) {
+	const char* initials[] = { "AAA", "JMS", "KRT", "ZED", "MOM", "ACE", "BOB" };
+	const glm::vec4 marqueeColor(1.0f, 0.85f, 0.2f, 1.0f);
+	const glm::vec4 scoreColor(0.6f, 0.9f, 1.0f, 1.0f);
+	const float titleHeight = 1.5f;
+	const float scoreHeight = 0.8f;
+	for (size_t i = 0; i < ARCADE_CABINETS.size(); i++) {
+		auto& position = ARCADE_CABINETS[i].position;
+		float yaw = std::atan2(-position.x, -position.z);
+		glm::mat4 facing = glm::rotate(glm::translate(glm::mat4(1), position + glm::vec3(0, 25, 0)),
+			yaw, glm::vec3(0, 1, 0));
+
+		auto title = marqueeTitle(ARCADE_CABINETS[i].folder);
+		text.addWorldText(title, glm::translate(facing,
+			glm::vec3(-SdfFont::measure(title.size(), titleHeight) / 2, 0, 0)), titleHeight, marqueeColor);
+		for (uint32_t rank = 0; rank < 5; rank++) {
+			auto score = std::to_string(90000 - rank * 15000 + static_cast<uint32_t>(i) * 1237 % 9000);
+			auto line = std::to_string(rank + 1) + ". " + initials[(i + rank) % 7] + " " + score;
+			float y = -(rank + 1.5f) * SdfFont::LINE_HEIGHT * scoreHeight;
+			text.addWorldText(line, glm::translate(facing,
+				glm::vec3(-SdfFont::measure(line.size(), scoreHeight) / 2, y, 0)), scoreHeight, scoreColor);
+		}
+	}
+}
+
+/**
+ * @brief A 1x1 square like Mesh3D::square, with its texture coordinates flipped vertically to
+ * show a texture rendered by OpenGL, whose first row is the bottom of the image.
+ */
+Mesh3D renderTargetQuad(uint32_t texture) {
+	return Mesh3D(
+		{
+			{ 0.5, 0.5, 0, 0, 0, 1, 1, 1 },    // TR
+			{ 0.5, -0.5, 0, 0, 0, 1, 1, 0 },   // BR
+			{ -0.5, -0.5, 0, 0, 0, 1, 0, 0 },  // BL
+			{ -0.5, 0.5, 0, 0, 0, 1, 0, 1 },   // TL
+		},
+		{
+			2, 1, 3,
+			3, 1, 0,
+		},
+		std::vector<Texture>{ Texture{ texture, "baseTexture" } }
+	);
+}
+
+/**
+ * @brief Gives every cabinet whose model folder has an "attract.screen" a screen, placed by one
+ * line of "x y z width height tilt": the screen's center and size in the model's space, and how
+ * far it leans back in degrees. It plays the folder's "attract.mjpg" if there is one, and a
+ * rendered game of Pong otherwise. The screen is a quad added as a child of the cabinet.
+ */
+void addCabinetScreens(VideoTextures& videos, ScreenRenderTargets& screens, Scene& scene) {
+	for (size_t i = 0; i < ARCADE_CABINETS.size(); i++) {
+		auto folder = std::filesystem::path(ARCADE_CABINETS[i].folder);
+		auto videoPath = folder / "attract.mjpg";
+		auto placementPath = folder / "attract.screen";
+		if (!std::filesystem::exists(placementPath)) {
+			continue;
+		}
+		std::ifstream placement(placementPath);
+		glm::vec3 center;
+		float width, height, tilt;
+		if (!(placement >> center.x >> center.y >> center.z >> width >> height >> tilt)) {
+			throw std::runtime_error("Malformed screen placement " + placementPath.string());
+		}
+
+		bool isVideo = std::filesystem::exists(videoPath);
+		uint32_t video = 0;
+		uint32_t liveScreen = 0;
+		uint32_t texture;
+		if (isVideo) {
+			video = videos.addVideo(videoPath.string());
+			texture = videos.texture(video);
+		}
+		else {
+			liveScreen = screens.addScreen(std::make_unique<ShaderScreenContent>("shaders/screen_pong.frag"), 512, 384);
+			texture = screens.texture(liveScreen);
+		}
+		auto screen = Object3D(std::vector<Mesh3D>{ isVideo ? Mesh3D::square({ Texture{ texture, "baseTexture" } })
+			: renderTargetQuad(texture) });
+		screen.setPosition(center);
+		screen.setScale(glm::vec3(width, height, 1));
+		screen.rotate(glm::vec3(-glm::radians(tilt), 0, 0));
+		auto& cabinet = scene.objects[scene.cabinetObjects[i]];
+		cabinet.addChild(std::move(screen));
+
+		// The cabinets don't move, so the screen's world bounds are found once.
+		std::vector<MeshDraw> draws;
+		cabinet.collectDraws(draws);
+		for (auto& draw : draws) {
+			auto& textures = draw.mesh->getTextures();
+			if (textures.size() == 1 && textures[0].textureId == texture) {
+				glm::vec3 worldCenter(draw.model[3]);
+				float radius = 0.5f * glm::length(glm::vec2(glm::length(glm::vec3(draw.model[0])),
+					glm::length(glm::vec3(draw.model[1]))));
+				if (isVideo) {
+					videos.setBounds(video, worldCenter, radius);
+				}
+				else {
+					screens.setBounds(liveScreen, worldCenter, radius);
+				}
+			}
+		}
+	}
+}
+
+/**
+ * @brief Hangs a bank of three monitors on the front wall, showing live views of the arcade from
+ * two security cameras on either side of a game of Pong. Returns the cameras, whose lighting must
+ * be set.
+ */
+std::vector<SceneCameraContent*> addMonitorWall(ScreenRenderTargets& screens, Scene& scene) {
+	const float width = 14;
+	const float height = 10.5f;
+	std::vector<SceneCameraContent*> cameras;
+	for (int32_t i = 0; i < 3; i++) {
+		std::unique_ptr<ScreenContent> content;
+		if (i == 1) {
+			content = std::make_unique<ShaderScreenContent>("shaders/screen_pong.frag");
+		}
+		else {
+			// The cameras watch from the back corners of the room.
+			auto camera = std::make_unique<SceneCameraContent>(scene.objects, glm::vec3(i == 0 ? 45 : -45, 25, 45),
+				glm::vec3(0, -5, -10), glm::radians(60.0f));
+			cameras.push_back(camera.get());
+			content = std::move(camera);
+		}
+		auto screen = screens.addScreen(std::move(content), 512, 384);
+		glm::vec3 position((i - 1) * 18.0f, 20, -49.8f);
+		auto monitor = Object3D(std::vector<Mesh3D>{ renderTargetQuad(screens.texture(screen)) });
+		monitor.setScale(glm::vec3(width, height, 1));
+		monitor.setPosition(position);
+		monitor.setMaterial(glm::vec4(1.0, 0.4, 0.1, 8)); // bright, like a lit screen
+		screens.setBounds(screen, position, 0.5f * glm::length(glm::vec2(width, height)));
+		scene.objects.push_back(std::move(monitor));
+	}
+	return cameras;
+}
+
+/**
+ * @brief Gathers the low-detail scene that reflection probes see: each HLOD proxy in place of its
+ * members, and every other object as it is. Blended meshes are left out.
+ */
+void collectProbeDraws(const Scene& scene, const std::vector<HlodCluster>& clusters, std::vector<MeshDraw>& draws) {
+	draws.clear();
+	std::vector<bool> merged(scene.objects.size());
+	for (auto& cluster : clusters) {
+		if (HlodBuilder::isCurrent(cluster, scene.objects)) {
+			cluster.proxy.collectDraws(draws);
+			for (auto member : cluster.members) {
+				merged[member] = true;
+			}
+		}
+	}
+	for (size_t i = 0; i < scene.objects.size(); i++) {
+		if (!merged[i]) {
+			scene.objects[i].collectDraws(draws);
+		}
+	}
+	draws.erase(std::remove_if(draws.begin(), draws.end(),
+		[](const MeshDraw& draw) { return draw.mesh->getAlphaMode() == AlphaMode::Blend; }), draws.end());
+}
+
+/**
+ * @brief Adds the arcade's particle effects: sparks rising from every cabinet, a slow glow around
+ * the UFO, and confetti raining over every fourth cabinet.
+ */
+void addArcadeEffects(ParticleSystem& particles, const Scene& scene) {
+	ParticleEmitterSettings sparks;
+	sparks.offset = glm::vec3(0, 8, 0);
+	sparks.spread = 0.5f;
+	sparks.speed = 6;
+	sparks.rate = 400;
+	sparks.lifetime = 1.5f;
+	sparks.startColor = glm::vec4(1, 0.8f, 0.3f, 1);
+	sparks.endColor = glm::vec4(1, 0.2f, 0, 0);
+	sparks.startSize = 0.08f;
+	sparks.endSize = 0.02f;
+
+	ParticleEmitterSettings glow;
+	glow.direction = glm::vec3(0, -1, 0);
+	glow.spread = 2;
+	glow.speed = 1;
+	glow.rate = 200;
+	glow.lifetime = 5;
+	glow.gravity = glm::vec3(0);
+	glow.drag = 0.2f;
+	glow.startColor = glm::vec4(0.3f, 1, 0.5f, 0.4f);
+	glow.endColor = glm::vec4(0.1f, 0.4f, 1, 0);
+	glow.startSize = 0.6f;
+	glow.endSize = 1.2f;
+
+	ParticleEmitterSettings confetti;
+	confetti.offset = glm::vec3(0, 14, 0);
+	confetti.spread = 1.5f;
+	confetti.speed = 3;
+	confetti.rate = 150;
+	confetti.lifetime = 3;
+	confetti.gravity = glm::vec3(0, -3, 0);
+	confetti.drag = 0.8f;
+	confetti.startColor = glm::vec4(1);
+	confetti.endColor = glm::vec4(1, 1, 1, 0.8f);
+	confetti.startSize = 0.12f;
+	confetti.endSize = 0.12f;
+	confetti.colorVariation = 1;
+	confetti.blend = ParticleBlend::Alpha;
+
+	particles.addEmitter(scene.objects[scene.ufoObject], glow);
+	for (size_t i = 0; i < scene.cabinetObjects.size(); i++) {
+		auto& cabinet = scene.objects[scene.cabinetObjects[i]];
+		particles.addEmitter(cabinet, sparks);
+		if (i % 4 == 3) {
+			particles.addEmitter(cabinet, confetti);
+		}
+	}
+}
+
+/**
+ * @brief The views of an installation in the window: three wall screens across the top two thirds,
+ * which together show a panorama around the camera, and a kiosk view of the room from above
+ * along the bottom.
+ */
+std::vector<RenderView> installationViews(const glm::vec3& cameraPos, const glm::vec3& cameraFront,
+	const glm::vec3& cameraUp, uint32_t width, uint32_t height) {
+	std::vector<RenderView> views;
+	int32_t wallWidth = width / 3;
+	int32_t wallHeight = height * 2 / 3;
+	float wallAspect = static_cast<float>(wallWidth) / wallHeight;
+	// Each wall screen covers 60 degrees horizontally.
+	float wallFovY = 2 * atan(tan(glm::radians(30.0f)) / wallAspect);
+	for (int32_t i = 0; i < 3; i++) {
+		glm::vec3 front = glm::vec3(glm::rotate(glm::mat4(1), glm::radians(60.0f * (1 - i)), cameraUp) * glm::vec4(cameraFront, 0));
+		views.push_back(RenderView{ glm::lookAt(cameraPos, cameraPos + front, cameraUp),
+			glm::perspective(wallFovY, wallAspect, 0.1f, 100.0f), cameraPos,
+			glm::ivec4(i * wallWidth, height - wallHeight, wallWidth, wallHeight), 0 });
+	}
+	glm::vec3 kioskPos(0, 25, 40);
+	int32_t kioskHeight = height - wallHeight;
+	views.push_back(RenderView{ glm::lookAt(kioskPos, glm::vec3(0), glm::vec3(0, 1, 0)),
+		glm::perspective(glm::radians(45.0f), static_cast<float>(width) / std::max(1, kioskHeight), 0.1f, 100.0f),
+		kioskPos, glm::ivec4(0, 0, width, kioskHeight), 0 });
+	return views;
+}
+
+/**
+ * @brief Adds the scene's animators, once every object is in place. The scene may have been
+ * imported or restored from a snapshot.
+ */
+void addArcadeAnimators(Scene& scene) {
+	//Animator animUfo;
+	//animUfo.addAnimation(std::make_unique<RotationAnimation>(scene.objects[0], 60, glm::vec3(0, 20 * M_PI, 0)));
+
+	//scene.animators.push_back(std::move(animUfo));
+}
+
+/**
+ * @brief Finds the UFO and the cabinets among the scene's models by the file each was imported
+ * from, so that neither the order they were added in nor whether the scene was restored from a
+ * snapshot matters. Throws if one is missing.
+ */
+void findArcadeModels(Scene& scene) {
+	auto find = [&scene](const std::string& model) {
+		for (auto index : scene.modelObjects) {
+			if (scene.objects[index].getName() == model) {
+				return index;
+			}
+		}
+		throw std::runtime_error("The scene has no " + model);
+	};
+	scene.ufoObject = find(UFO_MODEL);
+	scene.cabinetObjects.clear();
+	for (auto& cabinet : ARCADE_CABINETS) {
+		scene.cabinetObjects.push_back(find(cabinetModel(cabinet)));
+	}
 }
 
-Scene arcadeScene() {
+Scene arcadeScene(AssetReloader& reloader, TextureStreamer* streamer) {
 	Scene scene{ phongLightingShader() };
 	//Scene scene{ texturingShader() };
 
 	// loading in arcade machines, 12 TOTAL
-	auto pacman = assimpLoad("models/pacman/scene.gltf", true);
-	auto finalFight = assimpLoad("models/finalFight/scene.gltf", true);
-	auto streetFighter = assimpLoad("models/streetFighter/scene.gltf", true);
-	auto pixelPoro = assimpLoad("models/pixelPoro/scene.gltf", true);
-	auto kirby = assimpLoad("models/kirby/scene.gltf", true);
-	auto cyberWing = assimpLoad("models/cyberSwing/scene.gltf", true);
-	auto ddr = assimpLoad("models/ddr/scene.gltf", true);
-	auto diablo = assimpLoad("models/diablo/scene.gltf", true);
-	auto rune = assimpLoad("models/rune/scene.gltf", true);
-	auto mortalKombat = assimpLoad("models/mortalKombat/scene.gltf", true);
-	auto spaceInvaders = assimpLoad("models/spaceInvaders/scene.gltf", true);
-	auto donkeyKong = assimpLoad("models/donkeyKong/scene.gltf", true);
-
-	auto ufo = assimpLoad("models/ufo/scene.gltf", true);
+	auto load = [&](const std::string& path) {
+		return reloader.load(path, true, streamer, modelImportProfile(path));
+	};
+	std::vector<Object3D> cabinets;
+	for (auto& placement : ARCADE_CABINETS) {
+		auto cabinet = load(cabinetModel(placement));
+		cabinet.setScale(glm::vec3(placement.scale));
+		cabinet.setPosition(placement.position);
+		cabinet.rotate(glm::vec3(0, placement.yaw, 0));
+		cabinets.push_back(std::move(cabinet));
+	}
+
+	auto ufo = load(UFO_MODEL);
 
 	// loading in floor
 	std::vector<Texture> floorTexture = {
-		loadTexture("models/arcadeFloor.jpg", "baseTexture")
+		loadTexture("models/arcadeFloor.jpg", "baseTexture", streamer)
 	};
 	auto floorMesh = Mesh3D::square(floorTexture);
 	auto floor = Object3D(std::vector<Mesh3D>{floorMesh});
 	floor.setScale(glm::vec3(100, 100, 100));
 	floor.move(glm::vec3(0, -10, 0));
 	floor.rotate(glm::vec3(-M_PI / 2, 0, 0));
-	floor.setMaterial(glm::vec4(0.8, 0.8, 0.8, 1.0)); // floor material
+	floor.setMaterial(glm::vec4(0.8, 0.8, 0.4, 32)); // glossy floor material, which reflects the probes
 
 
 	// loading in walls
 	std::vector<Texture> wallTexture = {
-		loadTexture("models/arcadeWallpaper.png", "baseTexture")
+		loadTexture("models/arcadeWallpaper.png", "baseTexture", streamer)
 	};
 	auto wallMesh = Mesh3D::square(wallTexture);
 	auto frontWall = Object3D(std::vector<Mesh3D>{wallMesh});
@@ -131,7 +579,7 @@ Scene arcadeScene() {
 
 	// loading in ceiling
 	std::vector<Texture> ceilingTexture = {
-		loadTexture("models/arcadeCeiling.jpeg", "baseTexture")
+		loadTexture("models/arcadeCeiling.jpeg", "baseTexture", streamer)
 	};
 	auto ceilingMesh = Mesh3D::square(ceilingTexture);
 	auto ceiling = Object3D(std::vector<Mesh3D>{ceilingMesh});
@@ -145,77 +593,17 @@ Scene arcadeScene() {
 	//					-50 < z < 50
 
 
-	// 1
-	pacman.setScale(glm::vec3(.14, .14, .14));
-	pacman.setPosition(glm::vec3(-35, -10, -35));
-	pacman.rotate(glm::vec3(0, M_PI / 4, 0));
-	// 2
-	finalFight.setScale(glm::vec3(13.5, 13.5, 13.5));
-	finalFight.setPosition(glm::vec3(-10, -10, -40));
-	// 3 ccw pi/6
-	streetFighter.setScale(glm::vec3(16, 16, 16));
-	streetFighter.setPosition(glm::vec3(8, 5, -30));
-	streetFighter.rotate(glm::vec3(0, M_PI / 6, 0));
-	// 4 cw pi/4
-	pixelPoro.setScale(glm::vec3(3.5, 3.5, 3.5));
-	pixelPoro.setPosition(glm::vec3(37, -10, -34));
-	pixelPoro.rotate(glm::vec3(0, -M_PI / 4, 0));
-	// 5 cw pi/2
-	// make a lil smaller
-	//kirby.setScale(glm::vec3(1.2, 1.2, 1.2));
-	kirby.setPosition(glm::vec3(40, -10, -12));
-	kirby.rotate(glm::vec3(0, -M_PI / 2, 0));
-	// 6
-	// make a tiny bit bigger
-	cyberWing.setScale(glm::vec3(1.1, 1.1, 1.1));
-	cyberWing.setPosition(glm::vec3(40, -10, 10));
-	// 7 cw 3PI / 4
-	ddr.setScale(glm::vec3(4, 4, 4));
-	ddr.move(glm::vec3(82, -10, -12));
-	ddr.rotate(glm::vec3(0, -(3 * M_PI) / 4, 0));
-	// 8 ccw pi / 2
-	diablo.setScale(glm::vec3(14, 14, 14));
-	diablo.setPosition(glm::vec3(12, 0, 40));
-	diablo.rotate(glm::vec3(0, M_PI / 2, 0));
-	// 9 ccw 5PI / 6
-	rune.setScale(glm::vec3(0.31, 0.31, 0.31));
-	rune.move(glm::vec3(-5, -10, 40));
-	rune.rotate(glm::vec3(0, (5 * M_PI) / 6, 0));
-	// 10 ccw 5PI / 6
-	mortalKombat.setScale(glm::vec3(14, 14, 14));
-	mortalKombat.setPosition(glm::vec3(-54, 3, 80));
-	mortalKombat.rotate(glm::vec3(0, (5 * M_PI) / 6, 0));
-	// 11 ccw PI / 4
-	spaceInvaders.setScale(glm::vec3(0.065, 0.065, 0.065));
-	spaceInvaders.setPosition(glm::vec3(-40, 3, 15));
-	spaceInvaders.rotate(glm::vec3(0, M_PI / 4, 0));
-	// 12 ccw PI / 2
-	donkeyKong.setScale(glm::vec3(3.5, 3.5, 3.5));
-	donkeyKong.setPosition(glm::vec3(-40, 0, -15));
-	donkeyKong.rotate(glm::vec3(0, M_PI / 2, 0));
-
 	ufo.setScale(glm::vec3(0.06, 0.06, 0.06));
 	ufo.move(glm::vec3(0, 20, 0));
 
 	// move machines into objects
 	scene.objects.push_back(std::move(ufo));
-	scene.objects.push_back(std::move(pacman));
-	scene.objects.push_back(std::move(finalFight));
-	scene.objects.push_back(std::move(streetFighter));
-	scene.objects.push_back(std::move(pixelPoro));
-	scene.objects.push_back(std::move(kirby));
-	scene.objects.push_back(std::move(cyberWing));
-	scene.objects.push_back(std::move(ddr));
-	scene.objects.push_back(std::move(diablo));
-	scene.objects.push_back(std::move(rune));
-	scene.objects.push_back(std::move(mortalKombat));
-	scene.objects.push_back(std::move(spaceInvaders));
-	scene.objects.push_back(std::move(donkeyKong));
-
-	//Animator animUfo;
-	//animUfo.addAnimation(std::make_unique<RotationAnimation>(scene.objects[0], 60, glm::vec3(0, 20 * M_PI, 0)));
-
-	//scene.animators.push_back(std::move(animUfo));
+	for (auto& cabinet : cabinets) {
+		scene.objects.push_back(std::move(cabinet));
+	}
+	for (size_t i = 0; i < scene.objects.size(); i++) {
+		scene.modelObjects.push_back(i);
+	}
 
 	// moving floor into scene
 	scene.objects.push_back(std::move(floor));
@@ -232,40 +620,261 @@ Scene arcadeScene() {
 }
 
 
-int main() {
+int main(int argc, char* argv[]) {
 	
 	std::cout << std::filesystem::current_path() << std::endl;
+
+	// "--mix-audio out.wav [seconds]" renders the arcade's sound from the starting camera position
+	// to a file, without opening a window or an audio device.
+	if (argc >= 3 && std::string(argv[1]) == "--mix-audio") {
+		try {
+			AudioMixer mixer;
+			addArcadeSounds(mixer);
+			mixer.setListener(glm::vec3(0, 0, 5), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+			mixer.renderToFile(argv[2], argc >= 4 ? std::stof(argv[3]) : 10.0f);
+		}
+		catch (std::runtime_error& e) {
+			std::cerr << "ERROR: " << e.what() << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	// "--audio-benchmark [voices]" reports the mixer's CPU time and memory per voice.
+	if (argc >= 2 && std::string(argv[1]) == "--audio-benchmark") {
+		try {
+			runAudioBenchmark("models/retroMusic.wav", argc >= 3 ? std::stoi(argv[2]) : 64);
+		}
+		catch (std::runtime_error& e) {
+			std::cerr << "ERROR: " << e.what() << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	// "--compare-import-profiles [models...]" times every import profile's post-process steps and
+	// checks which profiles give the same triangles as max.
+	if (argc >= 2 && std::string(argv[1]) == "--compare-import-profiles") {
+		std::vector<std::string> models(argv + 2, argv + argc);
+		runImportBenchmark(models.empty() ? arcadeModels() : models, true);
+		return 0;
+	}
+
+	// "--particle-benchmark" reports the CPU particle simulation's time with 10k to 1M particles.
+	if (argc >= 2 && std::string(argv[1]) == "--particle-benchmark") {
+		runParticleBenchmark();
+		return 0;
+	}
 	
 	// Initialize the window and OpenGL.
 	sf::ContextSettings settings;
 	settings.depthBits = 24; // Request a 24 bits depth buffer
 	settings.stencilBits = 8;  // Request a 8 bits stencil buffer
-	settings.antialiasingLevel = 2;  // Request 2 levels of antialiasing
-	settings.majorVersion = 3;
-	settings.minorVersion = 3;
+	// Request 2 levels of antialiasing, or as many as given with --msaa, to compare with FXAA and TAA.
+	settings.antialiasingLevel = 2;
+	if (argc >= 3 && std::string(argv[1]) == "--msaa") {
+		settings.antialiasingLevel = std::stoi(argv[2]);
+	}
+	// Request OpenGL 4.6, so that the GPU culling and particle paths (4.3) and the GPU draw count
+	// (4.6) can be used. SFML settles for the newest version it can create; if that isn't even 3.3,
+	// which everything else needs, ask for 3.3 explicitly.
+	settings.majorVersion = 4;
+	settings.minorVersion = 6;
 	sf::Window window(sf::VideoMode{ 1200, 800 }, "Modern OpenGL", sf::Style::Resize | sf::Style::Close, settings);
+	auto created = window.getSettings();
+	if (created.majorVersion < 3 || (created.majorVersion == 3 && created.minorVersion < 3)) {
+		settings.majorVersion = 3;
+		settings.minorVersion = 3;
+		window.create(sf::VideoMode{ 1200, 800 }, "Modern OpenGL", sf::Style::Resize | sf::Style::Close, settings);
+	}
 	
-	sf::Music backgroundMusic; // SMFL Audio
-	if (!backgroundMusic.openFromFile("models/retroMusic.wav")) {
-		std::cerr << "Error loading music file" << std::endl;
+	// Background music plays everywhere; cabinet sounds are panned and attenuated around the camera.
+	AudioMixer audioMixer;
+	try {
+		addArcadeSounds(audioMixer);
+	}
+	catch (std::runtime_error& e) {
+		std::cerr << "Error loading sounds: " << e.what() << std::endl;
 		return 1;
 	}
-
-	// play music in loop
-	backgroundMusic.setLoop(true);
-	backgroundMusic.play();
+	audioMixer.start();
 
 	gladLoadGL();
 	glEnable(GL_DEPTH_TEST);
 
-	// Inintialize scene objects.
-	auto myScene = arcadeScene();
+	// Only the mip levels that are visible on screen are kept in VRAM, within this budget. The
+	// coarse levels of every texture are always resident.
+	TextureStreamer textureStreamer(256 * 1024 * 1024);
+
+	// Inintialize scene objects. Edits to the models' files and textures are picked up while running,
+	// and their new meshes and images uploaded by a thread with a context of its own. Unless an asset
+	// has changed since, the scene is restored from the snapshot taken after the last full import
+	// instead, and its models watched for edits just the same.
+	GpuUploader gpuUploader(window.getSettings());
+	AssetReloader assetReloader(2, &gpuUploader);
+	auto sceneLoadStart = std::chrono::steady_clock::now();
+	auto sceneAssetStamp = assetStamp("models");
+	Scene myScene{ phongLightingShader() };
+	bool restoredSnapshot = false;
+	std::unordered_map<uint32_t, std::string> snapshotTexturePaths;
+	try {
+		restoredSnapshot = loadSceneSnapshot(SNAPSHOT_PATH, sceneAssetStamp, myScene.objects, myScene.modelObjects,
+			&textureStreamer, snapshotTexturePaths);
+	}
+	catch (std::runtime_error& e) {
+		std::cerr << "Ignoring scene snapshot: " << e.what() << std::endl;
+		myScene.objects.clear();
+		myScene.modelObjects.clear();
+	}
+	if (restoredSnapshot) {
+		// Each model is named after its file, and imported as arcadeScene() imports it.
+		for (auto index : myScene.modelObjects) {
+			auto& model = myScene.objects[index];
+			assetReloader.watchLoaded(model, true, &textureStreamer, modelImportProfile(model.getName()),
+				snapshotTexturePaths);
+		}
+	}
+	else {
+		myScene = arcadeScene(assetReloader, &textureStreamer);
+		try {
+			saveSceneSnapshot(SNAPSHOT_PATH, myScene.objects, myScene.modelObjects, sceneAssetStamp, &textureStreamer,
+				assetReloader.texturePaths());
+		}
+		catch (std::runtime_error& e) {
+			std::cerr << "Could not save scene snapshot: " << e.what() << std::endl;
+		}
+	}
+	std::cout << (restoredSnapshot ? "Restored scene snapshot in " : "Imported scene in ")
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sceneLoadStart).count()
+		<< " ms" << std::endl;
+	try {
+		findArcadeModels(myScene);
+	}
+	catch (std::runtime_error& e) {
+		std::cerr << "Error loading scene: " << e.what() << std::endl;
+		return 1;
+	}
+
+	// Cabinets with an attract video play it on their screen, decoded on worker threads. Other
+	// screens render their content into textures, refreshed more often the larger they appear.
+	VideoTextures videoTextures;
+	ScreenRenderTargets liveScreens;
+	std::vector<SceneCameraContent*> securityCameras;
+	SceneState sceneState;
+	bool restoredState = false;
+	try {
+		securityCameras = addMonitorWall(liveScreens, myScene);
+
+		// Pick up where the last run stopped, if it ran the same scene. The objects are put back
+		// before anything is placed, baked or merged from where they stand: cabinet screens,
+		// impostors, HLOD proxies and static reflection probes.
+		addArcadeAnimators(myScene);
+		restoredState = loadSceneState(STATE_PATH, sceneState)
+			&& sceneState.objectTransforms.size() == myScene.objects.size()
+			&& sceneState.objectMaterials.size() == myScene.objects.size()
+			&& sceneState.animators.size() == myScene.animators.size();
+		if (restoredState) {
+			for (size_t i = 0; i < myScene.objects.size(); i++) {
+				myScene.objects[i].setTransform(sceneState.objectTransforms[i]);
+				myScene.objects[i].setMaterial(sceneState.objectMaterials[i]);
+			}
+		}
+
+		addCabinetScreens(videoTextures, liveScreens, myScene);
+	}
+	catch (std::runtime_error& e) {
+		std::cerr << "Error loading videos: " << e.what() << std::endl;
+		return 1;
+	}
 	// You can directly access specific objects in the scene using references.
 	/*auto& firstObject = myScene.objects[0];*/
 
 	// Activate the shader program.
 	myScene.program.activate();
 
+	// Large imported meshes are culled per meshlet; press M to toggle it for comparison.
+	MeshletCuller meshletCuller;
+	DepthPyramid depthPyramid;
+	bool meshletCulling = true;
+
+	// Press V to switch between forward shading and the visibility buffer. The GPU time of the
+	// scene pass is reported periodically, so both paths can be compared on the same view.
+	VisibilityBuffer visibilityBuffer;
+	bool visibilityMode = false;
+	GpuTimer sceneTimer;
+	float timerReportElapsed = 0;
+
+	// Draws are bucketed by alpha mode each frame. Blended draws are sorted back to front, or,
+	// after pressing O, composited with weighted blended order-independent transparency.
+	RenderQueue renderQueue;
+	WeightedBlendedOit weightedOit;
+	bool useWeightedOit = false;
+
+	// Press T to cycle through post-process anti-aliasing: off (the window's multisampling only),
+	// FXAA, and TAA. The cost of the resolve is reported with the scene pass.
+	AntiAliasing antiAliasing;
+	GpuTimer antiAliasingTimer;
+
+	// Press K to draw an installation's several views of the scene instead of the single camera:
+	// the frame's draws are culled and sorted once for all of them.
+	MultiViewRenderer multiViewRenderer;
+	bool multiViewMode = false;
+
+	// Press J to cycle through the SSAO presets (off, low, medium, high), and U to toggle its
+	// temporal accumulation. Each preset's GPU time is averaged separately, for comparison.
+	AmbientOcclusion ambientOcclusion;
+	GpuTimer ambientOcclusionTimers[3];
+
+	// Press P to cycle the particle effects through off and about 10k, 100k and 1M particles:
+	// sparks above every cabinet, a glow around the UFO, and confetti over a few cabinets.
+	ParticleSystem particles;
+	addArcadeEffects(particles, myScene);
+	const float particleDensities[] = { 0, 1, 10, 100 };
+	uint32_t particleLevel = 0;
+	GpuTimer particleTimer;
+
+	// Press N to cycle the text overlays: off, the cabinets' marquees and score tables with a HUD,
+	// and the same plus 2000 scrolling screen-space score lines, all batched into one draw call
+	// per atlas page.
+	TextRenderer textRenderer;
+	std::cout << "SDF font: " << textRenderer.font().glyphCount() << " glyphs on "
+		<< textRenderer.font().pageCount() << " atlas pages in " << textRenderer.font().buildMilliseconds()
+		<< " ms on " << textRenderer.font().buildThreads() << " threads" << std::endl;
+	uint32_t textLevel = 0;
+	uint32_t textFrame = 0;
+
+	// Press G to cull and draw the opaque and masked instances on the GPU, with a per-frame CPU
+	// cost that depends only on the number of distinct mesh/material batches. Instances are
+	// uploaded once; after that only the transforms of objects that moved are uploaded.
+	GpuObjectCuller gpuObjectCuller;
+	bool gpuObjectCulling = false;
+	if (gpuObjectCuller.isSupported()) {
+		gpuObjectCuller.build(myScene.objects);
+		std::cout << "GPU object culling: " << gpuObjectCuller.instanceCount() << " instances in "
+			<< gpuObjectCuller.batchCount() << " batches" << std::endl;
+	}
+
+	// Press I to draw distant models as octahedral impostors, baked once at load.
+	ImpostorBaker impostorBaker;
+	ImpostorRenderer impostorRenderer;
+	std::vector<int32_t> objectImpostors(myScene.objects.size(), -1);
+	for (auto index : myScene.modelObjects) {
+		objectImpostors[index] = static_cast<int32_t>(impostorRenderer.addImpostor(
+			impostorBaker.bake(myScene.objects[index])));
+	}
+	bool useImpostors = false;
+
+	// Press H to draw distant clusters of models as one merged, simplified proxy mesh each.
+	HlodBuilder hlodBuilder;
+	auto hlodClusters = hlodBuilder.build(myScene.objects, myScene.modelObjects);
+	for (auto& cluster : hlodClusters) {
+		std::cout << "HLOD cluster of " << cluster.members.size() << " models: " << cluster.sourceTriangles
+			<< " triangles merged into " << cluster.proxyTriangles << std::endl;
+	}
+	std::vector<bool> drawnByProxy(myScene.objects.size());
+	uint32_t proxiesDrawn = 0;
+	bool useHlod = false;
+
 	// Camera parameters initialized outside of while loop to update inside for user interaction
 	glm::vec3 cameraPos(0, 0, 5);
 	glm::vec3 cameraFront(0, 0, -1); // looking down negative z at first
@@ -284,16 +893,46 @@ int main() {
 	//myScene.program.setUniform("directionalLight", directionalLight);
 	myScene.program.setUniform("directionalColor", directionalColor);
 
+	// Press R to toggle reflections. Four static probes cover the room and are baked once; the one
+	// in the middle of the room, under the UFO, is refreshed a few steps per frame.
+	ReflectionProbes reflectionProbes;
+	glm::vec3 roomMin(-50, -10, -50);
+	glm::vec3 roomMax(50, 30, 50);
+	for (float x : { -25.0f, 25.0f }) {
+		for (float z : { -25.0f, 25.0f }) {
+			reflectionProbes.addProbe(glm::vec3(x, 0, z), roomMin, roomMax, true);
+		}
+	}
+	reflectionProbes.addProbe(glm::vec3(0, 5, 0), roomMin, roomMax, false);
+	reflectionProbes.setLighting(ambientColor, directionalLight, directionalColor);
+	for (auto securityCamera : securityCameras) {
+		securityCamera->setLighting(ambientColor, directionalLight, directionalColor);
+	}
+	std::vector<MeshDraw> probeDraws;
+	collectProbeDraws(myScene, hlodClusters, probeDraws);
+	reflectionProbes.bakeStatic(probeDraws);
+	bool useReflections = false;
+
 	
 	// Ready, set, go!
 	bool running = true;
 	sf::Clock c;
 	auto last = c.getElapsedTime();
 
-	// Start the animators.
+	// Start the animators, and resume those of the last run along with its camera.
 	for (auto& anim : myScene.animators) {
 		anim.start();
 	}
+	if (restoredState) {
+		for (size_t i = 0; i < myScene.animators.size(); i++) {
+			myScene.animators[i].restore(sceneState.animators[i]);
+		}
+		cameraPos = sceneState.cameraPos;
+		yaw = sceneState.cameraYaw;
+		pitch = sceneState.cameraPitch;
+		std::cout << "Restored the state of the last run" << std::endl;
+	}
+	float stateSaveElapsed = 0;
 
 	//// set material uniforms for each object in scene
 	//for (auto& o : myScene.objects) {
@@ -309,12 +948,74 @@ int main() {
 			if (ev.type == sf::Event::Closed) {
 				running = false;
 			}
+			else if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::M) {
+				meshletCulling = !meshletCulling;
+			}
+			else if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::H) {
+				useHlod = !useHlod;
+			}
+			else if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::I) {
+				useImpostors = !useImpostors;
+			}
+			else if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::R) {
+				useReflections = !useReflections;
+			}
+			else if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::T) {
+				antiAliasing.setMode(antiAliasing.mode() == AntiAliasingMode::Off ? AntiAliasingMode::Fxaa
+					: antiAliasing.mode() == AntiAliasingMode::Fxaa ? AntiAliasingMode::Taa : AntiAliasingMode::Off);
+				antiAliasingTimer.reset();
+			}
+			else if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::K) {
+				multiViewMode = !multiViewMode;
+				sceneTimer.reset();
+				timerReportElapsed = 0;
+			}
+			else if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::J) {
+				auto next = (static_cast<int32_t>(ambientOcclusion.quality()) + 1) % 4;
+				ambientOcclusion.setQuality(static_cast<AmbientOcclusionQuality>(next));
+			}
+			else if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::U) {
+				ambientOcclusion.setTemporal(!ambientOcclusion.temporal());
+				for (auto& timer : ambientOcclusionTimers) {
+					timer.reset();
+				}
+			}
+			else if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::P) {
+				particleLevel = (particleLevel + 1) % 4;
+				if (particleLevel > 0) {
+					particles.setDensity(particleDensities[particleLevel]);
+				}
+				particleTimer.reset();
+			}
+			else if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::N) {
+				textLevel = (textLevel + 1) % 3;
+			}
+			else if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::O) {
+				useWeightedOit = !useWeightedOit;
+			}
+			else if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::G
+				&& gpuObjectCuller.isSupported()) {
+				gpuObjectCulling = !gpuObjectCulling;
+				sceneTimer.reset();
+				timerReportElapsed = 0;
+			}
+			else if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::V) {
+				visibilityMode = !visibilityMode;
+				sceneTimer.reset();
+				timerReportElapsed = 0;
+			}
 		}
 		auto now = c.getElapsedTime();
 		auto diff = now - last;
 		float dt = diff.asSeconds(); // for user interaction
 		last = now;
 
+		// Swap in models and textures reloaded since the last frame. Models whose meshes changed
+		// must be gathered again by the GPU culler, which keeps pointers to their meshes.
+		if (assetReloader.applyPending(myScene.objects) > 0 && gpuObjectCuller.isSupported()) {
+			gpuObjectCuller.build(myScene.objects);
+		}
+
 
 		// WASD input for camera movement
 		if (sf::Keyboard::isKeyPressed(sf::Keyboard::W)) { // move forward
@@ -362,13 +1063,22 @@ int main() {
 		// update view and projection matrix
 		glm::mat4 camera = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp); // position, target, and up vector = new view matrix
 		glm::mat4 perspective = glm::perspective(glm::radians(45.0), static_cast<double>(window.getSize().x) / window.getSize().y, 0.1, 100.0);
+		// TAA draws the scene with a subpixel offset that changes every frame.
+		glm::mat4 jitteredPerspective = antiAliasing.jitter(perspective);
 		
 		// give shader programs uniform inputs inside loop to update camera
 		myScene.program.setUniform("view", camera);
-		myScene.program.setUniform("projection", perspective);
+		myScene.program.setUniform("projection", jitteredPerspective);
 		//myScene.program.setUniform("cameraPos", cameraPos);
 		myScene.program.setUniform("viewPos", cameraPos);
 		myScene.program.setUniform("directionalLight", cameraFront);
+		meshletCuller.setView(camera, jitteredPerspective, cameraPos);
+		visibilityBuffer.setLighting(ambientColor, cameraFront, directionalColor, cameraPos);
+		gpuObjectCuller.setView(camera, jitteredPerspective);
+		gpuObjectCuller.setLighting(ambientColor, cameraFront, directionalColor, cameraPos);
+		impostorRenderer.setLighting(ambientColor, cameraFront, directionalColor);
+		multiViewRenderer.setLighting(ambientColor, cameraFront, directionalColor);
+		audioMixer.setListener(cameraPos, cameraFront, cameraUp);
 
 
 		// Update the scene.
@@ -376,13 +1086,259 @@ int main() {
 			anim.tick(dt);
 		}
 
+		stateSaveElapsed += dt;
+		if (stateSaveElapsed >= STATE_SAVE_SECONDS) {
+			stateSaveElapsed = 0;
+			sceneState.objectTransforms.clear();
+			sceneState.objectMaterials.clear();
+			sceneState.animators.clear();
+			for (auto& o : myScene.objects) {
+				sceneState.objectTransforms.push_back(o.getTransform());
+				sceneState.objectMaterials.push_back(o.getMaterial());
+			}
+			for (auto& anim : myScene.animators) {
+				sceneState.animators.push_back(anim.state());
+			}
+			sceneState.cameraPos = cameraPos;
+			sceneState.cameraYaw = yaw;
+			sceneState.cameraPitch = pitch;
+			try {
+				saveSceneState(STATE_PATH, sceneState);
+			}
+			catch (std::runtime_error& e) {
+				std::cerr << "Could not save scene state: " << e.what() << std::endl;
+			}
+		}
+
 		// Clear the OpenGL "context".
+		// Post-process anti-aliasing resolves a single view, so the installation's views are not
+		// anti-aliased.
+		if (!multiViewMode) {
+			antiAliasing.begin(window.getSize().x, window.getSize().y);
+		}
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		// Render the scene objects.
-		for (auto& o : myScene.objects) {
-			// object material uniforms
-			myScene.program.setUniform("material", o.getMaterial());
-			o.render(myScene.program);
+		renderQueue.clear();
+		impostorRenderer.clear();
+		std::fill(drawnByProxy.begin(), drawnByProxy.end(), false);
+		proxiesDrawn = 0;
+		if (useHlod && !gpuObjectCulling) {
+			for (auto& cluster : hlodClusters) {
+				// A proxy no longer matches once any of its members has moved.
+				if (glm::distance(cluster.center, cameraPos) - cluster.radius > HLOD_DISTANCE
+					&& HlodBuilder::isCurrent(cluster, myScene.objects)) {
+					renderQueue.submit(cluster.proxy);
+					for (auto member : cluster.members) {
+						drawnByProxy[member] = true;
+					}
+					++proxiesDrawn;
+				}
+			}
+		}
+		for (size_t i = 0; i < myScene.objects.size(); i++) {
+			auto& o = myScene.objects[i];
+			if (drawnByProxy[i]) {
+				continue;
+			}
+			// The GPU-driven path draws every instance itself, so impostors only replace forward draws.
+			if (useImpostors && !gpuObjectCulling && !multiViewMode && objectImpostors[i] >= 0) {
+				auto bounds = impostorRenderer.worldBounds(objectImpostors[i], o);
+				if (glm::distance(glm::vec3(bounds), cameraPos) - bounds.w > IMPOSTOR_DISTANCE) {
+					impostorRenderer.submit(objectImpostors[i], o);
+					continue;
+				}
+			}
+			renderQueue.submit(o);
+		}
+		MeshletCuller* culler = meshletCulling ? &meshletCuller : nullptr;
+
+		// Stream in the mip levels that this frame's draws need, before they are sampled.
+		textureStreamer.beginFrame();
+		textureStreamer.requestDraws(renderQueue.getOpaque(), camera, perspective, window.getSize().y);
+		textureStreamer.requestDraws(renderQueue.getMasked(), camera, perspective, window.getSize().y);
+		textureStreamer.requestDraws(renderQueue.getBlended(), camera, perspective, window.getSize().y);
+		textureStreamer.update();
+		videoTextures.update(dt, perspective * camera, cameraPos);
+		liveScreens.update(dt, camera, perspective, cameraPos, window.getSize().y, SCREEN_BUDGET_MILLISECONDS);
+
+		// Refresh the dynamic probes before the scene pass, which samples them.
+		if (useReflections) {
+			collectProbeDraws(myScene, hlodClusters, probeDraws);
+			reflectionProbes.update(probeDraws, PROBE_BUDGET_MILLISECONDS);
+			reflectionProbes.apply(myScene.program, cameraPos);
+		}
+		else {
+			ReflectionProbes::disable(myScene.program);
+		}
+		gpuObjectCuller.setReflectionProbes(useReflections ? &reflectionProbes : nullptr);
+		multiViewRenderer.setReflectionProbes(useReflections ? &reflectionProbes : nullptr);
+
+		sceneTimer.begin();
+		if (multiViewMode) {
+			// Every bucket, blended draws included, is drawn into every view.
+			multiViewRenderer.setViews(installationViews(cameraPos, cameraFront, cameraUp,
+				window.getSize().x, window.getSize().y));
+			multiViewRenderer.cull(renderQueue);
+			multiViewRenderer.render();
+		}
+		else {
+			if (gpuObjectCulling) {
+				gpuObjectCuller.syncTransforms(myScene.objects);
+				gpuObjectCuller.render();
+			}
+			else {
+				if (visibilityMode) {
+					visibilityBuffer.render(renderQueue.getOpaque(), camera, jitteredPerspective, window.getSize().x, window.getSize().y);
+				}
+				else {
+					RenderQueue::render(renderQueue.getOpaque(), myScene.program, culler);
+				}
+				RenderQueue::render(renderQueue.getMasked(), myScene.program, culler);
+			}
+			impostorRenderer.render(camera, jitteredPerspective, cameraPos);
+
+			if (useWeightedOit) {
+				weightedOit.begin(window.getSize().x, window.getSize().y);
+				myScene.program.setUniform("weightedOit", true);
+				RenderQueue::render(renderQueue.getBlended(), myScene.program, culler);
+				myScene.program.setUniform("weightedOit", false);
+				weightedOit.end();
+			}
+			else {
+				renderQueue.sortBlended(camera);
+				renderQueue.renderBlended(myScene.program, culler);
+			}
+		}
+		sceneTimer.end();
+
+		if (!multiViewMode && ambientOcclusion.quality() != AmbientOcclusionQuality::Off) {
+			auto& timer = ambientOcclusionTimers[static_cast<int32_t>(ambientOcclusion.quality()) - 1];
+			timer.begin();
+			ambientOcclusion.apply(camera, jitteredPerspective, window.getSize().x, window.getSize().y);
+			timer.end();
+		}
+
+		if (!multiViewMode && particleLevel > 0) {
+			particleTimer.begin();
+			particles.update(dt);
+			particles.render(camera, jitteredPerspective, cameraPos);
+			particleTimer.end();
+		}
+
+		antiAliasingTimer.begin();
+		if (!multiViewMode) {
+			antiAliasing.resolve({ &renderQueue.getOpaque(), &renderQueue.getMasked(), &renderQueue.getBlended() },
+				camera, perspective);
+		}
+		antiAliasingTimer.end();
+
+		// Text goes over the resolved image, unjittered: its distance field is already smooth.
+		if (!multiViewMode && textLevel > 0) {
+			addCabinetText(textRenderer);
+			textRenderer.addScreenText("ARCADE  " + std::to_string(static_cast<int32_t>(1 / std::max(dt, 0.001f)))
+				+ " FPS", glm::vec2(16, 16), 16, glm::vec4(1));
+			if (textLevel == 2) {
+				++textFrame;
+				for (uint32_t i = 0; i < 2000; i++) {
+					auto line = "P" + std::to_string(i + 1) + " " + std::to_string((i * 7919 + textFrame * 13) % 1000000);
+					glm::vec2 position(16 + (i / 100) * 96.0f, 48 + (i % 100) * 10.0f);
+					textRenderer.addScreenText(line, position, 6, glm::vec4(0.5f, 1.0f, 0.5f, 0.8f));
+				}
+			}
+			textRenderer.render(camera, perspective, window.getSize().x, window.getSize().y);
+		}
+
+		timerReportElapsed += dt;
+		if (timerReportElapsed >= 2) {
+			std::cout << (multiViewMode ? "multi-view" : gpuObjectCulling ? "GPU-driven"
+				: visibilityMode ? "visibility buffer" : "forward")
+				<< " scene pass: " << sceneTimer.averageMilliseconds() << " ms GPU" << std::endl;
+			if (ambientOcclusion.quality() != AmbientOcclusionQuality::Off) {
+				const char* presetNames[] = { "low", "medium", "high" };
+				std::cout << "SSAO (" << (ambientOcclusion.temporal() ? "temporal" : "no temporal") << ")";
+				for (auto i = 0; i < 3; i++) {
+					if (ambientOcclusionTimers[i].samples() > 0) {
+						std::cout << " " << presetNames[i] << ": " << ambientOcclusionTimers[i].averageMilliseconds() << " ms";
+					}
+				}
+				std::cout << " GPU" << std::endl;
+			}
+			if (particleLevel > 0) {
+				std::cout << "particles: " << particles.particleCount() << " (" << particles.gpuParticleCount()
+					<< " on the GPU), " << particleTimer.averageMilliseconds() << " ms GPU, "
+					<< particles.cpuMilliseconds() << " ms CPU" << (particles.usesSimd() ? " with SIMD" : "") << std::endl;
+				particleTimer.reset();
+			}
+			if (textLevel > 0) {
+				std::cout << "text: " << textRenderer.lastStringCount() << " strings, " << textRenderer.lastGlyphCount()
+					<< " glyphs in " << textRenderer.lastDrawCount() << " draw calls, "
+					<< textRenderer.cpuMilliseconds() << " ms CPU" << std::endl;
+			}
+			if (multiViewMode) {
+				std::cout << multiViewRenderer.views().size() << " views in " << multiViewRenderer.groupCount()
+					<< " instanced groups: " << multiViewRenderer.drawsVisible() << " of "
+					<< multiViewRenderer.drawsTested() << " draws visible, " << multiViewRenderer.viewDraws()
+					<< " view draws in " << multiViewRenderer.drawCalls() << " draw calls" << std::endl;
+			}
+			std::cout << "anti-aliasing: " << window.getSettings().antialiasingLevel << "x MSAA, "
+				<< (antiAliasing.mode() == AntiAliasingMode::Fxaa ? "FXAA"
+					: antiAliasing.mode() == AntiAliasingMode::Taa ? "TAA" : "no post-process")
+				<< " resolve: " << antiAliasingTimer.averageMilliseconds() << " ms GPU" << std::endl;
+			if (gpuObjectCulling) {
+				std::cout << "instance transforms uploaded: " << gpuObjectCuller.lastUploadCount()
+					<< " last frame, " << gpuObjectCuller.totalUploadCount() << " total" << std::endl;
+			}
+			if (useImpostors) {
+				std::cout << "impostors drawn: " << impostorRenderer.instancesDrawn() << std::endl;
+			}
+			if (useReflections) {
+				std::cout << "reflection probe steps last frame: " << reflectionProbes.lastStepCount() << std::endl;
+			}
+			if (useHlod) {
+				std::cout << "HLOD proxies drawn: " << proxiesDrawn << " of " << hlodClusters.size() << std::endl;
+			}
+			std::cout << "live screens: " << liveScreens.lastRefreshCount() << " of " << liveScreens.lastDueCount()
+				<< " due refreshed last frame, " << liveScreens.fullRateCount() << " at full rate, "
+				<< liveScreens.frozenCount() << " of " << liveScreens.screenCount() << " frozen" << std::endl;
+			auto videoStats = videoTextures.stats();
+			if (videoStats.videos > 0) {
+				std::cout << "video: " << videoStats.videos << " screens (" << videoStats.fullRateVideos
+					<< " at full rate, " << videoStats.reducedVideos << " reduced), " << videoStats.framesDecoded
+					<< " frames decoded, " << videoStats.framesUploaded << " uploaded, " << videoStats.framesDropped
+					<< " dropped, " << videoStats.bytesUploadedLastUpdate / 1024 << " KB uploaded last frame" << std::endl;
+			}
+			auto reloadStats = assetReloader.stats();
+			if (reloadStats.modelsReloaded > 0 || reloadStats.texturesReloaded > 0 || reloadStats.failures > 0) {
+				std::cout << "hot reload: " << reloadStats.modelsReloaded << " models (" << reloadStats.modelsRebuilt
+					<< " rebuilt), " << reloadStats.meshesUploaded << " meshes uploaded, " << reloadStats.meshesUnchanged
+					<< " unchanged, " << reloadStats.texturesReloaded << " textures, " << reloadStats.failures
+					<< " failed, " << reloadStats.stagedUploads << " uploading; last applied in "
+					<< reloadStats.lastApplyMilliseconds << " ms" << std::endl;
+			}
+			auto uploadStats = gpuUploader.stats();
+			if (uploadStats.buffersUploaded > 0 || uploadStats.texturesUploaded > 0) {
+				std::cout << "upload thread: " << uploadStats.buffersUploaded << " buffers, " << uploadStats.texturesUploaded
+					<< " textures, " << uploadStats.bytesUploaded / 1024 << " KB, " << uploadStats.queuedJobs << " queued, "
+					<< uploadStats.pendingFences << " awaiting fences; last job took " << uploadStats.lastJobMilliseconds
+					<< " ms" << std::endl;
+			}
+			auto textureStats = textureStreamer.stats();
+			std::cout << "textures: " << textureStats.residentBytes / (1024 * 1024) << " of "
+				<< textureStats.fullBytes / (1024 * 1024) << " MB resident (budget "
+				<< textureStats.budgetBytes / (1024 * 1024) << " MB), " << textureStats.pendingTextures
+				<< " streaming, " << textureStats.budgetLimitedTextures << " limited by budget, "
+				<< textureStats.levelsLoaded << " levels loaded, " << textureStats.levelsEvicted
+				<< " evicted" << std::endl;
+			sceneTimer.reset();
+			antiAliasingTimer.reset();
+			timerReportElapsed = 0;
+		}
+
+		// The GPU cullers test next frame's meshlets and instances against this frame's depth.
+		if (!multiViewMode && (meshletCuller.usesGpu() || gpuObjectCulling)) {
+			depthPyramid.build(window.getSize().x, window.getSize().y);
+			meshletCuller.setDepthPyramid(&depthPyramid);
+			gpuObjectCuller.setDepthPyramid(&depthPyramid);
 		}
 		window.display();
 